@@ -0,0 +1,57 @@
+#ifndef ICARUS_COMMON_ARENA_H
+#define ICARUS_COMMON_ARENA_H
+
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+
+namespace ic {
+
+// A monotonic arena from which the data structures built while compiling a
+// single module are allocated. Allocation bumps a pointer through large blocks
+// obtained from the global allocator, deallocation does nothing, and every
+// block is released at once when the arena is destroyed. An arena must not be
+// allocated from concurrently.
+//
+// Containers opt in through `std::pmr` allocators, so that the same container
+// types may be used with or without an arena. Containers constructed without a
+// memory resource use `std::pmr::get_default_resource()`, which forwards to
+// `new` and `delete`.
+struct Arena : std::pmr::monotonic_buffer_resource {
+  // Constructs an arena whose first block holds `initial_size` bytes. Later
+  // blocks grow geometrically.
+  explicit Arena(size_t initial_size)
+      : std::pmr::monotonic_buffer_resource(initial_size) {}
+
+  // Returns the initial size of an arena used to compile a source file of
+  // `source_size` bytes. The token buffer, parse tree and per-node side tables
+  // together take roughly a dozen bytes per byte of source. Pages of the first
+  // block which are never touched are never committed, so overestimating is
+  // cheap.
+  static constexpr size_t InitialSizeFor(size_t source_size) {
+    return MinimumInitialSize + BytesPerSourceByte * source_size;
+  }
+
+ private:
+  static constexpr size_t MinimumInitialSize = size_t{1} << 16;
+  static constexpr size_t BytesPerSourceByte = 16;
+};
+
+// Hash containers which may allocate from an `Arena`.
+template <typename K, typename V>
+using ArenaFlatHashMap =
+    absl::flat_hash_map<K, V, absl::Hash<K>, std::equal_to<K>,
+                        std::pmr::polymorphic_allocator<std::pair<K const, V>>>;
+template <typename K>
+using ArenaFlatHashSet =
+    absl::flat_hash_set<K, absl::Hash<K>, std::equal_to<K>,
+                        std::pmr::polymorphic_allocator<K>>;
+
+}  // namespace ic
+
+#endif  // ICARUS_COMMON_ARENA_H
@@ -0,0 +1,84 @@
+#include "common/cache_file.h"
+
+#include <unistd.h>
+
+#include <bit>
+#include <cstring>
+#include <utility>
+
+namespace ic {
+
+uint64_t SourceHash(std::string_view source) {
+  // Each step is a bijection on the state for a fixed word, so sources of the
+  // same size differing in a single word never collide.
+  constexpr uint64_t Multiplier = 0x9e3779b97f4a7c15;
+  uint64_t hash                 = source.size();
+  size_t i                      = 0;
+  for (; i + sizeof(uint64_t) <= source.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, source.data() + i, sizeof(word));
+    hash = std::rotl((hash ^ word) * Multiplier, 29);
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, source.data() + i, source.size() - i);
+  hash = (hash ^ tail) * Multiplier;
+  return hash ^ (hash >> 32);
+}
+
+void CacheFormat::add_size(size_t size) {
+  description_.append(" ").append(std::to_string(size));
+}
+
+void CacheFormat::add_name(std::string_view name) {
+  description_.append(" ").append(name);
+}
+
+std::optional<CacheFileWriter> CacheFileWriter::TryCreate(
+    nth::file_path const& path) {
+  std::string temporary_path = std::string(path.path()) + ".tmp." +
+                               std::to_string(static_cast<long>(::getpid()));
+  std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+  if (not file) { return std::nullopt; }
+  return CacheFileWriter(std::string(path.path()), std::move(temporary_path),
+                         file);
+}
+
+CacheFileWriter::CacheFileWriter(CacheFileWriter&& w)
+    : path_(std::move(w.path_)),
+      temporary_path_(std::move(w.temporary_path_)),
+      file_(std::exchange(w.file_, nullptr)),
+      ok_(w.ok_) {}
+
+CacheFileWriter& CacheFileWriter::operator=(CacheFileWriter&& w) {
+  if (this != &w) {
+    Discard();
+    path_           = std::move(w.path_);
+    temporary_path_ = std::move(w.temporary_path_);
+    file_           = std::exchange(w.file_, nullptr);
+    ok_             = w.ok_;
+  }
+  return *this;
+}
+
+CacheFileWriter::~CacheFileWriter() { Discard(); }
+
+void CacheFileWriter::write(void const* data, size_t size) {
+  ok_ = ok_ and std::fwrite(data, 1, size, file_) == size;
+}
+
+bool CacheFileWriter::Commit() {
+  bool ok = std::fclose(std::exchange(file_, nullptr)) == 0 and ok_;
+  if (ok and std::rename(temporary_path_.c_str(), path_.c_str()) == 0) {
+    return true;
+  }
+  std::remove(temporary_path_.c_str());
+  return false;
+}
+
+void CacheFileWriter::Discard() {
+  if (not file_) { return; }
+  std::fclose(std::exchange(file_, nullptr));
+  std::remove(temporary_path_.c_str());
+}
+
+}  // namespace ic
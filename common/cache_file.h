@@ -0,0 +1,83 @@
+#ifndef ICARUS_COMMON_CACHE_FILE_H
+#define ICARUS_COMMON_CACHE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "nth/io/file_path.h"
+
+namespace ic {
+
+// Returns a hash of `source` which is stable across processes.
+uint64_t SourceHash(std::string_view source);
+
+// Describes everything on which the in-memory representation of a cache file
+// depends, so that files written by a compiler disagreeing on any of it may be
+// rejected.
+struct CacheFormat {
+  // `version` is incremented whenever the layout of the cache file changes in
+  // a way not otherwise described.
+  explicit CacheFormat(uint64_t version)
+      : description_(std::to_string(version)) {}
+
+  // Describes the size of a type stored in its in-memory representation.
+  void add_size(size_t size);
+
+  // Describes an enumerator, whose `name` is prefixed to distinguish its
+  // enumeration (e.g., "p.Identifier" for a kind of parse node).
+  void add_name(std::string_view name);
+
+  // Returns a hash of the description, which is stable across processes.
+  uint64_t fingerprint() const { return SourceHash(description_); }
+
+ private:
+  std::string description_;
+};
+
+// Writes a file in full under a temporary name and then renames it, so that
+// processes sharing the file never observe a partially written one.
+struct CacheFileWriter {
+  // Creates a temporary file to be renamed to `path`, returning `std::nullopt`
+  // if it cannot be created.
+  static std::optional<CacheFileWriter> TryCreate(nth::file_path const& path);
+
+  CacheFileWriter(CacheFileWriter const&)            = delete;
+  CacheFileWriter& operator=(CacheFileWriter const&) = delete;
+  CacheFileWriter(CacheFileWriter&& w);
+  CacheFileWriter& operator=(CacheFileWriter&& w);
+  // Removes the temporary file, if it has not been committed.
+  ~CacheFileWriter();
+
+  // Appends the `size` bytes starting at `data` to the file.
+  void write(void const* data, size_t size);
+
+  // Renames the temporary file to its final path. Returns whether every write
+  // succeeded and the file was renamed; otherwise the temporary file is
+  // removed. No further writes may be made.
+  bool Commit();
+
+ private:
+  explicit CacheFileWriter(std::string path, std::string temporary_path,
+                           std::FILE* file)
+      : path_(std::move(path)),
+        temporary_path_(std::move(temporary_path)),
+        file_(file) {}
+
+  // Closes and removes the temporary file, if any.
+  void Discard();
+
+  std::string path_;
+  std::string temporary_path_;
+  // Null once the file has been committed or discarded.
+  std::FILE* file_ = nullptr;
+  bool ok_         = true;
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_COMMON_CACHE_FILE_H
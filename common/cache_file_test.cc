@@ -0,0 +1,60 @@
+#include "common/cache_file.h"
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+#include "common/mapped_file.h"
+#include "nth/test/test.h"
+
+namespace ic {
+namespace {
+
+std::optional<nth::file_path> TemporaryPath(std::string_view name) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+  std::filesystem::remove(path);
+  return nth::file_path::try_construct(path.string());
+}
+
+NTH_TEST("cache-file/commit") {
+  std::optional path = TemporaryPath("ic-cache-file-commit");
+  NTH_ASSERT(path.has_value());
+  std::optional writer = CacheFileWriter::TryCreate(*path);
+  NTH_ASSERT(writer.has_value());
+  writer->write("let x", 5);
+  // Nothing is visible at `path` until the file is committed.
+  NTH_EXPECT(not MappedFile::TryOpen(*path).has_value());
+  writer->write(" ::= 3\n", 7);
+  NTH_ASSERT(writer->Commit());
+  std::optional file = MappedFile::TryOpen(*path);
+  NTH_ASSERT(file.has_value());
+  NTH_EXPECT(file->content() == "let x ::= 3\n");
+}
+
+NTH_TEST("cache-file/discard") {
+  std::optional path = TemporaryPath("ic-cache-file-discard");
+  NTH_ASSERT(path.has_value());
+  {
+    std::optional writer = CacheFileWriter::TryCreate(*path);
+    NTH_ASSERT(writer.has_value());
+    writer->write("let x ::= 3\n", 12);
+  }
+  NTH_EXPECT(not MappedFile::TryOpen(*path).has_value());
+}
+
+NTH_TEST("cache-file/fingerprint") {
+  auto fingerprint = [](uint64_t version, size_t size, std::string_view name) {
+    CacheFormat format(version);
+    format.add_size(size);
+    format.add_name(name);
+    return format.fingerprint();
+  };
+  uint64_t f = fingerprint(1, 8, "p.Identifier");
+  NTH_EXPECT(f == fingerprint(1, 8, "p.Identifier"));
+  NTH_EXPECT(f != fingerprint(2, 8, "p.Identifier"));
+  NTH_EXPECT(f != fingerprint(1, 4, "p.Identifier"));
+  NTH_EXPECT(f != fingerprint(1, 8, "p.Declaration"));
+}
+
+}  // namespace
+}  // namespace ic
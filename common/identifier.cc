@@ -5,21 +5,13 @@
 namespace ic {
 namespace {}  // namespace
 
-Identifier::Identifier() : Identifier(std::string("")) {}
+Identifier::Identifier() : Identifier(std::string_view("")) {}
 
-Identifier::Identifier(std::string &&s) {
-  auto [iter, inserted] = internal_common::Identifiers().insert(std::move(s));
-  mutable_value()       = internal_common::Identifiers().index(iter);
+Identifier::Identifier(std::string_view s) {
+  mutable_value() = internal_common::Identifiers().index(s);
 }
 
-Identifier::Identifier(std::string const &s) {
-  auto [iter, inserted] = internal_common::Identifiers().insert(s);
-  mutable_value()       = internal_common::Identifiers().index(iter);
-}
-
-Identifier::Identifier(std::string_view s) : Identifier(std::string(s)) {}
-
-Identifier::operator std::string const &() const {
+Identifier::operator std::string_view() const {
   return internal_common::Identifiers().from_index(value());
 }
 
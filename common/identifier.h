@@ -15,8 +15,7 @@ struct Identifier : internal_constants::ConstantHandle<Identifier> {
   Identifier(char const (&s)[N])
       : Identifier(([&] { NTH_REQUIRE(s[N - 1] == '\0'); }(),
                     std::string_view(s, N - 1))) {}
-  Identifier(std::string&& s);
-  Identifier(std::string const& s);
+  Identifier(std::string const& s) : Identifier(std::string_view(s)) {}
   Identifier(std::string_view s);
 
   size_t index() const {
@@ -25,11 +24,12 @@ struct Identifier : internal_constants::ConstantHandle<Identifier> {
 
   friend void NthPrint(auto& p, auto& f, Identifier id) {
     p.write("`");
-    f(p, static_cast<std::string const&>(id));
+    f(p, static_cast<std::string_view>(id));
     p.write("`");
   }
 
-  explicit operator std::string const&() const;
+  // The returned view is valid for the lifetime of the program.
+  explicit operator std::string_view() const;
 
  private:
   friend ConstantHandle;
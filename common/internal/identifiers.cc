@@ -1,16 +1,14 @@
 #include "common/internal/identifiers.h"
 
-#include <string>
-
 #include "nth/utility/no_destructor.h"
 
 namespace ic::internal_common {
 namespace {
 
-nth::NoDestructor<nth::flyweight_set<std::string>> ids_;
+nth::NoDestructor<Interner> ids_;
 
 }  // namespace
 
-nth::flyweight_set<std::string> &Identifiers() { return *ids_; }
+Interner &Identifiers() { return *ids_; }
 
 }  // namespace ic::internal_common
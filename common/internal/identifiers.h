@@ -1,13 +1,11 @@
 #ifndef ICARUS_COMMON_INTERNAL_IDENTIFIERS_H
 #define ICARUS_COMMON_INTERNAL_IDENTIFIERS_H
 
-#include <string>
-
-#include "nth/container/flyweight_set.h"
+#include "common/interner.h"
 
 namespace ic::internal_common {
 
-nth::flyweight_set<std::string> &Identifiers();
+Interner &Identifiers();
 
 }  // namespace ic::internal_common
 
@@ -0,0 +1,137 @@
+#include "common/interner.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/hash/hash.h"
+
+namespace ic {
+
+Interner::Interner() : shards_(std::make_unique<Shard[]>(ShardCount)) {}
+
+Interner::~Interner() {
+  for (auto& segment : segments_) {
+    delete[] segment.load(std::memory_order_relaxed);
+  }
+}
+
+size_t Interner::Hash(std::string_view s) {
+  return absl::Hash<std::string_view>{}(s);
+}
+
+std::string_view Interner::Shard::Copy(std::string_view s) {
+  size_t bytes = s.size() + 1;
+  if (static_cast<size_t>(end - cursor) < bytes) {
+    // Strings too long to share a block are given their own, so that a single
+    // large string does not waste the remainder of the current block.
+    size_t block_size = std::max(bytes, ArenaBlockSize);
+    char* block = blocks.emplace_back(new char[block_size]).get();
+    if (block_size != ArenaBlockSize) {
+      std::memcpy(block, s.data(), s.size());
+      block[s.size()] = '\0';
+      return std::string_view(block, s.size());
+    }
+    cursor = block;
+    end    = block + block_size;
+  }
+  char* result = cursor;
+  std::memcpy(result, s.data(), s.size());
+  result[s.size()] = '\0';
+  cursor += bytes;
+  return std::string_view(result, s.size());
+}
+
+void Interner::Publish(uint32_t index, std::string_view s) {
+  auto [segment, offset] = Locate(index);
+  std::string_view* entries =
+      segments_[segment].load(std::memory_order_acquire);
+  if (entries == nullptr) {
+    // Segments are allocated by whichever thread first needs one. Threads that
+    // lose the race discard their allocation and use the winner's.
+    auto* allocated = new std::string_view[FirstSegmentSize << segment];
+    if (segments_[segment].compare_exchange_strong(entries, allocated,
+                                                   std::memory_order_acq_rel)) {
+      entries = allocated;
+    } else {
+      delete[] allocated;
+    }
+  }
+  entries[offset] = s;
+}
+
+void Interner::Shard::Insert(size_t hash, uint64_t slot) {
+  Table* current = table.load(std::memory_order_relaxed);
+  if (current == nullptr or 2 * (current->size + 1) > current->capacity()) {
+    // Keep the load factor at or below one half so that probe sequences stay
+    // short. The replacement is fully populated before it is published.
+    auto& grown = tables.emplace_back(std::make_unique<Table>(
+        current ? 2 * current->capacity() : Table::InitialCapacity));
+    if (current) {
+      for (size_t i = 0; i < current->capacity(); ++i) {
+        uint64_t existing = current->slots[i].load(std::memory_order_relaxed);
+        if (existing == 0) { continue; }
+        // Slots retain the upper half of the hash, which is all that
+        // determines where a probe starts.
+        size_t j = (existing >> 32) & grown->mask;
+        while (grown->slots[j].load(std::memory_order_relaxed) != 0) {
+          j = (j + 1) & grown->mask;
+        }
+        grown->slots[j].store(existing, std::memory_order_relaxed);
+      }
+      grown->size = current->size;
+    }
+    current = grown.get();
+    table.store(current, std::memory_order_release);
+  }
+  size_t i = (hash >> 32) & current->mask;
+  while (current->slots[i].load(std::memory_order_relaxed) != 0) {
+    i = (i + 1) & current->mask;
+  }
+  ++current->size;
+  current->slots[i].store(slot, std::memory_order_release);
+}
+
+std::optional<uint32_t> Interner::Probe(Shard const& shard, std::string_view s,
+                                        size_t hash) const {
+  Table const* table = shard.table.load(std::memory_order_acquire);
+  if (table == nullptr) { return std::nullopt; }
+  uint64_t tag = Table::Slot(hash, 0) & ~uint64_t{0xffffffff};
+  for (size_t i = (hash >> 32) & table->mask;; i = (i + 1) & table->mask) {
+    uint64_t slot = table->slots[i].load(std::memory_order_acquire);
+    if (slot == 0) { return std::nullopt; }
+    if ((slot & ~uint64_t{0xffffffff}) != tag) { continue; }
+    // The string was published before the slot was written, so the acquire
+    // load above makes it readable here.
+    uint32_t n = Table::Index(slot);
+    if (from_index(n) == s) { return n; }
+  }
+}
+
+uint32_t Interner::index(std::string_view s) {
+  size_t hash  = Hash(s);
+  Shard& shard = ShardFor(hash);
+  if (auto n = Probe(shard, s, hash)) { return *n; }
+  absl::MutexLock lock(&shard.mutex);
+  // Another thread may have inserted `s` between the probe and acquiring the
+  // lock. All insertions happen under the lock, so this probe is definitive.
+  if (auto n = Probe(shard, s, hash)) { return *n; }
+  std::string_view stored = shard.Copy(s);
+  uint32_t n = next_index_.fetch_add(1, std::memory_order_acq_rel);
+  // The string must be readable at `n` before `n` is visible to any other
+  // thread, which can only happen via this shard's table.
+  Publish(n, stored);
+  shard.Insert(hash, Table::Slot(hash, n));
+  return n;
+}
+
+std::optional<uint32_t> Interner::find(std::string_view s) const {
+  size_t hash  = Hash(s);
+  Shard& shard = ShardFor(hash);
+  if (auto n = Probe(shard, s, hash)) { return n; }
+  // A miss may be due to an insertion of `s` still in flight on another
+  // thread; the lock orders this lookup with respect to it.
+  absl::MutexLock lock(&shard.mutex);
+  return Probe(shard, s, hash);
+}
+
+}  // namespace ic
@@ -0,0 +1,156 @@
+#ifndef ICARUS_COMMON_INTERNER_H
+#define ICARUS_COMMON_INTERNER_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "nth/debug/debug.h"
+
+namespace ic {
+
+// A set of strings, safe for concurrent use, in which each distinct string is
+// assigned a dense `uint32_t` index. When used from a single thread, indices
+// are assigned in insertion order starting from zero.
+//
+// Strings are partitioned into shards by hash so that concurrent insertions
+// of unrelated strings rarely contend on the same lock. The bytes of each
+// string are copied exactly once into an arena owned by its shard, and are
+// followed by a null-terminator so that they can be handed to C APIs. Looking
+// up a string by index never takes a lock, and neither does looking up the
+// index of a string that has already been inserted: each shard publishes an
+// open-addressing table which readers probe without synchronization beyond
+// acquire loads. Only misses fall back to the shard's lock.
+struct Interner {
+  Interner();
+  Interner(Interner const&)            = delete;
+  Interner& operator=(Interner const&) = delete;
+  ~Interner();
+
+  // Returns the index associated with `s`, inserting it if it is not already
+  // present. Does not allocate if `s` is already present.
+  uint32_t index(std::string_view s);
+
+  // Returns the index associated with `s` if present, and `std::nullopt`
+  // otherwise.
+  std::optional<uint32_t> find(std::string_view s) const;
+
+  // Returns the string associated with `index`. The returned view remains
+  // valid for the lifetime of the `Interner`, and is null-terminated. `index`
+  // must have been returned by a call to `index` or `find`.
+  std::string_view from_index(uint32_t index) const {
+    auto [segment, offset] = Locate(index);
+    std::string_view const* entries =
+        segments_[segment].load(std::memory_order_acquire);
+    NTH_REQUIRE((v.harden), entries != nullptr);
+    return entries[offset];
+  }
+
+  // The number of distinct strings inserted so far. While insertions are in
+  // flight on other threads, strings at indices less than `size()` may not yet
+  // be readable via `from_index`.
+  size_t size() const { return next_index_.load(std::memory_order_acquire); }
+
+  friend void NthPrint(auto& p, auto& f, Interner const& interner) {
+    p.write("[");
+    std::string_view separator = "";
+    for (uint32_t i = 0; i < interner.size(); ++i) {
+      p.write(std::exchange(separator, ", "));
+      f(p, interner.from_index(i));
+    }
+    p.write("]");
+  }
+
+ private:
+  static constexpr size_t ShardBits  = 4;
+  static constexpr size_t ShardCount = size_t{1} << ShardBits;
+  // Segment `k` of the index-to-string table holds
+  // `FirstSegmentSize << k` entries.
+  static constexpr uint32_t FirstSegmentBits = 6;
+  static constexpr uint32_t FirstSegmentSize = uint32_t{1} << FirstSegmentBits;
+  static constexpr size_t SegmentCount       = 33 - FirstSegmentBits;
+  static constexpr size_t ArenaBlockSize     = size_t{1} << 16;
+
+  static std::pair<size_t, size_t> Locate(uint32_t index) {
+    uint64_t n     = uint64_t{index} + FirstSegmentSize;
+    size_t segment = std::bit_width(n) - 1 - FirstSegmentBits;
+    return {segment, n - (uint64_t{FirstSegmentSize} << segment)};
+  }
+
+  // An open-addressing hash table with linear probing. Each slot packs the
+  // upper 32 bits of the string's hash above one more than its index, so that
+  // zero marks an empty slot and most mismatches are rejected without reading
+  // string bytes. Slots are only ever written while holding the owning
+  // shard's lock, and each goes from empty to full exactly once, so readers
+  // may probe concurrently.
+  struct Table {
+    static constexpr size_t InitialCapacity = 64;
+
+    explicit Table(size_t capacity)
+        : mask(capacity - 1),
+          slots(std::make_unique<std::atomic<uint64_t>[]>(capacity)) {}
+
+    static uint64_t Slot(size_t hash, uint32_t index) {
+      return (static_cast<uint64_t>(hash) & ~uint64_t{0xffffffff}) |
+             (uint64_t{index} + 1);
+    }
+    static uint32_t Index(uint64_t slot) {
+      return static_cast<uint32_t>(slot) - 1;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    size_t mask;
+    size_t size = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+  };
+
+  struct alignas(64) Shard {
+    // Copies `s` followed by a null-terminator into the arena, returning a
+    // view of the copy (excluding the terminator).
+    std::string_view Copy(std::string_view s);
+
+    // Inserts `slot` into the current table, growing it if necessary. Must be
+    // called while holding `mutex`.
+    void Insert(size_t hash, uint64_t slot);
+
+    mutable absl::Mutex mutex;
+    // The table readers probe. Tables that have been outgrown are kept alive
+    // in `tables` since readers may still be probing them; they are never
+    // written again, and hold every entry inserted before they were replaced.
+    std::atomic<Table*> table = nullptr;
+    std::vector<std::unique_ptr<Table>> tables;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    char* end    = nullptr;
+  };
+
+  static size_t Hash(std::string_view s);
+
+  // Probes the table currently published by `shard` for `s`, without taking
+  // any locks.
+  std::optional<uint32_t> Probe(Shard const& shard, std::string_view s,
+                                size_t hash) const;
+  Shard& ShardFor(size_t hash) const {
+    return shards_[static_cast<uint64_t>(hash) >> (64 - ShardBits)];
+  }
+
+  // Stores `s` at `index`, allocating the segment containing `index` if
+  // necessary.
+  void Publish(uint32_t index, std::string_view s);
+
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<uint32_t> next_index_ = 0;
+  std::atomic<std::string_view*> segments_[SegmentCount] = {};
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_COMMON_INTERNER_H
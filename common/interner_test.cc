@@ -0,0 +1,108 @@
+#include "common/interner.h"
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "nth/test/test.h"
+
+namespace ic {
+namespace {
+
+NTH_TEST("interner/default") {
+  Interner interner;
+  NTH_EXPECT(interner.size() == 0);
+  NTH_EXPECT(not interner.find("abc").has_value());
+}
+
+NTH_TEST("interner/insertion-order") {
+  Interner interner;
+  NTH_EXPECT(interner.index("abc") == 0);
+  NTH_EXPECT(interner.index("def") == 1);
+  NTH_EXPECT(interner.index("") == 2);
+  NTH_EXPECT(interner.index("abc") == 0);
+  NTH_EXPECT(interner.size() == 3);
+
+  NTH_EXPECT(interner.find("def") == 1);
+  NTH_EXPECT(interner.from_index(0) == "abc");
+  NTH_EXPECT(interner.from_index(1) == "def");
+  NTH_EXPECT(interner.from_index(2) == "");
+}
+
+NTH_TEST("interner/null-terminated") {
+  Interner interner;
+  std::string s = "abc";
+  uint32_t n    = interner.index(std::string_view(s).substr(0, 2));
+  std::string_view stored = interner.from_index(n);
+  NTH_EXPECT(stored == "ab");
+  NTH_EXPECT(stored.data()[stored.size()] == '\0');
+}
+
+NTH_TEST("interner/stable") {
+  Interner interner;
+  std::string_view first = interner.from_index(interner.index("first"));
+  std::string long_string(100'000, 'x');
+  for (int i = 0; i < 10'000; ++i) { interner.index(std::to_string(i)); }
+  uint32_t n = interner.index(long_string);
+  NTH_EXPECT(interner.from_index(0).data() == first.data());
+  NTH_EXPECT(interner.from_index(n) == long_string);
+  NTH_EXPECT(interner.from_index(5000) == "4999");
+}
+
+NTH_TEST("interner/concurrent") {
+  Interner interner;
+  constexpr int ThreadCount = 4;
+  constexpr int Count       = 2'000;
+  std::vector<std::vector<uint32_t>> indices(ThreadCount);
+  {
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < ThreadCount; ++t) {
+      threads.emplace_back([&, t] {
+        // Every thread inserts the same strings, in different orders.
+        for (int i = 0; i < Count; ++i) {
+          int j = (t % 2 == 0) ? i : Count - 1 - i;
+          indices[t].push_back(interner.index(std::to_string(j)));
+        }
+      });
+    }
+  }
+
+  NTH_ASSERT(interner.size() == Count);
+  for (int t = 0; t < ThreadCount; ++t) {
+    for (int i = 0; i < Count; ++i) {
+      int j = (t % 2 == 0) ? i : Count - 1 - i;
+      NTH_EXPECT(interner.from_index(indices[t][i]) == std::to_string(j));
+    }
+  }
+}
+
+NTH_TEST("interner/concurrent-lookup") {
+  Interner interner;
+  constexpr int Count = 2'000;
+  for (int i = 0; i < Count; ++i) { interner.index(std::to_string(i)); }
+  {
+    std::vector<std::jthread> threads;
+    // Lookups of present strings race with insertions that grow the tables
+    // being probed.
+    threads.emplace_back([&] {
+      for (int i = Count; i < 8 * Count; ++i) {
+        interner.index(std::to_string(i));
+      }
+    });
+    for (int t = 0; t < 3; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < Count; ++i) {
+          NTH_EXPECT(interner.find(std::to_string(i)) == uint32_t(i));
+          NTH_EXPECT(interner.index(std::to_string(i)) == uint32_t(i));
+        }
+      });
+    }
+  }
+  NTH_EXPECT(interner.size() == 8 * Count);
+  NTH_EXPECT(interner.find(std::to_string(8 * Count - 1)) == 8 * Count - 1);
+  NTH_EXPECT(not interner.find("absent").has_value());
+}
+
+}  // namespace
+}  // namespace ic
@@ -0,0 +1,63 @@
+#include "common/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "common/errno.h"
+
+namespace ic {
+
+std::optional<MappedFile> MappedFile::TryOpen(nth::file_path const& path) {
+  errno_resetter e;
+  int fd = ::open(path.path().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) { return std::nullopt; }
+
+  struct stat s;
+  if (::fstat(fd, &s) != 0 or not S_ISREG(s.st_mode)) {
+    ::close(fd);
+    return std::nullopt;
+  }
+
+  size_t size = static_cast<size_t>(s.st_size);
+  if (size == 0) {
+    ::close(fd);
+    return MappedFile(nullptr, 0);
+  }
+
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file, so the descriptor is no
+  // longer needed regardless of whether the mapping succeeded.
+  ::close(fd);
+  if (data == MAP_FAILED) { return std::nullopt; }
+
+  // Every consumer reads the contents front to back exactly once.
+  ::madvise(data, size, MADV_SEQUENTIAL);
+  return MappedFile(static_cast<char const*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& f)
+    : data_(std::exchange(f.data_, nullptr)),
+      size_(std::exchange(f.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& f) {
+  if (this != &f) {
+    Unmap();
+    data_ = std::exchange(f.data_, nullptr);
+    size_ = std::exchange(f.size_, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { Unmap(); }
+
+void MappedFile::Unmap() {
+  if (data_) { ::munmap(const_cast<char*>(data_), size_); }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace ic
@@ -0,0 +1,44 @@
+#ifndef ICARUS_COMMON_MAPPED_FILE_H
+#define ICARUS_COMMON_MAPPED_FILE_H
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "nth/io/file_path.h"
+
+namespace ic {
+
+// A read-only view of the contents of a file, mapped directly into memory
+// rather than copied. The view returned by `content()` is valid for the
+// lifetime of the `MappedFile`, so any structure holding onto a view of the
+// contents (e.g., a diagnostic consumer's source) must not outlive it.
+struct MappedFile {
+  // Maps the file at `path` into memory, returning `std::nullopt` if the file
+  // cannot be opened or mapped.
+  static std::optional<MappedFile> TryOpen(nth::file_path const& path);
+
+  MappedFile(MappedFile const&)            = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+  MappedFile(MappedFile&& f);
+  MappedFile& operator=(MappedFile&& f);
+  ~MappedFile();
+
+  std::string_view content() const { return std::string_view(data_, size_); }
+  size_t size() const { return size_; }
+
+ private:
+  explicit MappedFile(char const* data, size_t size)
+      : data_(data), size_(size) {}
+
+  // Releases the mapping, if any, leaving the file empty.
+  void Unmap();
+
+  // Empty files are not mapped, in which case `data_` is null.
+  char const* data_ = nullptr;
+  size_t size_      = 0;
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_COMMON_MAPPED_FILE_H
@@ -0,0 +1,52 @@
+#include "common/mapped_file.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "nth/test/test.h"
+
+namespace ic {
+namespace {
+
+std::optional<nth::file_path> WriteTemporaryFile(std::string_view name,
+                                                 std::string_view content) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+  std::FILE* file            = std::fopen(path.c_str(), "w");
+  if (not file) { return std::nullopt; }
+  std::fwrite(content.data(), 1, content.size(), file);
+  std::fclose(file);
+  return nth::file_path::try_construct(path.string());
+}
+
+NTH_TEST("mapped-file/missing") {
+  std::optional path = nth::file_path::try_construct(
+      (std::filesystem::temp_directory_path() / "ic-mapped-file-missing")
+          .string());
+  NTH_ASSERT(path.has_value());
+  NTH_EXPECT(not MappedFile::TryOpen(*path).has_value());
+}
+
+NTH_TEST("mapped-file/empty") {
+  std::optional path = WriteTemporaryFile("ic-mapped-file-empty", "");
+  NTH_ASSERT(path.has_value());
+  std::optional file = MappedFile::TryOpen(*path);
+  NTH_ASSERT(file.has_value());
+  NTH_EXPECT(file->content().empty());
+}
+
+NTH_TEST("mapped-file/content") {
+  std::optional path =
+      WriteTemporaryFile("ic-mapped-file-content", "let x ::= 3\n");
+  NTH_ASSERT(path.has_value());
+  std::optional file = MappedFile::TryOpen(*path);
+  NTH_ASSERT(file.has_value());
+  NTH_EXPECT(file->content() == "let x ::= 3\n");
+
+  MappedFile moved = std::move(*file);
+  NTH_EXPECT(moved.content() == "let x ::= 3\n");
+  NTH_EXPECT(file->content().empty());
+}
+
+}  // namespace
+}  // namespace ic
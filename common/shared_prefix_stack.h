@@ -0,0 +1,127 @@
+#ifndef ICARUS_COMMON_SHARED_PREFIX_STACK_H
+#define ICARUS_COMMON_SHARED_PREFIX_STACK_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "nth/debug/debug.h"
+
+namespace ic {
+
+// A stack which may be shared with other stacks in constant time. Sharing a
+// stack moves the elements it holds exclusively into an immutable segment, on
+// top of which both stacks then push their own elements. Popping an element of
+// a shared segment only moves the stack's view of that segment, and modifying
+// the top element when it belongs to a shared segment copies that element
+// alone. Thus no operation copies more than one element, and modifications to
+// one stack are never observed by another with which it shares elements.
+//
+// The interface mirrors that of `std::vector` for the operations a stack
+// supports, so that it may replace a vector used as one.
+template <typename T>
+struct SharedPrefixStack {
+  SharedPrefixStack() = default;
+  SharedPrefixStack(std::initializer_list<T> values) : owned_(values) {}
+
+  SharedPrefixStack(SharedPrefixStack const&)            = delete;
+  SharedPrefixStack& operator=(SharedPrefixStack const&) = delete;
+  SharedPrefixStack(SharedPrefixStack&&)                 = default;
+  SharedPrefixStack& operator=(SharedPrefixStack&&)      = default;
+
+  // Returns a stack holding the same elements as `*this`, without copying
+  // any of them.
+  SharedPrefixStack share() {
+    if (not owned_.empty()) {
+      size_t base = shared_size();
+      segment_    = std::make_shared<Segment const>(std::move(segment_),
+                                                    visible_, base,
+                                                    std::move(owned_));
+      visible_    = segment_->values.size();
+      owned_.clear();
+    }
+    SharedPrefixStack result;
+    result.segment_ = segment_;
+    result.visible_ = visible_;
+    return result;
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+  [[nodiscard]] size_t size() const { return shared_size() + owned_.size(); }
+
+  T const& back() const {
+    NTH_REQUIRE((v.harden), not empty());
+    if (not owned_.empty()) { return owned_.back(); }
+    return segment_->values[visible_ - 1];
+  }
+
+  T& back() {
+    NTH_REQUIRE((v.harden), not empty());
+    if (owned_.empty()) {
+      T value = segment_->values[visible_ - 1];
+      pop_shared();
+      owned_.push_back(std::move(value));
+    }
+    return owned_.back();
+  }
+
+  void push_back(T const& value) { owned_.push_back(value); }
+  void push_back(T&& value) { owned_.push_back(std::move(value)); }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return owned_.emplace_back(std::forward<Args>(args)...);
+  }
+
+  void pop_back() {
+    NTH_REQUIRE((v.harden), not empty());
+    if (owned_.empty()) {
+      pop_shared();
+    } else {
+      owned_.pop_back();
+    }
+  }
+
+ private:
+  struct Segment {
+    explicit Segment(std::shared_ptr<Segment const> parent,
+                     size_t parent_visible, size_t base, std::vector<T> values)
+        : parent(std::move(parent)),
+          parent_visible(parent_visible),
+          base(base),
+          values(std::move(values)) {}
+
+    // The segment beneath this one, and the number of its elements beneath
+    // this one.
+    std::shared_ptr<Segment const> parent;
+    size_t parent_visible;
+    // The number of elements beneath this segment.
+    size_t base;
+    std::vector<T> values;
+  };
+
+  size_t shared_size() const {
+    return segment_ ? segment_->base + visible_ : 0;
+  }
+
+  void pop_shared() {
+    if (--visible_ != 0) { return; }
+    // Segments are never empty, so once none of this one is visible, the view
+    // moves to the segment beneath it.
+    std::shared_ptr parent = segment_->parent;
+    visible_               = segment_->parent_visible;
+    segment_               = std::move(parent);
+  }
+
+  std::shared_ptr<Segment const> segment_;
+  // The number of elements of `*segment_` which are part of this stack.
+  size_t visible_ = 0;
+  // Elements above `*segment_`, which are not shared with any other stack.
+  std::vector<T> owned_;
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_COMMON_SHARED_PREFIX_STACK_H
@@ -0,0 +1,74 @@
+#include "common/shared_prefix_stack.h"
+
+#include "nth/test/test.h"
+
+namespace ic {
+namespace {
+
+NTH_TEST("shared-prefix-stack/push-pop") {
+  SharedPrefixStack<int> s;
+  NTH_EXPECT(s.empty());
+  s.push_back(1);
+  s.emplace_back(2);
+  NTH_EXPECT(s.size() == 2);
+  NTH_EXPECT(s.back() == 2);
+  s.pop_back();
+  NTH_EXPECT(s.back() == 1);
+  s.pop_back();
+  NTH_EXPECT(s.empty());
+}
+
+NTH_TEST("shared-prefix-stack/share") {
+  SharedPrefixStack<int> s = {1, 2, 3};
+  SharedPrefixStack<int> t = s.share();
+  NTH_EXPECT(s.size() == 3);
+  NTH_EXPECT(t.size() == 3);
+
+  s.push_back(4);
+  t.pop_back();
+  NTH_EXPECT(s.size() == 4);
+  NTH_EXPECT(s.back() == 4);
+  NTH_EXPECT(t.size() == 2);
+  NTH_EXPECT(t.back() == 2);
+
+  s.pop_back();
+  NTH_EXPECT(s.back() == 3);
+}
+
+NTH_TEST("shared-prefix-stack/modify-shared-top") {
+  SharedPrefixStack<int> s = {1, 2};
+  SharedPrefixStack<int> t = s.share();
+  t.back() = 5;
+  NTH_EXPECT(t.size() == 2);
+  NTH_EXPECT(t.back() == 5);
+  NTH_EXPECT(s.back() == 2);
+}
+
+NTH_TEST("shared-prefix-stack/nested-share") {
+  SharedPrefixStack<int> s = {1};
+  SharedPrefixStack<int> t = s.share();
+  t.push_back(2);
+  SharedPrefixStack<int> u = t.share();
+  u.push_back(3);
+  NTH_EXPECT(u.size() == 3);
+
+  // Popping past the end of the segment shared with `t` continues into the one
+  // shared with `s`.
+  u.pop_back();
+  u.pop_back();
+  NTH_EXPECT(u.size() == 1);
+  NTH_EXPECT(u.back() == 1);
+  u.pop_back();
+  NTH_EXPECT(u.empty());
+
+  NTH_EXPECT(t.size() == 2);
+  NTH_EXPECT(t.back() == 2);
+  NTH_EXPECT(s.size() == 1);
+
+  // Sharing a stack whose elements are all shared does not need a new segment.
+  SharedPrefixStack<int> v = s.share();
+  NTH_EXPECT(v.back() == 1);
+}
+
+}  // namespace
+}  // namespace ic
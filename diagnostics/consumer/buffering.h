@@ -0,0 +1,46 @@
+#ifndef ICARUS_DIAGNOSTICS_CONSUMER_BUFFERING_H
+#define ICARUS_DIAGNOSTICS_CONSUMER_BUFFERING_H
+
+#include <utility>
+#include <vector>
+
+#include "diagnostics/consumer/consumer.h"
+#include "diagnostics/message.h"
+
+namespace ic::diag {
+
+// Holds on to the diagnostics it consumes so that they may be forwarded to
+// another consumer later, allowing diagnostics found on separate threads to be
+// emitted in a deterministic order.
+struct BufferingConsumer : DiagnosticConsumer {
+  ~BufferingConsumer() = default;
+
+  void Start(MessageComponent const &component) override {
+    // `count()` is incremented only once every component of a message has
+    // been consumed, so it lags behind while a message is in progress.
+    if (count() == taken_ + messages_.size()) { messages_.emplace_back(); }
+    messages_.back().push_back(component);
+  }
+  void Process(MessageComponent const &component) override {}
+  void Complete(MessageComponent const &component) override {}
+
+  // Returns the diagnostics consumed since the last call to `take`, in order.
+  std::vector<Message> take() {
+    std::vector<Message> messages;
+    messages.reserve(messages_.size());
+    for (auto &components : messages_) {
+      messages.emplace_back(std::move(components));
+    }
+    taken_ += messages_.size();
+    messages_.clear();
+    return messages;
+  }
+
+ private:
+  size_t taken_ = 0;
+  std::vector<std::vector<MessageComponent>> messages_;
+};
+
+}  // namespace ic::diag
+
+#endif  // ICARUS_DIAGNOSTICS_CONSUMER_BUFFERING_H
@@ -11,13 +11,9 @@ ParseTree const &DiagnosticConsumer::parse_tree() const {
 }
 
 void DiagnosticConsumer::set_source(std::string_view source) {
-  source_  = source;
-  offsets_ = {0};
-  for (size_t i = source_.find('\n'); i < source_.size();
-       i        = source_.find('\n', i + 1)) {
-    offsets_.push_back(i + 1);
-  }
-  offsets_.push_back(source_.size() + 1);
+  source_           = source;
+  owned_line_table_ = LineTable::FromSource(source);
+  line_table_       = nullptr;
 }
 
 void DiagnosticConsumer::Consume(Token location, Message const &message) {
@@ -31,20 +27,18 @@ void DiagnosticConsumer::Consume(Token location, Message const &message) {
 
 std::pair<uint32_t, uint32_t> DiagnosticConsumer::LineAndColumn(
     Token token) const {
-  auto iter =
-      std::lower_bound(offsets_.begin(), offsets_.end(), token.offset());
-  NTH_REQUIRE(iter != offsets_.end());
-  if (*iter != token.offset()) { --iter; }
-  return std::pair<uint32_t, uint32_t>(
-      std::distance(offsets_.begin(), iter) + 1, token.offset() - *iter);
+  NTH_REQUIRE(token.offset() <= source_.size());
+  return line_table().LineAndColumn(token.offset());
 }
 
 std::string_view DiagnosticConsumer::Line(uint32_t line) const {
   NTH_REQUIRE(source_ != "");
   NTH_REQUIRE(line > 0);
-  NTH_REQUIRE(line < offsets_.size());
-  return std::string_view(source_.data() + offsets_[line - 1],
-                          source_.data() + offsets_[line] - 1);
+  NTH_REQUIRE(line <= lines());
+  uint32_t end = line == lines() ? source_.size()
+                                 : line_table().line_start(line + 1) - 1;
+  return std::string_view(source_.data() + line_table().line_start(line),
+                          source_.data() + end);
 }
 
 std::string_view DiagnosticConsumer::Symbol(Token token) const {
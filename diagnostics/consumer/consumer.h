@@ -3,9 +3,9 @@
 
 #include <string_view>
 #include <utility>
-#include <vector>
 
 #include "diagnostics/message.h"
+#include "lexer/line_table.h"
 #include "lexer/token.h"
 #include "nth/base/attributes.h"
 #include "parse/tree.h"
@@ -13,7 +13,19 @@
 namespace ic::diag {
 
 struct DiagnosticConsumer {
+  // Sets the source being diagnosed, scanning it to find the start of each
+  // line.
   void set_source(std::string_view source);
+
+  // Sets the source being diagnosed, along with the table of line offsets
+  // produced by the lexer for it, so that the source need not be scanned
+  // again.
+  void set_source(std::string_view source,
+                  NTH_ATTRIBUTE(lifetimebound) LineTable const &line_table) {
+    source_     = source;
+    line_table_ = &line_table;
+  }
+
   void set_parse_tree(NTH_ATTRIBUTE(lifetimebound) ParseTree const &tree) {
     tree_ = &tree;
   }
@@ -29,7 +41,7 @@ struct DiagnosticConsumer {
 
   std::string_view Line(uint32_t line) const;
 
-  size_t lines() const { return offsets_.size() - 1; }
+  size_t lines() const { return line_table().lines(); }
   size_t count() const { return count_; }
 
   virtual ~DiagnosticConsumer()                            = default;
@@ -38,10 +50,19 @@ struct DiagnosticConsumer {
   virtual void Complete(MessageComponent const &component) = 0;
 
  private:
+  LineTable const &line_table() const {
+    return line_table_ ? *line_table_ : owned_line_table_;
+  }
+
   size_t count_ = 0;
   ParseTree const *tree_   = nullptr;
   std::string_view source_ = "";
-  std::vector<uint32_t> offsets_;
+  // The line table provided by the lexer, or null if the table is owned. The
+  // owned table is never referred to by pointer, so that copies of a consumer
+  // refer to their own.
+  LineTable const *line_table_ = nullptr;
+  // Holds the line table when one is not provided by the lexer.
+  LineTable owned_line_table_;
 };
 
 }  // namespace ic::diag
@@ -1,187 +1,382 @@
 #include "ir/declaration.h"
 
-#include <optional>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "common/arena.h"
 #include "common/identifier.h"
 #include "common/string.h"
 #include "nth/container/stack.h"
-#include "nth/utility/iterator_range.h"
+#include "nth/debug/debug.h"
 #include "parse/node.h"
 
 namespace ic {
 namespace {
 
-template <typename NodeType>
-struct tree {
-  using node_type = NodeType;
+constexpr uint32_t NoPendingUse = std::numeric_limits<uint32_t>::max();
 
-  size_t insert_child(size_t parent_index) {
-    nodes_.emplace_back(
-        std::make_pair(nodes_.size() - parent_index, node_type()));
-    return nodes_.size() - 1;
-  }
+// The state of an identifier at some point during the pass over the tree.
+struct Symbol {
+  // The innermost declaration of the identifier in a scope which is still open,
+  // if any, along with the depth of that scope.
+  ParseNodeIndex declaration = ParseNodeIndex::Invalid();
+  uint32_t depth             = 0;
+  // The last declaration of the identifier in a scope which has been closed.
+  // No declaration is at index zero, so it stands for there being none.
+  ParseNodeIndex last_closed_declaration = ParseNodeIndex(0);
+  // The most recent use of the identifier which is not yet resolved, as an
+  // index into `Resolver::pending_`.
+  uint32_t pending = NoPendingUse;
+};
 
- private:
-  struct ancestor_iterator_base {
-    friend bool operator==(ancestor_iterator_base,
-                           ancestor_iterator_base) = default;
+// A diagnostic found while resolving the identifiers within a function literal
+// on a worker thread. It is reported once the identifiers preceding the
+// function literal have been resolved, so that diagnostics are reported in the
+// same order regardless of how many threads are used.
+struct DeferredDiagnostic {
+  enum class Kind : uint8_t {
+    DeclaredInSameScope,
+    ShadowsParent,
+    // The declaration must be reported as shadowing the declaration of the same
+    // identifier visible where the function literal appears, if any.
+    MayShadowEnclosingScope,
+  };
+  Kind kind;
+  ParseNodeIndex declaration;
+  // For `DeclaredInSameScope`, the earlier declaration in the same scope.
+  ParseNodeIndex previous = ParseNodeIndex::Invalid();
+};
 
-   protected:
-    explicit ancestor_iterator_base(std::pair<size_t, node_type> const *node) : node_(node) {}
+// The result of resolving identifiers within a function literal which is not
+// nested in any other, without regard to the scopes enclosing it.
+struct FunctionLiteralResolution {
+  // The `FunctionLiteralStart` and `FunctionLiteral` nodes of the subtree.
+  ParseNodeIndex start = ParseNodeIndex::Invalid();
+  ParseNodeIndex end   = ParseNodeIndex::Invalid();
 
-    std::pair<size_t, node_type> const *node_;
-  };
+  std::vector<DeferredDiagnostic> diagnostics;
+  // Uses of identifiers which are not declared within the function literal, in
+  // the order in which they appear.
+  std::vector<ParseNodeIndex> unresolved_uses;
+  // Each identifier declared within the function literal, along with its last
+  // declaration there.
+  std::vector<std::pair<Identifier, ParseNodeIndex>> declarations;
+};
 
- public:
-  template <typename S>
-  struct ancestor_iterator_impl : ancestor_iterator_base {
-    ancestor_iterator_impl &operator++() {
-      tree::ReplaceWithParent(this->node_);
-      return *this;
-    }
+// Resolves identifiers to declarations in a single pass over the parse tree.
+//
+// The declaration visible to each identifier is tracked in one table for the
+// whole module. Declaring an identifier records its previous entry in an undo
+// log, which is replayed when the declaring scope closes, so that opening and
+// closing scopes costs time proportional to the number of declarations in
+// them. Declarations may follow their uses (e.g., a function calling another
+// declared later in the module), so a use with no visible declaration is
+// deferred. Uses of an identifier which are deferred form a list, most recent
+// first. The uses in the list which follow the start of the innermost open
+// scope all lie within that scope, so a declaration there resolves exactly a
+// prefix of the list. Every node is therefore visited a constant number of
+// times.
+//
+// Function literals which are not nested in any other may instead be resolved
+// ahead of time on separate resolvers (see `ResolveFunctionLiteral`), and
+// their results spliced in when the pass reaches them (see `Splice`).
+struct Resolver {
+  explicit Resolver(ParseTree &tree, diag::DiagnosticConsumer &diag,
+                    std::pmr::memory_resource *memory_resource)
+      : tree_(tree),
+        diag_(diag),
+        symbols_(memory_resource),
+        scopes_(memory_resource),
+        undo_log_(memory_resource),
+        pending_(memory_resource) {}
 
-    ancestor_iterator_impl operator++(int) {
-      auto copy = *this;
-      ++*this;
-      return copy;
+  void OpenScope(ParseNodeIndex start) {
+    scopes_.push_back({.start = start, .undo_log_size = undo_log_.size()});
+  }
+
+  void CloseScope() {
+    NTH_REQUIRE((v.harden), not scopes_.empty());
+    while (undo_log_.size() > scopes_.back().undo_log_size) {
+      Undo const &undo = undo_log_.back();
+      Symbol &symbol   = symbols_.find(undo.identifier)->second;
+      symbol.last_closed_declaration =
+          std::max(symbol.last_closed_declaration, symbol.declaration);
+      symbol.declaration = undo.declaration;
+      symbol.depth       = undo.depth;
+      undo_log_.pop_back();
     }
+    scopes_.pop_back();
+  }
 
-    S &operator*() const {
-      return const_cast<std::pair<size_t, S> *>(this->node_)->second;
+  void Declare(ParseNodeIndex index) {
+    NTH_REQUIRE((v.harden), not scopes_.empty());
+    Identifier identifier = tree_.identifier(index);
+    Symbol &symbol        = symbols_[identifier];
+    uint32_t depth        = scopes_.size();
+    ParseNodeIndex start  = scopes_.back().start;
+    if (symbol.declaration != ParseNodeIndex::Invalid()) {
+      if (symbol.depth == depth) {
+        Report({.kind        = DeferredDiagnostic::Kind::DeclaredInSameScope,
+                .declaration = index,
+                .previous    = symbol.declaration});
+        return;
+      }
+      Report({.kind        = DeferredDiagnostic::Kind::ShadowsParent,
+              .declaration = symbol.declaration});
+    } else if (function_literal_) {
+      Report({.kind        = DeferredDiagnostic::Kind::MayShadowEnclosingScope,
+              .declaration = index});
     }
-    S *operator->() const {
-      return &const_cast<std::pair<size_t, S> *>(this->node_)->second;
+    if (symbol.last_closed_declaration > start) {
+      // The closed scope is nested within the current one.
+      Report({.kind        = DeferredDiagnostic::Kind::ShadowsParent,
+              .declaration = index});
     }
 
-   private:
-    friend tree;
-    using ancestor_iterator_base::ancestor_iterator_base;
-  };
-
-  using ancestor_iterator       = ancestor_iterator_impl<node_type>;
-  using const_ancestor_iterator = ancestor_iterator_impl<node_type const>;
+    undo_log_.push_back({.identifier  = identifier,
+                         .declaration = symbol.declaration,
+                         .depth       = symbol.depth});
+    symbol.declaration = index;
+    symbol.depth       = depth;
+    while (symbol.pending != NoPendingUse and
+           pending_[symbol.pending].use > start) {
+      PendingUse &use = pending_[symbol.pending];
+      tree_[use.use].corresponding_declaration_identifier = index;
+      use.use        = ParseNodeIndex::Invalid();
+      symbol.pending = use.next;
+    }
+  }
 
-  auto ancestors(size_t index) const {
-    return nth::iterator_range(const_ancestor_iterator(nodes_.data() + index),
-                               const_ancestor_iterator(nodes_.data() - 1));
+  void Use(ParseNodeIndex index) {
+    Symbol &symbol = symbols_[tree_.identifier(index)];
+    if (symbol.declaration != ParseNodeIndex::Invalid()) {
+      tree_[index].corresponding_declaration_identifier = symbol.declaration;
+    } else {
+      pending_.push_back({.use = index, .next = symbol.pending});
+      symbol.pending = pending_.size() - 1;
+    }
   }
 
-  auto ancestors(size_t index) {
-    return nth::iterator_range(ancestor_iterator(nodes_.data() + index),
-                               ancestor_iterator(nodes_.data()));
+  void Visit(ParseNodeIndex index) {
+    switch (tree_[index].kind) {
+      case ParseNode::Kind::FunctionLiteralStart:
+      case ParseNode::Kind::ScopeStart: OpenScope(index); break;
+      case ParseNode::Kind::StatementSequence:
+      case ParseNode::Kind::FunctionLiteral: CloseScope(); break;
+      case ParseNode::Kind::Declaration: {
+        for (auto d : declared_identifiers_.top()) {
+          tree_[d].corresponding_declaration = index;
+        }
+        declared_identifiers_.pop();
+      } break;
+      case ParseNode::Kind::DeclarationStart:
+        declared_identifiers_.emplace();
+        break;
+      case ParseNode::Kind::DeclaredIdentifier:
+        declared_identifiers_.top().push_back(index);
+        Declare(index);
+        break;
+      case ParseNode::Kind::Identifier: Use(index); break;
+      default: break;
+    }
   }
 
-  node_type &operator[](size_t index) { return nodes_[index].second; }
-  node_type const &operator[](size_t index) const { return nodes_[index].second; }
+  // Resolves the identifiers within `resolution.start` through
+  // `resolution.end` as though the function literal were the entire module,
+  // recording in `resolution` what must be resolved or reported once the
+  // scopes enclosing it are known. The resolver may be reused afterwards.
+  void ResolveFunctionLiteral(FunctionLiteralResolution &resolution) {
+    function_literal_ = &resolution;
+    for (auto i = resolution.start; i <= resolution.end; ++i) { Visit(i); }
+    for (PendingUse const &use : pending_) {
+      if (use.use == ParseNodeIndex::Invalid()) { continue; }
+      resolution.unresolved_uses.push_back(use.use);
+    }
+    for (auto const &[identifier, symbol] : symbols_) {
+      if (symbol.last_closed_declaration == ParseNodeIndex(0)) { continue; }
+      resolution.declarations.emplace_back(identifier,
+                                           symbol.last_closed_declaration);
+    }
+    symbols_.clear();
+    pending_.clear();
+    function_literal_ = nullptr;
+  }
 
-  size_t size() const { return nodes_.size(); }
+  // Completes the resolution of identifiers within a function literal resolved
+  // by `ResolveFunctionLiteral`, in place of visiting each of its nodes.
+  void Splice(FunctionLiteralResolution const &resolution) {
+    for (DeferredDiagnostic const &diagnostic : resolution.diagnostics) {
+      if (diagnostic.kind !=
+          DeferredDiagnostic::Kind::MayShadowEnclosingScope) {
+        Emit(diagnostic);
+        continue;
+      }
+      auto iter =
+          symbols_.find(tree_.identifier(diagnostic.declaration));
+      if (iter == symbols_.end() or
+          iter->second.declaration == ParseNodeIndex::Invalid()) {
+        continue;
+      }
+      Emit({.kind        = DeferredDiagnostic::Kind::ShadowsParent,
+            .declaration = iter->second.declaration});
+    }
+    for (ParseNodeIndex use : resolution.unresolved_uses) { Use(use); }
+    for (auto const &[identifier, declaration] : resolution.declarations) {
+      Symbol &symbol = symbols_[identifier];
+      symbol.last_closed_declaration =
+          std::max(symbol.last_closed_declaration, declaration);
+    }
+  }
 
-  tree() : nodes_(1, std::make_pair(1, node_type())) {}
+  // Reports every use which no declaration resolved, returning whether any
+  // diagnostics were emitted.
+  bool Finish() {
+    NTH_REQUIRE((v.harden), scopes_.empty());
+    for (PendingUse const &use : pending_) {
+      if (use.use == ParseNodeIndex::Invalid()) { continue; }
+      error_ = true;
+      diag_.Consume({
+          diag::Header(diag::MessageKind::Error),
+          diag::Text(InterpolateString<"Symbol `{}` has not been declared.">(
+              tree_.identifier(use.use))),
+          diag::SourceQuote(tree_.token(use.use)),
+      });
+    }
+    return error_;
+  }
 
  private:
-  template <typename>
-  friend struct ancestor_iterator_impl;
+  void Report(DeferredDiagnostic const &diagnostic) {
+    if (function_literal_) {
+      function_literal_->diagnostics.push_back(diagnostic);
+    } else {
+      Emit(diagnostic);
+    }
+  }
 
-  static void ReplaceWithParent(std::pair<size_t, node_type> const *&node) {
-    node -= node->first;
+  void Emit(DeferredDiagnostic const &diagnostic) {
+    error_ = true;
+    switch (diagnostic.kind) {
+      case DeferredDiagnostic::Kind::DeclaredInSameScope:
+        diag_.Consume({
+            diag::Header(diag::MessageKind::Error),
+            diag::Text(
+                "Symbol has been declared previously in the same scope."),
+            diag::SourceQuote(tree_.token(diagnostic.previous)),
+            diag::SourceQuote(tree_.token(diagnostic.declaration)),
+        });
+        break;
+      case DeferredDiagnostic::Kind::ShadowsParent:
+        diag_.Consume({
+            diag::Header(diag::MessageKind::Error),
+            diag::Text(InterpolateString<
+                       "Symbol `{}` has been declared in a parent scope.">(
+                tree_.identifier(diagnostic.declaration))),
+            diag::SourceQuote(tree_.token(diagnostic.declaration)),
+        });
+        break;
+      case DeferredDiagnostic::Kind::MayShadowEnclosingScope:
+        NTH_UNREACHABLE();
+    }
   }
 
-  std::vector<std::pair<size_t, node_type>> nodes_;
-};
+  struct Scope {
+    ParseNodeIndex start;
+    size_t undo_log_size;
+  };
 
-struct Entry {
-  std::vector<ParseNodeIndex> identifiers;
-  std::optional<ParseNodeIndex> declaration;
-};
+  // The entry of `identifier` before it was declared in the innermost scope.
+  struct Undo {
+    Identifier identifier;
+    ParseNodeIndex declaration;
+    uint32_t depth;
+  };
 
-}  // namespace
+  struct PendingUse {
+    // The identifier, or `ParseNodeIndex::Invalid()` once it is resolved.
+    ParseNodeIndex use;
+    // The previous unresolved use of the same identifier.
+    uint32_t next;
+  };
 
-bool AssignDeclarationsToIdentifiers(ParseTree &tree,
-                                     diag::DiagnosticConsumer &diag) {
-  bool error = false;
-  ::ic::tree<absl::flat_hash_map<Identifier, Entry>> entry_tree;
-  nth::stack<size_t> indices{0};
-  nth::stack<std::vector<ParseNodeIndex>> decl_ids;
-
-  absl::flat_hash_map<Identifier, Entry> *ptr = nullptr;
-  auto [start, end]                           = tree.node_range();
+  ParseTree &tree_;
+  diag::DiagnosticConsumer &diag_;
+  ArenaFlatHashMap<Identifier, Symbol> symbols_;
+  std::pmr::vector<Scope> scopes_;
+  std::pmr::vector<Undo> undo_log_;
+  std::pmr::vector<PendingUse> pending_;
+  nth::stack<std::vector<ParseNodeIndex>> declared_identifiers_;
+  // The function literal being resolved by `ResolveFunctionLiteral`, if any.
+  FunctionLiteralResolution *function_literal_ = nullptr;
+  bool error_ = false;
+};
+
+// Resolves the identifiers within each function literal of `tree` which is not
+// nested in any other, distributing them across `threads` threads. Returns the
+// results in the order in which the function literals appear.
+std::vector<FunctionLiteralResolution> ResolveFunctionLiterals(
+    ParseTree &tree, diag::DiagnosticConsumer &diag, uint32_t threads) {
+  std::vector<FunctionLiteralResolution> function_literals;
+  uint32_t depth    = 0;
+  auto [start, end] = tree.node_range();
   for (auto i = start; i < end; ++i) {
     switch (tree[i].kind) {
       case ParseNode::Kind::FunctionLiteralStart:
-      case ParseNode::Kind::ScopeStart:
-        indices.push(entry_tree.insert_child(indices.top()));
-        ptr = &entry_tree[indices.top()];
+        if (depth++ == 0) { function_literals.push_back({.start = i}); }
         break;
-      case ParseNode::Kind::StatementSequence:
       case ParseNode::Kind::FunctionLiteral:
-      case ParseNode::Kind::Scope:
-        indices.pop();
-        ptr = &entry_tree[indices.top()];
-        break;
-      case ParseNode::Kind::Declaration: {
-        for (auto d : decl_ids.top()) { tree[d].corresponding_declaration = i; }
-        decl_ids.pop();
-      } break;
-      case ParseNode::Kind::DeclarationStart: decl_ids.emplace(); break;
-      case ParseNode::Kind::DeclaredIdentifier: {
-        decl_ids.top().push_back(i);
-        auto &decl_id = (*ptr)[tree[i].token.Identifier()].declaration;
-        if (decl_id) {
-          error = true;
-          diag.Consume({
-              diag::Header(diag::MessageKind::Error),
-              diag::Text(
-                  "Symbol has been declared previously in the same scope."),
-              diag::SourceQuote(tree[*decl_id].token),
-              diag::SourceQuote(tree[i].token),
-          });
-        } else {
-          decl_id = i;
-        }
-      } break;
-      case ParseNode::Kind::Identifier:
-        (*ptr)[tree[i].token.Identifier()].identifiers.push_back(i);
+        if (--depth == 0) { function_literals.back().end = i; }
         break;
       default: break;
     }
   }
-  NTH_REQUIRE((v.harden), indices.size() == 1);
-  for (size_t i = 0; i < entry_tree.size(); ++i) {
-    for (auto const &[key, entry] : entry_tree[i]) {
-      bool found = false;
-      for (auto a : entry_tree.ancestors(i)) {
-        auto iter = a.find(key);
-        if (iter == a.end()) { continue; }
-        auto &decl_entry = iter->second;
-        if (not decl_entry.declaration) { continue; }
-        if (found) {
-          error = true;
-          diag.Consume({
-              diag::Header(diag::MessageKind::Error),
-              diag::Text(
-                  InterpolateString<
-                      "Symbol `{}` has been declared in a parent scope.">(key)),
-              diag::SourceQuote(tree[*decl_entry.declaration].token),
-          });
-        } else {
-          found = true;
-          for (auto index : entry.identifiers) {
-            tree[index].corresponding_declaration_identifier = *decl_entry.declaration;
-          }
-        }
-      }
-      if (not found) {
-          error = true;
-          diag.Consume({
-              diag::Header(diag::MessageKind::Error),
-              diag::Text(
-                  InterpolateString<"Symbol `{}` has not been declared.">(key)),
-          });
+
+  std::atomic<size_t> next = 0;
+  size_t worker_count = std::min<size_t>(threads, function_literals.size());
+  std::vector<std::jthread> workers;
+  workers.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.emplace_back([&] {
+      Resolver resolver(tree, diag, std::pmr::get_default_resource());
+      for (size_t j = next++; j < function_literals.size(); j = next++) {
+        resolver.ResolveFunctionLiteral(function_literals[j]);
       }
+    });
+  }
+  workers.clear();
+  return function_literals;
+}
+
+}  // namespace
+
+bool AssignDeclarationsToIdentifiers(ParseTree &tree,
+                                     diag::DiagnosticConsumer &diag,
+                                     DeclarationOptions const &options) {
+  std::vector<FunctionLiteralResolution> function_literals;
+  if (options.threads > 1) {
+    function_literals = ResolveFunctionLiterals(tree, diag, options.threads);
+  }
+
+  Resolver resolver(tree, diag, options.memory_resource);
+  auto function_literal = function_literals.begin();
+  auto [start, end]     = tree.node_range();
+  for (auto i = start; i < end; ++i) {
+    if (function_literal != function_literals.end() and
+        function_literal->start == i) {
+      resolver.Splice(*function_literal);
+      i = function_literal->end;
+      ++function_literal;
+    } else {
+      resolver.Visit(i);
     }
   }
-  return not error;
+  return not resolver.Finish();
 }
 
 }  // namespace ic
@@ -1,16 +1,34 @@
 #ifndef ICARUS_IR_DECLARATION_H
 #define ICARUS_IR_DECLARATION_H
 
+#include <cstdint>
+#include <memory_resource>
+
 #include "diagnostics/consumer/consumer.h"
 #include "parse/tree.h"
 
 namespace ic {
 
+struct DeclarationOptions {
+  // The maximum number of threads used. When more than one thread is used, the
+  // identifiers within each function literal not nested in another are
+  // resolved concurrently, and their results are then combined with those of
+  // the enclosing scopes. Identifiers are assigned the same declarations, and
+  // diagnostics are emitted in the same order, as on a single thread.
+  uint32_t threads = 1;
+
+  // The memory resource from which the symbol table is allocated. Symbol tables
+  // used by individual threads are always allocated from the default resource.
+  std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource();
+};
+
 // Modifies each identifier node in the parse tree to have a corresponding
 // declaration. Returns `false` if any diagnostics were emitted and `true`
-// otherwise.
+// otherwise. Runs in time linear in the size of the tree, regardless of how
+// deeply scopes are nested.
 bool AssignDeclarationsToIdentifiers(ParseTree& tree,
-                                     diag::DiagnosticConsumer& diag);
+                                     diag::DiagnosticConsumer& diag,
+                                     DeclarationOptions const& options = {});
 
 }  // namespace ic
 
@@ -0,0 +1,309 @@
+#include "ir/declaration.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "diagnostics/consumer/buffering.h"
+#include "diagnostics/message.h"
+#include "lexer/lexer.h"
+#include "nth/debug/debug.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+
+namespace ic {
+namespace {
+
+constexpr uint32_t Unresolved = std::numeric_limits<uint32_t>::max();
+
+// The outcome of resolving the identifiers of a source, described by source
+// offsets so that outcomes may be compared across parse trees.
+struct Resolution {
+  // The offset of the declared identifier to which the use at `offset` was
+  // resolved, or `Unresolved`.
+  uint32_t declaration_of(uint32_t offset) const {
+    for (auto [use, declaration] : uses) {
+      if (use == offset) { return declaration; }
+    }
+    NTH_UNREACHABLE();
+  }
+
+  friend bool operator==(Resolution const&, Resolution const&) = default;
+
+  bool success;
+  // The offset of each use of an identifier, in order, along with the offset
+  // of the declared identifier it was resolved to, or `Unresolved`.
+  std::vector<std::pair<uint32_t, uint32_t>> uses;
+  // The index of the declaration to which each declared identifier belongs,
+  // in order.
+  std::vector<uint32_t> declarations;
+  // The text of each diagnostic, in the order emitted, followed by the offsets
+  // of the tokens it quotes.
+  std::vector<std::string> diagnostics;
+};
+
+Resolution Resolve(std::string_view source, uint32_t threads = 1) {
+  diag::BufferingConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  ParseTree tree     = Parse(buffer, d).parse_tree;
+  for (ParseNode& node : tree.nodes()) {
+    if (node.kind == ParseNode::Kind::Identifier) {
+      node.corresponding_declaration_identifier = ParseNodeIndex::Invalid();
+    }
+  }
+
+  Resolution resolution{
+      .success = AssignDeclarationsToIdentifiers(tree, d, {.threads = threads}),
+  };
+  auto [start, end] = tree.node_range();
+  for (auto i = start; i < end; ++i) {
+    switch (tree[i].kind) {
+      case ParseNode::Kind::Identifier: {
+        ParseNodeIndex declaration =
+            tree[i].corresponding_declaration_identifier;
+        resolution.uses.emplace_back(
+            tree.token(i).offset(), declaration == ParseNodeIndex::Invalid()
+                                        ? Unresolved
+                                        : tree.token(declaration).offset());
+      } break;
+      case ParseNode::Kind::DeclaredIdentifier:
+        resolution.declarations.push_back(
+            tree[i].corresponding_declaration.value());
+        break;
+      default: break;
+    }
+  }
+  for (diag::Message const& message : d.take()) {
+    std::string& text = resolution.diagnostics.emplace_back();
+    for (diag::MessageComponent const& component : message.components()) {
+      if (auto const* t = component.As<diag::Text>()) {
+        text.append(t->text());
+      } else if (auto const* quote = component.As<diag::SourceQuote>()) {
+        text.append(" @").append(std::to_string(quote->token().offset()));
+      }
+    }
+  }
+  return resolution;
+}
+
+// Returns the offset of the `n`th occurrence (counting from zero) of `text` in
+// `source`.
+uint32_t Offset(std::string_view source, std::string_view text, int n = 0) {
+  size_t offset = source.find(text);
+  while (n-- > 0) { offset = source.find(text, offset + 1); }
+  NTH_REQUIRE(offset != std::string_view::npos);
+  return offset;
+}
+
+std::string At(uint32_t offset) { return " @" + std::to_string(offset); }
+
+NTH_TEST("declaration/in-order") {
+  std::string_view source = "let value ::= 3\nlet use ::= value\n";
+  Resolution resolution   = Resolve(source);
+  NTH_EXPECT(resolution.success);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "value", 1)) ==
+             Offset(source, "value"));
+  NTH_EXPECT(resolution.diagnostics.empty());
+}
+
+NTH_TEST("declaration/forward-reference") {
+  // Uses may precede a declaration in any enclosing scope.
+  std::string_view source = R"(let f ::= fn() -> i64 { return later }
+let later ::= 3
+let g ::= fn() -> i64 {
+  let h ::= fn() -> i64 { return inner }
+  let inner ::= 4
+  return inner
+}
+)";
+  Resolution resolution = Resolve(source);
+  NTH_EXPECT(resolution.success);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "later")) ==
+             Offset(source, "later", 1));
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "inner")) ==
+             Offset(source, "inner", 1));
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "inner", 2)) ==
+             Offset(source, "inner", 1));
+}
+
+NTH_TEST("declaration/forward-reference/closed-scope") {
+  // A declaration in a scope which does not enclose a use does not resolve it,
+  // even if it is visited after the use.
+  std::string_view source = R"(let f ::= fn() -> i64 { return hidden }
+let g ::= fn() -> i64 {
+  let hidden ::= 1
+  return hidden
+}
+)";
+  Resolution resolution = Resolve(source);
+  NTH_EXPECT(not resolution.success);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "hidden")) ==
+             Unresolved);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "hidden", 2)) ==
+             Offset(source, "hidden", 1));
+  NTH_EXPECT(resolution.diagnostics ==
+             std::vector<std::string>{"Symbol `hidden` has not been declared." +
+                                      At(Offset(source, "hidden"))});
+}
+
+NTH_TEST("declaration/shadows-parent") {
+  std::string_view source = R"(let value ::= 1
+let f ::= fn() -> i64 {
+  let value ::= 2
+  return value
+}
+)";
+  Resolution resolution = Resolve(source);
+  NTH_EXPECT(not resolution.success);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "value", 2)) ==
+             Offset(source, "value", 1));
+  NTH_EXPECT(resolution.diagnostics ==
+             std::vector<std::string>{
+                 "Symbol `value` has been declared in a parent scope." +
+                 At(Offset(source, "value"))});
+}
+
+NTH_TEST("declaration/shadows-closed-nested-scope") {
+  std::string_view source = R"(let condition ::= true
+if (condition) {
+  let value ::= 1
+}
+let value ::= 2
+)";
+  Resolution resolution = Resolve(source);
+  NTH_EXPECT(not resolution.success);
+  NTH_EXPECT(resolution.diagnostics ==
+             std::vector<std::string>{
+                 "Symbol `value` has been declared in a parent scope." +
+                 At(Offset(source, "value", 1))});
+}
+
+NTH_TEST("declaration/sibling-scopes") {
+  // Declarations in scopes which do not enclose one another do not conflict.
+  std::string_view source = R"(let f ::= fn() -> i64 {
+  let value ::= 1
+  return value
+}
+let g ::= fn() -> i64 {
+  let value ::= 2
+  return value
+}
+)";
+  Resolution resolution = Resolve(source);
+  NTH_EXPECT(resolution.success);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "value", 1)) ==
+             Offset(source, "value"));
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "value", 3)) ==
+             Offset(source, "value", 2));
+}
+
+NTH_TEST("declaration/same-scope") {
+  std::string_view source =
+      "let value ::= 1\nlet value ::= 2\nlet use ::= value\n";
+  Resolution resolution = Resolve(source);
+  NTH_EXPECT(not resolution.success);
+  // Later uses refer to the first declaration.
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "value", 2)) ==
+             Offset(source, "value"));
+  NTH_EXPECT(resolution.diagnostics ==
+             std::vector<std::string>{
+                 "Symbol has been declared previously in the same scope." +
+                 At(Offset(source, "value")) + At(Offset(source, "value", 1))});
+}
+
+NTH_TEST("declaration/undeclared") {
+  // Each use of an undeclared identifier is reported, in order.
+  std::string_view source = "let a ::= missing\nlet b ::= missing + other\n";
+  Resolution resolution   = Resolve(source);
+  NTH_EXPECT(not resolution.success);
+  NTH_EXPECT(resolution.declaration_of(Offset(source, "missing")) ==
+             Unresolved);
+  NTH_EXPECT(resolution.diagnostics ==
+             std::vector<std::string>{
+                 "Symbol `missing` has not been declared." +
+                     At(Offset(source, "missing")),
+                 "Symbol `missing` has not been declared." +
+                     At(Offset(source, "missing", 1)),
+                 "Symbol `other` has not been declared." +
+                     At(Offset(source, "other")),
+             });
+}
+
+// Returns a source with many function literals, which shadow parameters and
+// module-level declarations, use module-level declarations which precede and
+// follow them, and use undeclared identifiers.
+std::string GeneratedSource() {
+  std::string source;
+  for (int i = 0; i < 24; ++i) {
+    std::string n = std::to_string(i);
+    source += "let f" + n + " ::= fn(let n: i64) -> i64 {\n";
+    source += "  let local ::= n + shared + f0(n)\n";
+    if (i % 3 == 0) { source += "  let shared ::= local\n"; }
+    if (i % 4 == 1) { source += "  let k ::= missing" + n + "\n"; }
+    if (i % 5 == 2) { source += "  let n ::= 2\n"; }
+    if (i % 6 == 0) {
+      source += "  let inner ::= fn(let m: i64) -> i64 {\n";
+      source += "    let local ::= m\n";
+      source += "    return local + shared + absent\n";
+      source += "  }\n";
+    }
+    source += "  return f" + std::to_string((i + 1) % 24) + "(local)\n}\n";
+    if (i % 7 == 3) { source += "let before" + n + " ::= shared\n"; }
+  }
+  source += "let shared ::= 3\nlet n ::= 4\nlet top ::= f5(shared)\n";
+  return source;
+}
+
+NTH_TEST("declaration/threads", uint32_t threads) {
+  std::string source = GeneratedSource();
+  Resolution serial  = Resolve(source);
+  NTH_ASSERT(not serial.success);
+  NTH_ASSERT(not serial.diagnostics.empty());
+  NTH_EXPECT(Resolve(source, threads) == serial);
+}
+
+NTH_INVOKE_TEST("declaration/threads") {
+  for (uint32_t threads : {2, 3, 8, 64}) { co_yield threads; }
+}
+
+NTH_TEST("declaration/threads/small", std::string_view source) {
+  Resolution serial = Resolve(source);
+  for (uint32_t threads : {2, 4}) {
+    NTH_EXPECT(Resolve(source, threads) == serial);
+  }
+}
+
+NTH_INVOKE_TEST("declaration/threads/small") {
+  co_yield std::string_view(R"(let f ::= fn() -> i64 { return later }
+let later ::= 3
+)");
+  co_yield std::string_view(R"(let f ::= fn() -> i64 { return hidden }
+let g ::= fn() -> i64 {
+  let hidden ::= 1
+  return hidden
+}
+)");
+  co_yield std::string_view(R"(let value ::= 1
+let f ::= fn() -> i64 {
+  let value ::= 2
+  return value
+}
+)");
+  co_yield std::string_view(R"(let f ::= fn(let value: i64) -> i64 {
+  return value
+}
+let value ::= 2
+)");
+  co_yield std::string_view(R"(let f ::= fn() -> i64 {
+  let value ::= 1
+  let value ::= 2
+  return missing
+}
+)");
+}
+
+}  // namespace
+}  // namespace ic
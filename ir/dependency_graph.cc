@@ -0,0 +1,360 @@
+#include "ir/dependency_graph.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "nth/debug/debug.h"
+
+namespace ic {
+namespace {
+
+// The declaration of the identifier at `index`, or `ParseNodeIndex::Invalid()`
+// if it was not assigned one.
+ParseNodeIndex DeclarationOf(ParseTree const& tree, ParseNodeIndex index) {
+  ParseNodeIndex identifier = tree[index].corresponding_declaration_identifier;
+  if (identifier == ParseNodeIndex::Invalid() or
+      identifier.value() >= tree.size()) {
+    return ParseNodeIndex::Invalid();
+  }
+  return tree[identifier].corresponding_declaration;
+}
+
+}  // namespace
+
+DependencyGraph::DependencyGraph(std::pmr::memory_resource* memory_resource)
+    : memory_resource_(memory_resource),
+      units_(memory_resource),
+      owners_(memory_resource),
+      children_(memory_resource),
+      dependencies_(memory_resource),
+      dependents_(memory_resource) {}
+
+DependencyGraph::DependencyGraph(ParseTree const& tree,
+                                 std::pmr::memory_resource* memory_resource)
+    : DependencyGraph(memory_resource) {
+  auto [start, end] = tree.node_range();
+  units_.push_back({.range = tree.node_range(), .parent = Unit::Module()});
+  for (auto index = start; index < end; ++index) {
+    if (tree[index].kind != ParseNode::Kind::ScopeStart) { continue; }
+    for (ParseNodeIndex child :
+         tree.child_indices(tree[index].corresponding_statement_sequence)) {
+      if (child == index) { continue; }
+      units_.push_back(
+          {.range = tree.subtree_range(child), .parent = Unit::Module()});
+    }
+  }
+  // Sorting by the first node of each unit orders units so that each precedes
+  // those nested within it.
+  std::sort(units_.begin() + 1, units_.end(),
+            [](UnitInfo const& l, UnitInfo const& r) {
+              return l.range.lower_bound() < r.range.lower_bound();
+            });
+
+  // Sweep through the nodes maintaining the stack of units containing the
+  // current node, whose top is the unit that owns it.
+  std::pmr::vector<Edge> edges(memory_resource);
+  owners_.reserve(tree.size());
+  std::vector<Unit> open = {Unit::Module()};
+  uint32_t next = 1;
+  for (auto index = start; index < end; ++index) {
+    while (units_[open.back().value()].range.upper_bound() <= index) {
+      open.pop_back();
+    }
+    for (; next < units_.size() and units_[next].range.lower_bound() == index;
+         ++next) {
+      NTH_REQUIRE((v.debug), units_[next].range.upper_bound() <=
+                                 units_[open.back().value()].range.upper_bound());
+      units_[next].parent = open.back();
+      edges.push_back({.from = Unit(next), .to = open.back()});
+      open.push_back(Unit(next));
+    }
+    owners_.push_back(open.back());
+  }
+
+  for (auto index = start; index < end; ++index) {
+    if (tree[index].kind != ParseNode::Kind::Identifier) { continue; }
+    ParseNodeIndex declaration = DeclarationOf(tree, index);
+    if (declaration == ParseNodeIndex::Invalid() or
+        declaration.value() >= tree.size()) {
+      continue;
+    }
+    Unit from = owners_[index.value()];
+    Unit to   = owners_[declaration.value()];
+    // Declarations earlier in the same unit are handled in order and need no
+    // edge. Those later in the same unit can only be handled by breaking the
+    // resulting cycle.
+    if (from == to and declaration < index) { continue; }
+    edges.push_back({.from = from, .to = to});
+  }
+  Link(edges);
+}
+
+DependencyGraph DependencyGraph::TopLevel() const {
+  DependencyGraph graph(memory_resource_);
+  // Maps each unit to the unit of the top-level graph absorbing it.
+  std::vector<Unit> absorbed_by(units_.size(), Unit::Module());
+  graph.units_.push_back(units_[0]);
+  for (uint32_t u = 1; u < units_.size(); ++u) {
+    Unit parent = units_[u].parent;
+    if (parent == Unit::Module()) {
+      absorbed_by[u] = Unit(graph.units_.size());
+      graph.units_.push_back(units_[u]);
+    } else {
+      absorbed_by[u] = absorbed_by[parent.value()];
+    }
+  }
+
+  graph.owners_.reserve(owners_.size());
+  for (Unit owner : owners_) {
+    graph.owners_.push_back(absorbed_by[owner.value()]);
+  }
+
+  std::pmr::vector<Edge> edges(memory_resource_);
+  for (uint32_t u = 0; u < units_.size(); ++u) {
+    Unit from = absorbed_by[u];
+    for (Unit dependency : dependencies(Unit(u))) {
+      Unit to = absorbed_by[dependency.value()];
+      if (from != to) { edges.push_back({.from = from, .to = to}); }
+    }
+  }
+  graph.Link(edges);
+  return graph;
+}
+
+void DependencyGraph::Link(std::pmr::vector<Edge>& edges) {
+  std::sort(edges.begin(), edges.end(), [](Edge const& l, Edge const& r) {
+    return l.from.value() != r.from.value() ? l.from.value() < r.from.value()
+                                            : l.to.value() < r.to.value();
+  });
+  edges.erase(std::unique(edges.begin(), edges.end(),
+                          [](Edge const& l, Edge const& r) {
+                            return l.from == r.from and l.to == r.to;
+                          }),
+              edges.end());
+
+  // Builds the rows of `rows` from `count` entries, the `i`th of which is
+  // associated with unit `key(i)` and holds unit `value(i)`. Entries associated
+  // with the same unit retain their relative order.
+  auto fill = [&](Rows& rows, size_t count, auto key, auto value) {
+    rows.offsets.assign(units_.size() + 1, 0);
+    for (size_t i = 0; i < count; ++i) { ++rows.offsets[key(i).value() + 1]; }
+    for (size_t u = 0; u < units_.size(); ++u) {
+      rows.offsets[u + 1] += rows.offsets[u];
+    }
+    std::vector<uint32_t> cursor(rows.offsets.begin(), rows.offsets.end() - 1);
+    rows.units.resize(count, Unit::Module());
+    for (size_t i = 0; i < count; ++i) {
+      rows.units[cursor[key(i).value()]++] = value(i);
+    }
+  };
+
+  fill(
+      children_, units_.size() - 1,
+      [&](size_t i) { return units_[i + 1].parent; },
+      [&](size_t i) { return Unit(i + 1); });
+  fill(
+      dependencies_, edges.size(), [&](size_t i) { return edges[i].from; },
+      [&](size_t i) { return edges[i].to; });
+  // Edges are sorted by their source, so dependents are in increasing order.
+  fill(
+      dependents_, edges.size(), [&](size_t i) { return edges[i].to; },
+      [&](size_t i) { return edges[i].from; });
+}
+
+DependencyScheduler::DependencyScheduler(DependencyGraph const& graph)
+    : graph_(graph),
+      states_(graph.size(), State::Waiting),
+      remaining_(graph.size()) {
+  for (uint32_t u = 0; u < graph_.size(); ++u) {
+    remaining_[u] = graph_.dependencies(Unit(u)).size();
+    if (remaining_[u] == 0) {
+      states_[u] = State::Ready;
+      ready_.push(Unit(u));
+    }
+  }
+}
+
+std::optional<DependencyScheduler::Unit> DependencyScheduler::Next() {
+  if (ready_.empty()) { return std::nullopt; }
+  Unit unit = ready_.front();
+  ready_.pop();
+  states_[unit.value()] = State::HandedOut;
+  return unit;
+}
+
+void DependencyScheduler::Defer(Unit unit) {
+  NTH_REQUIRE((v.harden), states_[unit.value()] == State::HandedOut);
+  states_[unit.value()] = State::Ready;
+  ready_.push(unit);
+}
+
+void DependencyScheduler::Complete(Unit unit) {
+  NTH_REQUIRE((v.harden), states_[unit.value()] == State::HandedOut);
+  states_[unit.value()] = State::Complete;
+  for (Unit dependent : graph_.dependents(unit)) {
+    if (--remaining_[dependent.value()] == 0 and
+        states_[dependent.value()] == State::Waiting) {
+      states_[dependent.value()] = State::Ready;
+      ready_.push(dependent);
+    }
+  }
+}
+
+void DependencyScheduler::FindComponents() {
+  // Tarjan's algorithm, restricted to waiting units. Each component is found
+  // only after every component reachable from it, so components are recorded
+  // in an order in which no unit depends on a unit of a later component.
+  static constexpr uint32_t Unvisited = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> order(graph_.size(), Unvisited);
+  std::vector<uint32_t> low(graph_.size());
+  std::vector<bool> on_stack(graph_.size());
+  std::vector<uint32_t> stack;
+  struct Frame {
+    uint32_t unit;
+    uint32_t next_dependency;
+  };
+  std::vector<Frame> frames;
+  uint32_t visited = 0;
+  auto visit       = [&](uint32_t u) {
+    order[u] = low[u] = visited++;
+    on_stack[u]       = true;
+    stack.push_back(u);
+    frames.push_back({.unit = u, .next_dependency = 0});
+  };
+
+  component_offsets_.push_back(0);
+  for (uint32_t root = 0; root < graph_.size(); ++root) {
+    if (states_[root] != State::Waiting or order[root] != Unvisited) {
+      continue;
+    }
+    visit(root);
+    while (not frames.empty()) {
+      auto [u, next]    = frames.back();
+      auto dependencies = graph_.dependencies(Unit(u));
+      if (next < dependencies.size()) {
+        ++frames.back().next_dependency;
+        uint32_t d = dependencies[next].value();
+        if (states_[d] != State::Waiting) { continue; }
+        if (order[d] == Unvisited) {
+          visit(d);
+        } else if (on_stack[d]) {
+          low[u] = std::min(low[u], order[d]);
+        }
+        continue;
+      }
+
+      frames.pop_back();
+      if (not frames.empty()) {
+        uint32_t& parent_low = low[frames.back().unit];
+        parent_low           = std::min(parent_low, low[u]);
+      }
+      if (low[u] != order[u]) { continue; }
+
+      size_t first = component_units_.size();
+      uint32_t w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        on_stack[w] = false;
+        component_units_.emplace_back(w);
+      } while (w != u);
+      std::sort(component_units_.begin() + first, component_units_.end(),
+                [](Unit l, Unit r) { return l.value() < r.value(); });
+      component_offsets_.push_back(component_units_.size());
+    }
+  }
+}
+
+std::vector<DependencyScheduler::Unit> DependencyScheduler::NextComponent() {
+  NTH_REQUIRE((v.harden), ready_.empty());
+  // Units only ever stop waiting, so the components among the units waiting
+  // now are found once and handed out in turn.
+  if (component_offsets_.empty()) { FindComponents(); }
+  while (next_component_ + 1 < component_offsets_.size()) {
+    std::span component =
+        std::span(component_units_)
+            .subspan(component_offsets_[next_component_],
+                     component_offsets_[next_component_ + 1] -
+                         component_offsets_[next_component_]);
+    ++next_component_;
+    // A unit which does not lie on a cycle, but depended on one, becomes ready
+    // once that cycle completes, and is handed out by `Next` instead. Units on
+    // a cycle never become ready, so no component is partially handed out.
+    if (states_[component.front().value()] != State::Waiting) { continue; }
+    for (Unit unit : component) {
+      states_[unit.value()] = State::HandedOut;
+    }
+    return std::vector<Unit>(component.begin(), component.end());
+  }
+  return {};
+}
+
+ConcurrentDependencyScheduler::ConcurrentDependencyScheduler(
+    DependencyGraph const& graph, uint32_t workers)
+    : scheduler_(graph), ready_(std::max<uint32_t>(workers, 1)) {
+  std::lock_guard lock(mutex_);
+  TakeReady(0);
+}
+
+void ConcurrentDependencyScheduler::TakeReady(uint32_t worker) {
+  while (std::optional unit = scheduler_.Next()) {
+    ready_[worker].push_back(*unit);
+  }
+}
+
+bool ConcurrentDependencyScheduler::Next(uint32_t worker, Work& work) {
+  work.units.clear();
+  work.cycle = false;
+  std::unique_lock lock(mutex_);
+  while (true) {
+    if (not ready_[worker].empty()) {
+      work.units.push_back(ready_[worker].back());
+      ready_[worker].pop_back();
+      ++in_progress_;
+      return true;
+    }
+    for (size_t i = 1; i < ready_.size(); ++i) {
+      auto& victim = ready_[(worker + i) % ready_.size()];
+      if (victim.empty()) { continue; }
+      work.units.push_back(victim.front());
+      victim.pop_front();
+      ++in_progress_;
+      return true;
+    }
+    if (done_) { return false; }
+    if (in_progress_ == 0) {
+      work.units = scheduler_.NextComponent();
+      if (work.units.empty()) {
+        done_ = true;
+        changed_.notify_all();
+        return false;
+      }
+      work.cycle = true;
+      in_progress_ += work.units.size();
+      return true;
+    }
+    changed_.wait(lock);
+  }
+}
+
+void ConcurrentDependencyScheduler::Defer(uint32_t worker, Unit unit) {
+  std::lock_guard lock(mutex_);
+  scheduler_.Defer(unit);
+  // Ready units are always taken from `scheduler_` right away, so `unit` is
+  // the only one it holds.
+  std::optional next = scheduler_.Next();
+  NTH_REQUIRE((v.harden), next == unit);
+  ready_[worker].push_front(unit);
+  --in_progress_;
+  changed_.notify_all();
+}
+
+void ConcurrentDependencyScheduler::Complete(uint32_t worker, Unit unit) {
+  std::lock_guard lock(mutex_);
+  scheduler_.Complete(unit);
+  TakeReady(worker);
+  --in_progress_;
+  changed_.notify_all();
+}
+
+}  // namespace ic
@@ -0,0 +1,224 @@
+#ifndef ICARUS_IR_DEPENDENCY_GRAPH_H
+#define ICARUS_IR_DEPENDENCY_GRAPH_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <span>
+#include <vector>
+
+#include "common/strong_identifier_type.h"
+#include "nth/base/attributes.h"
+#include "nth/container/interval.h"
+#include "parse/node_index.h"
+#include "parse/tree.h"
+
+namespace ic {
+
+// Partitions the nodes of a parse tree into units of work: the module as a
+// whole, and each statement of every statement sequence. A unit consists of the
+// nodes in its subtree, other than those of the units nested within it.
+//
+// A unit depends on the unit it is nested within, as well as on the unit
+// containing the declaration of each identifier it uses. An identifier used
+// before its declaration within the same unit makes that unit depend on
+// itself. Dependencies are computed from the declarations assigned to
+// identifiers by `AssignDeclarationsToIdentifiers`, which must have been
+// called on the tree beforehand.
+struct DependencyGraph {
+  struct Unit : StrongIdentifierType<Unit, uint32_t> {
+    using StrongIdentifierType::StrongIdentifierType;
+
+    // The unit consisting of the entire module.
+    static constexpr Unit Module() { return Unit(0); }
+  };
+
+  explicit DependencyGraph(
+      ParseTree const& tree,
+      std::pmr::memory_resource* memory_resource =
+          std::pmr::get_default_resource());
+
+  // Returns the graph whose units are the module and each of its top-level
+  // statements. Each top-level statement absorbs the units nested within it,
+  // along with their dependencies on units outside of it.
+  DependencyGraph TopLevel() const;
+
+  size_t size() const { return units_.size(); }
+
+  // The nodes in the subtree of `unit`, including those of units nested within
+  // it.
+  nth::interval<ParseNodeIndex> range(Unit unit) const {
+    return units_[unit.value()].range;
+  }
+
+  // The units nested directly within `unit`, in source order.
+  std::span<Unit const> children(Unit unit) const {
+    return Slice(children_, unit);
+  }
+
+  // The innermost unit containing the node at `index`.
+  Unit owner(ParseNodeIndex index) const { return owners_[index.value()]; }
+
+  // The units on which `unit` depends, and those which depend on `unit`, each
+  // in increasing order and without repetition.
+  std::span<Unit const> dependencies(Unit unit) const {
+    return Slice(dependencies_, unit);
+  }
+  std::span<Unit const> dependents(Unit unit) const {
+    return Slice(dependents_, unit);
+  }
+
+ private:
+  struct Edge {
+    Unit from;
+    Unit to;
+  };
+
+  // Units stored in compressed rows: The units associated with unit `u` are
+  // `units[offsets[u]]` through `units[offsets[u + 1] - 1]`.
+  struct Rows {
+    explicit Rows(std::pmr::memory_resource* memory_resource)
+        : offsets(memory_resource), units(memory_resource) {}
+
+    std::pmr::vector<uint32_t> offsets;
+    std::pmr::vector<Unit> units;
+  };
+
+  struct UnitInfo {
+    nth::interval<ParseNodeIndex> range;
+    Unit parent;
+  };
+
+  explicit DependencyGraph(std::pmr::memory_resource* memory_resource);
+
+  static std::span<Unit const> Slice(Rows const& rows, Unit unit) {
+    return std::span(rows.units)
+        .subspan(rows.offsets[unit.value()],
+                 rows.offsets[unit.value() + 1] - rows.offsets[unit.value()]);
+  }
+
+  // Populates `children_`, `dependencies_`, and `dependents_` from `units_` and
+  // `edges`.
+  void Link(std::pmr::vector<Edge>& edges);
+
+  std::pmr::memory_resource* memory_resource_;
+  std::pmr::vector<UnitInfo> units_;
+  std::pmr::vector<Unit> owners_;
+  Rows children_;
+  Rows dependencies_;
+  Rows dependents_;
+};
+
+// Hands out the units of a `DependencyGraph` in an order consistent with their
+// dependencies: A unit becomes ready once every unit it depends on has
+// completed, and ready units are handed out in the order in which they became
+// ready. Units which lie on a cycle, or depend on one, never become ready;
+// they are handed out one strongly connected component at a time by
+// `NextComponent`.
+struct DependencyScheduler {
+  using Unit = DependencyGraph::Unit;
+
+  explicit DependencyScheduler(
+      DependencyGraph const& graph NTH_ATTRIBUTE(lifetimebound));
+
+  // Returns the ready unit which was handed out least recently, if any.
+  std::optional<Unit> Next();
+
+  // Hands `unit`, which must be handed out and incomplete, back to the
+  // scheduler, which will hand it out again after every unit currently ready.
+  void Defer(Unit unit);
+
+  // Marks `unit`, which must be handed out, as complete.
+  void Complete(Unit unit);
+
+  // Must only be called when no unit is ready and every unit which has been
+  // handed out is complete. Hands out the units of a strongly connected
+  // component which depends on no other incomplete unit, in increasing order.
+  // Returns an empty vector when every unit has been handed out. The
+  // components are found on the first call, in time linear in the size of the
+  // graph, and later calls take amortized constant time.
+  std::vector<Unit> NextComponent();
+
+  bool complete(Unit unit) const {
+    return states_[unit.value()] == State::Complete;
+  }
+
+ private:
+  enum class State : uint8_t { Waiting, Ready, HandedOut, Complete };
+
+  // Populates `component_units_` and `component_offsets_` with the strongly
+  // connected components of the waiting units.
+  void FindComponents();
+
+  DependencyGraph const& graph_;
+  std::vector<State> states_;
+  // For each unit, the number of units it depends on which are incomplete.
+  std::vector<uint32_t> remaining_;
+  std::queue<Unit> ready_;
+  // The strongly connected components of the units which were waiting when
+  // `NextComponent` was first called, ordered so that no unit depends on a
+  // unit of a later component. Component `i` consists of the units in
+  // `component_units_` from `component_offsets_[i]` up to
+  // `component_offsets_[i + 1]`. `component_offsets_` is empty until the
+  // components are found.
+  std::vector<Unit> component_units_;
+  std::vector<uint32_t> component_offsets_;
+  // The index of the next component to consider handing out.
+  size_t next_component_ = 0;
+};
+
+// Hands out the units of a `DependencyGraph` to several threads, each
+// identified by a worker index, in an order consistent with their
+// dependencies. Each worker has its own deque of ready units: Units made ready
+// when a worker completes a unit are pushed onto the back of that worker's
+// deque, and a worker takes units from the back of its own deque, or, when its
+// own is empty, steals them from the front of another's. Once no unit is ready
+// or being processed, the remaining units lie on or depend on a cycle, and the
+// units of a strongly connected component are handed to one worker together.
+struct ConcurrentDependencyScheduler {
+  using Unit = DependencyGraph::Unit;
+
+  explicit ConcurrentDependencyScheduler(
+      DependencyGraph const& graph NTH_ATTRIBUTE(lifetimebound),
+      uint32_t workers);
+
+  struct Work {
+    // Either a single ready unit, or the units of a strongly connected
+    // component in increasing order.
+    std::vector<Unit> units;
+    bool cycle = false;
+  };
+
+  // Blocks until there is work for `worker`, populating `work` with it.
+  // Returns `false`, leaving `work` empty, once every unit is complete.
+  bool Next(uint32_t worker, Work& work);
+
+  // Hands `unit`, which must have been handed to `worker` and be incomplete,
+  // back to the scheduler. It will be handed out again after every unit
+  // currently in the deque of `worker`.
+  void Defer(uint32_t worker, Unit unit);
+
+  // Marks `unit`, which must have been handed to `worker`, as complete.
+  void Complete(uint32_t worker, Unit unit);
+
+ private:
+  // Pushes units made ready onto the back of the deque of `worker`. Must be
+  // called with `mutex_` held.
+  void TakeReady(uint32_t worker);
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  DependencyScheduler scheduler_;
+  std::vector<std::deque<Unit>> ready_;
+  // The number of units handed out and not yet complete or deferred.
+  size_t in_progress_ = 0;
+  bool done_          = false;
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_IR_DEPENDENCY_GRAPH_H
@@ -0,0 +1,188 @@
+#include "ir/dependency_graph.h"
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "diagnostics/consumer/null.h"
+#include "ir/declaration.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+
+namespace ic {
+namespace {
+
+using Unit = DependencyGraph::Unit;
+
+// Invokes `f` with the dependency graph of `source`.
+void WithGraph(std::string_view source, auto f) {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  ParseTree tree     = Parse(buffer, d).parse_tree;
+  NTH_ASSERT(AssignDeclarationsToIdentifiers(tree, d));
+  f(DependencyGraph(tree));
+}
+
+// Returns the units of `graph` in the order handed out by a scheduler, each
+// unit completing as soon as it is handed out. Each element holds either a
+// single ready unit or the units of a strongly connected component.
+std::vector<std::vector<Unit>> Schedule(DependencyGraph const& graph) {
+  std::vector<std::vector<Unit>> schedule;
+  DependencyScheduler scheduler(graph);
+  while (true) {
+    if (std::optional unit = scheduler.Next()) {
+      schedule.push_back({*unit});
+      scheduler.Complete(*unit);
+      continue;
+    }
+    std::vector component = scheduler.NextComponent();
+    if (component.empty()) { break; }
+    for (Unit unit : component) { scheduler.Complete(unit); }
+    schedule.push_back(std::move(component));
+  }
+  return schedule;
+}
+
+NTH_TEST("dependency-graph/in-order") {
+  WithGraph("let x ::= 3\nlet y ::= x\n", [](DependencyGraph const& graph) {
+    NTH_ASSERT(graph.size() == 3);
+    NTH_EXPECT(Schedule(graph) ==
+               std::vector<std::vector<Unit>>{{Unit(0)}, {Unit(1)}, {Unit(2)}});
+  });
+}
+
+NTH_TEST("dependency-graph/out-of-order") {
+  WithGraph("let x ::= y\nlet y ::= 3\n", [](DependencyGraph const& graph) {
+    NTH_ASSERT(graph.size() == 3);
+    NTH_EXPECT(graph.dependencies(Unit(1)).size() == 2);
+    NTH_EXPECT(Schedule(graph) ==
+               std::vector<std::vector<Unit>>{{Unit(0)}, {Unit(2)}, {Unit(1)}});
+  });
+}
+
+NTH_TEST("dependency-graph/nested") {
+  WithGraph("let a ::= 1\nif (a) {\n  let b ::= a\n}\n",
+            [](DependencyGraph const& graph) {
+              NTH_ASSERT(graph.size() == 4);
+              NTH_EXPECT(std::vector(graph.children(Unit::Module()).begin(),
+                                     graph.children(Unit::Module()).end()) ==
+                         std::vector{Unit(1), Unit(2)});
+              NTH_ASSERT(graph.children(Unit(2)).size() == 1);
+              NTH_EXPECT(graph.children(Unit(2))[0] == Unit(3));
+              auto [start, end] = graph.range(Unit(3));
+              NTH_EXPECT(graph.owner(start) == Unit(3));
+              NTH_EXPECT(graph.owner(end) == Unit(2));
+
+              DependencyGraph top_level = graph.TopLevel();
+              NTH_EXPECT(top_level.size() == 3);
+              NTH_EXPECT(top_level.owner(start) == Unit(2));
+            });
+}
+
+NTH_TEST("dependency-graph/cycle") {
+  WithGraph("let x ::= y\nlet y ::= x\nlet z ::= x\n",
+            [](DependencyGraph const& graph) {
+              NTH_EXPECT(Schedule(graph) == std::vector<std::vector<Unit>>{
+                                                {Unit(0)},
+                                                {Unit(1), Unit(2)},
+                                                {Unit(3)},
+                                            });
+            });
+}
+
+NTH_TEST("dependency-graph/cycles") {
+  // Cycles are handed out after every cycle they depend on, and units which
+  // depend on a cycle become ready once it completes.
+  WithGraph(
+      "let a1 ::= b1 + c\nlet b1 ::= a1\nlet c ::= a0\nlet a0 ::= b0\n"
+      "let b0 ::= a0\nlet d ::= d\n",
+      [](DependencyGraph const& graph) {
+        NTH_EXPECT(Schedule(graph) == std::vector<std::vector<Unit>>{
+                                          {Unit(0)},
+                                          {Unit(4), Unit(5)},
+                                          {Unit(3)},
+                                          {Unit(1), Unit(2)},
+                                          {Unit(6)},
+                                      });
+      });
+}
+
+NTH_TEST("dependency-graph/self-reference") {
+  WithGraph("let x ::= x\n", [](DependencyGraph const& graph) {
+    NTH_EXPECT(Schedule(graph) ==
+               std::vector<std::vector<Unit>>{{Unit(0)}, {Unit(1)}});
+    NTH_EXPECT(graph.dependencies(Unit(1)).size() == 2);
+    NTH_EXPECT(graph.TopLevel().dependencies(Unit(1)).size() == 1);
+  });
+}
+
+NTH_TEST("dependency-graph/mutual-recursion") {
+  WithGraph(R"(let f ::= fn(let n: i64) -> i64 { return g(n) }
+let g ::= fn(let n: i64) -> i64 { return f(n) }
+)",
+            [](DependencyGraph const& graph) {
+              // Function bodies depend on the declarations of both functions,
+              // but neither declaration depends on either body.
+              for (auto const& step : Schedule(graph)) {
+                NTH_EXPECT(step.size() == 1);
+              }
+              // At the top level, the bodies are absorbed into the
+              // declarations, which then depend on one another.
+              NTH_EXPECT(Schedule(graph.TopLevel()) ==
+                         std::vector<std::vector<Unit>>{
+                             {Unit(0)},
+                             {Unit(1), Unit(2)},
+                         });
+            });
+}
+
+NTH_TEST("concurrent-dependency-scheduler/respects-dependencies") {
+  std::string source;
+  for (int i = 0; i < 64; ++i) {
+    // Each declaration depends on the one after it, and every fourth on one
+    // later still, forming cycles.
+    source.append("let x").append(std::to_string(i)).append(" ::= ");
+    source.append("x").append(std::to_string(i + 1));
+    if (i % 4 == 0) { source.append(" + x").append(std::to_string(i + 2)); }
+    source.append("\n");
+  }
+  source.append("let x64 ::= x0\nlet x65 ::= 1\n");
+  source.append("let f ::= fn(let n: i64) -> i64 {\n  return n\n}\n");
+
+  WithGraph(source, [](DependencyGraph const& graph) {
+    std::vector<std::atomic<int>> processed(graph.size());
+    std::atomic<bool> ordered = true;
+    ConcurrentDependencyScheduler scheduler(graph, 4);
+    auto work = [&](uint32_t worker) {
+      ConcurrentDependencyScheduler::Work work;
+      while (scheduler.Next(worker, work)) {
+        for (Unit unit : work.units) {
+          for (Unit dependency : graph.dependencies(unit)) {
+            if (processed[dependency.value()] != 0) { continue; }
+            if (not work.cycle or
+                not std::ranges::binary_search(
+                    work.units, dependency.value(), std::ranges::less{},
+                    [](Unit u) { return u.value(); })) {
+              ordered = false;
+            }
+          }
+          ++processed[unit.value()];
+          scheduler.Complete(worker, unit);
+        }
+      }
+    };
+    {
+      std::vector<std::jthread> threads;
+      for (uint32_t i = 1; i < 4; ++i) { threads.emplace_back(work, i); }
+      work(0);
+    }
+    NTH_EXPECT(ordered.load());
+    for (auto const& count : processed) { NTH_EXPECT(count.load() == 1); }
+  });
+}
+
+}  // namespace
+}  // namespace ic
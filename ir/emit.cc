@@ -1,5 +1,8 @@
 #include "ir/emit.h"
 
+#include <algorithm>
+#include <variant>
+
 #include "common/debug.h"
 #include "common/module_id.h"
 #include "common/resources.h"
@@ -183,16 +186,16 @@ Iteration HandleParseTreeNodeScopeLiteralStart(ParseNodeIndex index,
 
 void HandleParseTreeNodeBooleanLiteral(ParseNodeIndex index,
                                        EmitContext& context) {
-  auto node = context.Node(index);
-  NTH_REQUIRE((v.debug), node.token.kind() == Token::Kind::True or
-                             node.token.kind() == Token::Kind::False);
-  context.current_function().append<jasmin::Push<bool>>(node.token.kind() ==
+  Token token = context.TokenOf(index);
+  NTH_REQUIRE((v.debug), token.kind() == Token::Kind::True or
+                             token.kind() == Token::Kind::False);
+  context.current_function().append<jasmin::Push<bool>>(token.kind() ==
                                                         Token::Kind::True);
 }
 
 void HandleParseTreeNodeNullTypeLiteral(ParseNodeIndex index,
                                         EmitContext& context) {
-  NTH_REQUIRE((v.debug), context.Node(index).token.kind() == Token::Kind::Null);
+  NTH_REQUIRE((v.debug), context.TokenOf(index).kind() == Token::Kind::Null);
   context.current_function().append<PushNull>();
 }
 
@@ -200,14 +203,18 @@ void HandleParseTreeNodeIntegerLiteral(ParseNodeIndex index,
                                        EmitContext& context) {
   // TODO: Push an actual arbitrary-precision integer.
   // TODO: ToRepresentation is not right for large values.
+  Integer n = std::visit(
+      [](auto const& value) { return Integer(value); },
+      context.tree.token_buffer().integer_literal(
+          context.tree[index].token_index));
   context.current_function().append<jasmin::Push<int64_t>>(
-      Integer::ToRepresentation(context.Node(index).token.AsInteger()));
+      Integer::ToRepresentation(n));
 }
 
 void HandleParseTreeNodeStringLiteral(ParseNodeIndex index,
                                       EmitContext& context) {
   std::string_view s =
-      resources.StringLiteral(context.Node(index).token.AsStringLiteralIndex());
+      resources.StringLiteral(context.tree.string_literal_index(index));
   context.current_function().append<PushStringLiteral>(StringLiteral(s));
 }
 
@@ -215,13 +222,12 @@ void HandleParseTreeNodeCharacterLiteral(ParseNodeIndex index,
                                          EmitContext& context) {
   // TODO: Distinguish char from uint8_t and int8_T.
   context.current_function().append<jasmin::Push<char>>(
-      context.Node(index).token.AsCharacterLiteral());
+      context.TokenOf(index).AsCharacterLiteral());
 }
 
 void HandleParseTreeNodeTypeLiteral(ParseNodeIndex index,
                                     EmitContext& context) {
-  auto node = context.Node(index);
-  switch (node.token.kind()) {
+  switch (context.TokenOf(index).kind()) {
 #define IC_XMACRO_PRIMITIVE_TYPE(kind, symbol, spelling)                       \
   case Token::Kind::kind:                                                      \
     context.current_function().append<jasmin::Push<type::Type>>(type::symbol); \
@@ -440,8 +446,8 @@ Iteration HandleParseTreeNodeIdentifier(ParseNodeIndex index,
     }
     return Iteration::Continue;
   } else {
-    context.queue.emplace(context.queue.front()).range =
-        context.tree.subtree_range(decl_index);
+    context.queue.push(
+        context.queue.front().share(context.tree.subtree_range(decl_index)));
     return Iteration::PauseRetry;
   }
 }
@@ -454,11 +460,11 @@ void HandleParseTreeNodeInfixOperator(ParseNodeIndex index,
 
 void HandleParseTreeNodeExpressionPrecedenceGroup(ParseNodeIndex index,
                                                   EmitContext& context) {
-  auto iter = context.tree.children(index).begin();
+  auto iter = context.tree.child_indices(index).begin();
   ++iter;
-  auto operator_node = *iter;
-  size_t child_count = context.Node(index).child_count;
-  switch (operator_node.token.kind()) {
+  Token operator_token = context.TokenOf(*iter);
+  size_t child_count   = context.Node(index).child_count;
+  switch (operator_token.kind()) {
     case Token::Kind::MinusGreater: {
       for (size_t i = 0; i < child_count / 2; ++i) {
         context.current_function().append<ConstructFunctionType>();
@@ -512,13 +518,13 @@ void HandleParseTreeNodeExpressionPrecedenceGroup(ParseNodeIndex index,
       // TODO: Cast. For now most integer casts are correct enough at the jasmin
       // level, we can ignore this. (Jasmin debug info would flag it though).
     } break;
-    default: NTH_UNIMPLEMENTED("{}") <<= {operator_node.token};
+    default: NTH_UNIMPLEMENTED("{}") <<= {operator_token};
   }
 }
 
 Iteration HandleParseTreeNodeDeclarationStart(ParseNodeIndex index,
                                               EmitContext& context) {
-  auto info = context.Node(index).declaration_info;
+  auto info = context.Node(index).declaration_info();
   auto& d   = context.queue.front().declaration_stack.emplace_back();
   d.kind    = info.kind;
   d.index   = index;
@@ -557,7 +563,7 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
                                          EmitContext& context) {
   if (context.QualifiedTypeOf(index - 1).type().kind() ==
       type::Type::Kind::Slice) {
-    if (context.Node(index).token.Identifier() == Identifier("count")) {
+    if (context.IdentifierOf(index) == Identifier("count")) {
       context.current_function().append<jasmin::Swap>();
     }
     context.current_function().append<jasmin::Drop>();
@@ -593,7 +599,7 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
     NTH_REQUIRE((v.harden), successfully_deserialized);
 
     auto symbol = context.module(module_id).Lookup(
-        context.Node(index).token.Identifier());
+        context.IdentifierOf(index));
     context.Push(symbol.value(), symbol.type());
   }
 }
@@ -1007,9 +1013,58 @@ void EmitIr(EmitContext& context) {
   return;
 }
 
+void EmitModule(EmitContext& context, DependencyGraph const& graph,
+                IrFunction& initializer) {
+  DependencyGraph top_level = graph.TopLevel();
+  DependencyScheduler scheduler(top_level);
+  auto emit = [&](DependencyGraph::Unit unit) {
+    auto [start, end] = top_level.range(unit);
+    // A declaration statement starts with a `StatementStart` node immediately
+    // followed by the `DeclarationStart` node.
+    if (unit != DependencyGraph::Unit::Module() and start + 1 < end and
+        context.Node(start + 1).kind == ParseNode::Kind::DeclarationStart) {
+      auto info = context.Node(start + 1).declaration_info();
+      if (info.kind.constant() and info.kind.has_initializer()) {
+        context.queue.push({.range = context.tree.subtree_range(info.index)});
+        context.push_function(initializer, LexicalScope::Index::Root());
+        EmitIr(context);
+      }
+    }
+    scheduler.Complete(unit);
+  };
+
+  while (true) {
+    if (std::optional unit = scheduler.Next()) {
+      emit(*unit);
+      continue;
+    }
+    // Constants on a cycle are evaluated in source order, each stopping to
+    // evaluate those it uses which have not yet been evaluated.
+    std::vector component = scheduler.NextComponent();
+    if (component.empty()) { break; }
+    for (auto unit : component) { emit(unit); }
+  }
+
+  // The declarations evaluated above are skipped, as their values are already
+  // present in `context.constants`.
+  context.queue.push({.range = context.tree.node_range()});
+  context.push_function(initializer, LexicalScope::Index::Root());
+  EmitIr(context);
+}
+
 void EmitContext::Evaluate(nth::interval<ParseNodeIndex> subtree,
                            nth::stack<jasmin::Value>& value_stack,
                            std::vector<type::Type> types) {
+  ParseNodeIndex root = subtree.upper_bound() - 1;
+  if (auto iter = evaluations.find(root);
+      iter != evaluations.end() and
+      std::ranges::equal(iter->second.types(), types)) {
+    for (jasmin::Value v : iter->second.value_span()) { value_stack.push(v); }
+    // The evaluation of an enclosing subtree may have replaced this entry.
+    constants.insert_or_assign(subtree, iter->second);
+    return;
+  }
+
   nth::stack<jasmin::Value> vs;
   size_t size = 0;
   for (type::Type t : types) { size += type::JasminSize(t); }
@@ -1022,9 +1077,9 @@ void EmitContext::Evaluate(nth::interval<ParseNodeIndex> subtree,
 
   f.invoke(vs);
   for (jasmin::Value v : vs.top_span(vs.size())) { value_stack.push(v); }
-  constants.insert_or_assign(
-      subtree, ComputedConstants(subtree.upper_bound() - 1, std::move(vs),
-                                 std::move(types)));
+  ComputedConstants result(root, std::move(vs), std::move(types));
+  constants.insert_or_assign(subtree, result);
+  evaluations.insert_or_assign(root, std::move(result));
 }
 
 void SetExported(EmitContext const& context) {
@@ -1035,7 +1090,7 @@ void SetExported(EmitContext const& context) {
     std::span types      = constant.types();
     std::span value_span = constant.value_span();
     NTH_REQUIRE((v.harden), types.size() == 1);
-    context.current_module.Insert(context.Node(*iter - 1).token.Identifier(),
+    context.current_module.Insert(context.IdentifierOf(*iter - 1),
                                   AnyValue(types[0], value_span));
   }
 }
@@ -1,18 +1,23 @@
 #ifndef ICARUS_IR_EMIT_H
 #define ICARUS_IR_EMIT_H
 
+#include <memory_resource>
 #include <queue>
 #include <span>
 #include <vector>
 
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
+#include "common/arena.h"
 #include "common/identifier.h"
 #include "common/module_id.h"
+#include "common/shared_prefix_stack.h"
+#include "ir/dependency_graph.h"
 #include "ir/dependent_modules.h"
 #include "ir/lexical_scope.h"
 #include "ir/local_storage.h"
 #include "ir/module.h"
+#include "lexer/token.h"
 #include "nth/base/attributes.h"
 #include "nth/container/interval.h"
 #include "nth/container/interval_map.h"
@@ -48,13 +53,24 @@ struct Iteration {
 };
 
 struct EmitContext {
+  // Side tables keyed by parse node are allocated from `memory_resource`.
   explicit EmitContext(ParseTree const& tree NTH_ATTRIBUTE(lifetimebound),
                        DependentModules const& modules
                            NTH_ATTRIBUTE(lifetimebound),
-                       LexicalScopeTree& scopes, Module& module)
-      : tree(tree), lexical_scopes(scopes), current_module{module}, modules(modules) {
-    types_.resize(tree.size());
-  }
+                       LexicalScopeTree& scopes, Module& module,
+                       std::pmr::memory_resource* memory_resource =
+                           std::pmr::get_default_resource())
+      : tree(tree),
+        statement_expression_info(memory_resource),
+        instruction_spec(memory_resource),
+        declarator(memory_resource),
+        lexical_scopes(scopes),
+        declarations_to_export(memory_resource),
+        storage(memory_resource),
+        evaluations(memory_resource),
+        current_module{module},
+        modules(modules),
+        types_(tree.size(), memory_resource) {}
 
   Module const& module(ModuleId id) const { return modules[id]; }
 
@@ -84,25 +100,37 @@ struct EmitContext {
   void Push(std::span<jasmin::Value const>, std::span<type::Type const>);
   void Push(ComputedConstants const& c);
 
+  // Evaluates the expression spanning `subtree` at compile-time, pushing the
+  // resulting values, of types `types`, onto `value_stack`. Each subtree is
+  // evaluated at most once for a given list of types; subsequent calls reuse
+  // the result.
   void Evaluate(nth::interval<ParseNodeIndex> subtree,
                 nth::stack<jasmin::Value>& value_stack,
                 std::vector<type::Type> types);
 
   ParseNode const& Node(ParseNodeIndex index) const { return tree[index]; }
+  Token TokenOf(ParseNodeIndex index) const { return tree.token(index); }
+  Identifier IdentifierOf(ParseNodeIndex index) const {
+    return tree.identifier(index);
+  }
 
   ParseTree const& tree;
 
-  absl::flat_hash_map<ParseNodeIndex, std::pair<type::ByteWidth, size_t>>
+  ArenaFlatHashMap<ParseNodeIndex, std::pair<type::ByteWidth, size_t>>
       statement_expression_info;
 
-  absl::flat_hash_map<ParseNodeIndex, jasmin::InstructionSpecification>
+  ArenaFlatHashMap<ParseNodeIndex, jasmin::InstructionSpecification>
       instruction_spec;
-  absl::flat_hash_map<ParseNodeIndex, std::pair<ParseNodeIndex, ParseNodeIndex>>
+  ArenaFlatHashMap<ParseNodeIndex, std::pair<ParseNodeIndex, ParseNodeIndex>>
       declarator;
 
   LexicalScopeTree& lexical_scopes;
-  absl::flat_hash_set<ParseNodeIndex> declarations_to_export;
-  absl::flat_hash_map<LexicalScope::Index, LocalStorage> storage;
+  ArenaFlatHashSet<ParseNodeIndex> declarations_to_export;
+  ArenaFlatHashMap<LexicalScope::Index, LocalStorage> storage;
+  // The results of `Evaluate`, keyed by the root of the evaluated subtree.
+  // Unlike `constants`, entries are never overwritten by the evaluation of a
+  // subtree containing them.
+  ArenaFlatHashMap<ParseNodeIndex, ComputedConstants> evaluations;
   Module& current_module;
 
   void push_function(IrFunction& f, LexicalScope::Index scope_index) {
@@ -191,34 +219,58 @@ struct EmitContext {
       lexical_scopes.push_back(scope_index);
     }
 
+    // Returns a work item for `r` which starts from the state of `*this`.
+    // The stacks of each are shared rather than copied, so this takes constant
+    // time regardless of their depth.
+    WorkItem share(nth::interval<ParseNodeIndex> r) {
+      return {
+          .range                = r,
+          .declaration_stack    = declaration_stack.share(),
+          .branches             = branches.share(),
+          .lexical_scopes       = lexical_scopes.share(),
+          .function_stack       = function_stack.share(),
+          .value_category_stack = value_category_stack.share(),
+          .function_stack_      = function_stack_.share(),
+          .scope_stack_         = scope_stack_.share(),
+      };
+    }
+
     nth::interval<ParseNodeIndex> range;
-    std::vector<DeclarationInfo> declaration_stack;
-    std::vector<nth::interval<jasmin::InstructionIndex>> branches;
-    std::vector<LexicalScope::Index> lexical_scopes = {LexicalScope::Index::Root()};
-    std::vector<LexicalScope::Index> function_stack = {
+    SharedPrefixStack<DeclarationInfo> declaration_stack;
+    SharedPrefixStack<nth::interval<jasmin::InstructionIndex>> branches;
+    SharedPrefixStack<LexicalScope::Index> lexical_scopes = {
+        LexicalScope::Index::Root()};
+    SharedPrefixStack<LexicalScope::Index> function_stack = {
         LexicalScope::Index::Root()};
-    std::vector<ValueCategory> value_category_stack;
+    SharedPrefixStack<ValueCategory> value_category_stack;
 
     // TODO: Make private (requires no longer using designated initializers).
     // TODO: Combine these and check access to them.
-    std::vector<IrFunction*> function_stack_;
-    std::vector<Scope*> scope_stack_;
+    SharedPrefixStack<IrFunction*> function_stack_;
+    SharedPrefixStack<Scope*> scope_stack_;
   };
   std::queue<WorkItem> queue;
 
   void SetQualifiedType(ParseNodeIndex index, type::QualifiedType qt) {
     types_[index.value()] = qt;
   }
-  type::QualifiedType QualifiedTypeOf(ParseNodeIndex index) {
+  type::QualifiedType QualifiedTypeOf(ParseNodeIndex index) const {
     return types_[index.value()];
   }
 
  private:
-  std::vector<type::QualifiedType> types_;
+  std::pmr::vector<type::QualifiedType> types_;
 };
 
 void EmitIr(EmitContext& context);
 
+// Emits the initializer of the module into `initializer`. Constants declared at
+// the top level of the module are evaluated first, in an order consistent with
+// `graph`, so that emitting a use of a constant declared later in the module
+// need not stop to evaluate it.
+void EmitModule(EmitContext& context, DependencyGraph const& graph,
+                IrFunction& initializer);
+
 void SetExported(EmitContext const& context);
 
 }  // namespace ic
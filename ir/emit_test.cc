@@ -0,0 +1,95 @@
+#include "ir/emit.h"
+
+#include <string_view>
+#include <utility>
+
+#include "diagnostics/consumer/null.h"
+#include "ir/dependent_modules.h"
+#include "ir/module.h"
+#include "jasmin/core/value.h"
+#include "lexer/lexer.h"
+#include "nth/container/stack.h"
+#include "nth/debug/debug.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+#include "type/type.h"
+
+namespace ic {
+namespace {
+
+// Returns the index of the last node of kind `kind` in `tree`.
+ParseNodeIndex Last(ParseTree const& tree, ParseNode::Kind kind) {
+  ParseNodeIndex result = ParseNodeIndex::Invalid();
+  auto [start, end]     = tree.node_range();
+  for (auto i = start; i < end; ++i) {
+    if (tree[i].kind == kind) { result = i; }
+  }
+  NTH_REQUIRE(result != ParseNodeIndex::Invalid());
+  return result;
+}
+
+// The state required to evaluate subtrees of `source`.
+struct Evaluation {
+  explicit Evaluation(std::string_view source)
+      : buffer(lex::Lex(source, consumer)),
+        parse_result(Parse(buffer, consumer)),
+        context(parse_result.parse_tree, modules, parse_result.scope_tree,
+                module) {}
+
+  ParseTree const& tree() const { return parse_result.parse_tree; }
+
+  // Evaluates the subtree rooted at `index` as a type.
+  type::Type Evaluate(ParseNodeIndex index) {
+    nth::stack<jasmin::Value> value_stack;
+    context.Evaluate(tree().subtree_range(index), value_stack, {type::Type_});
+    NTH_REQUIRE(value_stack.size() == 1);
+    return value_stack.top_span(1)[0].as<type::Type>();
+  }
+
+  diag::NullConsumer consumer;
+  TokenBuffer buffer;
+  ParseResult parse_result;
+  DependentModules modules;
+  Module module;
+  EmitContext context;
+};
+
+NTH_TEST("emit/evaluate/refills-constants") {
+  Evaluation e("let t ::= i64 -> bool\n");
+  ParseNodeIndex bool_index = Last(e.tree(), ParseNode::Kind::TypeLiteral);
+  ParseNodeIndex group_index =
+      Last(e.tree(), ParseNode::Kind::ExpressionPrecedenceGroup);
+
+  NTH_EXPECT(e.Evaluate(bool_index) == type::Bool);
+  NTH_EXPECT(e.context.evaluations.size() == 1);
+
+  // Evaluating the enclosing expression replaces the constant associated with
+  // the nodes it contains.
+  e.Evaluate(group_index);
+  NTH_EXPECT(e.context.evaluations.size() == 2);
+  NTH_EXPECT(e.context.constants.at(bool_index) ==
+             e.context.evaluations.at(group_index));
+
+  NTH_EXPECT(e.Evaluate(bool_index) == type::Bool);
+  NTH_EXPECT(e.context.evaluations.size() == 2);
+  NTH_EXPECT(e.context.constants.at(bool_index) ==
+             e.context.evaluations.at(bool_index));
+}
+
+NTH_TEST("emit/evaluate/reuses-result") {
+  Evaluation e("let t ::= bool\n");
+  ParseNodeIndex index = Last(e.tree(), ParseNode::Kind::TypeLiteral);
+  NTH_EXPECT(e.Evaluate(index) == type::Bool);
+
+  // A recorded result is returned as-is rather than evaluated again, so
+  // replacing it is observable.
+  nth::stack<jasmin::Value> values;
+  values.push(jasmin::Value(type::I64));
+  e.context.evaluations.insert_or_assign(
+      index, EmitContext::ComputedConstants(index, std::move(values),
+                                            {type::Type_}));
+  NTH_EXPECT(e.Evaluate(index) == type::I64);
+}
+
+}  // namespace
+}  // namespace ic
@@ -1,7 +1,12 @@
 #include "ir/ir.h"
 
+#include <algorithm>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <span>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -9,8 +14,11 @@
 #include "common/interface.h"
 #include "common/module_id.h"
 #include "common/resources.h"
+#include "common/shared_prefix_stack.h"
 #include "common/string.h"
+#include "diagnostics/consumer/buffering.h"
 #include "ir/lexical_scope.h"
+#include "ir/type_check_cache.h"
 #include "ir/type_stack.h"
 #include "jasmin/core/function.h"
 #include "jasmin/core/value.h"
@@ -78,6 +86,10 @@ std::optional<type::QualifiedType> FindInfixOperator(
 
 struct IrContext {
   ParseNode const& Node(ParseNodeIndex index) { return emit.tree[index]; }
+  Token TokenOf(ParseNodeIndex index) { return emit.tree.token(index); }
+  Identifier IdentifierOf(ParseNodeIndex index) {
+    return emit.tree.identifier(index);
+  }
 
   auto ChildIndices(ParseNodeIndex index) {
     return emit.tree.child_indices(index);
@@ -89,20 +101,36 @@ struct IrContext {
     T result;
     nth::interval range = emit.tree.subtree_range(subtree_root_index);
     nth::stack<jasmin::Value> value_stack;
-    emit.Evaluate(range, value_stack, {FromConstant<T>()});
+    Evaluate(range, value_stack, {FromConstant<T>()});
     if constexpr (nth::type<T> == nth::type<std::string_view>) {
       size_t length = value_stack.top().as<size_t>();
       value_stack.pop();
       char const* ptr = value_stack.top().as<char const*>();
       value_stack.pop();
       return std::string_view(ptr, length);
+    } else if constexpr (nth::type<T> == nth::type<ModuleId>) {
+      return value_stack.top().as<ModuleId>();
     } else {
       // TODO: What about IcarusDeserializeValue?
       return std::nullopt;
     }
   }
 
-  TypeStack& type_stack() { return queue.front().type_stack_; }
+  // Evaluates `subtree` at compile-time, as `EmitContext::Evaluate` does.
+  void Evaluate(nth::interval<ParseNodeIndex> subtree,
+                nth::stack<jasmin::Value>& value_stack,
+                std::vector<type::Type> types) {
+    auto lock = LockEmit();
+    emit.Evaluate(subtree, value_stack, std::move(types));
+  }
+
+  // Returns a lock which must be held while accessing the side tables of
+  // `emit`, as they may be shared with other threads.
+  std::unique_lock<std::mutex> LockEmit() {
+    return std::unique_lock(emit_mutex);
+  }
+
+  TypeStack& type_stack() { return item().type_stack_; }
 
   void PopTypeStack(size_t num_to_pop) {
     auto& ts = type_stack();
@@ -114,52 +142,106 @@ struct IrContext {
   }
 
   nth::stack<DeclarationInfo>& declaration_stack() {
-    return queue.front().declaration_stack;
+    return item().declaration_stack;
   }
 
   std::vector<Token::Kind>& operator_stack() {
-    return queue.front().operator_stack;
+    return item().operator_stack;
   }
 
   void pop_lexical_scope() {
-    NTH_REQUIRE((v.harden), not queue.empty());
-    queue.front().lexical_scopes.pop_back();
+    item().lexical_scopes.pop_back();
   }
 
   void push_lexical_scope(LexicalScope::Index index) {
-    queue.front().lexical_scopes.push_back(index);
+    item().lexical_scopes.push_back(index);
   }
 
   LexicalScope::Index current_lexical_scope_index() {
-    NTH_REQUIRE((v.harden), not queue.front().lexical_scopes.empty());
-    return queue.front().lexical_scopes.back();
+    NTH_REQUIRE((v.harden), not item().lexical_scopes.empty());
+    return item().lexical_scopes.back();
   }
 
   LexicalScope& current_lexical_scope() {
     return emit.lexical_scopes[current_lexical_scope_index()];
   }
 
-  LocalStorage& current_storage() {
-    NTH_REQUIRE((v.harden), not queue.front().functions.empty());
-    return emit.storage[queue.front().functions.back()];
+  // Allocates stack space for the declaration at `index` in the current
+  // function. Space is allocated once every unit has been processed, in source
+  // order, so that the layout of each stack frame does not depend on the order
+  // in which units are processed.
+  void Allocate(ParseNodeIndex index, type::Type t) {
+    NTH_REQUIRE((v.harden), not item().functions.empty());
+    allocations.push_back(
+        {.function = item().functions.back(), .index = index, .type = t});
   }
 
   struct WorkItem {
     WorkItem(nth::interval<ParseNodeIndex> interval) : interval(interval) {}
 
+    // Returns a work item for the nested unit spanning `interval`, which starts
+    // in the lexical scope and function of `*this`. Those stacks are shared
+    // rather than copied. Every other stack starts out empty, as each nested
+    // unit is a statement, which leaves them as it found them.
+    WorkItem Nested(nth::interval<ParseNodeIndex> interval) {
+      WorkItem item(interval);
+      item.lexical_scopes = lexical_scopes.share();
+      item.functions      = functions.share();
+      return item;
+    }
+
     nth::interval<ParseNodeIndex> interval;
     std::vector<Token::Kind> operator_stack;
     nth::stack<DeclarationInfo> declaration_stack;
-    std::vector<LexicalScope::Index> lexical_scopes;
-    std::vector<LexicalScope::Index> functions;
+    SharedPrefixStack<LexicalScope::Index> lexical_scopes;
+    SharedPrefixStack<LexicalScope::Index> functions;
 
    private:
     friend IrContext;
     TypeStack type_stack_;
   };
 
-  size_t identifier_repetition_counter = 0;
-  std::queue<WorkItem> queue;
+  // The work item of the unit currently being processed.
+  WorkItem& item() {
+    NTH_REQUIRE((v.harden), items[unit.value()].has_value());
+    return *items[unit.value()];
+  }
+
+  // Returns whether the declaration at `declaration`, whose type is not yet
+  // known, is part of a cycle of units which includes that of the identifier
+  // at `index`.
+  bool DependsOnItself(ParseNodeIndex index, ParseNodeIndex declaration) {
+    DependencyGraph::Unit owner = graph.owner(declaration);
+    if (owner == unit and declaration < index) { return false; }
+    return std::ranges::binary_search(
+        component, owner.value(), std::ranges::less{},
+        [](DependencyGraph::Unit u) { return u.value(); });
+  }
+
+  // Returns whether the results of type-checking `u` were restored from a
+  // cache.
+  bool Restored(DependencyGraph::Unit u) const {
+    return restored and (*restored)[u.value()];
+  }
+
+  struct Allocation {
+    LexicalScope::Index function;
+    ParseNodeIndex index;
+    type::Type type;
+  };
+
+  DependencyGraph const& graph;
+  // The work item of each unit of `graph` which has been reached, but not yet
+  // processed in its entirety. Shared by every thread, each of which accesses
+  // only the items of units handed to it.
+  std::vector<std::optional<WorkItem>>& items;
+  std::mutex& emit_mutex;
+  DependencyGraph::Unit unit = DependencyGraph::Unit::Module();
+  // When the units of a cycle are being processed, the units of that cycle, in
+  // increasing order. Otherwise empty.
+  std::span<DependencyGraph::Unit const> component;
+  std::vector<Allocation> allocations;
+  std::vector<bool> const* restored = nullptr;
   EmitContext& emit;
 };
 
@@ -196,13 +278,13 @@ bool RequireConstant(type::QualifiedType actual, type::Type expected,
 
 void HandleParseTreeNodeModule(ParseNodeIndex index, IrContext& context,
                                diag::DiagnosticConsumer& diag) {
-  context.queue.front().functions.pop_back();
+  context.item().functions.pop_back();
   context.pop_lexical_scope();
 }
 
 void HandleParseTreeNodeModuleStart(ParseNodeIndex index, IrContext& context,
                                     diag::DiagnosticConsumer& diag) {
-  context.queue.front().functions.push_back(LexicalScope::Index::Root());
+  context.item().functions.push_back(LexicalScope::Index::Root());
   context.push_lexical_scope(LexicalScope::Index::Root());
 }
 
@@ -230,7 +312,7 @@ bool TryDiagnoseUnexpanded(TypeStack& type_stack,
 void HandleParseTreeNodeDeref(ParseNodeIndex index, IrContext& context,
                               diag::DiagnosticConsumer& diag) {
   if (TryDiagnoseUnexpanded(context.type_stack(), diag,
-                            context.Node(index - 1).token)) {
+                            context.TokenOf(index - 1))) {
     return;
   }
   auto qt = context.type_stack().top()[0];
@@ -294,7 +376,7 @@ void HandleParseTreeNodeMinus(ParseNodeIndex index, IrContext& context,
 void HandleParseTreeNodeAddress(ParseNodeIndex index, IrContext& context,
                                 diag::DiagnosticConsumer& diag) {
   if (TryDiagnoseUnexpanded(context.type_stack(), diag,
-                            context.Node(index - 1).token)) {
+                            context.TokenOf(index - 1))) {
     return;
   }
   auto qt = context.type_stack().top()[0];
@@ -306,7 +388,7 @@ void HandleParseTreeNodeAddress(ParseNodeIndex index, IrContext& context,
     diag.Consume({
         diag::Header(diag::MessageKind::Error),
         diag::Text("Expression is not addressable"),
-        diag::SourceQuote(context.Node(index - 1).token),
+        diag::SourceQuote(context.TokenOf(index - 1)),
     });
     context.type_stack().push({type::QualifiedType::Unqualified(type::Error)});
   }
@@ -323,14 +405,14 @@ void HandleParseTreeNodeDeclaration(ParseNodeIndex index, IrContext& context,
     if (not type) { NTH_UNIMPLEMENTED(); }
 
     auto qt = QualifiedBy(*type, info);
-    context.current_storage().insert(index, *type);
+    context.Allocate(index, *type);
     context.emit.SetQualifiedType(index, qt);
   } else if (info.kind.inferred_type()) {
     IC_PROPAGATE_ERRORS(context, context.Node(index), 1);
     type::QualifiedType qt =
         QualifiedBy(context.type_stack().top()[0].type(), info);
     if (not info.kind.constant()) {
-      context.current_storage().insert(index, qt.type());
+      context.Allocate(index, qt.type());
     }
     context.emit.SetQualifiedType(index, qt);
     context.type_stack().pop();
@@ -362,7 +444,7 @@ void HandleParseTreeNodeDeclaration(ParseNodeIndex index, IrContext& context,
     std::optional type = context.EvaluateAs<type::Type>(*type_iter);
     if (not type) { NTH_UNIMPLEMENTED(); }
     if (not type::ImplicitCast(AnyValue::JustType(init_qt.type()), *type)) {
-      auto token = context.Node(index).token;
+      auto token = context.TokenOf(index);
       diag.Consume({
           diag::Header(diag::MessageKind::Error),
           diag::Text(InterpolateString<"Initializing expression does not match "
@@ -374,7 +456,7 @@ void HandleParseTreeNodeDeclaration(ParseNodeIndex index, IrContext& context,
           {type::QualifiedType::Unqualified(type::Error)});
     }
     type::QualifiedType qt = type::QualifiedType::Unqualified(*type);
-    context.current_storage().insert(index, qt.type());
+    context.Allocate(index, qt.type());
     context.emit.SetQualifiedType(index, qt);
   }
 }
@@ -395,8 +477,11 @@ void HandleParseTreeNodeStatement(ParseNodeIndex index, IrContext& context,
         size += type::JasminSize(qt.type());
       }
 
-      context.emit.statement_expression_info.emplace(
-          index, std::make_pair(bytes, size));
+      {
+        auto lock = context.LockEmit();
+        context.emit.statement_expression_info.emplace(
+            index, std::make_pair(bytes, size));
+      }
       context.type_stack().pop();
     } break;
     default: break;
@@ -412,51 +497,50 @@ bool InterfaceLocallyComplete(Interface intf) { return not false; }
 Iteration HandleParseTreeNodeIdentifier(ParseNodeIndex index,
                                         IrContext& context,
                                         diag::DiagnosticConsumer& diag) {
-  auto token = context.Node(index).token;
-  auto id    = token.Identifier();
-  if (context.identifier_repetition_counter > context.queue.size()) {
+  auto decl_id_index = context.Node(index).corresponding_declaration_identifier;
+  auto decl_index    = context.Node(decl_id_index).corresponding_declaration;
+  auto decl_qt       = context.emit.QualifiedTypeOf(decl_index);
+  if (decl_qt.type() == type::Type()) {
+    // Units are processed only after those they depend on, unless they lie on
+    // a cycle, so the type of the declaration will never be known.
+    auto token = context.TokenOf(index);
+    auto id    = context.IdentifierOf(index);
     diag.Consume({
         diag::Header(diag::MessageKind::Error),
         diag::Text(
-            InterpolateString<"Identifier `{}` has no matching declaration.">(
-                id)),
+            context.DependsOnItself(index, decl_index)
+                ? InterpolateString<"The type of `{}` depends on itself.">(id)
+                : InterpolateString<
+                      "Identifier `{}` has no matching declaration.">(id)),
         diag::SourceQuote(token),
     });
     context.type_stack().push({type::QualifiedType::Unqualified(type::Error)});
     return Iteration::Continue;
   }
 
-  auto decl_id_index = context.Node(index).corresponding_declaration_identifier;
-  auto decl_index    = context.Node(decl_id_index).corresponding_declaration;
-  if (auto decl_qt = context.emit.QualifiedTypeOf(decl_index);
-      decl_qt.type() != type::Type()) {
+  {
+    auto lock = context.LockEmit();
     context.emit.declarator.emplace(index,
                                     std::pair{decl_id_index, decl_index});
-    context.emit.SetQualifiedType(index, decl_qt);
-
-    if (decl_qt == type::QualifiedType::Constant(type::Interface)) {
-      // To evaluate, it is important that the declarator is already set.
-      std::optional intf = context.EvaluateAs<Interface>(index);
-      NTH_REQUIRE((v.debug), intf.has_value());
-      if (not InterfaceLocallyComplete(*intf)) { return Iteration::PauseRetry; }
-    }
+  }
+  context.emit.SetQualifiedType(index, decl_qt);
 
-    context.type_stack().push({decl_qt});
-    // TODO: We should actually have interfaces be their own type that is
-    // implicitly convertible to a pattern.
-    return Iteration::Continue;
-  } else {
-    auto item     = context.queue.front();
-    item.interval = nth::interval(index, item.interval.upper_bound());
-    context.queue.push(std::move(item));
-    return Iteration::PauseRetry;
+  if (decl_qt == type::QualifiedType::Constant(type::Interface)) {
+    // To evaluate, it is important that the declarator is already set.
+    std::optional intf = context.EvaluateAs<Interface>(index);
+    NTH_REQUIRE((v.debug), intf.has_value());
+    if (not InterfaceLocallyComplete(*intf)) { return Iteration::PauseRetry; }
   }
+
+  context.type_stack().push({decl_qt});
+  // TODO: We should actually have interfaces be their own type that is
+  // implicitly convertible to a pattern.
+  return Iteration::Continue;
 }
 
 void HandleParseTreeNodeInfixOperator(ParseNodeIndex index, IrContext& context,
                                       diag::DiagnosticConsumer& diag) {
-  auto node = context.Node(index);
-  context.operator_stack().push_back(node.token.kind());
+  context.operator_stack().push_back(context.TokenOf(index).kind());
 }
 
 void HandleParseTreeNodeExpressionPrecedenceGroup(
@@ -484,24 +568,24 @@ void HandleParseTreeNodeExpressionPrecedenceGroup(
       type::Type parameters_type = context.type_stack().top()[0].type();
       auto iter                  = context.Children(index).begin();
       if (parameters_type != type::Type_) {
-        auto iter = context.Children(index).begin();
+        auto iter = context.ChildIndices(index).begin();
         diag.Consume({
             diag::Header(diag::MessageKind::Error),
             diag::Text(
                 InterpolateString<"Function parameters must be types, but "
                                   "you provided a(n) `{}`.">(parameters_type)),
-            diag::SourceQuote(iter->token),
+            diag::SourceQuote(context.TokenOf(*iter)),
         });
       }
 
       if (return_type and return_type != type::Type_) {
-        auto iter = context.Children(index).begin();
+        auto iter = context.ChildIndices(index).begin();
         diag.Consume({
             diag::Header(diag::MessageKind::Error),
             diag::Text(
                 InterpolateString<"Function returns must be types, but you "
                                   "provided a(n) `{}`.">(return_type)),
-            diag::SourceQuote(iter->token),
+            diag::SourceQuote(context.TokenOf(*iter)),
         });
       }
 
@@ -584,7 +668,7 @@ void HandleParseTreeNodeExpressionPrecedenceGroup(
 void HandleParseTreeNodeDeclarationStart(ParseNodeIndex index,
                                          IrContext& context,
                                          diag::DiagnosticConsumer&) {
-  context.declaration_stack().push(context.Node(index).declaration_info);
+  context.declaration_stack().push(context.Node(index).declaration_info());
 }
 
 void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
@@ -600,7 +684,7 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
       NTH_REQUIRE(module_id.has_value());
       auto qt =
           type::QualifiedType::Constant(context.emit.module(*module_id)
-                                            .Lookup(node.token.Identifier())
+                                            .Lookup(context.IdentifierOf(index))
                                             .type());
       context.type_stack().pop();
       context.type_stack().push({qt});
@@ -610,25 +694,27 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
             diag::Header(diag::MessageKind::Error),
             diag::Text(
                 InterpolateString<"No symbol named '{}' in the given module.">(
-                    diag.Symbol(context.Node(index).token))),
-            diag::SourceQuote(context.Node(index - 1).token),
+                    static_cast<std::string_view>(
+                        context.IdentifierOf(index)))),
+            diag::SourceQuote(context.TokenOf(index - 1)),
         });
       }
     } else {
       diag.Consume({
           diag::Header(diag::MessageKind::Error),
           diag::Text("Members may not be accessed from non-constant modules."),
-          diag::SourceQuote(context.Node(index - 1).token),
+          diag::SourceQuote(context.TokenOf(index - 1)),
       });
       context.type_stack().pop();
       context.type_stack().push(
           {type::QualifiedType::Unqualified(type::Error)});
     }
   } else if (context.type_stack().top()[0].type() == type::Type_) {
-    NTH_UNIMPLEMENTED("{} -> {}") <<= {context.type_stack().top(), node.token};
+    NTH_UNIMPLEMENTED("{} -> {}") <<=
+        {context.type_stack().top(), context.TokenOf(index)};
   } else if (context.type_stack().top()[0].type().kind() ==
              type::Type::Kind::Slice) {
-    if (context.Node(index).token.Identifier() == Identifier("data")) {
+    if (context.IdentifierOf(index) == Identifier("data")) {
       auto qt = type::QualifiedType::Unqualified(
           type::BufPtr(context.type_stack()
                            .top()[0]
@@ -638,7 +724,7 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
       context.type_stack().pop();
       context.type_stack().push({qt});
       context.emit.SetQualifiedType(index, qt);
-    } else if (context.Node(index).token.Identifier() == Identifier("count")) {
+    } else if (context.IdentifierOf(index) == Identifier("count")) {
       auto qt = type::QualifiedType::Unqualified(type::U64);
       context.type_stack().pop();
       context.type_stack().push({qt});
@@ -648,8 +734,8 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
           diag::Header(diag::MessageKind::Error),
           diag::Text(InterpolateString<"No member named `{}` in slice type. "
                                        "Only `.data` and `.count` are valid">(
-              context.Node(index).token.Identifier())),
-          diag::SourceQuote(context.Node(index - 1).token),
+              context.IdentifierOf(index))),
+          diag::SourceQuote(context.TokenOf(index - 1)),
       });
       context.type_stack().pop();
       context.type_stack().push(
@@ -662,7 +748,7 @@ void HandleParseTreeNodeMemberExpression(ParseNodeIndex index,
             InterpolateString<"Access operator `.` may only follow a type, "
                               "module, or enum, but you provided: {}.">(
                 context.type_stack().top()[0].type())),
-        diag::SourceQuote(context.Node(index - 2).token),
+        diag::SourceQuote(context.TokenOf(index - 2)),
     });
     context.type_stack().pop();
     context.type_stack().push({type::QualifiedType::Unqualified(type::Error)});
@@ -693,7 +779,7 @@ void HandleParseTreeNodeIndexExpression(ParseNodeIndex index,
 
   ++iter;
   if (TryDiagnoseUnexpanded(context.type_stack(), diag,
-                            context.Node(*iter).token)) {
+                            context.TokenOf(*iter))) {
     return;
   }
   auto qt = context.type_stack().top()[0];
@@ -883,7 +969,7 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
                            "Incorrect number of arguments passed to function: "
                                       "Expected {}, but {} were provided.">(r.parameters,
                                                                  r.arguments)),
-                diag::SourceQuote(context.Node(index).token),
+                diag::SourceQuote(context.TokenOf(index)),
             });
           } else if constexpr (t == nth::type<InvalidBinding>) {
             diag.Consume({
@@ -892,7 +978,7 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
                            "Argument at position {} cannot be passed to "
                                       "function. Expected a {} but argument has type {}">(
                     r.index, r.parameter, r.argument)),
-                diag::SourceQuote(context.Node(index).token),
+                diag::SourceQuote(context.TokenOf(index)),
             });
           }
           return false;
@@ -904,9 +990,12 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
       return;
     }
 
-    auto [iter, inserted] = context.emit.instruction_spec.try_emplace(
-        index, call.MakeInstructionSpecification());
-    NTH_REQUIRE((v.harden), inserted);
+    {
+      auto lock             = context.LockEmit();
+      auto [iter, inserted] = context.emit.instruction_spec.try_emplace(
+          index, call.MakeInstructionSpecification());
+      NTH_REQUIRE((v.harden), inserted);
+    }
     auto returns = fn_type.returns();
     std::vector<type::QualifiedType> return_qts;
     std::vector<type::Type> return_types;
@@ -921,7 +1010,7 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
       case type::Evaluation::RequireCompileTime: {
         nth::interval range = context.emit.tree.subtree_range(index);
         nth::stack<jasmin::Value> value_stack;
-        context.emit.Evaluate(range, value_stack, return_types);
+        context.Evaluate(range, value_stack, return_types);
         auto module_id = context.EvaluateAs<ModuleId>(index);
         if (module_id == ModuleId::Invalid()) {
           diag.Consume({
@@ -936,15 +1025,17 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
       case type::Evaluation::RequireRuntime: break;
     }
   } else if (call.callee.type().kind() == type::Type::Kind::DependentFunction) {
-    auto& spec = context.emit.instruction_spec[index];
-    ++spec.parameters;
+    {
+      auto lock = context.LockEmit();
+      ++context.emit.instruction_spec[index].parameters;
+    }
     std::vector<AnyValue> arguments;
 
     for (auto [index, qt] : call.arguments) {
       nth::stack<jasmin::Value> value_stack;
       nth::interval range = context.emit.tree.subtree_range(index);
       if (qt.constant()) {
-        context.emit.Evaluate(range, value_stack, {qt.type()});
+        context.Evaluate(range, value_stack, {qt.type()});
         std::span values = value_stack.top_span(value_stack.size());
         arguments.emplace_back(qt.type(),
                                std::vector(values.begin(), values.end()));
@@ -953,8 +1044,13 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
       }
     }
 
-    for (auto iter = call.postfix_start; iter != call.arguments.end(); ++iter) {
-      spec.parameters += type::JasminSize(iter->type());
+    {
+      auto lock  = context.LockEmit();
+      auto& spec = context.emit.instruction_spec[index];
+      for (auto iter = call.postfix_start; iter != call.arguments.end();
+           ++iter) {
+        spec.parameters += type::JasminSize(iter->type());
+      }
     }
 
     auto dep        = call.callee.type().as<type::DependentFunctionType>();
@@ -972,8 +1068,7 @@ void HandleParseTreeNodeCallExpression(ParseNodeIndex index, IrContext& context,
     context.type_stack().push({type::QualifiedType::Constant(*t)});
 
     nth::stack<jasmin::Value> value_stack;
-    context.emit.Evaluate(context.emit.tree.subtree_range(index), value_stack,
-                          {*t});
+    context.Evaluate(context.emit.tree.subtree_range(index), value_stack, {*t});
   } else {
     diag.Consume({
         diag::Header(diag::MessageKind::Error),
@@ -1036,7 +1131,7 @@ void HandleParseTreeNodePointer(ParseNodeIndex index, IrContext& context,
                                 diag::DiagnosticConsumer& diag) {
   IC_PROPAGATE_ERRORS(context, context.Node(index), 1);
   TryDiagnoseUnaryTypeConstructorError(context.type_stack(), diag, "pointer",
-                                       context.Node(index - 1).token);
+                                       context.TokenOf(index - 1));
 }
 
 void HandleParseTreeNodeBufferPointer(ParseNodeIndex index, IrContext& context,
@@ -1044,30 +1139,34 @@ void HandleParseTreeNodeBufferPointer(ParseNodeIndex index, IrContext& context,
   IC_PROPAGATE_ERRORS(context, context.Node(index), 1);
   TryDiagnoseUnaryTypeConstructorError(context.type_stack(), diag,
                                        "buffer-pointer",
-                                       context.Node(index - 1).token);
+                                       context.TokenOf(index - 1));
 }
 
 void HandleParseTreeNodeSlice(ParseNodeIndex index, IrContext& context,
                               diag::DiagnosticConsumer& diag) {
   IC_PROPAGATE_ERRORS(context, context.Node(index), 1);
   TryDiagnoseUnaryTypeConstructorError(context.type_stack(), diag, "slice",
-                                       context.Node(index - 1).token);
+                                       context.TokenOf(index - 1));
 }
 
 void HandleParseTreeNodeImport(ParseNodeIndex index, IrContext& context,
                                diag::DiagnosticConsumer& diag) {
   std::string_view path = *context.EvaluateAs<std::string_view>(index - 1);
-  ModuleId id           = resources.module_map[path];
   nth::interval range   = context.emit.tree.subtree_range(index);
-  context.emit.constants.insert_or_assign(
-      range, EmitContext::ComputedConstants(index, {id}, {type::Module}));
+  ModuleId id;
+  {
+    auto lock = context.LockEmit();
+    id        = resources.module_map[path];
+    context.emit.constants.insert_or_assign(
+        range, EmitContext::ComputedConstants(index, {id}, {type::Module}));
+  }
 
   if (id == ModuleId::Invalid()) {
     diag.Consume({
         diag::Header(diag::MessageKind::Error),
         diag::Text(
             InterpolateString<"Could not find a module named \"{}\".">(path)),
-        diag::SourceQuote(context.Node(index - 1).token),
+        diag::SourceQuote(context.TokenOf(index - 1)),
     });
     context.type_stack().pop();
     context.type_stack().push({type::QualifiedType::Constant(type::Error)});
@@ -1078,31 +1177,14 @@ void HandleParseTreeNodeImport(ParseNodeIndex index, IrContext& context,
   context.type_stack().push({type::QualifiedType::Constant(type::Module)});
 }
 
-Iteration HandleParseTreeNodeScopeStart(ParseNodeIndex index,
-                                        IrContext& context,
-                                        diag::DiagnosticConsumer& diag) {
-  auto item           = std::move(context.queue.front());
-  auto [start, end]   = item.interval;
-  auto stmt_seq_index = context.Node(index).corresponding_statement_sequence;
-  auto child_indices  = context.emit.tree.child_indices(stmt_seq_index);
-  for (auto i : child_indices) {
-    // TODO: We always just want to ignore the last one. There's probably a
-    // better way to do this.
-    if (i == index) { continue; }
-    item.interval = context.emit.tree.subtree_range(i);
-    context.queue.push(item);
-  }
-  item.interval = nth::interval(stmt_seq_index, end);
-  context.queue.push(item);
-
-  return Iteration::PauseMoveOn;
-}
+void HandleParseTreeNodeScopeStart(ParseNodeIndex index, IrContext& context,
+                                   diag::DiagnosticConsumer& diag) {}
 
 void HandleParseTreeNodeFunctionLiteralStart(ParseNodeIndex index,
                                              IrContext& context,
                                              diag::DiagnosticConsumer& diag) {
   LexicalScope::Index scope_index = context.Node(index).scope_index;
-  context.queue.front().functions.push_back(scope_index);
+  context.item().functions.push_back(scope_index);
   context.push_lexical_scope(scope_index);
 }
 
@@ -1220,7 +1302,7 @@ void HandleParseTreeNodeWhileLoopBodyStart(ParseNodeIndex index,
     diag.Consume({
         diag::Header(diag::MessageKind::Error),
         diag::Text("While-loop condition is not expanded."),
-        diag::SourceQuote(context.Node(index).token),
+        diag::SourceQuote(context.TokenOf(index)),
     });
     context.MakeError(1);
   } else if (context.type_stack().top().size() != 1) {
@@ -1230,7 +1312,7 @@ void HandleParseTreeNodeWhileLoopBodyStart(ParseNodeIndex index,
             InterpolateString<"While-loop conditions must be `bool`s, but you "
                               "provided a `{}`.">(
                 context.type_stack().top()[0])),
-        diag::SourceQuote(context.Node(index).token),
+        diag::SourceQuote(context.TokenOf(index)),
     });
     context.MakeError(1);
   } else {
@@ -1283,7 +1365,7 @@ void HandleParseTreeNodeReturn(ParseNodeIndex index, IrContext& context,
 void HandleParseTreeNodeFunctionLiteral(ParseNodeIndex index,
                                         IrContext& context,
                                         diag::DiagnosticConsumer& diag) {
-  context.queue.front().functions.pop_back();
+  context.item().functions.pop_back();
   context.pop_lexical_scope();
   context.emit.SetQualifiedType(index, context.type_stack().top()[0]);
   // TODO: Check that the return type matches the signature.
@@ -1303,7 +1385,7 @@ void HandleParseTreeNodeAssignment(ParseNodeIndex index, IrContext& context,
 
   if (not type::ImplicitCast(AnyValue::JustType(rhs_qt.type()),
                              lhs_qt.type())) {
-    auto token = context.Node(index).token;
+    auto token = context.TokenOf(index);
     diag.Consume({
         diag::Header(diag::MessageKind::Error),
         diag::Text(InterpolateString<
@@ -1346,13 +1428,36 @@ constexpr Iteration Invoke(ParseNodeIndex index, IrContext& context,
   }
 }
 
-void ProcessIrImpl(IrContext& context, diag::DiagnosticConsumer& diag) {
-  while (not context.queue.empty()) {
-    auto item         = context.queue.front();
-    auto [start, end] = item.interval;
-    auto index        = start;
-    for (; index != end; ++index) {
-      switch (context.Node(index).kind) {
+// Processes the work item of `context.unit` from where it last stopped. Returns
+// `true` if the unit was processed in its entirety, and `false` if it must be
+// resumed later.
+bool ProcessUnit(IrContext& context, diag::DiagnosticConsumer& diag) {
+  auto& item        = context.item();
+  auto [start, end] = item.interval;
+  auto children     = context.graph.children(context.unit);
+  auto child        = children.begin();
+  for (auto index = start; index != end; ++index) {
+    // Nested units are processed on their own, once this one is complete,
+    // starting from the state in which this one reaches them. Those skipped
+    // over are never reached.
+    while (child != children.end() and
+           context.graph.range(*child).lower_bound() < index) {
+      ++child;
+    }
+    if (child != children.end() and
+        context.graph.range(*child).lower_bound() == index) {
+      // Units whose results were restored have no work item, and so are
+      // complete as soon as they are scheduled.
+      if (not context.Restored(*child)) {
+        context.items[child->value()].emplace(
+            item.Nested(context.graph.range(*child)));
+      }
+      index = context.graph.range(*child).upper_bound() - 1;
+      ++child;
+      continue;
+    }
+
+    switch (context.Node(index).kind) {
 #define IC_XMACRO_PARSE_NODE(node_kind)                                        \
   case ParseNode::Kind::node_kind: {                                           \
     NTH_LOG((v.when(debug::type_check)), "Process node {} ({})") <<=           \
@@ -1360,34 +1465,100 @@ void ProcessIrImpl(IrContext& context, diag::DiagnosticConsumer& diag) {
     auto it = Invoke<HandleParseTreeNode##node_kind>(index, context, diag);    \
     switch (it.kind()) {                                                       \
       case Iteration::PauseMoveOn: ++index; [[fallthrough]];                   \
-      case Iteration::PauseRetry: goto stop_early;                             \
+      case Iteration::PauseRetry:                                              \
+        NTH_LOG((v.when(debug::type_check)), "Stopping early just before {}")  \
+            <<= {index};                                                       \
+        item.interval = nth::interval(index, end);                             \
+        return false;                                                          \
       case Iteration::Continue: break;                                         \
       case Iteration::Skip: index = it.index() - 1; break;                     \
     }                                                                          \
   } break;
 #include "parse/node.xmacro.h"
-      }
-      context.identifier_repetition_counter = 0;
     }
-    NTH_LOG((v.when(debug::type_check)), "Done type-checking chunk at {}") <<=
-        {index};
-    context.queue.pop();
-    continue;
-
-  stop_early:
-    NTH_LOG((v.when(debug::type_check)), "Stopping early just before {}") <<=
-        {index};
-    ++context.identifier_repetition_counter;
-    context.queue.pop();
   }
+  NTH_LOG((v.when(debug::type_check)), "Done type-checking unit {}") <<=
+      {context.unit.value()};
+  return true;
 }
 
 }  // namespace
 
-void ProcessIr(EmitContext& emit, diag::DiagnosticConsumer& diag) {
-  IrContext context{.emit = emit};
-  context.queue.push(IrContext::WorkItem(emit.tree.node_range()));
-  ProcessIrImpl(context, diag);
+void ProcessIr(EmitContext& emit, DependencyGraph const& graph,
+               diag::DiagnosticConsumer& diag,
+               ProcessIrOptions const& options) {
+  std::vector<std::optional<IrContext::WorkItem>> items(graph.size());
+  items[DependencyGraph::Unit::Module().value()].emplace(
+      emit.tree.node_range());
+  std::vector<std::vector<diag::Message>> diagnostics(graph.size());
+  std::mutex emit_mutex;
+
+  uint32_t threads = std::max<uint32_t>(options.threads, 1);
+  ConcurrentDependencyScheduler scheduler(graph, threads);
+  std::vector<std::vector<IrContext::Allocation>> allocations(threads);
+  auto process = [&](uint32_t worker) {
+    IrContext context{
+        .graph      = graph,
+        .items      = items,
+        .emit_mutex = emit_mutex,
+        .restored   = options.restored ? &options.restored->units : nullptr,
+        .emit       = emit,
+    };
+    diag::BufferingConsumer buffer;
+    ConcurrentDependencyScheduler::Work work;
+    while (scheduler.Next(worker, work)) {
+      // Uses of declarations within a cycle whose types are not yet known are
+      // diagnosed as such.
+      if (work.cycle) { context.component = work.units; }
+      for (auto unit : work.units) {
+        context.unit  = unit;
+        auto& item    = items[unit.value()];
+        bool complete = not item.has_value() or ProcessUnit(context, buffer);
+        for (auto& message : buffer.take()) {
+          diagnostics[unit.value()].push_back(std::move(message));
+        }
+        if (complete) {
+          item.reset();
+          scheduler.Complete(worker, unit);
+        } else {
+          scheduler.Defer(worker, unit);
+        }
+      }
+      context.component = {};
+    }
+    allocations[worker] = std::move(context.allocations);
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(threads - 1);
+    for (uint32_t i = 1; i < threads; ++i) { workers.emplace_back(process, i); }
+    process(0);
+  }
+
+  std::vector<IrContext::Allocation> merged;
+  for (auto const& a : allocations) {
+    merged.insert(merged.end(), a.begin(), a.end());
+  }
+  if (options.restored) {
+    for (ParseNodeIndex index : options.restored->allocations) {
+      merged.push_back({
+          .function = LexicalScope::Index::Root(),
+          .index    = index,
+          .type     = emit.QualifiedTypeOf(index).type(),
+      });
+    }
+  }
+  std::sort(merged.begin(), merged.end(),
+            [](auto const& l, auto const& r) { return l.index < r.index; });
+  for (auto const& allocation : merged) {
+    emit.storage[allocation.function].insert(allocation.index,
+                                             allocation.type);
+  }
+
+  for (auto const& messages : diagnostics) {
+    for (auto const& message : messages) { diag.Consume(message); }
+  }
 }
 
 }  // namespace ic
@@ -1,12 +1,33 @@
 #ifndef ICARUS_IR_IR_H
 #define ICARUS_IR_IR_H
 
+#include <cstdint>
+
 #include "diagnostics/consumer/consumer.h"
+#include "ir/dependency_graph.h"
 #include "ir/emit.h"
 
 namespace ic {
 
-void ProcessIr(EmitContext& emit_context, diag::DiagnosticConsumer& diag);
+struct RestoredTypeCheck;
+
+struct ProcessIrOptions {
+  // The maximum number of threads used. Units of the dependency graph which do
+  // not depend on one another are type-checked concurrently. Diagnostics are
+  // emitted in the order of the units in which they are found, and stack space
+  // is allocated in source order, regardless of how many threads are used.
+  uint32_t threads = 1;
+  // If present, the results of type-checking restored from a cache. Restored
+  // units are not type-checked again, and the stack space they require is
+  // allocated alongside that of every other unit.
+  RestoredTypeCheck const* restored = nullptr;
+};
+
+// Type-checks the module in `emit_context`, processing each unit of `graph`
+// only once every unit it depends on has been processed.
+void ProcessIr(EmitContext& emit_context, DependencyGraph const& graph,
+               diag::DiagnosticConsumer& diag,
+               ProcessIrOptions const& options = {});
 
 }  // namespace ic
 
@@ -0,0 +1,67 @@
+#include "ir/ir.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/resources.h"
+#include "diagnostics/consumer/buffering.h"
+#include "diagnostics/message.h"
+#include "ir/declaration.h"
+#include "ir/dependency_graph.h"
+#include "ir/dependent_modules.h"
+#include "ir/emit.h"
+#include "ir/module.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+
+namespace ic {
+namespace {
+
+// Type-checks `source`, in which the module named "m" may be imported, and
+// returns the text of each diagnostic emitted.
+std::vector<std::string> Diagnostics(std::string_view source,
+                                     uint32_t threads) {
+  diag::BufferingConsumer d;
+  d.set_source(source);
+  TokenBuffer buffer = lex::Lex(source, d);
+  auto [tree, scopes] = Parse(buffer, d);
+  AssignDeclarationsToIdentifiers(tree, d);
+  d.set_parse_tree(tree);
+
+  ModuleId id = resources.module_map.add("m");
+  DependentModules modules;
+  while (modules.count() <= id.value()) { modules.add("m"); }
+  Module module;
+  EmitContext context(tree, modules, scopes, module);
+  DependencyGraph graph(tree);
+  ProcessIr(context, graph, d, {.threads = threads});
+
+  std::vector<std::string> diagnostics;
+  for (diag::Message const& message : d.take()) {
+    std::string& text = diagnostics.emplace_back();
+    for (diag::MessageComponent const& component : message.components()) {
+      if (auto const* t = component.As<diag::Text>()) {
+        text.append(t->text());
+      }
+    }
+  }
+  return diagnostics;
+}
+
+NTH_TEST("ir/missing-module-member", uint32_t threads) {
+  // The diagnostic is buffered by a worker, which does not hold the source,
+  // before being forwarded.
+  NTH_EXPECT(Diagnostics("let m ::= import \"m\"\nlet x ::= m.missing\n",
+                         threads) ==
+             std::vector<std::string>{
+                 "No symbol named 'missing' in the given module."});
+}
+
+NTH_INVOKE_TEST("ir/missing-module-member") {
+  for (uint32_t threads : {1, 4}) { co_yield threads; }
+}
+
+}  // namespace
+}  // namespace ic
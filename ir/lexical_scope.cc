@@ -1,5 +1,7 @@
 #include "ir/lexical_scope.h"
 
+#include <algorithm>
+
 #include "nth/debug/debug.h"
 
 namespace ic {
@@ -17,6 +19,54 @@ LexicalScope::Index LexicalScopeTree::insert_child(
   return index;
 }
 
+uint32_t LexicalScopeTree::append_descendants(LexicalScopeTree const &tree) {
+  uint32_t offset = scopes_.size() - 1;
+  for (uint32_t i = 1; i < tree.scopes_.size(); ++i) {
+    uint32_t distance = tree.scopes_[i].parent_distance_;
+    // Only the distance to the root changes; all other parents are appended
+    // along with their children.
+    scopes_.push_back(LexicalScope(distance == i ? i + offset : distance));
+  }
+  return offset;
+}
+
+uint32_t LexicalScopeTree::replace_descendants(LexicalScope::Index first,
+                                               LexicalScope::Index last,
+                                               LexicalScopeTree const &tree) {
+  NTH_REQUIRE(first.value() != 0);
+  NTH_REQUIRE(first.value() <= last.value());
+  NTH_REQUIRE(last.value() <= scopes_.size());
+  uint32_t removed = last.value() - first.value();
+  uint32_t shift   = (tree.scopes_.size() - 1) - removed;
+  for (uint32_t i = last.value(); i < scopes_.size(); ++i) {
+    // Only the distance to the root changes; all other parents are shifted
+    // along with their children.
+    if (scopes_[i].parent_distance_ == i) {
+      scopes_[i].parent_distance_ += shift;
+    }
+  }
+
+  auto position = scopes_.begin() + first.value();
+  if (tree.scopes_.size() - 1 != removed) {
+    position = scopes_.erase(position, position + removed);
+    position =
+        scopes_.insert(position, tree.scopes_.size() - 1, LexicalScope(0));
+  }
+  uint32_t offset = first.value() - 1;
+  for (uint32_t i = 1; i < tree.scopes_.size(); ++i) {
+    uint32_t distance = tree.scopes_[i].parent_distance_;
+    *position++ = LexicalScope(distance == i ? i + offset : distance);
+  }
+  return offset;
+}
+
+bool LexicalScopeTree::operator==(LexicalScopeTree const &tree) const {
+  return std::ranges::equal(scopes_, tree.scopes_,
+                            [](LexicalScope const &l, LexicalScope const &r) {
+                              return l.parent_distance_ == r.parent_distance_;
+                            });
+}
+
 LexicalScope &LexicalScopeTree::root() { return scopes_[0]; }
 LexicalScope const &LexicalScopeTree::root() const { return scopes_[0]; }
 
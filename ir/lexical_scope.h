@@ -1,6 +1,8 @@
 #ifndef ICARUS_IR_LEXICAL_SCOPE_H
 #define ICARUS_IR_LEXICAL_SCOPE_H
 
+#include <memory_resource>
+#include <span>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -34,6 +36,30 @@ struct LexicalScope {
 struct LexicalScopeTree {
   LexicalScope::Index insert_child(LexicalScope::Index parent_index);
 
+  // Appends every scope in `tree` other than its root, in order, so that the
+  // relationships between them are preserved and those which are children of
+  // the root of `tree` become children of the root of `*this`. Returns the
+  // amount by which the indices of the appended scopes have been shifted.
+  uint32_t append_descendants(LexicalScopeTree const &tree);
+
+  // Replaces the scopes with indices in `[first, last)`, which must consist of
+  // children of the root along with all of their descendants, with every scope
+  // in `tree` other than its root, as `append_descendants` would append them.
+  // Returns the amount (modulo 2^32) by which the indices of the inserted
+  // scopes have been shifted. Scopes with indices at or after `last` are
+  // shifted by the difference between the number of scopes inserted and the
+  // number removed.
+  uint32_t replace_descendants(LexicalScope::Index first,
+                               LexicalScope::Index last,
+                               LexicalScopeTree const &tree);
+
+  size_t size() const { return scopes_.size(); }
+
+  // Every scope in the tree, in order of index. Scopes are trivially copyable
+  // and refer to one another only by relative position, so a tree may be
+  // reconstructed from a copy of them.
+  std::span<LexicalScope const> scopes() const { return scopes_; }
+
   LexicalScope &root();
   LexicalScope const &root() const;
 
@@ -89,7 +115,22 @@ struct LexicalScopeTree {
   LexicalScope &operator[](LexicalScope::Index index);
   LexicalScope const &operator[](LexicalScope::Index index) const;
 
-  LexicalScopeTree() : scopes_(1, LexicalScope(1)) {}
+  LexicalScopeTree() : LexicalScopeTree(std::pmr::get_default_resource()) {}
+
+  // Constructs a tree consisting only of the root scope, whose scopes are
+  // allocated from `memory_resource`.
+  explicit LexicalScopeTree(std::pmr::memory_resource *memory_resource)
+      : scopes_(1, LexicalScope(1), memory_resource) {}
+
+  // Constructs a tree consisting of `scopes`, as returned by `scopes()` for
+  // some tree, allocated from `memory_resource`.
+  explicit LexicalScopeTree(std::span<LexicalScope const> scopes,
+                            std::pmr::memory_resource *memory_resource)
+      : scopes_(scopes.begin(), scopes.end(), memory_resource) {
+    NTH_REQUIRE((v.harden), not scopes_.empty());
+  }
+
+  bool operator==(LexicalScopeTree const &tree) const;
 
  private:
   template <typename>
@@ -99,7 +140,7 @@ struct LexicalScopeTree {
     scope -= scope->parent_distance_;
   }
 
-  std::vector<LexicalScope> scopes_;
+  std::pmr::vector<LexicalScope> scopes_;
 };
 
 }  // namespace ic
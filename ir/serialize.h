@@ -110,8 +110,8 @@ struct ModuleSerializer : W {
     pairs.reserve(size);
     for (auto const& pair : exported_symbols) { pairs.push_back(&pair); }
     std::sort(pairs.begin(), pairs.end(), [](auto const* lhs, auto const* rhs) {
-      return Result(static_cast<std::string const&>(lhs->first) <
-                    static_cast<std::string const&>(rhs->first));
+      return Result(static_cast<std::string_view>(lhs->first) <
+                    static_cast<std::string_view>(rhs->first));
     });
     for (auto const* pair : pairs) {
       co_await nth::io::serialize(s, pair->first);
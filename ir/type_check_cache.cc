@@ -0,0 +1,611 @@
+#include "ir/type_check_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "common/cache_file.h"
+#include "common/mapped_file.h"
+#include "common/resources.h"
+#include "ir/lexical_scope.h"
+#include "jasmin/core/value.h"
+#include "lexer/lexer.h"
+#include "lexer/token.h"
+#include "nth/container/stack.h"
+#include "nth/debug/debug.h"
+#include "parse/node.h"
+#include "type/primitive.h"
+
+namespace ic {
+namespace {
+
+using Unit = DependencyGraph::Unit;
+
+// Incremented whenever the layout of a cache file, or the results type-checking
+// produces, change in a way not captured by `FormatFingerprint`.
+constexpr uint64_t FormatVersion = 3;
+constexpr uint64_t Magic         = 0x6568636163746369;  // "ictcache"
+
+struct Header {
+  uint64_t magic;
+  uint64_t format;
+  uint64_t environment;
+  uint64_t entry_count;
+};
+
+// The fixed-size prefix of each entry in a cache file, which is followed by
+// the contents of each of its vectors in order.
+struct EntryHeader {
+  uint64_t hash;
+  uint32_t node_count;
+  uint32_t description_size;
+  uint32_t dependency_count;
+  uint32_t declarator_count;
+  uint32_t allocation_count;
+  uint32_t constant_count;
+  uint32_t restorable;
+};
+
+struct ConstantHeader {
+  uint32_t root;
+  uint32_t count;
+};
+
+// Returns a hash of everything on which the in-memory representation of a
+// cache file depends, so that files written by a compiler disagreeing on any
+// of it are rejected.
+uint64_t FormatFingerprint() {
+  static uint64_t const fingerprint = [] {
+    CacheFormat format(FormatVersion);
+    for (size_t size :
+         {sizeof(Header), sizeof(EntryHeader), sizeof(ConstantHeader),
+          sizeof(type::QualifiedType), sizeof(type::Type)}) {
+      format.add_size(size);
+    }
+#define IC_XMACRO_PARSE_NODE(kind) format.add_name("p." #kind);
+#include "parse/node.xmacro.h"
+#define IC_XMACRO_TYPE_KIND(kind) format.add_name("t." #kind);
+#include "common/language/type_kind.xmacro.h"
+#define IC_XMACRO_PRIMITIVE_TYPE(kind, symbol, spelling)                       \
+  format.add_name("pt." #kind);
+#include "common/language/primitive_types.xmacro.h"
+    return format.fingerprint();
+  }();
+  return fingerprint;
+}
+
+// Returns whether `qt` is the type of a node which is never type-checked (e.g.,
+// `StatementStart`), whose representation is the same in every process.
+bool Untyped(type::QualifiedType qt) { return qt == type::QualifiedType(); }
+
+// Invokes `f` with a null pointer to the type by which values of type `t` are
+// represented, if that representation is the same in every process. Returns
+// whether `f` was invoked.
+bool WithRepresentation(type::Type t, auto f) {
+  if (t.kind() != type::Type::Kind::Primitive) { return false; }
+  switch (t.as<type::PrimitiveType>().primitive_kind()) {
+    case type::PrimitiveType::Kind::Bool: f(static_cast<bool*>(nullptr)); break;
+    case type::PrimitiveType::Kind::Char: f(static_cast<char*>(nullptr)); break;
+    case type::PrimitiveType::Kind::Byte:
+      f(static_cast<std::byte*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::I8: f(static_cast<int8_t*>(nullptr)); break;
+    case type::PrimitiveType::Kind::I16:
+      f(static_cast<int16_t*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::I32:
+      f(static_cast<int32_t*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::I64:
+      f(static_cast<int64_t*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::U8: f(static_cast<uint8_t*>(nullptr)); break;
+    case type::PrimitiveType::Kind::U16:
+      f(static_cast<uint16_t*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::U32:
+      f(static_cast<uint32_t*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::U64:
+      f(static_cast<uint64_t*>(nullptr));
+      break;
+    case type::PrimitiveType::Kind::F32: f(static_cast<float*>(nullptr)); break;
+    case type::PrimitiveType::Kind::F64: f(static_cast<double*>(nullptr)); break;
+    case type::PrimitiveType::Kind::Type:
+      f(static_cast<type::Type*>(nullptr));
+      break;
+    default: return false;
+  }
+  return true;
+}
+
+// Returns the bits representing `value`, of type `t`, if they are the same in
+// every process.
+std::optional<uint64_t> Encode(type::Type t, jasmin::Value value) {
+  std::optional<uint64_t> result;
+  WithRepresentation(t, [&]<typename T>(T*) {
+    T x = value.as<T>();
+    if constexpr (std::is_same_v<T, type::Type>) {
+      if (x.kind() != type::Type::Kind::Primitive) { return; }
+    }
+    uint64_t bits = 0;
+    std::memcpy(&bits, &x, sizeof(x));
+    result = bits;
+  });
+  return result;
+}
+
+// Returns the value of type `t` represented by `bits`, as returned by `Encode`.
+std::optional<jasmin::Value> Decode(type::Type t, uint64_t bits) {
+  std::optional<jasmin::Value> result;
+  WithRepresentation(t, [&]<typename T>(T*) {
+    T x;
+    std::memcpy(&x, &bits, sizeof(x));
+    result.emplace(x);
+  });
+  return result;
+}
+
+void AppendBytes(std::string& s, void const* data, size_t size) {
+  s.append(static_cast<char const*>(data), size);
+}
+
+template <typename T>
+void Append(std::string& s, T const& value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  AppendBytes(s, &value, sizeof(value));
+}
+
+template <typename T>
+void Append(std::string& s, std::span<T const> values) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  AppendBytes(s, values.data(), values.size_bytes());
+}
+
+// Reads values in their in-memory representation from the front of `content`.
+struct Reader {
+  template <typename T>
+  bool read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (content.size() < sizeof(T)) { return false; }
+    std::memcpy(&value, content.data(), sizeof(T));
+    content.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  template <typename T>
+  bool read(std::vector<T>& values, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (content.size() / sizeof(T) < count) { return false; }
+    values.resize(count);
+    std::memcpy(values.data(), content.data(), count * sizeof(T));
+    content.remove_prefix(count * sizeof(T));
+    return true;
+  }
+
+  bool read(std::string& s, size_t size) {
+    if (content.size() < size) { return false; }
+    s.assign(content.substr(0, size));
+    content.remove_prefix(size);
+    return true;
+  }
+
+  std::string_view content;
+};
+
+// Returns a description of each unit of `top_level`, a graph returned by
+// `DependencyGraph::TopLevel` for `tree`, which was parsed from `source`. The
+// description captures the parse subtree of the unit, including the spelling
+// of every token, but not its position in the source.
+std::vector<std::string> Descriptions(std::string_view source,
+                                      ParseTree const& tree,
+                                      DependencyGraph const& top_level) {
+  // The module unit consists of every node, and is never recorded.
+  std::vector<std::string> descriptions(top_level.size());
+  for (uint32_t u = 1; u < top_level.size(); ++u) {
+    std::string& description = descriptions[u];
+    auto [start, end]        = top_level.range(Unit(u));
+    for (auto index = start; index < end; ++index) {
+      ParseNode const& node = tree[index];
+      Append(description, node.kind);
+      Append(description, node.subtree_size);
+      Token token = tree.token(index);
+      Append(description, token.kind());
+      std::string_view value;
+      switch (token.kind()) {
+        case Token::Kind::Identifier:
+          value = static_cast<std::string_view>(tree.identifier(index));
+          break;
+        case Token::Kind::StringLiteral:
+          value = resources.StringLiteral(tree.string_literal_index(index));
+          break;
+        case Token::Kind::IntegerLiteral:
+          value = lex::IntegerLiteralSpelling(source, token.offset());
+          break;
+        default:
+          // Wide payloads index other tokens, and their relationship is
+          // captured by the sizes of subtrees.
+          if (not token.has_wide_payload()) {
+            Append(description, token.payload());
+          }
+          continue;
+      }
+      Append(description, value.size());
+      description.append(value);
+    }
+  }
+  return descriptions;
+}
+
+// Returns the hash of each of `descriptions`, as returned by `Descriptions`.
+std::vector<uint64_t> HashesOf(std::span<std::string const> descriptions) {
+  std::vector<uint64_t> hashes(descriptions.size(), 0);
+  for (uint32_t u = 1; u < descriptions.size(); ++u) {
+    hashes[u] = SourceHash(descriptions[u]);
+  }
+  return hashes;
+}
+
+}  // namespace
+
+std::vector<uint64_t> TypeCheckCache::Hashes(std::string_view source,
+                                             ParseTree const& tree,
+                                             DependencyGraph const& top_level) {
+  return HashesOf(Descriptions(source, tree, top_level));
+}
+
+TypeCheckCache TypeCheckCache::Record(uint64_t environment,
+                                      std::string_view source,
+                                      DependencyGraph const& graph,
+                                      EmitContext const& emit) {
+  TypeCheckCache cache(environment);
+  ParseTree const& tree     = emit.tree;
+  DependencyGraph top_level = graph.TopLevel();
+  std::vector descriptions  = Descriptions(source, tree, top_level);
+  std::vector hashes        = HashesOf(descriptions);
+
+  // Units sharing a hash cannot be told apart, so none of them are recorded.
+  absl::flat_hash_map<uint64_t, uint32_t> occurrences;
+  for (uint32_t u = 1; u < top_level.size(); ++u) { ++occurrences[hashes[u]]; }
+
+  std::vector<std::vector<ParseNodeIndex>> evaluations(top_level.size());
+  for (auto const& [root, constant] : emit.evaluations) {
+    evaluations[top_level.owner(root).value()].push_back(root);
+  }
+  auto const* top_level_storage =
+      [&]() -> LocalStorage const* {
+    auto iter = emit.storage.find(LexicalScope::Index::Root());
+    return iter == emit.storage.end() ? nullptr : &iter->second;
+  }();
+
+  // Records the results of `unit`, returning `false` if any of them cannot be
+  // restored in another process.
+  auto record = [&](Unit unit, Entry& entry) {
+    auto [start, end] = top_level.range(unit);
+    // Only declarations consisting of a single unit are recorded. Any other
+    // statement, or a declaration containing statements (e.g., the body of a
+    // function literal), involves results which are not recorded.
+    if (start + 1 >= end or
+        tree[start + 1].kind != ParseNode::Kind::DeclarationStart or
+        not graph.children(graph.owner(start)).empty()) {
+      return false;
+    }
+
+    entry.types.reserve(entry.node_count);
+    for (auto index = start; index < end; ++index) {
+      type::QualifiedType qt = emit.QualifiedTypeOf(index);
+      if (not Untyped(qt) and qt.type().kind() != type::Type::Kind::Primitive) {
+        return false;
+      }
+      entry.types.push_back(qt);
+
+      ParseNode const& node = tree[index];
+      if (node.kind == ParseNode::Kind::Import or
+          emit.instruction_spec.contains(index) or
+          emit.statement_expression_info.contains(index)) {
+        return false;
+      }
+
+      if (auto iter = emit.declarator.find(index);
+          iter != emit.declarator.end()) {
+        auto [declared_identifier, declaration] = iter->second;
+        Unit owner                              = top_level.owner(declaration);
+        uint32_t slot                           = 0;
+        if (owner != unit) {
+          auto d = std::ranges::lower_bound(entry.dependencies,
+                                            hashes[owner.value()]);
+          if (d == entry.dependencies.end() or *d != hashes[owner.value()]) {
+            return false;
+          }
+          slot = 1 + (d - entry.dependencies.begin());
+        }
+        ParseNodeIndex base = top_level.range(owner).lower_bound();
+        entry.declarators.push_back({
+            .identifier          = (index - start).value(),
+            .unit                = slot,
+            .declared_identifier = (declared_identifier - base).value(),
+            .declaration         = (declaration - base).value(),
+        });
+      }
+
+      if (node.kind == ParseNode::Kind::Declaration and top_level_storage and
+          top_level_storage->try_offset(index)) {
+        entry.allocations.push_back((index - start).value());
+      }
+    }
+
+    for (ParseNodeIndex root : evaluations[unit.value()]) {
+      auto const& computed = emit.evaluations.at(root);
+      std::span types      = computed.types();
+      std::span values     = computed.value_span();
+      if (types.size() != values.size()) { return false; }
+      Constant& constant = entry.constants.emplace_back();
+      constant.root      = (root - start).value();
+      constant.types.assign(types.begin(), types.end());
+      for (size_t i = 0; i < types.size(); ++i) {
+        std::optional bits = Encode(types[i], values[i]);
+        if (not bits) { return false; }
+        constant.values.push_back(*bits);
+      }
+    }
+    return true;
+  };
+
+  for (uint32_t u = 1; u < top_level.size(); ++u) {
+    if (occurrences[hashes[u]] != 1) { continue; }
+    auto [start, end] = top_level.range(Unit(u));
+    Entry entry{.node_count = (end - start).value()};
+    for (Unit dependency : top_level.dependencies(Unit(u))) {
+      if (dependency == Unit::Module()) { continue; }
+      entry.dependencies.push_back(hashes[dependency.value()]);
+    }
+    std::sort(entry.dependencies.begin(), entry.dependencies.end());
+    entry.description = std::move(descriptions[u]);
+    entry.restorable  = record(Unit(u), entry);
+    if (not entry.restorable) {
+      entry.types.clear();
+      entry.declarators.clear();
+      entry.allocations.clear();
+      entry.constants.clear();
+    }
+    cache.entries_.emplace(hashes[u], std::move(entry));
+  }
+  return cache;
+}
+
+RestoredTypeCheck TypeCheckCache::Restore(std::string_view source,
+                                          DependencyGraph const& graph,
+                                          EmitContext& emit) const {
+  RestoredTypeCheck restored;
+  restored.units.resize(graph.size());
+  ParseTree const& tree     = emit.tree;
+  DependencyGraph top_level = graph.TopLevel();
+  std::vector descriptions  = Descriptions(source, tree, top_level);
+  std::vector hashes        = HashesOf(descriptions);
+
+  // Maps each hash to the only unit with that hash, or to the module unit if
+  // there is more than one.
+  absl::flat_hash_map<uint64_t, Unit> units;
+  for (uint32_t u = 1; u < top_level.size(); ++u) {
+    auto [iter, inserted] = units.try_emplace(hashes[u], Unit(u));
+    if (not inserted) { iter->second = Unit::Module(); }
+  }
+
+  // A unit is unchanged if it has an entry with the same description, as
+  // hashes may collide, and depends on units with the hashes recorded in it,
+  // each of which is itself unchanged.
+  std::vector<Entry const*> unchanged(top_level.size(), nullptr);
+  std::vector<Unit> changed;
+  for (uint32_t u = 1; u < top_level.size(); ++u) {
+    auto iter = entries_.find(hashes[u]);
+    if (iter != entries_.end() and units.at(hashes[u]) == Unit(u) and
+        iter->second.description == descriptions[u]) {
+      std::vector<uint64_t> dependencies;
+      for (Unit dependency : top_level.dependencies(Unit(u))) {
+        if (dependency == Unit::Module()) { continue; }
+        dependencies.push_back(hashes[dependency.value()]);
+      }
+      std::sort(dependencies.begin(), dependencies.end());
+      if (dependencies == iter->second.dependencies) {
+        unchanged[u] = &iter->second;
+        continue;
+      }
+    }
+    changed.push_back(Unit(u));
+  }
+  while (not changed.empty()) {
+    Unit unit = changed.back();
+    changed.pop_back();
+    for (Unit dependent : top_level.dependents(unit)) {
+      if (std::exchange(unchanged[dependent.value()], nullptr)) {
+        changed.push_back(dependent);
+      }
+    }
+  }
+
+  for (uint32_t u = 1; u < top_level.size(); ++u) {
+    Entry const* entry = unchanged[u];
+    if (not entry or not entry->restorable) { continue; }
+    auto [start, end] = top_level.range(Unit(u));
+    if ((end - start).value() != entry->node_count) { continue; }
+
+    // Every dependency of an unchanged unit is the only unit with its hash.
+    auto declaring_range = [&](uint32_t slot) {
+      return top_level.range(
+          slot == 0 ? Unit(u) : units.at(entry->dependencies[slot - 1]));
+    };
+    if (not std::ranges::all_of(entry->declarators, [&](auto const& d) {
+          auto [base, limit] = declaring_range(d.unit);
+          uint32_t size      = (limit - base).value();
+          return d.declared_identifier < size and d.declaration < size;
+        })) {
+      continue;
+    }
+
+    for (uint32_t i = 0; i < entry->node_count; ++i) {
+      if (Untyped(entry->types[i])) { continue; }
+      emit.SetQualifiedType(start + i, entry->types[i]);
+    }
+    for (auto const& d : entry->declarators) {
+      ParseNodeIndex base = declaring_range(d.unit).lower_bound();
+      emit.declarator.emplace(start + d.identifier,
+                              std::pair(base + d.declared_identifier,
+                                        base + d.declaration));
+    }
+    for (uint32_t offset : entry->allocations) {
+      restored.allocations.push_back(start + offset);
+    }
+    for (auto const& constant : entry->constants) {
+      nth::stack<jasmin::Value> values;
+      for (size_t i = 0; i < constant.types.size(); ++i) {
+        std::optional value = Decode(constant.types[i], constant.values[i]);
+        NTH_REQUIRE((v.harden), value.has_value());
+        values.push(*value);
+      }
+      ParseNodeIndex root = start + constant.root;
+      EmitContext::ComputedConstants computed(root, std::move(values),
+                                              constant.types);
+      emit.constants.insert_or_assign(tree.subtree_range(root), computed);
+      emit.evaluations.insert_or_assign(root, std::move(computed));
+    }
+    restored.units[graph.owner(start).value()] = true;
+  }
+  return restored;
+}
+
+bool TypeCheckCache::Write(nth::file_path const& path) const {
+  std::string content;
+  Append(content, Header{
+                      .magic       = Magic,
+                      .format      = FormatFingerprint(),
+                      .environment = environment_,
+                      .entry_count = entries_.size(),
+                  });
+  for (auto const& [hash, entry] : entries_) {
+    Append(content,
+           EntryHeader{
+               .hash             = hash,
+               .node_count       = entry.node_count,
+               .description_size = static_cast<uint32_t>(
+                   entry.description.size()),
+               .dependency_count = static_cast<uint32_t>(
+                   entry.dependencies.size()),
+               .declarator_count = static_cast<uint32_t>(
+                   entry.declarators.size()),
+               .allocation_count = static_cast<uint32_t>(
+                   entry.allocations.size()),
+               .constant_count = static_cast<uint32_t>(entry.constants.size()),
+               .restorable     = entry.restorable,
+           });
+    content.append(entry.description);
+    Append(content, std::span(entry.dependencies));
+    if (not entry.restorable) { continue; }
+    Append(content, std::span(entry.types));
+    Append(content, std::span(entry.declarators));
+    Append(content, std::span(entry.allocations));
+    for (auto const& constant : entry.constants) {
+      Append(content, ConstantHeader{
+                          .root  = constant.root,
+                          .count = static_cast<uint32_t>(constant.types.size()),
+                      });
+      Append(content, std::span(constant.types));
+      Append(content, std::span(constant.values));
+    }
+  }
+
+  std::optional file = CacheFileWriter::TryCreate(path);
+  if (not file) { return false; }
+  file->write(content.data(), content.size());
+  return file->Commit();
+}
+
+std::optional<TypeCheckCache> TypeCheckCache::Read(nth::file_path const& path,
+                                                   uint64_t environment) {
+  std::optional file = MappedFile::TryOpen(path);
+  if (not file) { return std::nullopt; }
+  Reader reader{.content = file->content()};
+
+  Header header;
+  if (not reader.read(header) or header.magic != Magic or
+      header.format != FormatFingerprint() or
+      header.environment != environment) {
+    return std::nullopt;
+  }
+
+  TypeCheckCache cache(environment);
+  for (uint64_t e = 0; e < header.entry_count; ++e) {
+    EntryHeader entry_header;
+    if (not reader.read(entry_header)) { return std::nullopt; }
+    Entry entry{
+        .node_count = entry_header.node_count,
+        .restorable = entry_header.restorable != 0,
+    };
+    if (not reader.read(entry.description, entry_header.description_size) or
+        not reader.read(entry.dependencies, entry_header.dependency_count)) {
+      return std::nullopt;
+    }
+    if (entry.restorable) {
+      if (not reader.read(entry.types, entry.node_count) or
+          not reader.read(entry.declarators, entry_header.declarator_count) or
+          not reader.read(entry.allocations, entry_header.allocation_count)) {
+        return std::nullopt;
+      }
+      for (type::QualifiedType qt : entry.types) {
+        if (not Untyped(qt) and
+            qt.type().kind() != type::Type::Kind::Primitive) {
+          return std::nullopt;
+        }
+      }
+      for (auto const& d : entry.declarators) {
+        if (d.identifier >= entry.node_count or
+            d.unit > entry.dependencies.size()) {
+          return std::nullopt;
+        }
+      }
+      for (uint32_t c = 0; c < entry_header.constant_count; ++c) {
+        ConstantHeader constant_header;
+        Constant& constant = entry.constants.emplace_back();
+        if (not reader.read(constant_header) or
+            not reader.read(constant.types, constant_header.count) or
+            not reader.read(constant.values, constant_header.count)) {
+          return std::nullopt;
+        }
+        constant.root = constant_header.root;
+        if (constant.root >= entry.node_count) { return std::nullopt; }
+        for (type::Type t : constant.types) {
+          if (not WithRepresentation(t, [](auto*) {})) { return std::nullopt; }
+        }
+      }
+    }
+    if (not cache.entries_.emplace(entry_header.hash, std::move(entry))
+                .second) {
+      return std::nullopt;
+    }
+  }
+  if (not reader.content.empty()) { return std::nullopt; }
+  return cache;
+}
+
+std::optional<nth::file_path> TypeCheckCachePath(
+    nth::file_path const& directory, nth::file_path const& source) {
+  // The cache is keyed by the location of the source rather than its content,
+  // as it is meant to be reused after the source is edited.
+  std::error_code error;
+  std::filesystem::path absolute =
+      std::filesystem::weakly_canonical(source.path(), error);
+  if (error) { return std::nullopt; }
+  char name[sizeof("0123456789abcdef.ict")];
+  std::snprintf(name, sizeof(name), "%016llx.ict",
+                static_cast<unsigned long long>(SourceHash(absolute.string())));
+  return nth::file_path::try_construct(
+      (std::filesystem::path(directory.path()) / name).string());
+}
+
+}  // namespace ic
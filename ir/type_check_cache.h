@@ -0,0 +1,126 @@
+#ifndef ICARUS_IR_TYPE_CHECK_CACHE_H
+#define ICARUS_IR_TYPE_CHECK_CACHE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "ir/dependency_graph.h"
+#include "ir/emit.h"
+#include "nth/io/file_path.h"
+#include "parse/node_index.h"
+#include "parse/tree.h"
+#include "type/qualified_type.h"
+#include "type/type.h"
+
+namespace ic {
+
+// The results of type-checking restored from a `TypeCheckCache`.
+struct RestoredTypeCheck {
+  // Whether the results of each unit of the dependency graph were restored, in
+  // which case the unit need not be type-checked.
+  std::vector<bool> units;
+  // The restored declarations requiring stack space in the module's top-level
+  // function.
+  std::vector<ParseNodeIndex> allocations;
+};
+
+// Records the results of type-checking each top-level declaration of a module,
+// so that a later compilation of the same source file, after edits elsewhere
+// in it, need only type-check the declarations affected by those edits.
+//
+// Each top-level statement is identified by a hash of its parse subtree,
+// including the spelling of every token, so that it is recognized regardless
+// of its position in the source. As hashes are not collision resistant, the
+// entry also records the description of the subtree which was hashed, which
+// must match exactly. The entry for a statement records the hashes of the
+// top-level statements it depends on, and is restored only if neither
+// it nor anything it depends on, transitively, has changed. The cache as a
+// whole is tied to the contents of the module map and the modules it names.
+//
+// Types and compile-time values are recorded in their in-memory
+// representation. Only those of primitive types have a representation which is
+// the same in every process, so the results of declarations involving any other
+// type are not recorded, and such declarations are always type-checked.
+struct TypeCheckCache {
+  // Records the results of type-checking the module in `emit`, which was parsed
+  // from `source` and has dependency graph `graph`, in an environment
+  // identified by `environment`.
+  static TypeCheckCache Record(uint64_t environment, std::string_view source,
+                               DependencyGraph const& graph,
+                               EmitContext const& emit);
+
+  // Returns the cache stored at `path`, or `std::nullopt` if there is no such
+  // file, or if it was not written by this compiler in the same environment.
+  static std::optional<TypeCheckCache> Read(nth::file_path const& path,
+                                            uint64_t environment);
+
+  // Writes the cache to `path`. The file is written in full under a temporary
+  // name and then renamed, so that compilations sharing a cache never observe
+  // a partially written file. Returns whether the file was written.
+  bool Write(nth::file_path const& path) const;
+
+  // Restores into `emit` the results of each top-level declaration of the
+  // module parsed from `source`, whose dependency graph is `graph`, which is
+  // recorded and unchanged.
+  RestoredTypeCheck Restore(std::string_view source,
+                            DependencyGraph const& graph,
+                            EmitContext& emit) const;
+
+  // Returns the hash identifying each unit of `top_level`, a graph returned by
+  // `DependencyGraph::TopLevel` for `tree`, which was parsed from `source`.
+  static std::vector<uint64_t> Hashes(std::string_view source,
+                                      ParseTree const& tree,
+                                      DependencyGraph const& top_level);
+
+ private:
+  // Identifies a declaration by the unit containing it, either the unit of
+  // the entry itself (`unit == 0`) or its `unit - 1`th dependency, and by the
+  // offsets of its nodes from the start of that unit.
+  struct Declarator {
+    uint32_t identifier;
+    uint32_t unit;
+    uint32_t declared_identifier;
+    uint32_t declaration;
+  };
+
+  // The result of evaluating the subtree rooted at `root` at compile-time.
+  struct Constant {
+    uint32_t root;
+    std::vector<type::Type> types;
+    std::vector<uint64_t> values;
+  };
+
+  // All offsets are relative to the start of the unit.
+  struct Entry {
+    uint32_t node_count;
+    // The description from which the hash of this unit was computed, which
+    // must match on restoration, as hashes may collide.
+    std::string description;
+    // The hashes of the units this unit depends on, in increasing order.
+    std::vector<uint64_t> dependencies;
+    // Whether the results below were recorded.
+    bool restorable = false;
+    std::vector<type::QualifiedType> types;
+    std::vector<Declarator> declarators;
+    std::vector<uint32_t> allocations;
+    std::vector<Constant> constants;
+  };
+
+  explicit TypeCheckCache(uint64_t environment) : environment_(environment) {}
+
+  uint64_t environment_;
+  absl::flat_hash_map<uint64_t, Entry> entries_;
+};
+
+// Returns the path of the type-check cache file for the source file at `source`
+// within `directory`.
+std::optional<nth::file_path> TypeCheckCachePath(
+    nth::file_path const& directory, nth::file_path const& source);
+
+}  // namespace ic
+
+#endif  // ICARUS_IR_TYPE_CHECK_CACHE_H
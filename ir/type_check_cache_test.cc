@@ -0,0 +1,173 @@
+#include "ir/type_check_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/cache_file.h"
+#include "common/mapped_file.h"
+#include "diagnostics/consumer/null.h"
+#include "ir/declaration.h"
+#include "ir/dependent_modules.h"
+#include "ir/ir.h"
+#include "ir/module.h"
+#include "jasmin/core/value.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+
+namespace ic {
+namespace {
+
+// Returns the hash of each top-level unit of `source`, excluding the module.
+std::vector<uint64_t> HashesOf(std::string_view source) {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  ParseTree tree     = Parse(buffer, d).parse_tree;
+  NTH_ASSERT(AssignDeclarationsToIdentifiers(tree, d));
+  DependencyGraph graph(tree);
+  std::vector hashes = TypeCheckCache::Hashes(source, tree, graph.TopLevel());
+  hashes.erase(hashes.begin());
+  return hashes;
+}
+
+NTH_TEST("type-check-cache/hashes-ignore-position") {
+  std::vector a = HashesOf("let x ::= 3\nlet y ::= true\n");
+  std::vector b = HashesOf("let y ::= true\n\n\n  let x ::= 3\n");
+  NTH_ASSERT(a.size() == 2);
+  NTH_ASSERT(b.size() == 2);
+  NTH_EXPECT(a[0] == b[1]);
+  NTH_EXPECT(a[1] == b[0]);
+  NTH_EXPECT(a[0] != a[1]);
+}
+
+NTH_TEST("type-check-cache/hashes-depend-on-spelling") {
+  std::vector a = HashesOf("let x ::= 3\nlet y ::= true\n");
+  std::vector b = HashesOf("let x ::= 4\nlet y ::= true\n");
+  std::vector c = HashesOf("let z ::= 3\nlet y ::= true\n");
+  NTH_EXPECT(a[0] != b[0]);
+  NTH_EXPECT(a[0] != c[0]);
+  NTH_EXPECT(a[1] == b[1]);
+  NTH_EXPECT(a[1] == c[1]);
+}
+
+// The state of compiling `source` through name resolution.
+struct Compilation {
+  explicit Compilation(std::string_view source)
+      : buffer(lex::Lex(source, consumer)),
+        parse_result(Parse(buffer, consumer)),
+        resolved(AssignDeclarationsToIdentifiers(parse_result.parse_tree,
+                                                 consumer)),
+        emit(parse_result.parse_tree, modules, parse_result.scope_tree,
+             module),
+        graph(parse_result.parse_tree) {}
+
+  diag::NullConsumer consumer;
+  TokenBuffer buffer;
+  ParseResult parse_result;
+  bool resolved;
+  DependentModules modules;
+  Module module;
+  EmitContext emit;
+  DependencyGraph graph;
+};
+
+NTH_TEST("type-check-cache/restore") {
+  std::string_view source = "let b ::= true\nlet t ::= bool\nlet c ::= b\n";
+  Compilation original(source);
+  NTH_ASSERT(original.resolved);
+  ProcessIr(original.emit, original.graph, original.consumer);
+  NTH_ASSERT(original.consumer.count() == 0);
+  TypeCheckCache cache =
+      TypeCheckCache::Record(0, source, original.graph, original.emit);
+
+  Compilation restored(source);
+  NTH_ASSERT(restored.resolved);
+  RestoredTypeCheck result =
+      cache.Restore(source, restored.graph, restored.emit);
+
+  // Every declaration is restored, including the nodes which are never
+  // type-checked.
+  DependencyGraph top_level = restored.graph.TopLevel();
+  NTH_ASSERT(top_level.size() == 4);
+  for (uint32_t u = 1; u < top_level.size(); ++u) {
+    auto [start, end] = top_level.range(DependencyGraph::Unit(u));
+    NTH_EXPECT(result.units[restored.graph.owner(start).value()]);
+    for (auto index = start; index < end; ++index) {
+      NTH_EXPECT(restored.emit.QualifiedTypeOf(index) ==
+                 original.emit.QualifiedTypeOf(index));
+    }
+  }
+
+  NTH_EXPECT(restored.emit.declarator.size() ==
+             original.emit.declarator.size());
+  for (auto const& [identifier, declarator] : original.emit.declarator) {
+    auto iter = restored.emit.declarator.find(identifier);
+    NTH_ASSERT(iter != restored.emit.declarator.end());
+    NTH_EXPECT(iter->second == declarator);
+  }
+
+  for (auto const& [root, computed] : original.emit.evaluations) {
+    auto iter = restored.emit.evaluations.find(root);
+    NTH_ASSERT(iter != restored.emit.evaluations.end());
+    NTH_EXPECT(std::ranges::equal(iter->second.types(), computed.types()));
+    NTH_EXPECT(std::ranges::equal(
+        iter->second.value_span(), computed.value_span(),
+        [](jasmin::Value l, jasmin::Value r) {
+          return l.raw_value() == r.raw_value();
+        }));
+    NTH_EXPECT(restored.emit.constants.at(root) == computed);
+  }
+}
+
+NTH_TEST("type-check-cache/restore-requires-same-description") {
+  // Simulates a hash collision by changing the recorded description of a unit
+  // without changing its hash.
+  std::string_view source = "let collided ::= true\nlet t ::= bool\n";
+  Compilation original(source);
+  NTH_ASSERT(original.resolved);
+  ProcessIr(original.emit, original.graph, original.consumer);
+  NTH_ASSERT(original.consumer.count() == 0);
+
+  std::optional path = nth::file_path::try_construct(
+      (std::filesystem::temp_directory_path() / "ic-type-check-cache-collision")
+          .string());
+  NTH_ASSERT(path.has_value());
+  NTH_ASSERT(TypeCheckCache::Record(0, source, original.graph, original.emit)
+                 .Write(*path));
+  std::string content;
+  {
+    std::optional file = MappedFile::TryOpen(*path);
+    NTH_ASSERT(file.has_value());
+    content = file->content();
+  }
+  size_t offset = content.find("collided");
+  NTH_ASSERT(offset != std::string::npos);
+  content.replace(offset, 8, "collider");
+  std::optional writer = CacheFileWriter::TryCreate(*path);
+  NTH_ASSERT(writer.has_value());
+  writer->write(content.data(), content.size());
+  NTH_ASSERT(writer->Commit());
+
+  std::optional cache = TypeCheckCache::Read(*path, 0);
+  NTH_ASSERT(cache.has_value());
+  Compilation restored(source);
+  NTH_ASSERT(restored.resolved);
+  RestoredTypeCheck result =
+      cache->Restore(source, restored.graph, restored.emit);
+  DependencyGraph top_level = restored.graph.TopLevel();
+  NTH_ASSERT(top_level.size() == 3);
+  auto owner = [&](uint32_t u) {
+    return restored.graph.owner(top_level.range(DependencyGraph::Unit(u))
+                                    .lower_bound())
+        .value();
+  };
+  NTH_EXPECT(not result.units[owner(1)]);
+  NTH_EXPECT(result.units[owner(2)]);
+}
+
+}  // namespace
+}  // namespace ic
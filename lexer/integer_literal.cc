@@ -0,0 +1,147 @@
+#include "lexer/integer_literal.h"
+
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "nth/debug/debug.h"
+#include "nth/utility/no_destructor.h"
+
+namespace ic::lex {
+namespace {
+
+constexpr uint64_t DigitValue(char c) {
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+constexpr bool HasRadixPrefix(std::string_view spelling) {
+  return spelling.size() >= 2 and spelling[0] == '0' and
+         std::string_view("bodx").find(spelling[1]) != std::string_view::npos;
+}
+
+constexpr std::string_view Digits(std::string_view spelling) {
+  return HasRadixPrefix(spelling) ? spelling.substr(2) : spelling;
+}
+
+// Returns whether each of the eight bytes of `chunk` is an ASCII decimal digit.
+constexpr bool AllDecimalDigits(uint64_t chunk) {
+  return (chunk & 0xf0f0f0f0f0f0f0f0) == 0x3030303030303030 and
+         ((chunk + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) ==
+             0x3030303030303030;
+}
+
+// Returns the value of the eight decimal digits in `chunk`, where the first
+// digit is in the lowest-addressed (least significant) byte. Adjacent digits
+// are combined pairwise, then adjacent pairs, then adjacent quadruples, so
+// that the whole chunk is converted with three multiplications.
+constexpr uint64_t ParseEightDecimalDigits(uint64_t chunk) {
+  chunk -= 0x3030303030303030;
+  chunk = (chunk * 10 + (chunk >> 8)) & 0x00ff00ff00ff00ff;
+  chunk = (chunk * 100 + (chunk >> 16)) & 0x0000ffff0000ffff;
+  return (chunk * 10000 + (chunk >> 32)) & 0x00000000ffffffff;
+}
+
+static_assert(ParseEightDecimalDigits(0x3837363534333231) == 12345678);
+static_assert(AllDecimalDigits(0x3837363534333231));
+static_assert(not AllDecimalDigits(0x38373636355f3231));
+
+// Accumulates the value of `digits`, in radix `radix`, into `value` for as long
+// as it fits in 64 bits. Returns the digits which were not accumulated, which
+// are empty unless accumulating the first of them would overflow.
+std::string_view Accumulate(std::string_view digits, uint64_t radix,
+                            uint64_t& value) {
+  if constexpr (std::endian::native == std::endian::little) {
+    if (radix == 10) {
+      while (digits.size() >= 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, digits.data(), 8);
+        if (not AllDecimalDigits(chunk)) { break; }
+        uint64_t next;
+        if (__builtin_mul_overflow(value, uint64_t{100'000'000}, &next) or
+            __builtin_add_overflow(next, ParseEightDecimalDigits(chunk),
+                                   &next)) {
+          return digits;
+        }
+        value = next;
+        digits.remove_prefix(8);
+      }
+    }
+  }
+
+  for (; not digits.empty(); digits.remove_prefix(1)) {
+    char c = digits.front();
+    if (c == '_') { continue; }
+    uint64_t next;
+    if (__builtin_mul_overflow(value, radix, &next) or
+        __builtin_add_overflow(next, DigitValue(c), &next)) {
+      return digits;
+    }
+    value = next;
+  }
+  return digits;
+}
+
+}  // namespace
+
+uint32_t IntegerLiteralRadix(std::string_view spelling) {
+  if (not HasRadixPrefix(spelling)) { return 10; }
+  switch (spelling[1]) {
+    case 'b': return 2;
+    case 'o': return 8;
+    case 'x': return 16;
+    default: return 10;
+  }
+}
+
+std::optional<uint64_t> ParseIntegerLiteral64(std::string_view spelling) {
+  uint64_t value = 0;
+  if (not Accumulate(Digits(spelling), IntegerLiteralRadix(spelling), value)
+              .empty()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+IntegerLiteralValue ParseIntegerLiteral(std::string_view spelling) {
+  int radix             = IntegerLiteralRadix(spelling);
+  uint64_t prefix       = 0;
+  std::string_view rest = Accumulate(Digits(spelling), radix, prefix);
+  if (rest.empty()) { return prefix; }
+
+  nth::integer value = prefix;
+  for (char c : rest) {
+    if (c == '_') { continue; }
+    value = value * radix + static_cast<int>(DigitValue(c));
+  }
+  return value;
+}
+
+uint32_t IntegerLiteralTable::index(std::string_view spelling) {
+  if (auto n = ParseIntegerLiteral64(spelling)) {
+    return spellings_.index(std::to_string(*n));
+  }
+
+  std::string_view digits = Digits(spelling);
+  std::string canonical(spelling.substr(0, spelling.size() - digits.size()));
+  for (char c : digits) {
+    if (c == '_') { continue; }
+    if (c == '0' and canonical.size() == spelling.size() - digits.size()) {
+      continue;
+    }
+    canonical.push_back(std::tolower(c));
+  }
+  return spellings_.index(canonical);
+}
+
+IntegerLiteralValue IntegerLiteralTable::operator[](uint32_t index) const {
+  return ParseIntegerLiteral(spellings_.from_index(index));
+}
+
+IntegerLiteralTable& IntegerLiterals() {
+  static nth::NoDestructor<IntegerLiteralTable> table;
+  return *table;
+}
+
+}  // namespace ic::lex
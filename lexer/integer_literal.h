@@ -0,0 +1,61 @@
+#ifndef ICARUS_LEXER_INTEGER_LITERAL_H
+#define ICARUS_LEXER_INTEGER_LITERAL_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include "common/interner.h"
+#include "nth/numeric/integer.h"
+
+namespace ic::lex {
+
+// Integer literals consist of an optional radix prefix (`0b`, `0o`, `0d`, or
+// `0x`) followed by one or more digits in that radix, possibly separated by
+// underscores. Literals without a prefix are decimal. The functions below
+// require that `spelling` be a well-formed integer literal, as produced by the
+// lexer.
+
+// Returns the radix of the integer literal spelled `spelling`.
+uint32_t IntegerLiteralRadix(std::string_view spelling);
+
+// Returns the value of the integer literal spelled `spelling` if it is
+// representable as a `uint64_t`, and `std::nullopt` otherwise.
+std::optional<uint64_t> ParseIntegerLiteral64(std::string_view spelling);
+
+// The value of an integer literal. Values representable as a `uint64_t` are
+// held directly, and only larger values as arbitrary-precision integers.
+using IntegerLiteralValue = std::variant<uint64_t, nth::integer>;
+
+// Returns the value of the integer literal spelled `spelling`. Digits are
+// accumulated in 64 bits, and only if that overflows does accumulation continue
+// in arbitrary precision, from the digit at which it overflowed.
+IntegerLiteralValue ParseIntegerLiteral(std::string_view spelling);
+
+// Holds the values of integer literals too large to be held in the payload of
+// their token (see `TokenBuffer::InlineIntegerLimit`). Each distinct value is
+// assigned a dense index, so that lexing the same source repeatedly does not
+// grow the table. Literals are keyed by a canonical spelling: the decimal
+// spelling of values representable as a `uint64_t`, and otherwise the digits in
+// their original radix without separators or leading zeros. Safe for concurrent
+// use; looking up a value, or the index of a value already present, does not
+// take a lock.
+struct IntegerLiteralTable {
+  // Returns the index of the value of the integer literal spelled `spelling`,
+  // inserting it if it is not already present.
+  uint32_t index(std::string_view spelling);
+
+  // Returns the value at `index`, which must have been returned by `index`.
+  IntegerLiteralValue operator[](uint32_t index) const;
+
+ private:
+  Interner spellings_;
+};
+
+// Returns the process-wide table of integer literal values.
+IntegerLiteralTable& IntegerLiterals();
+
+}  // namespace ic::lex
+
+#endif  // ICARUS_LEXER_INTEGER_LITERAL_H
@@ -0,0 +1,128 @@
+#include "lexer/integer_literal.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include "nth/test/test.h"
+
+namespace ic::lex {
+namespace {
+
+NTH_TEST("integer-literal/radix", std::string_view spelling, uint32_t radix) {
+  NTH_EXPECT(IntegerLiteralRadix(spelling) == radix);
+}
+
+NTH_INVOKE_TEST("integer-literal/radix") {
+  co_yield nth::TestArguments{"0", 10};
+  co_yield nth::TestArguments{"01", 10};
+  co_yield nth::TestArguments{"123", 10};
+  co_yield nth::TestArguments{"0b1", 2};
+  co_yield nth::TestArguments{"0o1", 8};
+  co_yield nth::TestArguments{"0d1", 10};
+  co_yield nth::TestArguments{"0x1", 16};
+}
+
+NTH_TEST("integer-literal/64-bit", std::string_view spelling,
+         uint64_t expected) {
+  std::optional value = ParseIntegerLiteral64(spelling);
+  NTH_ASSERT(value.has_value());
+  NTH_EXPECT(*value == expected);
+}
+
+NTH_INVOKE_TEST("integer-literal/64-bit") {
+  co_yield nth::TestArguments{"0", 0};
+  co_yield nth::TestArguments{"7", 7};
+  co_yield nth::TestArguments{"0d7", 7};
+  co_yield nth::TestArguments{"1_000_000", 1'000'000};
+  co_yield nth::TestArguments{"12345678", 12'345'678};
+  co_yield nth::TestArguments{"1234_5678_9", 123'456'789};
+  co_yield nth::TestArguments{"123456789012345678", 123'456'789'012'345'678};
+  co_yield nth::TestArguments{"18446744073709551615",
+                              std::numeric_limits<uint64_t>::max()};
+  co_yield nth::TestArguments{"0b1011", 11};
+  co_yield nth::TestArguments{"0o777", 511};
+  co_yield nth::TestArguments{"0x1f", 31};
+  co_yield nth::TestArguments{"0xFF_FF", 65535};
+  co_yield nth::TestArguments{"0xffffffffffffffff",
+                              std::numeric_limits<uint64_t>::max()};
+}
+
+NTH_TEST("integer-literal/64-bit-overflow", std::string_view spelling) {
+  NTH_EXPECT(not ParseIntegerLiteral64(spelling).has_value());
+}
+
+NTH_INVOKE_TEST("integer-literal/64-bit-overflow") {
+  co_yield std::string_view("18446744073709551616");
+  co_yield std::string_view("123456789012345678901234567890");
+  co_yield std::string_view("0x1_0000_0000_0000_0000");
+  co_yield std::string_view(
+      "0b1_0000000000000000000000000000000000000000000000000000000000000000");
+}
+
+NTH_TEST("integer-literal/direct", std::string_view spelling,
+         uint64_t expected) {
+  IntegerLiteralValue value = ParseIntegerLiteral(spelling);
+  NTH_ASSERT(std::holds_alternative<uint64_t>(value));
+  NTH_EXPECT(std::get<uint64_t>(value) == expected);
+}
+
+NTH_INVOKE_TEST("integer-literal/direct") {
+  co_yield nth::TestArguments{"0", 0};
+  co_yield nth::TestArguments{"1_000_000", 1'000'000};
+  co_yield nth::TestArguments{"18446744073709551615",
+                              std::numeric_limits<uint64_t>::max()};
+  co_yield nth::TestArguments{"0xffffffffffffffff",
+                              std::numeric_limits<uint64_t>::max()};
+}
+
+NTH_TEST("integer-literal/bignum") {
+  nth::integer max = std::numeric_limits<uint64_t>::max();
+  for (std::string_view spelling :
+       {"18446744073709551616", "1844674407370955161_6",
+        "0x1_0000_0000_0000_0000"}) {
+    IntegerLiteralValue value = ParseIntegerLiteral(spelling);
+    NTH_ASSERT(std::holds_alternative<nth::integer>(value));
+    NTH_EXPECT(std::get<nth::integer>(value) == max + 1);
+  }
+  // Digits after the point of overflow are accumulated onto those before it,
+  // whether it occurs within a block of eight decimal digits or not.
+  IntegerLiteralValue value = ParseIntegerLiteral("1844674407370955161600");
+  NTH_ASSERT(std::holds_alternative<nth::integer>(value));
+  NTH_EXPECT(std::get<nth::integer>(value) == (max + 1) * 100);
+
+  value = ParseIntegerLiteral("123456789012345678901234");
+  NTH_ASSERT(std::holds_alternative<nth::integer>(value));
+  NTH_EXPECT(std::get<nth::integer>(value) ==
+             nth::integer(uint64_t{1234567890123456}) * 100'000'000 +
+                 78'901'234);
+}
+
+NTH_TEST("integer-literal/table") {
+  IntegerLiteralTable table;
+  uint32_t small = table.index("7");
+  uint32_t large = table.index("18446744073709551616");
+  NTH_EXPECT(small != large);
+  NTH_EXPECT(std::get<uint64_t>(table[small]) == 7);
+  NTH_EXPECT(std::holds_alternative<nth::integer>(table[large]));
+  NTH_EXPECT(table[large] == ParseIntegerLiteral("18446744073709551616"));
+}
+
+NTH_TEST("integer-literal/table/deduplicates") {
+  IntegerLiteralTable table;
+  uint32_t n = table.index("4294967296");
+  NTH_EXPECT(table.index("4294967296") == n);
+  NTH_EXPECT(table.index("4_294_967_296") == n);
+  NTH_EXPECT(table.index("0x1_0000_0000") == n);
+  NTH_EXPECT(table.index("0d04294967296") == n);
+
+  uint32_t large = table.index("0x1_0000_0000_0000_0000");
+  NTH_EXPECT(table.index("0x0010000000000000000") == large);
+  NTH_EXPECT(table.index("0x10000000000000000") == large);
+  NTH_EXPECT(large != n);
+}
+
+}  // namespace
+}  // namespace ic::lex
@@ -1,11 +1,13 @@
 #include "lexer/lex.h"
 
-#include "lexer/lex_impl.h"
+#include "lexer/scan.h"
 
 namespace ic::lex {
 
 std::string_view ConsumeIdentifier(std::string_view &source) {
-  return ConsumeWhile<IdentifierCharacter>(source);
+  std::string_view result = source.substr(0, IdentifierRunLength(source));
+  source.remove_prefix(result.size());
+  return result;
 }
 
 }  // namespace ic::lex
@@ -1,20 +1,81 @@
 #include "lexer/lexer.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <concepts>
+#include <span>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "lexer/lex.h"
 #include "lexer/lex_impl.h"
+#include "lexer/scan.h"
+#include "lexer/token_kind_table.h"
 #include "nth/debug/debug.h"
 
 namespace ic::lex {
 namespace {
 
+constexpr Token::Kind ClosingPairFor(Token::Kind k) {
+  return static_cast<Token::Kind>(
+      static_cast<std::underlying_type_t<Token::Kind>>(k) + 1);
+}
+
+constexpr bool IsOpenOrClose(Token::Kind k) {
+  switch (k) {
+#define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol)                                \
+  case Token::Kind::kind: return true;
+#define IC_XMACRO_TOKEN_KIND_CLOSE(kind, symbol)                               \
+  case Token::Kind::kind: return true;
+#include "lexer/token_kind.xmacro.h"
+    default: return false;
+  }
+}
+
+using ::ic::lex::internal_lexer::Chunk;
+using ::ic::lex::internal_lexer::DeferredPayloads;
+
+// Returns whether lexing may restart immediately after a newline, given the
+// source text preceding the newline and the character following it. Raw
+// newlines cannot appear in string literals and always end comments, so lexing
+// can restart after any newline except:
+//   * One appearing as a character literal (`!'<newline>'`).
+//   * One followed by another newline. If the first newline is part of a run
+//     of whitespace, the second does not produce a `Newline` token, but it
+//     would if lexing restarted between them.
+constexpr bool IsLineBoundary(std::string_view before, char after) {
+  return after != '\n' and not before.ends_with("!'");
+}
+
+// Returns whether lexing may restart immediately after the newline at
+// `source[index]`. A newline ending `source` is not considered a boundary,
+// because the character following it is not yet known.
+constexpr bool IsLineBoundary(std::string_view source, size_t index) {
+  return index + 1 < source.size() and
+         IsLineBoundary(source.substr(0, index), source[index + 1]);
+}
+
 struct Lexer {
-  explicit Lexer(TokenBuffer& token_buffer, char const* start)
-      : token_buffer_(token_buffer), start_(start) {}
+  // Constructs a lexer appending tokens to `token_buffer`. The character
+  // pointed to by `start` is at offset `start_offset` in the source. If
+  // `deferred` is not null, the lexer records payloads there rather than
+  // interning them, and does not pair open and close symbols.
+  explicit Lexer(TokenBuffer& token_buffer, char const* start,
+                 DeferredPayloads* deferred = nullptr,
+                 uint32_t start_offset      = 0)
+      : token_buffer_(token_buffer),
+        start_(start),
+        start_offset_(start_offset),
+        deferred_(deferred) {}
+
+  // Lexes all of `source`, not including the end-of-file token. Lexing stops
+  // at the first character which cannot begin a token, in which case `false`
+  // is returned and the remainder of `source` is ignored.
+  bool LexAll(std::string_view source);
 
   bool TryLexKeywordOrIdentifier(std::string_view& source);
   bool TryLexNumber(std::string_view& source);
@@ -23,11 +84,27 @@ struct Lexer {
   bool TryLexCharacterLiteral(std::string_view& source);
   bool TryLexComment(std::string_view& source);
 
-  uint32_t StartIndex(std::string_view s) const { return s.data() - start_; }
-  uint32_t StartIndex(char const* s) const { return s - start_; }
+  uint32_t StartIndex(std::string_view s) const {
+    return StartIndex(s.data());
+  }
+  uint32_t StartIndex(char const* s) const {
+    return s - start_ + start_offset_;
+  }
 
-  void PushOpen(Token::Kind k) { opens_.emplace_back(k, token_buffer_.size()); }
+  void AppendOpen(Token::Kind k, uint32_t offset) {
+    if (not deferred_) { opens_.emplace_back(k, token_buffer_.size()); }
+    token_buffer_.Append(Token::Symbol(k, offset));
+  }
 
+  void AppendClose(Token::Kind k, uint32_t offset) {
+    if (deferred_) {
+      token_buffer_.Append(Token::Symbol(k, offset));
+    } else {
+      token_buffer_.AppendClose(k, PairClose(k), offset);
+    }
+  }
+
+ private:
   uint32_t PairClose(Token::Kind k) {
     // TODO: Emit a diagnostic.
     NTH_REQUIRE((v.always), not opens_.empty());
@@ -37,14 +114,14 @@ struct Lexer {
     return n;
   }
 
- private:
-  static constexpr Token::Kind ClosingPairFor(Token::Kind k) {
-    return static_cast<Token::Kind>(
-        static_cast<std::underlying_type_t<Token::Kind>>(k) + 1);
-  }
+  void AppendKeywordOrIdentifier(std::string_view identifier);
+  void AppendIntegerLiteral(std::string_view integer, uint32_t offset);
+  void AppendStringLiteral(std::string s, uint32_t offset);
 
   TokenBuffer& token_buffer_;
   char const* start_;
+  uint32_t start_offset_;
+  DeferredPayloads* deferred_;
   std::vector<std::pair<Token::Kind, uint32_t>> opens_;
 };
 
@@ -52,30 +129,73 @@ constexpr bool LeadingIdentifierCharacter(char c) {
   return std::isalpha(c) or c == '_';
 }
 
+constexpr bool BinaryCharacter(char c) {
+  return c == '0' or c == '1' or c == '_';
+}
+
+constexpr bool OctalCharacter(char c) {
+  return ('0' <= c and c <= '7') or c == '_';
+}
+
 constexpr bool DecimalCharacter(char c) { return std::isdigit(c) or c == '_'; }
 
-constexpr bool WhitespaceCharacter(char c) { return std::isspace(c); }
+constexpr bool HexadecimalCharacter(char c) {
+  return std::isxdigit(c) or c == '_';
+}
 
-}  // namespace
+// Consumes the integer literal at the start of `source`, which must begin with
+// a digit, returning its digits (excluding any radix prefix). The returned
+// digits are empty if a radix prefix is not followed by a digit of that radix
+// (e.g., `0x` or `0b2`), in which case no token begins at the prefix and
+// `LexAll` stops there, as it does at any other character which cannot begin a
+// token.
+std::string_view ConsumeIntegerLiteral(std::string_view& source) {
+  char radix = 'd';
+  if (source.size() >= 2 and source[0] == '0') {
+    switch (source[1]) {
+      case 'b':
+      case 'o':
+      case 'd':
+      case 'x':
+        radix = source[1];
+        source.remove_prefix(2);
+        break;
+      default: break;
+    }
+  }
 
-TokenBuffer Lex(std::string_view source,
-                diag::DiagnosticConsumer& diagnostic_consumer) {
-  TokenBuffer buffer;
-  Lexer lexer(buffer, source.data());
+  switch (radix) {
+    case 'b': return lex::ConsumeWhile<BinaryCharacter>(source);
+    case 'o': return lex::ConsumeWhile<OctalCharacter>(source);
+    case 'x': return lex::ConsumeWhile<HexadecimalCharacter>(source);
+    default: return lex::ConsumeWhile<DecimalCharacter>(source);
+  }
+}
+
+bool Lexer::LexAll(std::string_view source) {
   while (true) {
     if (not source.empty() and source.front() == '\n') {
-      buffer.Append(
-          Token::Symbol(Token::Kind::Newline, lexer.StartIndex(source)));
+      token_buffer_.Append(
+          Token::Symbol(Token::Kind::Newline, StartIndex(source)));
+      token_buffer_.AddLineStart(StartIndex(source) + 1);
       source.remove_prefix(1);
       continue;
     }
 
-    lex::ConsumeWhile<WhitespaceCharacter>(source);
-    if (source.empty()) { break; }
+    // Newlines following other whitespace are skipped without emitting a
+    // `Newline` token, but must still be recorded in the line table.
+    std::string_view whitespace =
+        source.substr(0, WhitespaceRunLength(source));
+    for (size_t i = whitespace.find('\n'); i != std::string_view::npos;
+         i        = whitespace.find('\n', i + 1)) {
+      token_buffer_.AddLineStart(StartIndex(whitespace) + i + 1);
+    }
+    source.remove_prefix(whitespace.size());
+    if (source.empty()) { return true; }
 
     // We need to special-case `[*]` because otherwise we'll lex `[`.
     if (source.starts_with("[*]")) {
-      [[maybe_unused]] bool b = lexer.TryLexOperator(source);
+      [[maybe_unused]] bool b = TryLexOperator(source);
       NTH_REQUIRE((v.debug), b);
       continue;
     }
@@ -83,38 +203,458 @@ TokenBuffer Lex(std::string_view source,
     switch (source.front()) {
 #define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol)                                \
   case symbol:                                                                 \
-    lexer.PushOpen(Token::Kind::kind);                                         \
-    buffer.Append(Token::Symbol(Token::Kind::kind, lexer.StartIndex(source))); \
+    AppendOpen(Token::Kind::kind, StartIndex(source));                         \
     source.remove_prefix(1);                                                   \
     continue;
 #define IC_XMACRO_TOKEN_KIND_CLOSE(kind, symbol)                               \
   case symbol:                                                                 \
-    buffer.AppendClose(Token::Kind::kind, lexer.PairClose(Token::Kind::kind),  \
-                       lexer.StartIndex(source));                              \
+    AppendClose(Token::Kind::kind, StartIndex(source));                        \
     source.remove_prefix(1);                                                   \
     continue;
 #define IC_XMACRO_TOKEN_KIND_ONE_CHARACTER_TOKEN(kind, symbol)                 \
   case symbol:                                                                 \
-    buffer.Append(Token::Symbol(Token::Kind::kind, lexer.StartIndex(source))); \
+    token_buffer_.Append(                                                      \
+        Token::Symbol(Token::Kind::kind, StartIndex(source)));                 \
     source.remove_prefix(1);                                                   \
     continue;
 #include "lexer/token_kind.xmacro.h"
       default: break;
     }
 
-    if (lexer.TryLexKeywordOrIdentifier(source)) { continue; }
-    if (lexer.TryLexNumber(source)) { continue; }
-    if (lexer.TryLexComment(source)) { continue; }
-    if (lexer.TryLexOperator(source)) { continue; }
-    if (lexer.TryLexStringLiteral(source)) { continue; }
-    if (lexer.TryLexCharacterLiteral(source)) { continue; }
+    if (TryLexKeywordOrIdentifier(source)) { continue; }
+    if (TryLexNumber(source)) { continue; }
+    if (TryLexComment(source)) { continue; }
+    if (TryLexOperator(source)) { continue; }
+    if (TryLexStringLiteral(source)) { continue; }
+    if (TryLexCharacterLiteral(source)) { continue; }
+
+    return false;
+  }
+}
+
+void Lexer::AppendKeywordOrIdentifier(std::string_view identifier) {
+  if (not deferred_) {
+    token_buffer_.AppendKeywordOrIdentifier(identifier, StartIndex(identifier));
+  } else if (auto kind = LookupKeyword(identifier)) {
+    token_buffer_.Append(Token::Symbol(*kind, StartIndex(identifier)));
+  } else {
+    deferred_->identifiers.push_back(identifier);
+    token_buffer_.Append(
+        Token::Symbol(Token::Kind::Identifier, StartIndex(identifier)));
+  }
+}
+
+void Lexer::AppendIntegerLiteral(std::string_view integer, uint32_t offset) {
+  if (deferred_) {
+    deferred_->integer_literals.push_back(integer);
+    token_buffer_.Append(Token::Symbol(Token::Kind::IntegerLiteral, offset));
+  } else {
+    token_buffer_.AppendIntegerLiteral(integer, offset);
+  }
+}
+
+void Lexer::AppendStringLiteral(std::string s, uint32_t offset) {
+  if (deferred_) {
+    deferred_->string_literals.push_back(std::move(s));
+    token_buffer_.Append(Token::Symbol(Token::Kind::StringLiteral, offset));
+  } else {
+    token_buffer_.AppendStringLiteral(std::move(s), offset);
+  }
+}
+
+// Returns the offset immediately after the first newline in `source` at or
+// after `position` at which lexing may restart, or `source.size()` if there is
+// no such newline.
+size_t NextLineBoundary(std::string_view source, size_t position) {
+  while (true) {
+    position += FindNewline(source.substr(position));
+    if (position == source.size()) { return position; }
+    if (IsLineBoundary(source, position++)) { return position; }
+  }
+}
+
+// Returns the offsets at which `source` should be split so as to produce at
+// most `chunk_count` chunks of roughly equal size. Chunks are split immediately
+// after a newline at which lexing may restart.
+std::vector<size_t> ChunkBoundaries(std::string_view source,
+                                    size_t chunk_count) {
+  std::vector<size_t> boundaries;
+  boundaries.push_back(0);
+  for (size_t i = 1; i < chunk_count; ++i) {
+    size_t position = NextLineBoundary(
+        source, std::max(boundaries.back(), source.size() * i / chunk_count));
+    if (position == source.size()) { break; }
+    boundaries.push_back(position);
+  }
+  boundaries.push_back(source.size());
+  return boundaries;
+}
+
+// A sink for `Stitch` which hands tokens off to a `StreamingLexer`'s caller
+// rather than retaining them. Open symbols have already been handed off by the
+// time their matching close symbol is seen, so their payloads are never set.
+// Alongside each token, its full-width payload is recorded, since there is no
+// `TokenBuffer` from which a `Token::WidePayload` could later be recovered.
+struct TokenStream {
+  size_t size() const { return count; }
+
+  void Append(Token token) { Append(token, token.payload()); }
+
+  void Append(Token token, uint32_t payload) {
+    tokens.push_back(token);
+    payloads.push_back(payload);
+    ++count;
+  }
+
+  void AppendClose(Token::Kind kind, uint32_t open_index, uint32_t offset) {
+    Append(Token::CloseSymbol(kind, open_index, offset), open_index);
+  }
+
+  void AppendIntegerLiteral(std::string_view integer, uint32_t offset) {
+    uint32_t payload = TokenBuffer::IntegerLiteralPayload(integer);
+    Append(Token::IntegerLiteral(offset, payload), payload);
+  }
+
+  void AppendStringLiteral(std::string s, uint32_t offset) {
+    uint32_t payload = TokenBuffer::StringLiteralPayload(s);
+    Append(Token::StringLiteral(offset, payload), payload);
+  }
+
+  void AppendIdentifier(Identifier identifier, uint32_t offset) {
+    Append(Token::Identifier(offset, identifier),
+           Identifier::ToRepresentation(identifier));
+  }
+
+  std::vector<Token>& tokens;
+  std::vector<uint32_t>& payloads;
+  uint32_t& count;
+};
+
+// Appends the tokens of `chunk` to `buffer`, constructing the tokens whose
+// payloads were deferred and pairing open and close symbols. Because chunks are
+// stitched in order and every token is appended through the same `TokenBuffer`
+// interface the serial lexer uses, the result is identical to that of lexing
+// the chunks serially. Open symbols which have not yet been closed are tracked
+// in `*opens` across calls. If `opens` is null, open and close symbols are left
+// unpaired.
+template <typename Sink>
+void Stitch(Chunk& chunk, Sink& buffer,
+            std::vector<std::pair<Token::Kind, uint32_t>>* opens) {
+  auto identifier     = chunk.deferred.identifiers.begin();
+  auto integer        = chunk.deferred.integer_literals.begin();
+  auto string_literal = chunk.deferred.string_literals.begin();
+  for (Token token : chunk.tokens) {
+    switch (token.kind()) {
+      case Token::Kind::Identifier:
+        buffer.AppendIdentifier(Identifier(*identifier++), token.offset());
+        break;
+      case Token::Kind::IntegerLiteral:
+        buffer.AppendIntegerLiteral(*integer++, token.offset());
+        break;
+      case Token::Kind::StringLiteral:
+        buffer.AppendStringLiteral(std::move(*string_literal++),
+                                   token.offset());
+        break;
+#define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol)                                \
+  case Token::Kind::kind:                                                      \
+    if (opens) { opens->emplace_back(Token::Kind::kind, buffer.size()); }      \
+    buffer.Append(token);                                                      \
+    break;
+#define IC_XMACRO_TOKEN_KIND_CLOSE(kind, symbol)                               \
+  case Token::Kind::kind:                                                      \
+    if (not opens) {                                                           \
+      buffer.Append(token);                                                    \
+      break;                                                                   \
+    }                                                                          \
+    /* TODO: Emit a diagnostic. */                                             \
+    NTH_REQUIRE((v.always), not opens->empty());                               \
+    NTH_REQUIRE((v.always),                                                    \
+                Token::Kind::kind == ClosingPairFor(opens->back().first));     \
+    buffer.AppendClose(Token::Kind::kind, opens->back().second,                \
+                       token.offset());                                        \
+    opens->pop_back();                                                         \
+    break;
+#include "lexer/token_kind.xmacro.h"
+      default: buffer.Append(token); break;
+    }
+  }
+}
 
+// Pairs every open symbol in `buffer` with its matching close symbol, setting
+// the payload of each to the index of the other. As with `Lex`, the payload of
+// an open symbol which is never closed is zero.
+void PairSymbols(TokenBuffer& buffer) {
+  std::vector<uint32_t> opens;
+  std::span kinds = buffer.kinds();
+  for (uint32_t i = 0; i < kinds.size(); ++i) {
+    switch (kinds[i]) {
+#define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol)                                \
+  case Token::Kind::kind: opens.push_back(i); break;
+#define IC_XMACRO_TOKEN_KIND_CLOSE(kind, symbol)                               \
+  case Token::Kind::kind:                                                      \
+    /* TODO: Emit a diagnostic. */                                             \
+    NTH_REQUIRE((v.always), not opens.empty());                                \
+    NTH_REQUIRE((v.always),                                                    \
+                Token::Kind::kind == ClosingPairFor(kinds[opens.back()]));     \
+    buffer.set_payload(opens.back(), i);                                       \
+    buffer.set_payload(i, opens.back());                                       \
+    opens.pop_back();                                                          \
     break;
+#include "lexer/token_kind.xmacro.h"
+      default: break;
+    }
+  }
+  for (uint32_t open : opens) { buffer.set_payload(open, 0); }
+}
+
+// Returns an estimate of the number of tokens in a source of `source_size`
+// bytes, used to reserve space in the token buffer up front. Typical code,
+// counting whitespace and comments, averages four to eight bytes per token.
+// The buffer grows as usual for denser sources.
+size_t EstimatedTokenCount(size_t source_size) { return source_size / 4 + 1; }
+
+}  // namespace
+
+TokenBuffer Lex(std::string_view source,
+                diag::DiagnosticConsumer& diagnostic_consumer,
+                LexOptions const& options) {
+  size_t chunk_count =
+      std::min<size_t>(std::max<uint32_t>(options.threads, 1),
+                       source.size() / options.minimum_chunk_size + 1);
+
+  TokenBuffer buffer(options.memory_resource);
+  buffer.reserve(EstimatedTokenCount(source.size()));
+  if (chunk_count == 1) {
+    Lexer lexer(buffer, source.data());
+    lexer.LexAll(source);
+    buffer.Append(Token::Eof());
+    return buffer;
+  }
+
+  std::vector<size_t> boundaries = ChunkBoundaries(source, chunk_count);
+  std::vector<Chunk> chunks(boundaries.size() - 1);
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      threads.emplace_back([&, i] {
+        Lexer lexer(chunks[i].tokens, source.data(), &chunks[i].deferred);
+        chunks[i].complete = lexer.LexAll(
+            source.substr(boundaries[i], boundaries[i + 1] - boundaries[i]));
+      });
+    }
+  }
+
+  std::vector<std::pair<Token::Kind, uint32_t>> opens;
+  for (Chunk& chunk : chunks) {
+    Stitch(chunk, buffer, &opens);
+    buffer.AppendLineTable(chunk.tokens.line_table());
+    // A serial lexer would not have lexed any subsequent chunks.
+    if (not chunk.complete) { break; }
   }
   buffer.Append(Token::Eof());
   return buffer;
 }
 
+std::string_view IntegerLiteralSpelling(std::string_view source,
+                                        uint32_t offset) {
+  std::string_view literal = source.substr(offset);
+  ConsumeIntegerLiteral(literal);
+  return source.substr(offset, literal.data() - source.data() - offset);
+}
+
+TokenEdit Relex(TokenBuffer& token_buffer, std::string_view source,
+                SourceEdit const& edit,
+                diag::DiagnosticConsumer& diagnostic_consumer) {
+  NTH_REQUIRE((v.harden), edit.offset <= source.size());
+  NTH_REQUIRE((v.harden), edit.length <= source.size() - edit.offset);
+  size_t edit_end = edit.offset + edit.length;
+
+  // Lexing restarts at the last line boundary strictly before the edit, so that
+  // the character following the boundary is unaffected by the edit.
+  size_t start = 0;
+  for (size_t position = edit.offset; position >= 2;) {
+    size_t newline = source.rfind('\n', position - 2);
+    if (newline == std::string_view::npos) { break; }
+    if (IsLineBoundary(source, newline)) {
+      start = newline + 1;
+      break;
+    }
+    position = newline + 1;
+  }
+
+  // The text to be lexed again runs from `start` through the first line
+  // boundary following the edit, which must be a boundary both before and
+  // after the edit is applied. If there is no such boundary, it runs through
+  // the end of the source.
+  std::string text(source.substr(start, edit.offset - start));
+  text.append(edit.replacement);
+  size_t end = edit_end;
+  while (end < source.size()) {
+    size_t newline = end + FindNewline(source.substr(end));
+    if (newline == source.size()) {
+      text.append(source.substr(end));
+      end = source.size();
+      break;
+    }
+    text.append(source.substr(end, newline - end));
+    bool boundary = IsLineBoundary(source, newline) and
+                    IsLineBoundary(text, source[newline + 1]);
+    text.push_back('\n');
+    end = newline + 1;
+    if (boundary) { break; }
+  }
+
+  Chunk chunk;
+  Lexer lexer(chunk.tokens, text.data(), &chunk.deferred, start);
+  if (not lexer.LexAll(text)) {
+    // `Lex` would not have lexed anything following the region, so everything
+    // up to the end-of-file token is replaced.
+    end = source.size();
+  }
+  TokenBuffer replacement;
+  Stitch(chunk, replacement, nullptr);
+  replacement.AppendLineTable(chunk.tokens.line_table());
+
+  // Offsets are increasing, with the end-of-file token's offset greatest.
+  size_t first = token_buffer.lower_bound(start);
+  size_t last  = end == source.size() ? token_buffer.size() - 1
+                                      : token_buffer.lower_bound(end, first);
+
+  // Most edits do not change the number of tokens or where open and close
+  // symbols appear, in which case every symbol keeps its partner.
+  bool same_shape = replacement.size() == last - first;
+  for (size_t i = 0; same_shape and i < replacement.size(); ++i) {
+    Token::Kind kind = token_buffer.kind(first + i);
+    if (IsOpenOrClose(kind) or IsOpenOrClose(replacement.kind(i))) {
+      if (kind != replacement.kind(i)) {
+        same_shape = false;
+      } else {
+        replacement.set_payload(i, token_buffer.payload(first + i));
+      }
+    }
+  }
+
+  TokenEdit token_edit = token_buffer.Splice(
+      first, last, start, end, replacement,
+      static_cast<int64_t>(edit.replacement.size()) -
+          static_cast<int64_t>(edit.length));
+  if (not same_shape) { PairSymbols(token_buffer); }
+  return token_edit;
+}
+
+void StreamingLexer::Feed(std::string_view bytes) {
+  // Everything in `pending_` before this call is part of a line which has not
+  // yet ended, so only the newly appended bytes need to be searched, along
+  // with the last byte previously appended: A newline there could not be
+  // recognized as a boundary until the byte following it was known.
+  size_t searched = pending_.empty() ? 0 : pending_.size() - 1;
+  pending_.append(bytes);
+  size_t position = pending_.size();
+  while (position > searched) {
+    size_t newline = pending_.rfind('\n', position - 1);
+    if (newline == std::string::npos or newline < searched) { return; }
+    if (IsLineBoundary(pending_, newline)) {
+      LexPending(newline + 1);
+      return;
+    }
+    position = newline;
+  }
+}
+
+void StreamingLexer::Finish() {
+  LexPending(pending_.size());
+  TokenStream{.tokens = tokens_, .payloads = payloads_, .count = token_count_}
+      .Append(Token::Eof());
+}
+
+void StreamingLexer::LexPending(size_t length) {
+  chunk_.tokens.clear();
+  chunk_.deferred.clear();
+  if (not chunk_.complete) {
+    // Lexing stopped in an earlier line, so nothing further is lexed.
+    pending_.erase(0, length);
+    pending_offset_ += length;
+    return;
+  }
+  Lexer lexer(chunk_.tokens, pending_.data(), &chunk_.deferred,
+              pending_offset_);
+  chunk_.complete =
+      lexer.LexAll(std::string_view(pending_).substr(0, length));
+
+  TokenStream stream{
+      .tokens = tokens_, .payloads = payloads_, .count = token_count_};
+  Stitch(chunk_, stream, &opens_);
+  pending_.erase(0, length);
+  pending_offset_ += length;
+}
+
+PipelinedLexer::PipelinedLexer(std::string_view source,
+                               TokenBuffer& token_buffer, size_t chunk_size)
+    : source_(source), token_buffer_(token_buffer) {
+  token_buffer_.reserve(EstimatedTokenCount(source.size()));
+  thread_ = std::jthread([this, chunk_size] { LexChunks(chunk_size); });
+}
+
+PipelinedLexer::~PipelinedLexer() { Stop(); }
+
+void PipelinedLexer::Stop() {
+  stopped_.store(true, std::memory_order_relaxed);
+  // Wakes the lexing thread if it is waiting for a slot to be consumed.
+  consumed_.fetch_add(1, std::memory_order_release);
+  consumed_.notify_one();
+}
+
+void PipelinedLexer::LexChunks(size_t chunk_size) {
+  size_t position = 0;
+  for (size_t i = 0;; ++i) {
+    for (size_t consumed = consumed_.load(std::memory_order_acquire);
+         i - consumed >= Capacity;
+         consumed = consumed_.load(std::memory_order_acquire)) {
+      if (stopped_.load(std::memory_order_relaxed)) { return; }
+      consumed_.wait(consumed, std::memory_order_acquire);
+    }
+    if (stopped_.load(std::memory_order_relaxed)) { return; }
+
+    Slot& slot = slots_[i % Capacity];
+    slot.chunk.tokens.clear();
+    slot.chunk.deferred.clear();
+    size_t end =
+        NextLineBoundary(source_, std::min(position + chunk_size,
+                                           source_.size()));
+    Lexer lexer(slot.chunk.tokens, source_.data(), &slot.chunk.deferred);
+    slot.chunk.complete =
+        lexer.LexAll(source_.substr(position, end - position));
+    slot.last = end == source_.size() or not slot.chunk.complete;
+    position  = end;
+
+    produced_.store(i + 1, std::memory_order_release);
+    produced_.notify_one();
+    if (slot.last) { return; }
+  }
+}
+
+bool PipelinedLexer::Advance() {
+  if (finished_) { return false; }
+  size_t i = consumed_.load(std::memory_order_relaxed);
+  for (size_t produced = produced_.load(std::memory_order_acquire);
+       produced == i; produced = produced_.load(std::memory_order_acquire)) {
+    produced_.wait(produced, std::memory_order_acquire);
+  }
+
+  Slot& slot = slots_[i % Capacity];
+  Stitch(slot.chunk, token_buffer_, &opens_);
+  token_buffer_.AppendLineTable(slot.chunk.tokens.line_table());
+  if (slot.last) {
+    token_buffer_.Append(Token::Eof());
+    finished_ = true;
+  }
+
+  consumed_.store(i + 1, std::memory_order_release);
+  consumed_.notify_one();
+  return not finished_;
+}
+
 bool Lexer::TryLexCharacterLiteral(std::string_view& source) {
   // TODO: Actually most of these situations where you're returning false are
   // diagnosable errors because you know nothing else will match.
@@ -144,6 +684,9 @@ bool Lexer::TryLexCharacterLiteral(std::string_view& source) {
     case '\'': NTH_UNIMPLEMENTED(); break;
     default:
       if (source[3] == '\'') {
+        if (source[2] == '\n') {
+          token_buffer_.AddLineStart(StartIndex(source) + 3);
+        }
         token_buffer_.Append(
             Token::CharacterLiteral(source[2], StartIndex(source)));
         source.remove_prefix(4);
@@ -156,8 +699,7 @@ bool Lexer::TryLexCharacterLiteral(std::string_view& source) {
 
 bool Lexer::TryLexComment(std::string_view& source) {
   if (source.size() < 2 or source.substr(0, 2) != "//") { return false; }
-  size_t index = source.find("\n");
-  source.remove_prefix(std::min(index, source.size()));
+  source.remove_prefix(FindNewline(source));
   return true;
 }
 
@@ -165,64 +707,30 @@ bool Lexer::TryLexKeywordOrIdentifier(std::string_view& source) {
   NTH_REQUIRE((v.harden), not source.empty());
   if (not LeadingIdentifierCharacter(source.front())) { return false; }
   std::string_view identifier = lex::ConsumeIdentifier(source);
-  token_buffer_.AppendKeywordOrIdentifier(identifier, StartIndex(identifier));
+  AppendKeywordOrIdentifier(identifier);
   return true;
 }
 
 bool Lexer::TryLexNumber(std::string_view& source) {
   NTH_REQUIRE((v.harden), not source.empty());
+  if (not std::isdigit(source.front())) { return false; }
+  std::string_view literal = source;
+  if (ConsumeIntegerLiteral(literal).empty()) { return false; }
   char const* start = source.data();
-  if (source.front() == '0') {
-    if (source.size() == 1) {
-      token_buffer_.AppendIntegerLiteral(source.substr(0, 1),
-                                         StartIndex(source.substr(0, 1)));
-      source.remove_prefix(1);
-      return true;
-    } else {
-      if (IdentifierCharacter(source[1])) {
-        switch (source[1]) {
-          case 'b': NTH_UNIMPLEMENTED();
-          case 'd': {
-            source.remove_prefix(2);
-            goto consume_decimal;
-          }
-          case 'x': NTH_UNIMPLEMENTED();
-          default: NTH_UNIMPLEMENTED("{}") <<= {source[1]};
-        }
-      } else {
-        goto consume_decimal;
-      }
-      switch (source[1]) {
-        case 'b': NTH_UNIMPLEMENTED();
-        case 'd': {
-          source.remove_prefix(2);
-          goto consume_decimal;
-        }
-      }
-      NTH_UNREACHABLE();
-    }
-  } else {
-  consume_decimal:
-    std::string_view number = lex::ConsumeWhile<DecimalCharacter>(source);
-    if (number.empty()) { return false; }
-    token_buffer_.AppendIntegerLiteral(number, StartIndex(start));
-    return true;
-  }
-  NTH_UNREACHABLE();
+  source            = literal;
+
+  AppendIntegerLiteral(std::string_view(start, source.data() - start),
+                       StartIndex(start));
+  return true;
 }
 
 bool Lexer::TryLexOperator(std::string_view& source) {
   NTH_REQUIRE((v.harden), not source.empty());
-#define IC_XMACRO_TOKEN_KIND_OPERATOR(kind, symbol)                            \
-  if (source.starts_with(symbol)) {                                            \
-    token_buffer_.Append(                                                      \
-        Token::Symbol(Token::Kind::kind, StartIndex(source)));                 \
-    source.remove_prefix(std::string_view(symbol).size());                     \
-    return true;                                                               \
-  }
-#include "lexer/token_kind.xmacro.h"
-
-  return false;
+  auto [kind, length] = MatchOperator(source);
+  if (length == 0) { return false; }
+  token_buffer_.Append(Token::Symbol(kind, StartIndex(source)));
+  source.remove_prefix(length);
+  return true;
 }
 
 bool Lexer::TryLexStringLiteral(std::string_view& source) {
@@ -267,17 +775,21 @@ bool Lexer::TryLexStringLiteral(std::string_view& source) {
           escaped = true;
           break;
         case '"':
-          token_buffer_.AppendStringLiteral(std::move(content),
+          AppendStringLiteral(std::move(content),
                                             StartIndex(source.substr(0, 1)));
           source.remove_prefix(++p - source.data());
           return true;
         case '\n':
           NTH_UNIMPLEMENTED(
               "Raw newline in string literal should emit an error.");
-        default:
+        default: {
           // TODO: Check if this is a valid character or a literal '\r', '\t' or
           // something similar.
-          content.push_back(*p++); break;
+          std::string_view remaining(p, source.data() + source.size() - p);
+          size_t run = FindStringLiteralSpecialCharacter(remaining);
+          content.append(p, run);
+          p += run;
+        } break;
       }
     }
   }
@@ -1,16 +1,242 @@
 #ifndef ICARUS_LEXER_LEXER_H
 #define ICARUS_LEXER_LEXER_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "common/to_bytes.h"
 #include "diagnostics/consumer/consumer.h"
 #include "lexer/token_buffer.h"
 
 namespace ic::lex {
 
+struct LexOptions {
+  // The maximum number of threads used to lex the source. When more than one
+  // thread is used, the source is split into chunks at line boundaries which
+  // are lexed concurrently and then stitched together. The resulting token
+  // buffer is identical to the one produced by lexing on a single thread.
+  uint32_t threads = 1;
+
+  // Sources are not split into chunks smaller than this many bytes.
+  size_t minimum_chunk_size = size_t{1} << 20;
+
+  // The memory resource from which the resulting token buffer is allocated.
+  // Buffers used by individual threads are always allocated from the default
+  // resource.
+  std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource();
+};
+
 TokenBuffer Lex(std::string_view source,
+                diag::DiagnosticConsumer& diagnostic_consumer,
+                LexOptions const& options = {});
+
+// Returns the spelling of the integer literal whose token begins at `offset` in
+// `source`, exactly as `Lex` consumed it.
+std::string_view IntegerLiteralSpelling(std::string_view source,
+                                        uint32_t offset);
+
+// Describes an edit to a source, replacing the `length` bytes starting at
+// `offset` with `replacement`.
+struct SourceEdit {
+  uint32_t offset;
+  uint32_t length;
+  std::string_view replacement;
+};
+
+// Updates `token_buffer`, which must hold the result of lexing `source`, to
+// hold the result of lexing `source` with `edit` applied. Only the lines
+// touched by `edit` are lexed again. Tokens on other lines are reused: those
+// after the edit have their offsets shifted, and if the edit adds, removes, or
+// changes open or close symbols, symbols are re-paired across the whole buffer.
+// Lexing `source` must not have stopped early (see `Lexer::LexAll`), though
+// lexing the edited source may. Returns the range of tokens which were
+// replaced, from which a parse of the buffer may be updated (see `Reparse`).
+//
+// An edit which changes neither the number of tokens nor the number of lines
+// (e.g., renaming an identifier) takes time proportional to the lines touched,
+// and only logarithmic in the length of the source. Other edits additionally
+// move every later token within the buffer.
+TokenEdit Relex(TokenBuffer& token_buffer, std::string_view source,
+                SourceEdit const& edit,
                 diag::DiagnosticConsumer& diagnostic_consumer);
 
+namespace internal_lexer {
+
+// Tokens whose payloads refer to global interning tables cannot be finalized
+// while lexing a chunk concurrently with other chunks. Instead, the chunk
+// records a placeholder token and stashes what is needed to construct the real
+// token here, in the order the tokens appear. Open and close symbols are
+// likewise left unpaired, to be paired when the chunks are stitched together.
+struct DeferredPayloads {
+  void clear() {
+    identifiers.clear();
+    integer_literals.clear();
+    string_literals.clear();
+  }
+
+  std::vector<std::string_view> identifiers;
+  std::vector<std::string_view> integer_literals;
+  std::vector<std::string> string_literals;
+};
+
+struct Chunk {
+  TokenBuffer tokens;
+  DeferredPayloads deferred;
+  // Whether lexing reached the end of the chunk (see `Lexer::LexAll`).
+  bool complete = true;
+};
+
+}  // namespace internal_lexer
+
+// Lexes a source on a separate thread, so that the tokens lexed so far may be
+// consumed (e.g., by `ParsePipelined`) while the remainder of the source is
+// still being lexed. The source is split into chunks of roughly `chunk_size`
+// bytes at line boundaries. The lexing thread lexes each chunk into the next
+// slot of a bounded ring buffer shared with the consuming thread, waiting
+// whenever every slot holds a chunk which has not yet been consumed, so that it
+// never runs more than `Capacity` chunks ahead.
+//
+// Chunks are lexed as they are by `Lex` on multiple threads: Payloads which
+// refer to global interning tables are deferred, and are only interned on the
+// consuming thread when the chunk is appended to the token buffer. The
+// resulting token buffer is identical to the one produced by `Lex`.
+struct PipelinedLexer {
+  static constexpr size_t Capacity = 16;
+
+  // Starts lexing `source` on a new thread, appending tokens to
+  // `token_buffer` as they are consumed. Both must outlive this object.
+  explicit PipelinedLexer(std::string_view source, TokenBuffer& token_buffer,
+                          size_t chunk_size = size_t{1} << 16);
+
+  PipelinedLexer(PipelinedLexer const&)            = delete;
+  PipelinedLexer& operator=(PipelinedLexer const&) = delete;
+
+  // Stops lexing, if it has not yet completed, and waits for the lexing thread
+  // to exit.
+  ~PipelinedLexer();
+
+  // Appends the tokens of the next chunk to the token buffer, waiting for it to
+  // be lexed if necessary. After the tokens of the last chunk have been
+  // appended (or those of a chunk at which lexing stopped early, see
+  // `Lexer::LexAll`), the end-of-file token is appended and `false` is
+  // returned. Subsequent calls do nothing and return `false`.
+  bool Advance();
+
+  TokenBuffer const& token_buffer() const { return token_buffer_; }
+
+ private:
+  struct Slot {
+    internal_lexer::Chunk chunk;
+    // Whether this chunk ends at the end of the source.
+    bool last;
+  };
+
+  // Lexes each chunk of the source in turn, run on the lexing thread.
+  void LexChunks(size_t chunk_size);
+
+  // Tells the lexing thread to stop once it has lexed the current chunk.
+  void Stop();
+
+  std::string_view source_;
+  TokenBuffer& token_buffer_;
+  std::vector<std::pair<Token::Kind, uint32_t>> opens_;
+  bool finished_ = false;
+
+  std::array<Slot, Capacity> slots_;
+  // The number of chunks lexed and consumed respectively. Slot `i % Capacity`
+  // is written only by the lexing thread while `i == produced_` and is read
+  // only by the consuming thread while `i == consumed_`.
+  std::atomic<size_t> produced_ = 0;
+  std::atomic<size_t> consumed_ = 0;
+  std::atomic<bool> stopped_    = false;
+  std::jthread thread_;
+};
+
+// Lexes a source which is provided incrementally, using memory proportional to
+// the longest line rather than to the length of the source. Bytes passed to
+// `Feed` are retained only until the line containing them ends, at which point
+// the line is lexed and its tokens are made available via `tokens()`. Callers
+// are expected to consume these tokens and call `clear_tokens` between calls to
+// `Feed`.
+//
+// Tokens are identical to those produced by `Lex` on the concatenation of all
+// bytes fed, with one exception: Because an open symbol (e.g., `(`) is handed
+// off before its matching close symbol is seen, its payload is not set to the
+// index of the close symbol. Close symbols do carry the index of their
+// matching open symbol, and identifiers, string literals and integer literals
+// their usual payload, unless it does not fit in a `Token` (see
+// `Token::WidePayload`). There is no `TokenBuffer` from which to recover such
+// payloads, so the full-width payload of each token is available from
+// `payloads()`, at the same index as the token in `tokens()`.
+struct StreamingLexer {
+  // Appends `bytes` to the source, lexing any lines which are now complete.
+  void Feed(std::string_view bytes);
+
+  // Lexes any remaining bytes and appends the end-of-file token.
+  void Finish();
+
+  std::span<Token const> tokens() const { return tokens_; }
+  std::span<uint32_t const> payloads() const { return payloads_; }
+  void clear_tokens() {
+    tokens_.clear();
+    payloads_.clear();
+  }
+
+ private:
+  // Lexes the first `length` bytes of `pending_`, which must end at a line
+  // boundary or at the end of the source, and removes them from `pending_`.
+  void LexPending(size_t length);
+
+  // Bytes which have been fed but not yet lexed, starting at the beginning of
+  // a line, and the offset of that line in the source.
+  std::string pending_;
+  uint32_t pending_offset_ = 0;
+
+  internal_lexer::Chunk chunk_;
+  std::vector<std::pair<Token::Kind, uint32_t>> opens_;
+  uint32_t token_count_ = 0;
+  std::vector<Token> tokens_;
+  std::vector<uint32_t> payloads_;
+};
+
+// Lexes the contents of `reader` in windows of `window_size` bytes, invoking
+// `f` on each token in order, along with its full-width payload. Returns
+// `false` if the reader fails, and `true` otherwise. See `StreamingLexer` for
+// details on how tokens may differ from those produced by `Lex`.
+template <typename R>
+bool LexStream(R& reader, std::invocable<Token, uint32_t> auto&& f,
+               size_t window_size = size_t{1} << 16) {
+  StreamingLexer lexer;
+  std::string window;
+  size_t remaining = reader.size();
+  while (remaining != 0) {
+    window.resize(std::min(window_size, remaining));
+    if (not reader.read(ToBytes(window))) { return false; }
+    remaining -= window.size();
+    lexer.Feed(window);
+    for (size_t i = 0; i < lexer.tokens().size(); ++i) {
+      f(lexer.tokens()[i], lexer.payloads()[i]);
+    }
+    lexer.clear_tokens();
+  }
+  lexer.Finish();
+  for (size_t i = 0; i < lexer.tokens().size(); ++i) {
+    f(lexer.tokens()[i], lexer.payloads()[i]);
+  }
+  return true;
+}
+
 }  // namespace ic::lex
 
 #endif  // ICARUS_LEXER_LEXER_H
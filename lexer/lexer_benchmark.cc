@@ -0,0 +1,102 @@
+// Measures lexer throughput in bytes per second. By default a synthetic source
+// file resembling machine-generated Icarus code is lexed, but a path to a
+// source file may be passed as the sole argument instead. Throughput is
+// reported for each scanning implementation supported by this processor, so
+// the scalar row serves as the baseline for the vectorized rows.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "lexer/scan.h"
+
+namespace ic::lex {
+namespace {
+
+std::string SyntheticSource(size_t minimum_size) {
+  std::string source;
+  for (size_t i = 0; source.size() < minimum_size; ++i) {
+    source.append("// Generated declaration number ")
+        .append(std::to_string(i))
+        .append(" with a moderately long trailing comment.\n")
+        .append("let generated_identifier_")
+        .append(std::to_string(i))
+        .append(" ::= some_function_name(argument_number_one, ")
+        .append(std::to_string(i * 7919))
+        .append(")\n")
+        .append("    var message_")
+        .append(std::to_string(i))
+        .append(": []char = \"A string literal with an \\\"escape\\\" and "
+                "some padding to make it long enough.\\n\"\n\n");
+  }
+  return source;
+}
+
+bool ReadFile(char const* path, std::string& content) {
+  std::FILE* file = std::fopen(path, "rb");
+  if (not file) { return false; }
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    content.append(buffer, n);
+  }
+  std::fclose(file);
+  return true;
+}
+
+char const* Name(ScanImplementation implementation) {
+  switch (implementation) {
+    case ScanImplementation::Scalar: return "scalar";
+    case ScanImplementation::Sse2: return "sse2";
+    case ScanImplementation::Avx2: return "avx2";
+  }
+  return "unknown";
+}
+
+void Measure(std::string_view source, ScanImplementation implementation) {
+  if (not SetScanImplementation(implementation)) {
+    std::printf("%-8s unsupported\n", Name(implementation));
+    return;
+  }
+
+  diag::NullConsumer consumer;
+  // Warm up caches and the allocator before timing.
+  size_t tokens = Lex(source, consumer).size();
+
+  constexpr int Iterations = 10;
+  auto start               = std::chrono::steady_clock::now();
+  for (int i = 0; i < Iterations; ++i) { Lex(source, consumer); }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double bytes_per_second = source.size() * Iterations / elapsed.count();
+  std::printf("%-8s %10.1f MiB/s  (%zu bytes, %zu tokens)\n",
+              Name(implementation), bytes_per_second / (1 << 20),
+              source.size(), tokens);
+}
+
+}  // namespace
+}  // namespace ic::lex
+
+int main(int argc, char const* argv[]) {
+  std::string source;
+  if (argc > 1) {
+    if (not ic::lex::ReadFile(argv[1], source)) {
+      std::fprintf(stderr, "Failed to read '%s'.\n", argv[1]);
+      return 1;
+    }
+  } else {
+    source = ic::lex::SyntheticSource(32 << 20);
+  }
+
+  auto active = ic::lex::ActiveScanImplementation();
+  for (auto implementation :
+       {ic::lex::ScanImplementation::Scalar, ic::lex::ScanImplementation::Sse2,
+        ic::lex::ScanImplementation::Avx2}) {
+    ic::lex::Measure(source, implementation);
+  }
+  ic::lex::SetScanImplementation(active);
+  return 0;
+}
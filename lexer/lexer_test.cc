@@ -1,5 +1,10 @@
 #include "lexer/lexer.h"
 
+#include <algorithm>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
 #include "diagnostics/consumer/null.h"
 #include "lexer/token_matchers.h"
 #include "nth/test/test.h"
@@ -49,7 +54,8 @@ NTH_TEST("lex/identifier", std::string_view id) {
 
 NTH_INVOKE_TEST("lex/identifier") {
   for (std::string_view id :
-       {"a", "name", "_blah", "_17", "blah__", "blah_17_", "___"}) {
+       {"a", "name", "_blah", "_17", "blah__", "blah_17_", "___", "lets",
+        "i", "i65", "interfaces", "unspellable"}) {
     co_yield id;
   }
 }
@@ -66,6 +72,26 @@ NTH_INVOKE_TEST("lex/integer") {
   co_yield nth::TestArguments{"0d0", 0};
   co_yield nth::TestArguments{"123", 123};
   co_yield nth::TestArguments{"0d123", 123};
+  co_yield nth::TestArguments{"01", 1};
+  co_yield nth::TestArguments{"1_000", 1000};
+  co_yield nth::TestArguments{"0b1011", 11};
+  co_yield nth::TestArguments{"0o777", 511};
+  co_yield nth::TestArguments{"0x1f", 31};
+  co_yield nth::TestArguments{"0xFF_FF", 65535};
+}
+
+NTH_TEST("lex/integer/no-digits", std::string_view n) {
+  // A radix prefix with no valid digits following it cannot be lexed.
+  diag::NullConsumer d;
+  auto token_buffer = Lex(n, d);
+  NTH_EXPECT(token_buffer >>= ElementsAreSequentially(HasKind(Token::Kind::Eof)));
+}
+
+NTH_INVOKE_TEST("lex/integer/no-digits") {
+  for (std::string_view n :
+       {"0b", "0o", "0d", "0x", "0b2", "0o9", "0dz", "0xg"}) {
+    co_yield n;
+  }
 }
 
 NTH_TEST("lex/basic") {
@@ -77,6 +103,33 @@ NTH_TEST("lex/basic") {
                  HasKind(Token::Kind::Eof)));
 }
 
+NTH_TEST("lex/operator", std::string_view content, Token::Kind kind) {
+  diag::NullConsumer d;
+  auto token_buffer = Lex(content, d);
+  NTH_EXPECT(token_buffer >>= ElementsAreSequentially(
+                 HasKind(kind), HasKind(Token::Kind::Eof)));
+}
+
+NTH_INVOKE_TEST("lex/operator") {
+#define IC_XMACRO_TOKEN_KIND_OPERATOR(kind, symbol)                            \
+  co_yield nth::TestArguments{symbol, Token::Kind::kind};
+#include "lexer/token_kind.xmacro.h"
+}
+
+NTH_TEST("lex/operator/longest-match") {
+  diag::NullConsumer d;
+  auto token_buffer = Lex("a<=b", d);
+  NTH_EXPECT(token_buffer >>= ElementsAreSequentially(
+                 HasKind(Token::Kind::Identifier),
+                 HasKind(Token::Kind::LessEqual),
+                 HasKind(Token::Kind::Identifier), HasKind(Token::Kind::Eof)));
+
+  token_buffer = Lex("::==", d);
+  NTH_EXPECT(token_buffer >>= ElementsAreSequentially(
+                 HasKind(Token::Kind::ColonColonEqual),
+                 HasKind(Token::Kind::Equal), HasKind(Token::Kind::Eof)));
+}
+
 NTH_TEST("lex/comment/eof") {
   diag::NullConsumer d;
   auto token_buffer = Lex("// comment", d);
@@ -176,5 +229,320 @@ NTH_INVOKE_TEST("lex/character-literal") {
   }
 }
 
+std::string GeneratedSource() {
+  std::string source;
+  for (int i = 0; i < 200; ++i) {
+    source += "f" + std::to_string(i % 13) + " ::= fn(x: i64) -> i64 {\n";
+    source += "  // comment with \"quotes\n";
+    source += "  c ::= !'\n'\n";
+    source += "  s ::= \"a\\tb" + std::to_string(i % 5) + "\"\n";
+    source += "  return [*]x[" + std::to_string(i) + "] <= (x + 1)\n";
+    source += "}\n";
+  }
+  return source;
+}
+
+NTH_TEST("lex/threads", uint32_t threads) {
+  std::string source = GeneratedSource();
+  diag::NullConsumer d;
+  auto serial   = Lex(source, d);
+  auto parallel = Lex(source, d,
+                      {
+                          .threads            = threads,
+                          .minimum_chunk_size = 64,
+                      });
+  NTH_EXPECT(std::ranges::equal(serial, parallel));
+  NTH_EXPECT(serial.line_table() == parallel.line_table());
+}
+
+NTH_INVOKE_TEST("lex/threads") {
+  for (uint32_t threads : {2, 3, 8, 64}) { co_yield threads; }
+}
+
+NTH_TEST("lex/threads/blank-lines") {
+  // Chunks must not begin between two newlines, as whether the second produces
+  // a `Newline` token depends on what precedes the first.
+  std::string source;
+  for (int i = 0; i < 50; ++i) { source += "a \n\n  \n\nb\n"; }
+  diag::NullConsumer d;
+  auto serial   = Lex(source, d);
+  auto parallel = Lex(source, d,
+                      {
+                          .threads            = 16,
+                          .minimum_chunk_size = 1,
+                      });
+  NTH_EXPECT(std::ranges::equal(serial, parallel));
+  NTH_EXPECT(serial.line_table() == parallel.line_table());
+}
+
+NTH_TEST("lex/threads/unlexable") {
+  // Chunks following one which could not be lexed are discarded rather than
+  // reported, even if they also contain input which cannot be lexed.
+  std::string source = GeneratedSource() + "x ::= 0x\n" + GeneratedSource() +
+                       "y ::= 0b2\n" + GeneratedSource();
+  diag::NullConsumer d;
+  auto serial   = Lex(source, d);
+  auto parallel = Lex(source, d,
+                      {
+                          .threads            = 8,
+                          .minimum_chunk_size = 64,
+                      });
+  NTH_EXPECT(serial.size() < Lex(GeneratedSource(), d).size() * 2);
+  NTH_EXPECT(std::ranges::equal(serial, parallel));
+}
+
+NTH_TEST("lex/pipelined", size_t chunk_size) {
+  std::string source = GeneratedSource() + "no_trailing_newline";
+  diag::NullConsumer d;
+  auto expected = Lex(source, d);
+
+  TokenBuffer token_buffer;
+  PipelinedLexer lexer(source, token_buffer, chunk_size);
+  while (lexer.Advance()) {}
+  NTH_EXPECT(not lexer.Advance());
+  NTH_EXPECT(std::ranges::equal(expected, token_buffer));
+  NTH_EXPECT(expected.line_table() == token_buffer.line_table());
+}
+
+NTH_INVOKE_TEST("lex/pipelined") {
+  for (size_t chunk_size : {1, 3, 64, 4096, 1 << 20}) { co_yield chunk_size; }
+}
+
+NTH_TEST("lex/pipelined/abandoned") {
+  // Destroying the lexer before every chunk is consumed stops the lexing
+  // thread, even while it waits for a slot.
+  std::string source = GeneratedSource();
+  TokenBuffer token_buffer;
+  PipelinedLexer lexer(source, token_buffer, 1);
+  NTH_EXPECT(lexer.Advance());
+}
+
+NTH_TEST("lex/memory-resource", uint32_t threads) {
+  std::string source = GeneratedSource();
+  diag::NullConsumer d;
+  std::pmr::monotonic_buffer_resource resource;
+  auto expected = Lex(source, d);
+  auto actual   = Lex(source, d,
+                      {
+                          .threads            = threads,
+                          .minimum_chunk_size = 64,
+                          .memory_resource    = &resource,
+                      });
+  NTH_EXPECT(std::ranges::equal(expected, actual));
+  NTH_EXPECT(expected.line_table() == actual.line_table());
+}
+
+NTH_INVOKE_TEST("lex/memory-resource") {
+  for (uint32_t threads : {1, 4}) { co_yield threads; }
+}
+
+NTH_TEST("lex/wide-payload") {
+  // Enough tokens between the parentheses that their indices do not fit in a
+  // `Token`'s payload.
+  std::string source = "(";
+  for (uint32_t i = 0; i < Token::PayloadLimit / 2; ++i) { source += "a\n"; }
+  source += ")";
+
+  diag::NullConsumer d;
+  auto token_buffer = Lex(source, d);
+  NTH_ASSERT(token_buffer.size() > Token::PayloadLimit);
+  size_t close = token_buffer.size() - 2;
+  NTH_ASSERT(token_buffer.kind(close) == Token::Kind::RightParen);
+  NTH_EXPECT(token_buffer.payload(0) == close);
+  NTH_EXPECT(token_buffer.payload(close) == 0);
+  NTH_EXPECT(token_buffer[0].has_wide_payload());
+}
+
+NTH_TEST("lex/line-table", std::string_view source) {
+  diag::NullConsumer d;
+  NTH_EXPECT(Lex(source, d).line_table() == LineTable::FromSource(source));
+}
+
+NTH_INVOKE_TEST("lex/line-table") {
+  co_yield std::string_view("");
+  co_yield std::string_view("x");
+  co_yield std::string_view("x\ny\n");
+  co_yield std::string_view("x  \n\n  y");
+  co_yield std::string_view("// comment\nx // comment\n");
+  co_yield std::string_view("c ::= !'\n'\n");
+  co_yield std::string_view("s ::= \"\\n\"\n");
+}
+
+NTH_TEST("lex/stream", size_t window_size) {
+  std::string source = GeneratedSource() + "no_trailing_newline";
+  diag::NullConsumer d;
+  auto expected = Lex(source, d);
+
+  std::vector<Token> tokens;
+  std::vector<uint32_t> payloads;
+  StreamingLexer lexer;
+  for (std::string_view s = source; not s.empty();) {
+    lexer.Feed(s.substr(0, window_size));
+    s.remove_prefix(std::min(window_size, s.size()));
+    tokens.insert(tokens.end(), lexer.tokens().begin(), lexer.tokens().end());
+    payloads.insert(payloads.end(), lexer.payloads().begin(),
+                    lexer.payloads().end());
+    lexer.clear_tokens();
+  }
+  lexer.Finish();
+  tokens.insert(tokens.end(), lexer.tokens().begin(), lexer.tokens().end());
+  payloads.insert(payloads.end(), lexer.payloads().begin(),
+                  lexer.payloads().end());
+
+  NTH_ASSERT(tokens.size() == expected.size());
+  NTH_ASSERT(payloads.size() == expected.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    switch (expected[i].kind()) {
+      case Token::Kind::LeftParen:
+      case Token::Kind::LeftBrace:
+      case Token::Kind::LeftBracket:
+        // Open symbols are streamed before their matching close symbol.
+        NTH_EXPECT(tokens[i].kind() == expected[i].kind());
+        NTH_EXPECT(tokens[i].offset() == expected[i].offset());
+        break;
+      default:
+        NTH_EXPECT(tokens[i] == expected[i]);
+        NTH_EXPECT(payloads[i] == expected.payload(i));
+        break;
+    }
+  }
+}
+
+NTH_INVOKE_TEST("lex/stream") {
+  for (size_t window_size : {1, 2, 3, 7, 64, 4096}) { co_yield window_size; }
+}
+
+NTH_TEST("lex/stream/wide-integer", std::string_view n) {
+  // Integer literals too large for a `Token`'s payload are streamed as
+  // `Token::WidePayload`, with their value recoverable from the payload
+  // streamed alongside.
+  diag::NullConsumer d;
+  auto expected = Lex(n, d);
+  NTH_ASSERT(expected.size() == 2);
+
+  StreamingLexer lexer;
+  lexer.Feed(n);
+  lexer.Finish();
+  NTH_ASSERT(lexer.tokens().size() == 2);
+  NTH_EXPECT(lexer.tokens()[0].has_wide_payload());
+  NTH_EXPECT(lexer.payloads()[0] == expected.payload(0));
+
+  TokenBuffer streamed;
+  streamed.Append(Token::Kind::IntegerLiteral, lexer.tokens()[0].offset(),
+                  lexer.payloads()[0]);
+  NTH_EXPECT(streamed.integer_literal(0) == expected.integer_literal(0));
+}
+
+NTH_INVOKE_TEST("lex/stream/wide-integer") {
+  for (std::string_view n :
+       {"20000000", "0xffffff", "2147483648", "18446744073709551616"}) {
+    co_yield n;
+  }
+}
+
+NTH_TEST("lex/relex", std::string_view source, SourceEdit edit) {
+  std::string edited(source.substr(0, edit.offset));
+  edited.append(edit.replacement);
+  edited.append(source.substr(edit.offset + edit.length));
+
+  diag::NullConsumer d;
+  auto token_buffer    = Lex(source, d);
+  size_t size          = token_buffer.size();
+  TokenEdit token_edit = Relex(token_buffer, source, edit, d);
+  auto expected        = Lex(edited, d);
+  NTH_ASSERT(token_buffer.size() == expected.size());
+  NTH_EXPECT(token_edit.first <= token_edit.new_end);
+  NTH_EXPECT(size - token_edit.old_end ==
+             token_buffer.size() - token_edit.new_end);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    NTH_EXPECT(token_buffer.kind(i) == expected.kind(i));
+    NTH_EXPECT(token_buffer.offset(i) == expected.offset(i));
+    NTH_EXPECT(token_buffer.payload(i) == expected.payload(i));
+  }
+  NTH_EXPECT(token_buffer.line_table() == expected.line_table());
+}
+
+NTH_INVOKE_TEST("lex/relex") {
+  // Edits within a single line.
+  co_yield nth::TestArguments{"a b\nc d\n", SourceEdit{.offset = 2,
+                                                         .length = 1,
+                                                         .replacement = "xyz"}};
+  co_yield nth::TestArguments{"a b\nc d\n", SourceEdit{.offset = 0,
+                                                         .length = 0,
+                                                         .replacement = "3 "}};
+  co_yield nth::TestArguments{"a b\nc d", SourceEdit{.offset      = 7,
+                                                      .length      = 0,
+                                                      .replacement = " e"}};
+  // Edits adding and removing lines.
+  co_yield nth::TestArguments{"a\nb\nc\n", SourceEdit{.offset = 2,
+                                                         .length = 2,
+                                                         .replacement = ""}};
+  co_yield nth::TestArguments{
+      "a\nb\n", SourceEdit{.offset = 1, .length = 0, .replacement = "\n\n"}};
+  co_yield nth::TestArguments{"a \n\nb\n", SourceEdit{.offset = 3,
+                                                          .length = 1,
+                                                          .replacement = ""}};
+  // Edits changing how symbols are paired.
+  co_yield nth::TestArguments{"f(a)\ng(b)\n", SourceEdit{.offset = 3,
+                                                           .length = 3,
+                                                           .replacement = ""}};
+  co_yield nth::TestArguments{"{\n  x\n}\ny\n",
+                              SourceEdit{.offset      = 4,
+                                         .length      = 1,
+                                         .replacement = "[z]"}};
+  co_yield nth::TestArguments{"{\n  x\n}\ny\n",
+                              SourceEdit{.offset      = 0,
+                                         .length      = 0,
+                                         .replacement = "(\n"}};
+  // Edits affecting how subsequent lines are lexed.
+  co_yield nth::TestArguments{"c ::= !'\n'\nb\n",
+                              SourceEdit{.offset      = 6,
+                                         .length      = 1,
+                                         .replacement = ""}};
+  co_yield nth::TestArguments{"a\nb\n// c\nd\n",
+                              SourceEdit{.offset      = 2,
+                                         .length      = 0,
+                                         .replacement = "// "}};
+}
+
+NTH_TEST("lex/relex/generated") {
+  std::string source = GeneratedSource();
+  diag::NullConsumer d;
+  auto token_buffer = Lex(source, d);
+  // Rename a declaration in the middle of the file, and then rename it back.
+  size_t offset = source.find("f7 ::=", source.size() / 2);
+  NTH_ASSERT(offset != std::string::npos);
+  std::string edited = source.substr(0, offset) + "renamed" +
+                       source.substr(offset + 2);
+  Relex(token_buffer, source,
+        {.offset      = static_cast<uint32_t>(offset),
+         .length      = 2,
+         .replacement = "renamed"},
+        d);
+  NTH_EXPECT(std::ranges::equal(token_buffer, Lex(edited, d)));
+  Relex(token_buffer, edited,
+        {.offset      = static_cast<uint32_t>(offset),
+         .length      = 7,
+         .replacement = "f7"},
+        d);
+  auto expected = Lex(source, d);
+  NTH_EXPECT(std::ranges::equal(token_buffer, expected));
+  NTH_EXPECT(token_buffer.line_table() == expected.line_table());
+
+  // Insert a line after the offsets have been shifted, changing the number of
+  // tokens and lines.
+  size_t line = source.find('\n', source.size() / 4) + 1;
+  edited      = source.substr(0, line) + "inserted ::= (1)\n" +
+           source.substr(line);
+  Relex(token_buffer, source,
+        {.offset      = static_cast<uint32_t>(line),
+         .length      = 0,
+         .replacement = "inserted ::= (1)\n"},
+        d);
+  expected = Lex(edited, d);
+  NTH_EXPECT(std::ranges::equal(token_buffer, expected));
+  NTH_EXPECT(token_buffer.line_table() == expected.line_table());
+}
+
 }  // namespace
 }  // namespace ic::lex
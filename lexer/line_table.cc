@@ -0,0 +1,40 @@
+#include "lexer/line_table.h"
+
+#include "lexer/scan.h"
+
+namespace ic {
+
+LineTable LineTable::FromSource(std::string_view source) {
+  LineTable table;
+  uint32_t offset = 0;
+  while (true) {
+    size_t newline = lex::FindNewline(source);
+    if (newline == source.size()) { break; }
+    offset += newline + 1;
+    table.AddLineStart(offset);
+    source.remove_prefix(newline + 1);
+  }
+  return table;
+}
+
+void LineTable::Splice(uint32_t begin, uint32_t end,
+                       LineTable const& replacement, int64_t delta) {
+  size_t first = starts_.upper_bound(begin);
+  size_t last  = starts_.upper_bound(end, first);
+  starts_.Replace(first, last, replacement.starts_);
+  starts_.Shift(first + replacement.starts_.size(), delta);
+  hint_ = 1;
+}
+
+std::pair<uint32_t, uint32_t> LineTable::LineAndColumn(uint32_t offset) const {
+  if (not Contains(hint_, offset)) {
+    if (hint_ < lines() and Contains(hint_ + 1, offset)) {
+      ++hint_;
+    } else {
+      hint_ = starts_.upper_bound(offset) + 1;
+    }
+  }
+  return std::pair<uint32_t, uint32_t>(hint_, offset - line_start(hint_));
+}
+
+}  // namespace ic
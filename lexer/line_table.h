@@ -0,0 +1,84 @@
+#ifndef ICARUS_LEXER_LINE_TABLE_H
+#define ICARUS_LEXER_LINE_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include "lexer/shiftable_offsets.h"
+#include "nth/debug/debug.h"
+
+namespace ic {
+
+// Records the offset at which each line of a source begins. Lines are
+// 1-indexed and the first line always begins at offset zero, so only the
+// offsets immediately following each newline character are stored. The lexer
+// populates a line table as it visits each newline, so that consumers of the
+// source need not scan it again.
+struct LineTable {
+  // Constructs a line table for `source` by scanning it for newlines.
+  static LineTable FromSource(std::string_view source);
+
+  // Records that a line begins at `offset`, immediately after a newline
+  // character. Offsets must be recorded in increasing order.
+  void AddLineStart(uint32_t offset) {
+    NTH_REQUIRE((v.debug), starts_.empty() or starts_.back() < offset);
+    starts_.push_back(offset);
+  }
+
+  // Records every line start from `table`, all of which must be greater than
+  // those already recorded in `*this`.
+  void Append(LineTable const& table) {
+    NTH_REQUIRE((v.debug), starts_.empty() or table.starts_.empty() or
+                               starts_.back() < table.starts_[0]);
+    starts_.Append(table.starts_);
+  }
+
+  // Replaces the line starts in the range `(begin, end]` with those recorded in
+  // `replacement`, and shifts all line starts after `end` by `delta`. This
+  // reflects an edit to the source which replaces the lines beginning after
+  // `begin` and up to `end`, changing the length of the source by `delta`.
+  // Unless the number of lines changes, this takes time proportional to the
+  // number of lines replaced and logarithmic in the number of lines overall.
+  void Splice(uint32_t begin, uint32_t end, LineTable const& replacement,
+              int64_t delta);
+
+  void clear() {
+    starts_.clear();
+    hint_ = 1;
+  }
+
+  // Returns the number of lines in the source.
+  size_t lines() const { return starts_.size() + 1; }
+
+  // Returns the offset at which `line` begins.
+  uint32_t line_start(uint32_t line) const {
+    NTH_REQUIRE((v.debug), line > 0);
+    NTH_REQUIRE((v.debug), line <= lines());
+    return line == 1 ? 0 : starts_[line - 2];
+  }
+
+  // Returns the line containing `offset` along with the 0-indexed column of
+  // `offset` within that line. The line of the most recent lookup is
+  // remembered, so that lookups made in increasing (or repeated) offset order,
+  // as is typical when emitting many diagnostics, take amortized constant time.
+  // Other lookups take time polylogarithmic in the number of lines.
+  std::pair<uint32_t, uint32_t> LineAndColumn(uint32_t offset) const;
+
+  friend bool operator==(LineTable const& lhs, LineTable const& rhs) {
+    return lhs.starts_ == rhs.starts_;
+  }
+
+ private:
+  bool Contains(uint32_t line, uint32_t offset) const {
+    return line_start(line) <= offset and
+           (line == lines() or offset < line_start(line + 1));
+  }
+
+  ShiftableOffsets starts_;
+  // The line returned by the most recent call to `LineAndColumn`.
+  mutable uint32_t hint_ = 1;
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_LEXER_LINE_TABLE_H
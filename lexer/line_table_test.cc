@@ -0,0 +1,88 @@
+#include "lexer/line_table.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "nth/test/test.h"
+
+namespace ic {
+namespace {
+
+NTH_TEST("line-table/from-source") {
+  NTH_EXPECT(LineTable::FromSource("").lines() == 1);
+  NTH_EXPECT(LineTable::FromSource("abc").lines() == 1);
+  NTH_EXPECT(LineTable::FromSource("abc\n").lines() == 2);
+
+  LineTable table = LineTable::FromSource("ab\n\ncde\nf");
+  NTH_ASSERT(table.lines() == 4);
+  NTH_EXPECT(table.line_start(1) == 0);
+  NTH_EXPECT(table.line_start(2) == 3);
+  NTH_EXPECT(table.line_start(3) == 4);
+  NTH_EXPECT(table.line_start(4) == 8);
+}
+
+NTH_TEST("line-table/line-and-column") {
+  LineTable table = LineTable::FromSource("ab\n\ncde\nf");
+  using LineColumn = std::pair<uint32_t, uint32_t>;
+  // In increasing order.
+  NTH_EXPECT(table.LineAndColumn(0) == LineColumn(1, 0));
+  NTH_EXPECT(table.LineAndColumn(2) == LineColumn(1, 2));
+  NTH_EXPECT(table.LineAndColumn(3) == LineColumn(2, 0));
+  NTH_EXPECT(table.LineAndColumn(4) == LineColumn(3, 0));
+  NTH_EXPECT(table.LineAndColumn(6) == LineColumn(3, 2));
+  NTH_EXPECT(table.LineAndColumn(8) == LineColumn(4, 0));
+  NTH_EXPECT(table.LineAndColumn(9) == LineColumn(4, 1));
+  // Out of order.
+  NTH_EXPECT(table.LineAndColumn(1) == LineColumn(1, 1));
+  NTH_EXPECT(table.LineAndColumn(7) == LineColumn(3, 3));
+  NTH_EXPECT(table.LineAndColumn(3) == LineColumn(2, 0));
+}
+
+NTH_TEST("line-table/append") {
+  LineTable table = LineTable::FromSource("a\nb\n");
+  LineTable rest;
+  rest.AddLineStart(6);
+  rest.AddLineStart(9);
+  table.Append(rest);
+  NTH_ASSERT(table.lines() == 5);
+  NTH_EXPECT(table.line_start(4) == 6);
+  NTH_EXPECT(table.line_start(5) == 9);
+}
+
+NTH_TEST("line-table/splice") {
+  // "a\nb\nc\nd\n" with "b\nc\n" replaced by "xy\n\nz\nw\n".
+  LineTable table = LineTable::FromSource("a\nb\nc\nd\n");
+  LineTable replacement;
+  replacement.AddLineStart(5);
+  replacement.AddLineStart(6);
+  replacement.AddLineStart(8);
+  replacement.AddLineStart(10);
+  table.Splice(2, 6, replacement, 4);
+  NTH_EXPECT(table == LineTable::FromSource("a\nxy\n\nz\nw\nd\n"));
+}
+
+NTH_TEST("line-table/splice-same-line-count") {
+  std::string source;
+  for (int i = 0; i < 1000; ++i) { source.append("line\n"); }
+  LineTable table = LineTable::FromSource(source);
+
+  // Lengthen line 101, then shorten line 501, keeping the number of lines.
+  LineTable replacement;
+  replacement.AddLineStart(511);
+  table.Splice(500, 505, replacement, 6);
+  source.replace(500, 4, "lengthened");
+  replacement.clear();
+  replacement.AddLineStart(2510);
+  table.Splice(2506, 2511, replacement, -1);
+  source.replace(2506, 4, "lin");
+  NTH_EXPECT(table == LineTable::FromSource(source));
+
+  using LineColumn = std::pair<uint32_t, uint32_t>;
+  NTH_EXPECT(table.LineAndColumn(510) == LineColumn(101, 10));
+  NTH_EXPECT(table.LineAndColumn(2508) == LineColumn(501, 2));
+  NTH_EXPECT(table.LineAndColumn(source.size() - 1) == LineColumn(1000, 4));
+}
+
+}  // namespace
+}  // namespace ic
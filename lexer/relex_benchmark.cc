@@ -0,0 +1,91 @@
+// Measures the cost of re-lexing a source file after a single-line edit, for
+// synthetic source files of increasing size. Each row reports the time taken
+// to lex the whole file with `Lex` (the baseline) alongside the time taken by
+// `Relex` to apply an edit in the middle of the file. Lexing performed by
+// `Relex` is confined to the edited line, and because the edit does not change
+// the number of tokens or lines, later tokens and line starts are moved by
+// updating logarithmically many shifts (see `ShiftableOffsets`). The time
+// taken by `Relex` is therefore essentially independent of the size of the
+// file.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+
+namespace ic::lex {
+namespace {
+
+std::string SyntheticSource(size_t minimum_size) {
+  std::string source;
+  for (size_t i = 0; source.size() < minimum_size; ++i) {
+    source.append("// Generated declaration number ")
+        .append(std::to_string(i))
+        .append("\n")
+        .append("let generated_identifier_")
+        .append(std::to_string(i))
+        .append(" ::= some_function_name(argument.member, ")
+        .append(std::to_string(i * 7919))
+        .append(") + other_identifier * 3\n\n");
+  }
+  return source;
+}
+
+constexpr int Iterations = 20;
+
+double SecondsPerIteration(auto&& f) {
+  f();  // Warm up caches and the allocator before timing.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Iterations; ++i) { f(); }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / Iterations;
+}
+
+void Measure(size_t size) {
+  std::string source = SyntheticSource(size);
+  diag::NullConsumer consumer;
+
+  double lex = SecondsPerIteration([&] { Lex(source, consumer); });
+
+  // Alternately renames an identifier in the middle of the file and renames it
+  // back, so that every iteration applies a single-line edit to the same file.
+  size_t offset = source.find("let ", source.size() / 2) + 4;
+  std::string original(source.substr(offset, 9));
+  std::string renamed = "renamed_identifier";
+  std::string edited  = source.substr(0, offset) + renamed +
+                       source.substr(offset + original.size());
+  TokenBuffer buffer = Lex(source, consumer);
+  bool is_edited     = false;
+  double relex = SecondsPerIteration([&] {
+    if (is_edited) {
+      Relex(buffer, edited,
+            {.offset      = static_cast<uint32_t>(offset),
+             .length      = static_cast<uint32_t>(renamed.size()),
+             .replacement = original},
+            consumer);
+    } else {
+      Relex(buffer, source,
+            {.offset      = static_cast<uint32_t>(offset),
+             .length      = static_cast<uint32_t>(original.size()),
+             .replacement = renamed},
+            consumer);
+    }
+    is_edited = not is_edited;
+  });
+
+  std::printf("%10zu bytes %10zu tokens  lex %10.3f ms  relex %8.3f ms\n",
+              source.size(), buffer.size(), lex * 1e3, relex * 1e3);
+}
+
+}  // namespace
+}  // namespace ic::lex
+
+int main() {
+  for (size_t size = size_t{1} << 16; size <= size_t{1} << 26; size <<= 2) {
+    ic::lex::Measure(size);
+  }
+  return 0;
+}
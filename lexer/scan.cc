@@ -0,0 +1,331 @@
+#include "lexer/scan.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define ICARUS_LEXER_SCAN_X86 1
+#else
+#define ICARUS_LEXER_SCAN_X86 0
+#endif  // defined(__x86_64__)
+
+namespace ic::lex {
+namespace {
+
+enum CharacterClass : uint8_t {
+  Whitespace           = 1,
+  Identifier           = 2,
+  StringLiteralSpecial = 4,
+};
+
+constexpr std::array<uint8_t, 256> CharacterClasses = [] {
+  std::array<uint8_t, 256> table{};
+  for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+    table[static_cast<uint8_t>(c)] |= Whitespace;
+  }
+  for (char c = 'a'; c <= 'z'; ++c) { table[c] |= Identifier; }
+  for (char c = 'A'; c <= 'Z'; ++c) { table[c] |= Identifier; }
+  for (char c = '0'; c <= '9'; ++c) { table[c] |= Identifier; }
+  table['_'] |= Identifier;
+  for (char c : {'"', '\\', '\n'}) {
+    table[static_cast<uint8_t>(c)] |= StringLiteralSpecial;
+  }
+  return table;
+}();
+
+constexpr bool HasClass(char c, CharacterClass cls) {
+  return CharacterClasses[static_cast<uint8_t>(c)] & cls;
+}
+
+size_t RunLengthScalar(char const* p, size_t start, size_t size,
+                       CharacterClass cls) {
+  size_t i = start;
+  for (; i < size and HasClass(p[i], cls); ++i) {}
+  return i;
+}
+
+size_t FindScalar(char const* p, size_t start, size_t size,
+                  CharacterClass cls) {
+  size_t i = start;
+  for (; i < size and not HasClass(p[i], cls); ++i) {}
+  return i;
+}
+
+size_t WhitespaceRunLengthScalar(std::string_view s) {
+  return RunLengthScalar(s.data(), 0, s.size(), Whitespace);
+}
+
+size_t IdentifierRunLengthScalar(std::string_view s) {
+  return RunLengthScalar(s.data(), 0, s.size(), Identifier);
+}
+
+size_t FindNewlineScalar(std::string_view s) {
+  void const* p = std::memchr(s.data(), '\n', s.size());
+  return p ? static_cast<char const*>(p) - s.data() : s.size();
+}
+
+size_t FindStringLiteralSpecialCharacterScalar(std::string_view s) {
+  return FindScalar(s.data(), 0, s.size(), StringLiteralSpecial);
+}
+
+#if ICARUS_LEXER_SCAN_X86
+
+// Each vector kernel processes as many full vectors as fit in the input and
+// hands off the remaining tail to the scalar implementation. Because runs are
+// typically short, the first character is checked before any vector loads.
+
+// Returns a mask whose bytes are all ones exactly when `low <= c <= high`.
+__m128i InRangeSse2(__m128i c, char low, char high) {
+  __m128i shifted = _mm_sub_epi8(c, _mm_set1_epi8(low));
+  __m128i width   = _mm_set1_epi8(static_cast<char>(high - low));
+  return _mm_cmpeq_epi8(_mm_min_epu8(shifted, width), shifted);
+}
+
+__m128i WhitespaceSse2(__m128i c) {
+  return _mm_or_si128(InRangeSse2(c, '\t', '\r'),
+                      _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+}
+
+__m128i IdentifierSse2(__m128i c) {
+  __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  return _mm_or_si128(
+      _mm_or_si128(InRangeSse2(c, '0', '9'), InRangeSse2(lower, 'a', 'z')),
+      _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+}
+
+__m128i StringLiteralSpecialSse2(__m128i c) {
+  return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('"')),
+                                   _mm_cmpeq_epi8(c, _mm_set1_epi8('\\'))),
+                      _mm_cmpeq_epi8(c, _mm_set1_epi8('\n')));
+}
+
+__m128i Load128(char const* p) {
+  return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+}
+
+size_t WhitespaceRunLengthSse2(std::string_view s) {
+  char const* p = s.data();
+  size_t i      = 0;
+  if (s.empty() or not HasClass(p[0], Whitespace)) { return 0; }
+  for (; i + 16 <= s.size(); i += 16) {
+    uint32_t mask = _mm_movemask_epi8(WhitespaceSse2(Load128(p + i)));
+    if (mask != 0xffff) { return i + std::countr_one(mask); }
+  }
+  return RunLengthScalar(p, i, s.size(), Whitespace);
+}
+
+size_t IdentifierRunLengthSse2(std::string_view s) {
+  char const* p = s.data();
+  size_t i      = 0;
+  if (s.empty() or not HasClass(p[0], Identifier)) { return 0; }
+  for (; i + 16 <= s.size(); i += 16) {
+    uint32_t mask = _mm_movemask_epi8(IdentifierSse2(Load128(p + i)));
+    if (mask != 0xffff) { return i + std::countr_one(mask); }
+  }
+  return RunLengthScalar(p, i, s.size(), Identifier);
+}
+
+size_t FindNewlineSse2(std::string_view s) {
+  char const* p   = s.data();
+  size_t i        = 0;
+  __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= s.size(); i += 16) {
+    uint32_t mask =
+        _mm_movemask_epi8(_mm_cmpeq_epi8(Load128(p + i), newline));
+    if (mask != 0) { return i + std::countr_zero(mask); }
+  }
+  return i + FindNewlineScalar(s.substr(i));
+}
+
+size_t FindStringLiteralSpecialCharacterSse2(std::string_view s) {
+  char const* p = s.data();
+  size_t i      = 0;
+  for (; i + 16 <= s.size(); i += 16) {
+    uint32_t mask =
+        _mm_movemask_epi8(StringLiteralSpecialSse2(Load128(p + i)));
+    if (mask != 0) { return i + std::countr_zero(mask); }
+  }
+  return FindScalar(p, i, s.size(), StringLiteralSpecial);
+}
+
+#define ICARUS_LEXER_SCAN_AVX2 __attribute__((target("avx2")))
+
+ICARUS_LEXER_SCAN_AVX2 __m256i InRangeAvx2(__m256i c, char low, char high) {
+  __m256i shifted = _mm256_sub_epi8(c, _mm256_set1_epi8(low));
+  __m256i width   = _mm256_set1_epi8(static_cast<char>(high - low));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, width), shifted);
+}
+
+ICARUS_LEXER_SCAN_AVX2 __m256i WhitespaceAvx2(__m256i c) {
+  return _mm256_or_si256(InRangeAvx2(c, '\t', '\r'),
+                         _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')));
+}
+
+ICARUS_LEXER_SCAN_AVX2 __m256i IdentifierAvx2(__m256i c) {
+  __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+  return _mm256_or_si256(
+      _mm256_or_si256(InRangeAvx2(c, '0', '9'), InRangeAvx2(lower, 'a', 'z')),
+      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+}
+
+ICARUS_LEXER_SCAN_AVX2 __m256i StringLiteralSpecialAvx2(__m256i c) {
+  return _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('"')),
+                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\'))),
+      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')));
+}
+
+ICARUS_LEXER_SCAN_AVX2 __m256i Load256(char const* p) {
+  return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+}
+
+ICARUS_LEXER_SCAN_AVX2 size_t WhitespaceRunLengthAvx2(std::string_view s) {
+  char const* p = s.data();
+  size_t i      = 0;
+  if (s.empty() or not HasClass(p[0], Whitespace)) { return 0; }
+  for (; i + 32 <= s.size(); i += 32) {
+    uint32_t mask = _mm256_movemask_epi8(WhitespaceAvx2(Load256(p + i)));
+    if (mask != 0xffffffff) { return i + std::countr_one(mask); }
+  }
+  return RunLengthScalar(p, i, s.size(), Whitespace);
+}
+
+ICARUS_LEXER_SCAN_AVX2 size_t IdentifierRunLengthAvx2(std::string_view s) {
+  char const* p = s.data();
+  size_t i      = 0;
+  if (s.empty() or not HasClass(p[0], Identifier)) { return 0; }
+  for (; i + 32 <= s.size(); i += 32) {
+    uint32_t mask = _mm256_movemask_epi8(IdentifierAvx2(Load256(p + i)));
+    if (mask != 0xffffffff) { return i + std::countr_one(mask); }
+  }
+  return RunLengthScalar(p, i, s.size(), Identifier);
+}
+
+ICARUS_LEXER_SCAN_AVX2 size_t FindNewlineAvx2(std::string_view s) {
+  char const* p   = s.data();
+  size_t i        = 0;
+  __m256i newline = _mm256_set1_epi8('\n');
+  for (; i + 32 <= s.size(); i += 32) {
+    uint32_t mask =
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(Load256(p + i), newline));
+    if (mask != 0) { return i + std::countr_zero(mask); }
+  }
+  return i + FindNewlineScalar(s.substr(i));
+}
+
+ICARUS_LEXER_SCAN_AVX2 size_t
+FindStringLiteralSpecialCharacterAvx2(std::string_view s) {
+  char const* p = s.data();
+  size_t i      = 0;
+  for (; i + 32 <= s.size(); i += 32) {
+    uint32_t mask =
+        _mm256_movemask_epi8(StringLiteralSpecialAvx2(Load256(p + i)));
+    if (mask != 0) { return i + std::countr_zero(mask); }
+  }
+  return FindScalar(p, i, s.size(), StringLiteralSpecial);
+}
+
+#undef ICARUS_LEXER_SCAN_AVX2
+
+#endif  // ICARUS_LEXER_SCAN_X86
+
+struct Kernels {
+  ScanImplementation implementation;
+  size_t (*whitespace_run_length)(std::string_view);
+  size_t (*identifier_run_length)(std::string_view);
+  size_t (*find_newline)(std::string_view);
+  size_t (*find_string_literal_special)(std::string_view);
+};
+
+constexpr Kernels ScalarKernels = {
+    .implementation              = ScanImplementation::Scalar,
+    .whitespace_run_length       = WhitespaceRunLengthScalar,
+    .identifier_run_length       = IdentifierRunLengthScalar,
+    .find_newline                = FindNewlineScalar,
+    .find_string_literal_special = FindStringLiteralSpecialCharacterScalar,
+};
+
+#if ICARUS_LEXER_SCAN_X86
+constexpr Kernels Sse2Kernels = {
+    .implementation              = ScanImplementation::Sse2,
+    .whitespace_run_length       = WhitespaceRunLengthSse2,
+    .identifier_run_length       = IdentifierRunLengthSse2,
+    .find_newline                = FindNewlineSse2,
+    .find_string_literal_special = FindStringLiteralSpecialCharacterSse2,
+};
+
+constexpr Kernels Avx2Kernels = {
+    .implementation              = ScanImplementation::Avx2,
+    .whitespace_run_length       = WhitespaceRunLengthAvx2,
+    .identifier_run_length       = IdentifierRunLengthAvx2,
+    .find_newline                = FindNewlineAvx2,
+    .find_string_literal_special = FindStringLiteralSpecialCharacterAvx2,
+};
+#endif  // ICARUS_LEXER_SCAN_X86
+
+bool Supported(ScanImplementation implementation) {
+  switch (implementation) {
+    case ScanImplementation::Scalar: return true;
+#if ICARUS_LEXER_SCAN_X86
+    case ScanImplementation::Sse2: return true;
+    case ScanImplementation::Avx2: return __builtin_cpu_supports("avx2");
+#else
+    case ScanImplementation::Sse2:
+    case ScanImplementation::Avx2: return false;
+#endif  // ICARUS_LEXER_SCAN_X86
+  }
+  return false;
+}
+
+Kernels const& KernelsFor(ScanImplementation implementation) {
+  switch (implementation) {
+#if ICARUS_LEXER_SCAN_X86
+    case ScanImplementation::Sse2: return Sse2Kernels;
+    case ScanImplementation::Avx2: return Avx2Kernels;
+#endif  // ICARUS_LEXER_SCAN_X86
+    default: return ScalarKernels;
+  }
+}
+
+Kernels const* SelectKernels() {
+  for (auto implementation :
+       {ScanImplementation::Avx2, ScanImplementation::Sse2}) {
+    if (Supported(implementation)) { return &KernelsFor(implementation); }
+  }
+  return &ScalarKernels;
+}
+
+Kernels const* active_kernels = SelectKernels();
+
+}  // namespace
+
+size_t WhitespaceRunLength(std::string_view s) {
+  return active_kernels->whitespace_run_length(s);
+}
+
+size_t IdentifierRunLength(std::string_view s) {
+  return active_kernels->identifier_run_length(s);
+}
+
+size_t FindNewline(std::string_view s) {
+  return active_kernels->find_newline(s);
+}
+
+size_t FindStringLiteralSpecialCharacter(std::string_view s) {
+  return active_kernels->find_string_literal_special(s);
+}
+
+ScanImplementation ActiveScanImplementation() {
+  return active_kernels->implementation;
+}
+
+bool SetScanImplementation(ScanImplementation implementation) {
+  if (not Supported(implementation)) { return false; }
+  active_kernels = &KernelsFor(implementation);
+  return true;
+}
+
+}  // namespace ic::lex
@@ -0,0 +1,44 @@
+#ifndef ICARUS_LEXER_SCAN_H
+#define ICARUS_LEXER_SCAN_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace ic::lex {
+
+// Byte-scanning kernels used by the lexer for its hottest loops. Each function
+// has a scalar implementation as well as SSE2 and AVX2 implementations on
+// x86-64. The implementation is chosen once at startup based on the
+// capabilities of the processor and all implementations are guaranteed to
+// produce identical results.
+
+// Returns the number of leading characters in `s` which are whitespace, as
+// classified by `std::isspace` in the "C" locale.
+size_t WhitespaceRunLength(std::string_view s);
+
+// Returns the number of leading characters in `s` which may appear in an
+// identifier (see `IdentifierCharacter` in "lexer/lex.h").
+size_t IdentifierRunLength(std::string_view s);
+
+// Returns the index of the first '\n' in `s`, or `s.size()` if there is none.
+size_t FindNewline(std::string_view s);
+
+// Returns the index of the first character in `s` which cannot be copied
+// verbatim into the contents of a string literal (one of '"', '\\', or '\n'),
+// or `s.size()` if there is none.
+size_t FindStringLiteralSpecialCharacter(std::string_view s);
+
+enum class ScanImplementation { Scalar, Sse2, Avx2 };
+
+// Returns the implementation currently used by the functions above.
+ScanImplementation ActiveScanImplementation();
+
+// Replaces the implementation used by the functions above, returning `true`
+// on success and `false` if the requested implementation is not supported by
+// this processor. This is intended only for tests and benchmarks and must not
+// be called while any other thread is lexing.
+bool SetScanImplementation(ScanImplementation implementation);
+
+}  // namespace ic::lex
+
+#endif  // ICARUS_LEXER_SCAN_H
@@ -0,0 +1,90 @@
+#include "lexer/scan.h"
+
+#include <cctype>
+#include <string>
+
+#include "nth/test/test.h"
+
+namespace ic::lex {
+namespace {
+
+// Produces inputs which exercise both the vectorized loops and the scalar
+// tails, with the interesting character placed at every position relative to
+// a vector boundary.
+std::string WithCharacterAt(char filler, size_t length, char c,
+                            size_t position) {
+  std::string s(length, filler);
+  if (position < length) { s[position] = c; }
+  return s;
+}
+
+size_t ExpectedWhitespaceRunLength(std::string_view s) {
+  size_t i = 0;
+  for (; i < s.size() and std::isspace(static_cast<unsigned char>(s[i]));
+       ++i) {}
+  return i;
+}
+
+size_t ExpectedIdentifierRunLength(std::string_view s) {
+  size_t i = 0;
+  for (; i < s.size() and (std::isalnum(static_cast<unsigned char>(s[i])) or
+                           s[i] == '_');
+       ++i) {}
+  return i;
+}
+
+size_t ExpectedFind(std::string_view s, std::string_view characters) {
+  size_t i = s.find_first_of(characters);
+  return i == std::string_view::npos ? s.size() : i;
+}
+
+NTH_TEST("scan/whitespace", ScanImplementation implementation) {
+  if (not SetScanImplementation(implementation)) { return; }
+  for (char filler : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+    for (char stop : {'a', '_', '\0', '\x08', '\x0e', '\x80', '\xff', '!'}) {
+      for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        for (size_t position = 0; position <= length; ++position) {
+          std::string s = WithCharacterAt(filler, length, stop, position);
+          NTH_EXPECT(WhitespaceRunLength(s) == ExpectedWhitespaceRunLength(s));
+        }
+      }
+    }
+  }
+}
+
+NTH_TEST("scan/identifier", ScanImplementation implementation) {
+  if (not SetScanImplementation(implementation)) { return; }
+  for (char filler : {'a', 'z', 'A', 'Z', '0', '9', '_'}) {
+    for (char stop : {' ', '@', '[', '`', '{', '/', ':', '\x80', '\xdf'}) {
+      for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+        for (size_t position = 0; position <= length; ++position) {
+          std::string s = WithCharacterAt(filler, length, stop, position);
+          NTH_EXPECT(IdentifierRunLength(s) == ExpectedIdentifierRunLength(s));
+        }
+      }
+    }
+  }
+}
+
+NTH_TEST("scan/find", ScanImplementation implementation) {
+  if (not SetScanImplementation(implementation)) { return; }
+  for (char c : {'"', '\\', '\n', 'a', '\0', '\xff'}) {
+    for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+      for (size_t position = 0; position <= length; ++position) {
+        std::string s = WithCharacterAt('x', length, c, position);
+        NTH_EXPECT(FindNewline(s) == ExpectedFind(s, "\n"));
+        NTH_EXPECT(FindStringLiteralSpecialCharacter(s) ==
+                   ExpectedFind(s, "\"\\\n"));
+      }
+    }
+  }
+}
+
+NTH_INVOKE_TEST("scan/*") {
+  co_yield ScanImplementation::Scalar;
+  co_yield ScanImplementation::Sse2;
+  co_yield ScanImplementation::Avx2;
+}
+
+}  // namespace
+}  // namespace ic::lex
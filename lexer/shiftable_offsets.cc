@@ -0,0 +1,97 @@
+#include "lexer/shiftable_offsets.h"
+
+#include <algorithm>
+
+namespace ic {
+
+void ShiftableOffsets::Shift(size_t first, int64_t delta) {
+  if (first >= values_.size() or delta == 0) { return; }
+  if (shifts_.empty()) {
+    shifts_.assign((values_.size() + BlockSize - 1) >> BlockBits, 0);
+  }
+  uint32_t d   = static_cast<uint32_t>(delta);
+  size_t block = first >> BlockBits;
+  if ((first & (BlockSize - 1)) != 0) {
+    // Only part of the first block moves, so its elements are adjusted
+    // individually.
+    size_t end = std::min((block + 1) << BlockBits, values_.size());
+    for (size_t i = first; i < end; ++i) { values_[i] += d; }
+    ++block;
+  }
+  ShiftBlocks(block, d);
+}
+
+void ShiftableOffsets::Replace(size_t first, size_t last,
+                               ShiftableOffsets const& replacement) {
+  NTH_REQUIRE((v.harden), first <= last);
+  NTH_REQUIRE((v.harden), last <= values_.size());
+  if (replacement.size() == last - first) {
+    for (size_t i = 0; i < replacement.size(); ++i) {
+      Set(first + i, replacement[i]);
+    }
+    return;
+  }
+  Fold();
+  std::vector<uint32_t> inserted = replacement.values();
+  auto position = values_.erase(values_.begin() + first, values_.begin() + last);
+  values_.insert(position, inserted.begin(), inserted.end());
+}
+
+size_t ShiftableOffsets::lower_bound(uint32_t value, size_t from) const {
+  size_t low = from, high = size();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if ((*this)[middle] < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+size_t ShiftableOffsets::upper_bound(uint32_t value, size_t from) const {
+  size_t low = from, high = size();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if ((*this)[middle] <= value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+void ShiftableOffsets::Append(ShiftableOffsets const& other) {
+  Fold();
+  values_.reserve(values_.size() + other.size());
+  for (size_t i = 0; i < other.size(); ++i) { values_.push_back(other[i]); }
+}
+
+std::vector<uint32_t> ShiftableOffsets::values() const {
+  std::vector<uint32_t> result;
+  result.reserve(size());
+  for (size_t i = 0; i < size(); ++i) { result.push_back((*this)[i]); }
+  return result;
+}
+
+void ShiftableOffsets::Fold() {
+  if (shifts_.empty()) { return; }
+  for (size_t block = 0; block < shifts_.size(); ++block) {
+    uint32_t shift = BlockShift(block);
+    size_t end     = std::min((block + 1) << BlockBits, values_.size());
+    for (size_t i = block << BlockBits; i < end; ++i) { values_[i] += shift; }
+  }
+  shifts_.clear();
+}
+
+bool operator==(ShiftableOffsets const& lhs, ShiftableOffsets const& rhs) {
+  if (lhs.size() != rhs.size()) { return false; }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (lhs[i] != rhs[i]) { return false; }
+  }
+  return true;
+}
+
+}  // namespace ic
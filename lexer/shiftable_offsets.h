@@ -0,0 +1,118 @@
+#ifndef ICARUS_LEXER_SHIFTABLE_OFFSETS_H
+#define ICARUS_LEXER_SHIFTABLE_OFFSETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include "nth/debug/debug.h"
+
+namespace ic {
+
+// A sequence of offsets into a source, in which every offset from a given
+// position onward can be moved by the same amount in time logarithmic in the
+// length of the sequence. An edit to a source moves all of the text following
+// it, so this allows the tokens and line starts after an edit to be updated
+// without visiting each of them.
+//
+// Elements are grouped into blocks of `BlockSize` consecutive elements, and
+// each element is stored relative to a shift shared by its block. The shifts
+// are held in a Fenwick tree over blocks, which is only allocated by the first
+// call to `Shift`; until then reading an element is a single load. Arithmetic
+// is modulo 2^32, so stored values may wrap so long as the offsets they
+// represent do not.
+struct ShiftableOffsets {
+  static constexpr size_t BlockBits = 6;
+  static constexpr size_t BlockSize = size_t{1} << BlockBits;
+
+  ShiftableOffsets() = default;
+  explicit ShiftableOffsets(std::pmr::memory_resource* memory_resource)
+      : values_(memory_resource) {}
+
+  size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  uint32_t operator[](size_t index) const {
+    NTH_REQUIRE((v.debug), index < values_.size());
+    if (shifts_.empty()) { return values_[index]; }
+    return values_[index] + BlockShift(index >> BlockBits);
+  }
+  uint32_t back() const { return (*this)[size() - 1]; }
+
+  // Adds `delta` to each element with index at least `first`.
+  void Shift(size_t first, int64_t delta);
+
+  // Sets the element at `index` to `value`.
+  void Set(size_t index, uint32_t value) {
+    NTH_REQUIRE((v.debug), index < values_.size());
+    values_[index] =
+        shifts_.empty() ? value : value - BlockShift(index >> BlockBits);
+  }
+
+  // Replaces the elements with indices in `[first, last)` with those of
+  // `replacement`. This takes time proportional to the size of `replacement`
+  // (times the logarithm of the length of the sequence) if it has `last -
+  // first` elements, and otherwise time proportional to the length of the
+  // sequence.
+  void Replace(size_t first, size_t last, ShiftableOffsets const& replacement);
+
+  // Returns the index of the first element at or after `from` which is not
+  // less than (respectively, greater than) `value`. The elements in
+  // `[from, size())` must be sorted.
+  size_t lower_bound(uint32_t value, size_t from = 0) const;
+  size_t upper_bound(uint32_t value, size_t from = 0) const;
+
+  // Appending to a sequence which has been shifted first folds every shift
+  // into the stored elements, taking time proportional to its length.
+  void push_back(uint32_t value) {
+    Fold();
+    values_.push_back(value);
+  }
+  void Append(ShiftableOffsets const& other);
+  void assign(std::span<uint32_t const> values) {
+    shifts_.clear();
+    values_.assign(values.begin(), values.end());
+  }
+
+  // Returns a copy of the elements in order.
+  std::vector<uint32_t> values() const;
+
+  size_t capacity() const { return values_.capacity(); }
+  void reserve(size_t n) { values_.reserve(n); }
+  void clear() {
+    values_.clear();
+    shifts_.clear();
+  }
+
+  friend bool operator==(ShiftableOffsets const& lhs,
+                         ShiftableOffsets const& rhs);
+
+ private:
+  // Returns the sum of the shifts applied to blocks up to and including
+  // `block`.
+  uint32_t BlockShift(size_t block) const {
+    uint32_t total = 0;
+    for (size_t i = block + 1; i > 0; i &= i - 1) { total += shifts_[i - 1]; }
+    return total;
+  }
+
+  // Adds `delta` to the shift of each block from `block` onward.
+  void ShiftBlocks(size_t block, uint32_t delta) {
+    for (size_t i = block + 1; i <= shifts_.size(); i += i & (~i + 1)) {
+      shifts_[i - 1] += delta;
+    }
+  }
+
+  // Applies every shift to the stored elements and discards the shifts.
+  void Fold();
+
+  std::pmr::vector<uint32_t> values_;
+  // A Fenwick tree over blocks of `values_`, or empty if no shifts are pending.
+  std::vector<uint32_t> shifts_;
+};
+
+}  // namespace ic
+
+#endif  // ICARUS_LEXER_SHIFTABLE_OFFSETS_H
@@ -0,0 +1,110 @@
+#include "lexer/shiftable_offsets.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "nth/test/test.h"
+
+namespace ic {
+namespace {
+
+ShiftableOffsets Iota(uint32_t count, uint32_t step) {
+  ShiftableOffsets offsets;
+  for (uint32_t i = 0; i < count; ++i) { offsets.push_back(i * step); }
+  return offsets;
+}
+
+NTH_TEST("shiftable-offsets/shift") {
+  // Shifts starting both at and within a block, and after the last element.
+  for (size_t first : {size_t{0}, size_t{1}, ShiftableOffsets::BlockSize,
+                       ShiftableOffsets::BlockSize + 5, size_t{999},
+                       size_t{1000}}) {
+    ShiftableOffsets offsets = Iota(1000, 10);
+    offsets.Shift(first, 7);
+    offsets.Shift(first, -3);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      NTH_EXPECT(offsets[i] == i * 10 + (i >= first ? 4 : 0));
+    }
+  }
+}
+
+NTH_TEST("shiftable-offsets/matches-direct-updates") {
+  ShiftableOffsets offsets = Iota(3000, 4);
+  std::vector<uint32_t> expected = offsets.values();
+  uint32_t seed = 1;
+  for (int n = 0; n < 200; ++n) {
+    seed = seed * 1664525 + 1013904223;
+    size_t first  = seed % expected.size();
+    int64_t delta = static_cast<int64_t>(seed >> 28) - 8;
+    offsets.Shift(first, delta);
+    for (size_t i = first; i < expected.size(); ++i) { expected[i] += delta; }
+    offsets.Set(first, 17);
+    expected[first] = 17;
+  }
+  NTH_EXPECT(offsets.values() == expected);
+}
+
+NTH_TEST("shiftable-offsets/replace") {
+  ShiftableOffsets replacement;
+  replacement.push_back(1);
+  replacement.push_back(2);
+
+  // Same size.
+  ShiftableOffsets offsets = Iota(200, 10);
+  offsets.Shift(100, 5);
+  offsets.Replace(70, 72, replacement);
+  NTH_EXPECT(offsets.size() == 200);
+  NTH_EXPECT(offsets[69] == 690);
+  NTH_EXPECT(offsets[70] == 1);
+  NTH_EXPECT(offsets[71] == 2);
+  NTH_EXPECT(offsets[72] == 720);
+  NTH_EXPECT(offsets[100] == 1005);
+
+  // Different sizes.
+  offsets.Replace(70, 75, replacement);
+  NTH_ASSERT(offsets.size() == 197);
+  NTH_EXPECT(offsets[71] == 2);
+  NTH_EXPECT(offsets[72] == 750);
+  NTH_EXPECT(offsets[97] == 1005);
+  offsets.Replace(0, 0, replacement);
+  NTH_ASSERT(offsets.size() == 199);
+  NTH_EXPECT(offsets[0] == 1);
+  NTH_EXPECT(offsets[2] == 0);
+}
+
+NTH_TEST("shiftable-offsets/search") {
+  ShiftableOffsets offsets = Iota(500, 10);
+  offsets.Shift(250, 3);
+  NTH_EXPECT(offsets.lower_bound(0) == 0);
+  NTH_EXPECT(offsets.lower_bound(2500) == 250);
+  NTH_EXPECT(offsets.lower_bound(2491) == 250);
+  NTH_EXPECT(offsets.lower_bound(2503) == 250);
+  NTH_EXPECT(offsets.upper_bound(2503) == 251);
+  NTH_EXPECT(offsets.upper_bound(2490, 300) == 300);
+  NTH_EXPECT(offsets.lower_bound(100'000) == 500);
+}
+
+NTH_TEST("shiftable-offsets/append-and-equality") {
+  ShiftableOffsets offsets = Iota(100, 10);
+  offsets.Shift(50, 1);
+  ShiftableOffsets rest;
+  rest.push_back(2000);
+  offsets.Append(rest);
+  offsets.push_back(3000);
+  NTH_ASSERT(offsets.size() == 102);
+  NTH_EXPECT(offsets[49] == 490);
+  NTH_EXPECT(offsets[50] == 501);
+  NTH_EXPECT(offsets[100] == 2000);
+  NTH_EXPECT(offsets.back() == 3000);
+
+  ShiftableOffsets shifted = Iota(100, 10);
+  ShiftableOffsets direct  = Iota(100, 10);
+  shifted.Shift(10, 1);
+  for (size_t i = 10; i < 100; ++i) { direct.Set(i, i * 10 + 1); }
+  NTH_EXPECT(shifted == direct);
+  direct.Set(99, 0);
+  NTH_EXPECT(not(shifted == direct));
+}
+
+}  // namespace
+}  // namespace ic
@@ -6,27 +6,22 @@
 
 namespace ic {
 
-Token Token::IntegerLiteral(uint32_t offset, Integer n) {
+Token Token::IntegerLiteral(uint32_t offset, uint32_t payload) {
   Token token;
-  token.offset_  = offset;
-  token.kind_    = static_cast<uint8_t>(Kind::IntegerLiteral);
-  token.payload_ = Integer::ToRepresentation(n);
+  token.offset_ = offset;
+  token.kind_   = static_cast<uint8_t>(Kind::IntegerLiteral);
+  token.set_payload(payload);
   return token;
 }
 
 Token Token::StringLiteral(uint32_t offset, uint32_t index) {
   Token token;
-  token.offset_  = offset;
-  token.kind_    = static_cast<uint8_t>(Kind::StringLiteral);
-  token.payload_ = index;
+  token.offset_ = offset;
+  token.kind_   = static_cast<uint8_t>(Kind::StringLiteral);
+  token.set_payload(index);
   return token;
 }
 
-Integer Token::AsInteger() const {
-  NTH_REQUIRE((v.debug), kind() == Kind::IntegerLiteral);
-  return Integer::FromRepresentation(payload_);
-}
-
 bool Token::AsBoolean() const {
   switch (kind()) {
     case Kind::True: return true;
@@ -39,17 +34,15 @@ char Token::AsCharacterLiteral() const { return payload_; }
 
 uint32_t Token::AsStringLiteralIndex() const {
   NTH_REQUIRE(kind() == Kind::StringLiteral);
+  NTH_REQUIRE((v.harden), not has_wide_payload());
   return payload_;
 }
 
 Token Token::Identifier(uint32_t offset, ic::Identifier identifier_index) {
-  uint32_t rep = Identifier::ToRepresentation(identifier_index);
-  NTH_REQUIRE((v.debug), rep < PayloadLimit);
-
   Token token;
-  token.offset_  = offset;
-  token.kind_    = static_cast<uint8_t>(Kind::Identifier);
-  token.payload_ = Identifier::ToRepresentation(identifier_index);
+  token.offset_ = offset;
+  token.kind_   = static_cast<uint8_t>(Kind::Identifier);
+  token.set_payload(Identifier::ToRepresentation(identifier_index));
   return token;
 }
 
@@ -93,15 +86,16 @@ Token Token::Invalid() {
 
 ic::Identifier Token::Identifier() const {
   NTH_REQUIRE((v.debug), kind() == Kind::Identifier);
+  NTH_REQUIRE((v.harden), not has_wide_payload());
   return ic::Identifier::FromRepresentation(payload_);
 }
 
 Token Token::CloseSymbol(Token::Kind kind, uint32_t open_index,
                          uint32_t offset) {
   Token token;
-  token.kind_    = static_cast<uint8_t>(kind);
-  token.offset_  = offset;
-  token.payload_ = open_index;
+  token.kind_   = static_cast<uint8_t>(kind);
+  token.offset_ = offset;
+  token.set_payload(open_index);
   return token;
 }
 
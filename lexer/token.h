@@ -23,6 +23,16 @@ struct Token {
  public:
   static constexpr uint32_t PayloadLimit = uint32_t{1} << PayloadBits;
 
+  // Payloads which index other tokens (the matching symbol of an open or close
+  // symbol) grow with the length of the source, those of integer literals may
+  // hold their values directly, and those of identifiers and string literals
+  // index process-wide tables which grow with the number of distinct values
+  // interned. None of these need fit in a `Token`. Such payloads are stored in
+  // the token as `WidePayload`, and their value is available from the
+  // `TokenBuffer` holding the token (see `TokenBuffer::payload`,
+  // `TokenBuffer::identifier` and `TokenBuffer::string_literal_index`).
+  static constexpr uint32_t WidePayload = PayloadLimit - 1;
+
   // A categorization describing the token.
   enum class Kind : uint8_t {
 #define IC_XMACRO_TOKEN_KIND(kind) kind,
@@ -33,19 +43,25 @@ struct Token {
 
   constexpr uint32_t offset() const { return offset_; }
 
-  constexpr void set_payload(uint32_t payload) { payload_ = payload; }
+  constexpr void set_payload(uint32_t payload) {
+    payload_ = payload < WidePayload ? payload : WidePayload;
+  }
   constexpr uint32_t payload() const { return payload_; }
+  constexpr bool has_wide_payload() const { return payload_ == WidePayload; }
 
-  // Constructs an integer token at the given offset.
-  static Token IntegerLiteral(uint32_t offset, Integer n);
+  // Constructs an integer token at the given offset with the given payload, as
+  // computed by `TokenBuffer::IntegerLiteralPayload`.
+  static Token IntegerLiteral(uint32_t offset, uint32_t payload);
 
-  // Constructs a string-literal token at the given offset.
+  // Constructs a string-literal token at the given offset. If `index` does not
+  // fit, the token holds `WidePayload`.
   static Token StringLiteral(uint32_t offset, uint32_t index);
 
   // Constructs a character-literal token at the given offset.
   static Token CharacterLiteral(char c, uint32_t offset);
 
-  // Constructs an identifier token at the given offset.
+  // Constructs an identifier token at the given offset. If the representation
+  // of `id` does not fit, the token holds `WidePayload`.
   static Token Identifier(uint32_t offset, Identifier id);
 
   // Constructs a symbol token with the given kind at the given `offset`.
@@ -57,19 +73,30 @@ struct Token {
   static Token CloseSymbol(Token::Kind token, uint32_t open_index,
                            uint32_t offset);
 
+  // Constructs a token from its constituent parts, as stored by a
+  // `TokenBuffer`. Payloads which do not fit are stored as `WidePayload`.
+  static constexpr Token FromParts(Kind k, uint32_t offset, uint32_t payload) {
+    Token token;
+    token.offset_ = offset;
+    token.kind_   = static_cast<uint8_t>(k);
+    token.set_payload(payload);
+    return token;
+  }
+
   // Constructs a token representing the end of the lex-stream.
   static Token Eof();
 
   // Constructs an invalid token that may not appear in a correct lex-stream.
   static Token Invalid();
 
+  // Returns the identifier held by this token, which must not have a wide
+  // payload. Prefer `TokenBuffer::identifier` when the buffer is available.
   ic::Identifier Identifier() const;
 
 #define IC_XMACRO_TOKEN_KIND_KEYWORD(kind, keyword)                            \
   static Token Keyword##kind(uint32_t offset);
 #include "lexer/token_kind.xmacro.h"
 
-  Integer AsInteger() const;
   bool AsBoolean() const;
   char AsCharacterLiteral() const;
   uint32_t AsStringLiteralIndex() const;
@@ -80,8 +107,6 @@ struct Token {
 
     switch (t.kind()) {
       case Token::Kind::IntegerLiteral:
-        nth::Interpolate<" {}">(p, f, Integer::FromRepresentation(t.payload_));
-        break;
       case Token::Kind::StringLiteral:
       case Token::Kind::Identifier:
         nth::Interpolate<" #{}">(p, f, t.payload_);
@@ -100,9 +125,9 @@ struct Token {
   }
 
  private:
-  uint32_t offset_;
-  uint32_t kind_ : 8;
-  uint32_t payload_ : PayloadBits;
+  uint32_t offset_                = 0;
+  uint32_t kind_ : 8              = 0;
+  uint32_t payload_ : PayloadBits = 0;
 };
 static_assert(sizeof(Token) == 8);
 
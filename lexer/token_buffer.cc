@@ -1,43 +1,86 @@
 #include "lexer/token_buffer.h"
 
+#include <algorithm>
+#include <utility>
+#include <optional>
+
 #include "common/resources.h"
+#include "lexer/integer_literal.h"
+#include "lexer/token_kind_table.h"
+#include "nth/debug/debug.h"
 #include "nth/debug/log/log.h"
-#include "nth/numeric/integer.h"
 
 namespace ic {
 
-void TokenBuffer::AppendIntegerLiteral(std::string_view integer,
-                                       uint32_t offset) {
-  nth::integer value = 0;
-  for (char c : integer) {
-    if (c == '_') { continue; }
-    value = value * 10 + (c - '0');
+uint32_t TokenBuffer::IntegerLiteralPayload(std::string_view integer) {
+  if (std::optional<uint64_t> n = lex::ParseIntegerLiteral64(integer);
+      n and *n < InlineIntegerLimit) {
+    return static_cast<uint32_t>(*n);
   }
+  return InlineIntegerLimit + lex::IntegerLiterals().index(integer);
+}
+
+lex::IntegerLiteralValue TokenBuffer::integer_literal(size_t index) const {
+  NTH_REQUIRE((v.debug), kinds_[index] == Token::Kind::IntegerLiteral);
+  uint32_t payload = payloads_[index];
+  if (payload < InlineIntegerLimit) { return uint64_t{payload}; }
+  return lex::IntegerLiterals()[payload - InlineIntegerLimit];
+}
 
-  tokens_.push_back(Token::IntegerLiteral(offset, std::move(value)));
+uint32_t TokenBuffer::StringLiteralPayload(std::string_view s) {
+  return resources.StringLiteralIndex(s);
 }
 
 void TokenBuffer::AppendStringLiteral(std::string s, uint32_t offset) {
-  uint32_t index = resources.StringLiteralIndex(std::move(s));
-  tokens_.push_back(Token::StringLiteral(offset, index));
+  Append(Token::Kind::StringLiteral, offset, StringLiteralPayload(s));
 }
 
 void TokenBuffer::AppendKeywordOrIdentifier(std::string_view identifier,
                                             uint32_t offset) {
-#define IC_XMACRO_TOKEN_KIND_KEYWORD(kind, keyword)                            \
-  if (identifier == keyword) {                                                 \
-    tokens_.push_back(Token::Keyword##kind(offset));                           \
-    return;                                                                    \
+  if (auto kind = lex::LookupKeyword(identifier)) {
+    Append(Token::Symbol(*kind, offset));
+  } else {
+    AppendIdentifier(Identifier(identifier), offset);
   }
-#include "lexer/token_kind.xmacro.h"
+}
 
-  tokens_.push_back(Token::Identifier(offset, Identifier(identifier)));
+TokenEdit TokenBuffer::Splice(size_t first, size_t last,
+                              uint32_t begin_offset, uint32_t end_offset,
+                              TokenBuffer const& replacement,
+                              int64_t offset_delta) {
+  NTH_REQUIRE((v.harden), first <= last);
+  NTH_REQUIRE((v.harden), last <= size());
+  auto replace = [&](auto& v, auto const& r) {
+    if (r.size() == last - first) {
+      std::copy(r.begin(), r.end(), v.begin() + first);
+    } else {
+      auto position = v.erase(v.begin() + first, v.begin() + last);
+      v.insert(position, r.begin(), r.end());
+    }
+  };
+  replace(kinds_, replacement.kinds_);
+  replace(payloads_, replacement.payloads_);
+  offsets_.Replace(first, last, replacement.offsets_);
+  size_t shifted = first + replacement.size();
+  offsets_.Shift(shifted, offset_delta);
+  if (shifted < size() and kinds_.back() == Token::Kind::Eof) {
+    // The end-of-file token does not move.
+    offsets_.Shift(size() - 1, -offset_delta);
+  }
+  line_table_.Splice(begin_offset, end_offset, replacement.line_table_,
+                     offset_delta);
+  return {.first        = first,
+          .old_end      = last,
+          .new_end      = first + replacement.size(),
+          .offset_delta = offset_delta};
 }
 
 void TokenBuffer::AppendClose(Token::Kind kind, uint32_t open_index,
                               uint32_t offset) {
-  tokens_[open_index].set_payload(tokens_.size());
-  tokens_.push_back(Token::CloseSymbol(kind, open_index, offset));
+  payloads_[open_index] = size();
+  kinds_.push_back(kind);
+  offsets_.push_back(offset);
+  payloads_.push_back(open_index);
 }
 
 }  // namespace ic
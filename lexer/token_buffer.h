@@ -1,31 +1,194 @@
 #ifndef ICARUS_LEXER_TOKEN_BUFFER_H
 #define ICARUS_LEXER_TOKEN_BUFFER_H
 
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "diagnostics/consumer/consumer.h"
+#include "lexer/integer_literal.h"
+#include "lexer/line_table.h"
+#include "lexer/shiftable_offsets.h"
 #include "lexer/token.h"
-#include "nth/container/flyweight_set.h"
+#include "nth/debug/debug.h"
 #include "nth/io/string_printer.h"
 
 namespace ic {
 
+// Describes how the tokens of a buffer changed when it was edited: The tokens
+// with indices in `[first, old_end)` were replaced by those now with indices in
+// `[first, new_end)`. Every later token other than the end-of-file token was
+// moved `offset_delta` bytes through the source, and has an index which differs
+// by `new_end - old_end`.
+struct TokenEdit {
+  size_t first;
+  size_t old_end;
+  size_t new_end;
+  int64_t offset_delta;
+};
+
+// Stores the tokens of a lexed source. Tokens are stored as a
+// struct-of-arrays: their kinds, offsets and payloads are each held in a
+// separate dense array, so that a scan which only inspects kinds (as much of
+// the parser does) touches one byte per token rather than eight.
+//
+// Offsets are stored as `ShiftableOffsets`, so that an edit which does not
+// change the number of tokens can move every later token in time logarithmic
+// in the number of tokens (see `Splice`).
+//
+// Payloads are stored at their full width, so the index of the symbol matching
+// an open or close symbol, or of an identifier or string literal in its
+// interning table, is available from the buffer even when it exceeds
+// `Token::PayloadLimit` (in which case the `Token` itself holds
+// `Token::WidePayload`).
 struct TokenBuffer {
-  using const_iterator = std::vector<Token>::const_iterator;
+  struct const_iterator;
+
+  TokenBuffer() = default;
+
+  // Constructs an empty token buffer whose tokens are allocated from
+  // `memory_resource`.
+  explicit TokenBuffer(std::pmr::memory_resource* memory_resource)
+      : kinds_(memory_resource),
+        offsets_(memory_resource),
+        payloads_(memory_resource) {}
 
-  void Append(Token token) { tokens_.push_back(token); }
+  void Append(Token token) {
+    Append(token.kind(), token.offset(), token.payload());
+  }
+  // Appends a token of kind `kind` at `offset` whose payload, which need not
+  // fit in a `Token`, is `payload`.
+  void Append(Token::Kind kind, uint32_t offset, uint32_t payload) {
+    kinds_.push_back(kind);
+    offsets_.push_back(offset);
+    payloads_.push_back(payload);
+  }
   void AppendClose(Token::Kind kind, uint32_t open_index, uint32_t offset);
 
-  void AppendIntegerLiteral(std::string_view integer, uint32_t offset);
+  void AppendIntegerLiteral(std::string_view integer, uint32_t offset) {
+    Append(Token::Kind::IntegerLiteral, offset, IntegerLiteralPayload(integer));
+  }
   void AppendStringLiteral(std::string s, uint32_t offset);
+  void AppendIdentifier(Identifier identifier, uint32_t offset) {
+    Append(Token::Kind::Identifier, offset,
+           Identifier::ToRepresentation(identifier));
+  }
   void AppendKeywordOrIdentifier(std::string_view identifier, uint32_t offset);
 
-  Token operator[](size_t index) const { return tokens_[index]; }
-  size_t size() const { return tokens_.size(); }
+  // Integer literals less than `InlineIntegerLimit` are held directly as the
+  // payload of their token, so that the common case involves no table at all.
+  // The payload of any other integer literal is `InlineIntegerLimit` plus the
+  // index of its value in `lex::IntegerLiterals()`.
+  static constexpr uint32_t InlineIntegerLimit = uint32_t{1} << 31;
+
+  // Returns the payload of an integer literal spelled `integer` (including any
+  // radix prefix).
+  static uint32_t IntegerLiteralPayload(std::string_view integer);
+
+  // Returns the payload of a string literal whose contents (after processing
+  // escape sequences) are `s`.
+  static uint32_t StringLiteralPayload(std::string_view s);
+
+  Token operator[](size_t index) const {
+    return Token::FromParts(kinds_[index], offsets_[index], payloads_[index]);
+  }
+  size_t size() const { return kinds_.size(); }
+
+  Token::Kind kind(size_t index) const { return kinds_[index]; }
+  uint32_t offset(size_t index) const { return offsets_[index]; }
+  uint32_t payload(size_t index) const { return payloads_[index]; }
+
+  // Returns the value of the integer literal token at `index`.
+  lex::IntegerLiteralValue integer_literal(size_t index) const;
+
+  // Returns the identifier held by the identifier token at `index`.
+  Identifier identifier(size_t index) const {
+    NTH_REQUIRE((v.debug), kinds_[index] == Token::Kind::Identifier);
+    return Identifier::FromRepresentation(payloads_[index]);
+  }
+
+  // Returns the index in `resources` of the string literal token at `index`.
+  uint32_t string_literal_index(size_t index) const {
+    NTH_REQUIRE((v.debug), kinds_[index] == Token::Kind::StringLiteral);
+    return payloads_[index];
+  }
+
+  // Sets the payload of the token at `index`, which need not fit in a `Token`.
+  void set_payload(size_t index, uint32_t payload) {
+    payloads_[index] = payload;
+  }
+
+  // The kind, offset and payload of each token, in order. Offsets are not
+  // stored contiguously once the buffer has been spliced, so they are copied.
+  std::span<Token::Kind const> kinds() const { return kinds_; }
+  std::vector<uint32_t> offsets() const { return offsets_.values(); }
+  std::span<uint32_t const> payloads() const { return payloads_; }
+
+  // Returns the index of the first token at or after `from` whose offset is not
+  // less than `offset`, or `size()` if there is no such token. The end-of-file
+  // token's offset is greater than every other.
+  size_t lower_bound(uint32_t offset, size_t from = 0) const {
+    return offsets_.lower_bound(offset, from);
+  }
+
+  // Replaces the tokens with those whose kinds, offsets and payloads are the
+  // corresponding elements of `kinds`, `offsets` and `payloads`, as returned by
+  // the accessors above for some buffer. The line table is left unchanged.
+  void Assign(std::span<Token::Kind const> kinds,
+              std::span<uint32_t const> offsets,
+              std::span<uint32_t const> payloads) {
+    NTH_REQUIRE((v.harden), kinds.size() == offsets.size());
+    NTH_REQUIRE((v.harden), kinds.size() == payloads.size());
+    kinds_.assign(kinds.begin(), kinds.end());
+    offsets_.assign(offsets);
+    payloads_.assign(payloads.begin(), payloads.end());
+  }
+
+  // Replaces the tokens with indices in `[first, last)` with those of
+  // `replacement`, and the line starts in `(begin_offset, end_offset]` with
+  // those of `replacement`. The offsets of later tokens (other than the
+  // end-of-file token) and line starts are shifted by `offset_delta`. Payloads
+  // are copied verbatim, so any open and close symbols must be re-paired by the
+  // caller. Returns a description of the replacement.
+  //
+  // If the number of tokens and of lines is unchanged, this takes time
+  // proportional to the size of `replacement` and logarithmic in the size of
+  // the buffer. Otherwise later tokens must be moved within their arrays,
+  // taking time linear in their number.
+  TokenEdit Splice(size_t first, size_t last, uint32_t begin_offset,
+              uint32_t end_offset, TokenBuffer const& replacement,
+              int64_t offset_delta);
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // Records that a line of the source begins at `offset`.
+  void AddLineStart(uint32_t offset) { line_table_.AddLineStart(offset); }
+  void AppendLineTable(LineTable const& table) { line_table_.Append(table); }
 
-  auto begin() const { return tokens_.begin(); }
-  auto end() const { return tokens_.end(); }
+  // Returns the offsets at which each line of the lexed source begins.
+  LineTable const& line_table() const { return line_table_; }
+
+  size_t capacity() const { return kinds_.capacity(); }
+  void reserve(size_t n) {
+    kinds_.reserve(n);
+    offsets_.reserve(n);
+    payloads_.reserve(n);
+  }
+
+  void clear() {
+    kinds_.clear();
+    offsets_.clear();
+    payloads_.clear();
+    line_table_.clear();
+  }
 
   friend void NthPrint(auto& printer, TokenBuffer const& token_buffer);
 
@@ -33,16 +196,94 @@ struct TokenBuffer {
   friend TokenBuffer Lex(std::string_view source,
                          diag::DiagnosticConsumer& diagnostic_consumer);
 
-  std::vector<Token> tokens_;
+  std::pmr::vector<Token::Kind> kinds_;
+  ShiftableOffsets offsets_;
+  std::pmr::vector<uint32_t> payloads_;
+  LineTable line_table_;
+};
+
+// A random-access iterator over a `TokenBuffer`, yielding `Token`s by value.
+struct TokenBuffer::const_iterator {
+  using value_type        = Token;
+  using reference         = Token;
+  using difference_type   = ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+  const_iterator() = default;
+
+  Token operator*() const { return (*buffer_)[index_]; }
+  Token operator[](difference_type n) const { return (*buffer_)[index_ + n]; }
+
+  const_iterator& operator++() {
+    ++index_;
+    return *this;
+  }
+  const_iterator operator++(int) {
+    auto copy = *this;
+    ++index_;
+    return copy;
+  }
+  const_iterator& operator--() {
+    --index_;
+    return *this;
+  }
+  const_iterator operator--(int) {
+    auto copy = *this;
+    --index_;
+    return copy;
+  }
+  const_iterator& operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+  const_iterator& operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+  friend const_iterator operator+(const_iterator i, difference_type n) {
+    return i += n;
+  }
+  friend const_iterator operator+(difference_type n, const_iterator i) {
+    return i += n;
+  }
+  friend const_iterator operator-(const_iterator i, difference_type n) {
+    return i -= n;
+  }
+  friend difference_type operator-(const_iterator lhs, const_iterator rhs) {
+    return static_cast<difference_type>(lhs.index_) -
+           static_cast<difference_type>(rhs.index_);
+  }
+
+  friend bool operator==(const_iterator lhs, const_iterator rhs) {
+    return lhs.index_ == rhs.index_;
+  }
+  friend auto operator<=>(const_iterator lhs, const_iterator rhs) {
+    return lhs.index_ <=> rhs.index_;
+  }
+
+ private:
+  friend TokenBuffer;
+  explicit const_iterator(TokenBuffer const* buffer, size_t index)
+      : buffer_(buffer), index_(index) {}
+
+  TokenBuffer const* buffer_ = nullptr;
+  size_t index_              = 0;
 };
 
+inline TokenBuffer::const_iterator TokenBuffer::begin() const {
+  return const_iterator(this, 0);
+}
+inline TokenBuffer::const_iterator TokenBuffer::end() const {
+  return const_iterator(this, size());
+}
+
 void NthPrint(auto& printer, TokenBuffer const& token_buffer) {
   nth::universal_formatter f({
       .depth    = 5,
       .fallback = "...",
   });
 
-  for (auto const& token : token_buffer.tokens_) {
+  for (Token token : token_buffer) {
     nth::Interpolate<"\n  {}">(printer, f, token);
   }
 }
@@ -0,0 +1,203 @@
+#ifndef ICARUS_LEXER_TOKEN_KIND_TABLE_H
+#define ICARUS_LEXER_TOKEN_KIND_TABLE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "lexer/token.h"
+
+namespace ic::lex {
+namespace internal_token_kind_table {
+
+struct Spelling {
+  std::string_view text;
+  Token::Kind kind;
+};
+
+inline constexpr std::array Keywords{
+#define IC_XMACRO_TOKEN_KIND_KEYWORD(k, keyword)                               \
+  Spelling{.text = keyword, .kind = Token::Kind::k},
+#include "lexer/token_kind.xmacro.h"
+};
+
+inline constexpr std::array Operators{
+#define IC_XMACRO_TOKEN_KIND_OPERATOR(k, symbol)                               \
+  Spelling{.text = symbol, .kind = Token::Kind::k},
+#include "lexer/token_kind.xmacro.h"
+};
+
+// Keywords are looked up in an open-addressed table indexed by a perfect hash
+// of the keyword's length and its first, second, and last characters. The hash
+// is parameterized by a seed which is searched for at compile-time so that no
+// two keywords collide. Because the hash only inspects a few characters, a
+// lookup must still compare the full spelling against the table entry.
+inline constexpr size_t KeywordTableSize = 128;
+
+constexpr uint32_t KeywordHash(std::string_view s, uint32_t seed) {
+  uint32_t h = (seed ^ static_cast<uint32_t>(s.size())) * 0x01000193;
+  for (char c : {s[0], s.size() > 1 ? s[1] : '\0', s.back()}) {
+    h = (h ^ static_cast<uint8_t>(c)) * 0x01000193;
+  }
+  return (h ^ (h >> 15)) % KeywordTableSize;
+}
+
+constexpr bool HashIsPerfect(uint32_t seed) {
+  std::array<bool, KeywordTableSize> occupied{};
+  for (auto const& keyword : Keywords) {
+    uint32_t h = KeywordHash(keyword.text, seed);
+    if (occupied[h]) { return false; }
+    occupied[h] = true;
+  }
+  return true;
+}
+
+inline constexpr uint32_t KeywordHashSeed = [] {
+  uint32_t seed = 0;
+  while (not HashIsPerfect(seed)) { ++seed; }
+  return seed;
+}();
+
+struct KeywordTableEntry {
+  std::string_view text;
+  Token::Kind kind = Token::Kind::Identifier;
+};
+
+inline constexpr std::array<KeywordTableEntry, KeywordTableSize> KeywordTable =
+    [] {
+      std::array<KeywordTableEntry, KeywordTableSize> table{};
+      for (auto const& keyword : Keywords) {
+        table[KeywordHash(keyword.text, KeywordHashSeed)] = {
+            .text = keyword.text,
+            .kind = keyword.kind,
+        };
+      }
+      return table;
+    }();
+
+inline constexpr auto KeywordLengths = [] {
+  std::pair<size_t, size_t> lengths(Keywords[0].text.size(),
+                                    Keywords[0].text.size());
+  for (auto const& keyword : Keywords) {
+    lengths.first  = std::min(lengths.first, keyword.text.size());
+    lengths.second = std::max(lengths.second, keyword.text.size());
+  }
+  return lengths;
+}();
+
+// Operators are recognized by a deterministic finite automaton built from the
+// trie of operator spellings. Characters are first mapped to a small set of
+// equivalence classes (one per character appearing in any operator, and a
+// class zero for everything else) to keep the transition table compact.
+// State zero is the start state, and a transition to state zero means there is
+// no transition. States which do not accept any operator are marked as
+// accepting `Token::Kind::Invalid`.
+inline constexpr auto OperatorCharacterClasses = [] {
+  std::array<uint8_t, 256> classes{};
+  uint8_t next = 1;
+  for (auto const& op : Operators) {
+    for (char c : op.text) {
+      uint8_t& cls = classes[static_cast<uint8_t>(c)];
+      if (cls == 0) { cls = next++; }
+    }
+  }
+  return classes;
+}();
+
+inline constexpr size_t OperatorCharacterClassCount = [] {
+  uint8_t max = 0;
+  for (uint8_t c : OperatorCharacterClasses) { max = std::max(max, c); }
+  return size_t{max} + 1;
+}();
+
+inline constexpr size_t OperatorStateCount = [] {
+  size_t count = 1;
+  for (auto const& op : Operators) { count += op.text.size(); }
+  return count;
+}();
+
+struct OperatorAutomaton {
+  std::array<std::array<uint8_t, OperatorCharacterClassCount>,
+             OperatorStateCount>
+      transitions{};
+  std::array<Token::Kind, OperatorStateCount> accepting = [] {
+    std::array<Token::Kind, OperatorStateCount> accepting;
+    accepting.fill(Token::Kind::Invalid);
+    return accepting;
+  }();
+};
+
+inline constexpr OperatorAutomaton OperatorDfa = [] {
+  static_assert(OperatorStateCount <= 256);
+  OperatorAutomaton dfa;
+  uint8_t next = 1;
+  for (auto const& op : Operators) {
+    uint8_t state = 0;
+    for (char c : op.text) {
+      uint8_t& target =
+          dfa.transitions[state][OperatorCharacterClasses[static_cast<uint8_t>(
+              c)]];
+      if (target == 0) { target = next++; }
+      state = target;
+    }
+    dfa.accepting[state] = op.kind;
+  }
+  return dfa;
+}();
+
+}  // namespace internal_token_kind_table
+
+// Returns the kind of the keyword spelled by `identifier`, if there is one, and
+// `std::nullopt` otherwise.
+constexpr std::optional<Token::Kind> LookupKeyword(std::string_view identifier) {
+  namespace internal = internal_token_kind_table;
+  if (identifier.size() < internal::KeywordLengths.first or
+      identifier.size() > internal::KeywordLengths.second) {
+    return std::nullopt;
+  }
+  auto const& entry = internal::KeywordTable[internal::KeywordHash(
+      identifier, internal::KeywordHashSeed)];
+  if (entry.text != identifier) { return std::nullopt; }
+  return entry.kind;
+}
+
+struct OperatorMatch {
+  Token::Kind kind;
+  uint32_t length = 0;
+};
+
+// Returns the longest operator spelling which is a prefix of `source` along
+// with its length. If no operator is a prefix of `source`, the returned
+// `length` is zero.
+constexpr OperatorMatch MatchOperator(std::string_view source) {
+  namespace internal = internal_token_kind_table;
+  OperatorMatch match{.kind = Token::Kind::Invalid};
+  uint8_t state = 0;
+  for (uint32_t i = 0; i < source.size(); ++i) {
+    state = internal::OperatorDfa.transitions[state]
+                                             [internal::OperatorCharacterClasses
+                                                  [static_cast<uint8_t>(
+                                                      source[i])]];
+    if (state == 0) { break; }
+    if (Token::Kind kind = internal::OperatorDfa.accepting[state];
+        kind != Token::Kind::Invalid) {
+      match = {.kind = kind, .length = i + 1};
+    }
+  }
+  return match;
+}
+
+#define IC_XMACRO_TOKEN_KIND_KEYWORD(k, keyword)                               \
+  static_assert(LookupKeyword(keyword) == Token::Kind::k);
+#define IC_XMACRO_TOKEN_KIND_OPERATOR(k, symbol)                               \
+  static_assert(MatchOperator(symbol).kind == Token::Kind::k and               \
+                MatchOperator(symbol).length ==                                \
+                    std::string_view(symbol).size());
+#include "lexer/token_kind.xmacro.h"
+
+}  // namespace ic::lex
+
+#endif  // ICARUS_LEXER_TOKEN_KIND_TABLE_H
@@ -21,12 +21,13 @@ inline constexpr auto HasKind = nth::debug::MakeProperty<"has-kind">(
     });
 
 // Matches a token representing an integer holding `number` as its immediate
-// value.
+// value. Only integers small enough to be held directly in the payload of a
+// `Token` can be matched.
 inline constexpr auto HasIntegerValue =
     nth::debug::MakeProperty<"has-integer-value">(
-        [](auto const &value, Integer number) {
+        [](auto const &value, uint32_t number) {
           return value.kind() == Token::Kind::IntegerLiteral and
-                 value.AsInteger() == number;
+                 not value.has_wide_payload() and value.payload() == number;
         });
 
 // Matches a token representing a boolean value holding `b`.
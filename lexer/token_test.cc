@@ -37,13 +37,25 @@ NTH_TEST("token/value") {
   NTH_EXPECT(Token::Symbol(Token::Kind::Colon, 4).offset() == 4);
 }
 
+NTH_TEST("token/wide-payload") {
+  Token narrow = Token::CloseSymbol(Token::Kind::RightParen, 3, 0);
+  NTH_EXPECT(narrow.payload() == 3);
+  NTH_EXPECT(not narrow.has_wide_payload());
+
+  Token wide =
+      Token::CloseSymbol(Token::Kind::RightParen, Token::PayloadLimit + 3, 0);
+  NTH_EXPECT(wide.payload() == Token::WidePayload);
+  NTH_EXPECT(wide.has_wide_payload());
+
+  NTH_EXPECT(
+      Token::StringLiteral(0, Token::PayloadLimit + 3).has_wide_payload());
+}
+
 NTH_TEST("token/print") {
   NTH_EXPECT(AsString(Token::Identifier(5, Identifier("a"))) ==
              "[tk.Identifier @5 #3]");
-  NTH_EXPECT(AsString(Token::IntegerLiteral(5, 9'000'000'000)) ==
-             "[tk.IntegerLiteral @5 0x218711a00]");
   NTH_EXPECT(AsString(Token::IntegerLiteral(5, 3)) ==
-             "[tk.IntegerLiteral @5 0x3]");
+             "[tk.IntegerLiteral @5 #3]");
   NTH_EXPECT(AsString(Token::Symbol(Token::Kind::Colon, 3)) == "[tk.(:) @3]");
 }
 
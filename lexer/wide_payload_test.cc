@@ -0,0 +1,44 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "common/identifier.h"
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "lexer/token.h"
+#include "nth/test/test.h"
+
+namespace ic::lex {
+namespace {
+
+// Lexes more distinct identifiers than the payload of a `Token` can index, so
+// that the later ones are only available from the `TokenBuffer`.
+NTH_TEST("lex/wide-identifiers") {
+  constexpr size_t Count = size_t{Token::PayloadLimit} + 1024;
+  std::string source;
+  source.reserve(Count * 10);
+  for (size_t i = 0; i < Count; ++i) {
+    source.append("v");
+    source.append(std::to_string(i));
+    source.append("\n");
+  }
+
+  diag::NullConsumer d;
+  auto token_buffer = Lex(source, d);
+  NTH_ASSERT(token_buffer.size() == 2 * Count + 1);
+
+  size_t wide = 0;
+  for (size_t i = 0; i < token_buffer.size(); i += 2) {
+    if (token_buffer.kind(i) == Token::Kind::Eof) { break; }
+    NTH_ASSERT(token_buffer.kind(i) == Token::Kind::Identifier);
+    std::string_view spelling = source.substr(token_buffer.offset(i));
+    spelling = spelling.substr(0, spelling.find('\n'));
+    NTH_ASSERT(static_cast<std::string_view>(token_buffer.identifier(i)) ==
+               spelling);
+    if (token_buffer[i].has_wide_payload()) { ++wide; }
+  }
+  NTH_EXPECT(wide >= 1024);
+}
+
+}  // namespace
+}  // namespace ic::lex
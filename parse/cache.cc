@@ -0,0 +1,284 @@
+#include "parse/cache.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "common/identifier.h"
+#include "common/mapped_file.h"
+#include "common/resources.h"
+#include "lexer/lexer.h"
+#include "lexer/token.h"
+#include "nth/debug/debug.h"
+#include "parse/node.h"
+
+namespace ic {
+namespace {
+
+// Incremented whenever the layout of a cache file changes in a way not
+// captured by `FormatFingerprint`.
+constexpr uint64_t FormatVersion = 3;
+constexpr uint64_t Magic         = 0x6568636163707369;  // "ispcache"
+
+// The kinds of tokens whose payloads index a process-wide interning table, in
+// the order their tables are stored.
+constexpr std::array InternedKinds = {
+    Token::Kind::Identifier,
+    Token::Kind::StringLiteral,
+    Token::Kind::IntegerLiteral,
+};
+
+struct Header {
+  uint64_t magic;
+  uint64_t format;
+  uint64_t source_hash;
+  uint64_t source_size;
+  uint64_t token_count;
+  uint64_t node_count;
+  uint64_t scope_count;
+  std::array<uint64_t, InternedKinds.size()> interned_count;
+  uint64_t text_size;
+};
+
+// Records the value behind the payload of an interned token: The next `size`
+// bytes of text.
+struct Interned {
+  uint32_t payload;
+  uint32_t size;
+};
+
+// Returns a hash of everything on which the in-memory representation of a
+// cache file depends, so that files written by a compiler disagreeing on any
+// of it are rejected.
+uint64_t FormatFingerprint() {
+  static uint64_t const fingerprint = [] {
+    CacheFormat format(FormatVersion);
+    for (size_t size : {sizeof(Header), sizeof(ParseNode), sizeof(Token),
+                        sizeof(LexicalScope), sizeof(Interned)}) {
+      format.add_size(size);
+    }
+#define IC_XMACRO_PARSE_NODE(kind) format.add_name("p." #kind);
+#include "parse/node.xmacro.h"
+#define IC_XMACRO_TOKEN_KIND(kind) format.add_name("tk." #kind);
+#include "lexer/token_kind.xmacro.h"
+    return format.fingerprint();
+  }();
+  return fingerprint;
+}
+
+size_t PaddedSize(size_t size) { return (size + 7) & ~size_t{7}; }
+
+// Returns the size of the cache file described by `header`.
+size_t FileSize(Header const& header) {
+  size_t entries = 0;
+  for (uint64_t count : header.interned_count) { entries += count; }
+  return sizeof(Header) +
+         PaddedSize(header.token_count * sizeof(Token::Kind)) +
+         2 * PaddedSize(header.token_count * sizeof(uint32_t)) +
+         PaddedSize(header.node_count * sizeof(ParseNode)) +
+         PaddedSize(header.scope_count * sizeof(LexicalScope)) +
+         entries * sizeof(Interned) + header.text_size + header.source_size;
+}
+
+// Returns the value behind the payload of the token at `index` in
+// `token_buffer`, which was lexed from `source` and whose kind is one of
+// `InternedKinds`.
+std::string_view InternedValue(std::string_view source,
+                               TokenBuffer const& token_buffer, size_t index) {
+  switch (token_buffer.kind(index)) {
+    case Token::Kind::Identifier:
+      return static_cast<std::string_view>(token_buffer.identifier(index));
+    case Token::Kind::StringLiteral:
+      return resources.StringLiteral(token_buffer.string_literal_index(index));
+    case Token::Kind::IntegerLiteral:
+      return lex::IntegerLiteralSpelling(source, token_buffer.offset(index));
+    default: NTH_UNREACHABLE();
+  }
+}
+
+// Interns `value` as the lexer would for a token of kind `kind`, returning the
+// resulting payload.
+uint32_t Intern(Token::Kind kind, std::string_view value) {
+  switch (kind) {
+    case Token::Kind::Identifier:
+      return Identifier::ToRepresentation(Identifier(value));
+    case Token::Kind::StringLiteral:
+      return resources.StringLiteralIndex(value);
+    case Token::Kind::IntegerLiteral:
+      return TokenBuffer::IntegerLiteralPayload(value);
+    default: NTH_UNREACHABLE();
+  }
+}
+
+}  // namespace
+
+std::optional<nth::file_path> ParseCachePath(nth::file_path const& directory,
+                                             std::string_view source) {
+  char name[sizeof("0123456789abcdef.icp")];
+  std::snprintf(name, sizeof(name), "%016llx.icp",
+                static_cast<unsigned long long>(SourceHash(source)));
+  return nth::file_path::try_construct(
+      (std::filesystem::path(directory.path()) / name).string());
+}
+
+bool WriteParseCache(nth::file_path const& path, std::string_view source,
+                     TokenBuffer const& token_buffer,
+                     ParseResult const& result) {
+  // Interned values are recorded in the order the lexer first encountered
+  // them, so that interning them again reproduces the same tables.
+  std::array<std::vector<Interned>, InternedKinds.size()> interned;
+  std::array<std::string, InternedKinds.size()> text;
+  std::array<absl::flat_hash_set<uint32_t>, InternedKinds.size()> seen;
+  for (size_t i = 0; i < token_buffer.size(); ++i) {
+    Token::Kind kind = token_buffer.kind(i);
+    uint32_t payload = token_buffer.payload(i);
+    // Small integer literals are held directly in their payloads.
+    if (kind == Token::Kind::IntegerLiteral and
+        payload < TokenBuffer::InlineIntegerLimit) {
+      continue;
+    }
+    for (size_t k = 0; k < InternedKinds.size(); ++k) {
+      if (kind != InternedKinds[k]) { continue; }
+      if (not seen[k].insert(payload).second) { break; }
+      std::string_view value = InternedValue(source, token_buffer, i);
+      interned[k].push_back({.payload = payload,
+                             .size    = static_cast<uint32_t>(value.size())});
+      text[k].append(value);
+      break;
+    }
+  }
+
+  std::span nodes  = result.parse_tree.nodes();
+  std::span scopes = result.scope_tree.scopes();
+  Header header    = {
+      .magic       = Magic,
+      .format      = FormatFingerprint(),
+      .source_hash = SourceHash(source),
+      .source_size = source.size(),
+      .token_count = token_buffer.size(),
+      .node_count  = nodes.size(),
+      .scope_count = scopes.size(),
+      .text_size   = 0,
+  };
+  for (size_t k = 0; k < InternedKinds.size(); ++k) {
+    header.interned_count[k] = interned[k].size();
+    header.text_size += text[k].size();
+  }
+
+  std::optional file = CacheFileWriter::TryCreate(path);
+  if (not file) { return false; }
+  auto write = [&](void const* data, size_t size) { file->write(data, size); };
+  auto pad   = [&](size_t size) {
+    static constexpr char zeros[8] = {};
+    write(zeros, PaddedSize(size) - size);
+  };
+  write(&header, sizeof(header));
+  std::vector<uint32_t> offsets = token_buffer.offsets();
+  for (std::span<std::byte const> bytes :
+       {std::as_bytes(token_buffer.kinds()),
+        std::as_bytes(std::span<uint32_t const>(offsets)),
+        std::as_bytes(token_buffer.payloads())}) {
+    write(bytes.data(), bytes.size());
+    pad(bytes.size());
+  }
+  write(nodes.data(), nodes.size_bytes());
+  pad(nodes.size_bytes());
+  write(scopes.data(), scopes.size_bytes());
+  pad(scopes.size_bytes());
+  for (auto const& entries : interned) {
+    write(entries.data(), entries.size() * sizeof(Interned));
+  }
+  for (std::string const& t : text) { write(t.data(), t.size()); }
+  write(source.data(), source.size());
+  return file->Commit();
+}
+
+std::optional<ParseResult> ReadParseCache(
+    nth::file_path const& path, std::string_view source,
+    TokenBuffer& token_buffer, std::pmr::memory_resource* memory_resource) {
+  std::optional file = MappedFile::TryOpen(path);
+  if (not file) { return std::nullopt; }
+  std::string_view content = file->content();
+
+  Header header;
+  if (content.size() < sizeof(header)) { return std::nullopt; }
+  std::memcpy(&header, content.data(), sizeof(header));
+  if (header.magic != Magic or header.format != FormatFingerprint() or
+      header.source_size != source.size() or header.scope_count == 0 or
+      header.token_count == 0 or header.token_count > content.size() or
+      header.node_count > content.size() or
+      header.scope_count > content.size() or
+      header.text_size > content.size() or
+      header.source_size > content.size() or
+      FileSize(header) != content.size() or
+      header.source_hash != SourceHash(source) or
+      content.substr(content.size() - source.size()) != source) {
+    return std::nullopt;
+  }
+
+  // The mapping is page-aligned and every section begins at a multiple of
+  // eight bytes, so tokens, nodes and scopes may be copied directly out of it.
+  char const* position = content.data() + sizeof(header);
+  std::span kinds(reinterpret_cast<Token::Kind const*>(position),
+                  header.token_count);
+  position += PaddedSize(kinds.size_bytes());
+  std::span offsets(reinterpret_cast<uint32_t const*>(position),
+                    header.token_count);
+  position += PaddedSize(offsets.size_bytes());
+  std::span payloads(reinterpret_cast<uint32_t const*>(position),
+                     header.token_count);
+  position += PaddedSize(payloads.size_bytes());
+  std::span nodes(reinterpret_cast<ParseNode const*>(position),
+                  header.node_count);
+  position += PaddedSize(nodes.size_bytes());
+  std::span scopes(reinterpret_cast<LexicalScope const*>(position),
+                   header.scope_count);
+  position += PaddedSize(scopes.size_bytes());
+  std::array<std::span<Interned const>, InternedKinds.size()> interned;
+  for (size_t k = 0; k < InternedKinds.size(); ++k) {
+    interned[k] = std::span(reinterpret_cast<Interned const*>(position),
+                            header.interned_count[k]);
+    position += interned[k].size_bytes();
+  }
+  std::string_view text(position, header.text_size);
+
+  // Intern every recorded value, remembering only the payloads which differ
+  // from those recorded. In the common case there are none and the tokens are
+  // used exactly as they were written.
+  std::array<absl::flat_hash_map<uint32_t, uint32_t>, InternedKinds.size()>
+      moved;
+  for (size_t k = 0; k < InternedKinds.size(); ++k) {
+    for (auto [payload, size] : interned[k]) {
+      if (size > text.size()) { return std::nullopt; }
+      uint32_t current = Intern(InternedKinds[k], text.substr(0, size));
+      text.remove_prefix(size);
+      if (current != payload) { moved[k].emplace(payload, current); }
+    }
+  }
+  if (not text.empty()) { return std::nullopt; }
+
+  token_buffer.Assign(kinds, offsets, payloads);
+  for (size_t k = 0; k < InternedKinds.size(); ++k) {
+    if (moved[k].empty()) { continue; }
+    for (size_t i = 0; i < kinds.size(); ++i) {
+      if (kinds[i] != InternedKinds[k]) { continue; }
+      auto iter = moved[k].find(payloads[i]);
+      if (iter == moved[k].end()) { continue; }
+      token_buffer.set_payload(i, iter->second);
+    }
+  }
+  return ParseResult{
+      .parse_tree = ParseTree(token_buffer, nodes, memory_resource),
+      .scope_tree = LexicalScopeTree(scopes, memory_resource),
+  };
+}
+
+}  // namespace ic
@@ -0,0 +1,61 @@
+#ifndef ICARUS_PARSE_CACHE_H
+#define ICARUS_PARSE_CACHE_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+
+#include "common/cache_file.h"
+#include "lexer/token_buffer.h"
+#include "nth/io/file_path.h"
+#include "parse/parser.h"
+
+namespace ic {
+
+// A parse cache file holds the tokens, parse tree and lexical scope tree of a
+// source file, after declarations have been assigned to identifiers, so that a
+// later compilation of the byte-identical source may skip lexing, parsing, and
+// assigning declarations. Cache files are named by a hash of the source they
+// were written for, and record a copy of the source itself so that a stale or
+// colliding file is rejected rather than used: The hash is not collision
+// resistant, so it only serves to find the file and to reject most mismatches
+// cheaply.
+//
+// Tokens, nodes and scopes are stored in their in-memory representation and
+// copied out of the mapped file in bulk, so a cache file is only usable by a
+// compiler agreeing on the kinds of nodes and tokens; files written by any
+// other compiler are rejected. Identifier, string literal and integer literal
+// tokens hold indices into process-wide interning tables whose contents depend
+// on what else the process has interned (e.g., the exports of dependencies), so
+// the cache also records the value behind each such index. Reading a cache
+// interns those values in the order the lexer would have, and rewrites any
+// token whose index differs from the one recorded.
+
+// Returns the path of the cache file for `source` within `directory`.
+std::optional<nth::file_path> ParseCachePath(nth::file_path const& directory,
+                                             std::string_view source);
+
+// Writes the cache file at `path` for `source`, from which `token_buffer` was
+// lexed and `result` was parsed without diagnostics. The file is written in
+// full under a temporary name and then renamed, so that compilations sharing a
+// cache never observe a partially written file. Returns whether the file was
+// written.
+bool WriteParseCache(nth::file_path const& path, std::string_view source,
+                     TokenBuffer const& token_buffer,
+                     ParseResult const& result);
+
+// Returns the parse result stored in the cache file at `path`, allocated from
+// `memory_resource`, or `std::nullopt` if there is no such file or if it was
+// not written for `source` by this compiler. On success, `token_buffer` holds
+// the tokens of `source` (but not its line table), to which the nodes of the
+// returned parse tree refer; otherwise it is left unchanged.
+std::optional<ParseResult> ReadParseCache(
+    nth::file_path const& path, std::string_view source,
+    TokenBuffer& token_buffer,
+    std::pmr::memory_resource* memory_resource =
+        std::pmr::get_default_resource());
+
+}  // namespace ic
+
+#endif  // ICARUS_PARSE_CACHE_H
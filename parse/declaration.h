@@ -78,6 +78,8 @@ struct DeclarationKind {
   constexpr bool parameter() const { return data_ & uint8_t{8}; }
   constexpr bool addressable() const { return data_ & uint8_t{16}; }
 
+  friend constexpr bool operator==(DeclarationKind, DeclarationKind) = default;
+
  private:
   explicit constexpr DeclarationKind(uint8_t n) : data_(n) {}
 
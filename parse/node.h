@@ -1,6 +1,9 @@
 #ifndef ICARUS_PARSE_NODE_H
 #define ICARUS_PARSE_NODE_H
 
+#include <cstdint>
+#include <limits>
+
 #include "ir/lexical_scope.h"
 #include "lexer/token.h"
 #include "nth/strings/interpolate.h"
@@ -9,7 +12,11 @@
 
 namespace ic {
 
-// Represents a node in the parse tree. 
+// Represents a node in the parse tree. Every pass after parsing streams over
+// the nodes of the tree, so nodes are kept to 16 bytes: Rather than a copy of
+// its token, a node stores the index of its token in the module's
+// `TokenBuffer` (see `ParseTree::token`), and at most one index-sized field of
+// the union below is populated on any node.
 struct ParseNode {
   // Represents a category describing this parse tree node. Examples include
   // `IfStatement`, `Declaration` and `Import`. Note that not all categories
@@ -24,14 +31,29 @@ struct ParseNode {
 #include "parse/node.xmacro.h"
   };
 
+  // The value of `token_index` for nodes which are not associated with any
+  // token.
+  static constexpr uint32_t NoToken = std::numeric_limits<uint32_t>::max();
+
   friend void NthPrint(auto &p, auto &f, ParseNode const &n) {
-    nth::Interpolate<"({}, size={}, {})">(p, f, n.kind, n.subtree_size,
-                                          n.token);
+    nth::Interpolate<"({}, size={}, token={})">(p, f, n.kind, n.subtree_size,
+                                                n.token_index);
+  }
+
+  // Populated only on `DeclarationStart` nodes.
+  DeclarationInfo declaration_info() const {
+    return {.index = declaration_index, .kind = declaration_kind};
+  }
+  void set_declaration_info(DeclarationInfo const &info) {
+    declaration_index = info.index;
+    declaration_kind  = info.kind;
   }
 
   Kind kind;
-  // Note: This field may not be populated on all node kinds.
-  int16_t child_count = -1;
+  // The kind of the declaration started by a `DeclarationStart` node. It is
+  // stored apart from `declaration_index` in what would otherwise be padding,
+  // so that the union below need only be as large as an index.
+  DeclarationKind declaration_kind;
 
   enum class StatementKind : uint8_t {
     Unknown,
@@ -44,16 +66,21 @@ struct ParseNode {
   union {
     struct {
     } unused = {};
+    // Note: This field is only populated on nodes whose children vary in
+    // number, such as `CallExpression`.
+    uint32_t child_count;
     ParseNodeIndex corresponding_statement_sequence;
     ParseNodeIndex corresponding_declaration_identifier;
     ParseNodeIndex corresponding_declaration;
+    // The scope opened by this node. The scope of a scope invocation is stored
+    // on its `ScopeBlockStart`.
     LexicalScope::Index scope_index;
-    DeclarationInfo declaration_info;
+    ParseNodeIndex declaration_index;
     StatementKind statement_kind;
   };
-  Token token = Token::Invalid();
+  uint32_t token_index = NoToken;
 };
-static_assert(sizeof(ParseNode) == 24);
+static_assert(sizeof(ParseNode) == 16);
 
 void NthPrint(auto &p, auto &, ParseNode::Kind k) {
   static constexpr std::array KindStrings{
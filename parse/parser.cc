@@ -1,11 +1,18 @@
 #include "parse/parser.h"
 
+#include <algorithm>
+#include <array>
 #include <concepts>
 #include <cstring>
+#include <memory_resource>
+#include <optional>
 #include <span>
+#include <thread>
+#include <vector>
 
 #include "common/debug.h"
 #include "diagnostics/consumer/consumer.h"
+#include "diagnostics/consumer/null.h"
 #include "nth/debug/debug.h"
 #include "parse/declaration.h"
 #include "parse/node_index.h"
@@ -17,19 +24,54 @@ namespace {
 
 struct Parser {
   explicit Parser(TokenBuffer const& token_buffer, LexicalScopeTree& scope_tree,
-                  diag::DiagnosticConsumer& diagnostic_consumer)
-      : iterator_(token_buffer.begin()),
+                  diag::DiagnosticConsumer& diagnostic_consumer,
+                  std::pmr::memory_resource* memory_resource =
+                      std::pmr::get_default_resource())
+      : state_(
+            {
+                {.kind = State::Kind::Module, .subtree_start = 0},
+                {.kind = State::Kind::Newlines, .subtree_start = 0},
+            },
+            memory_resource),
         token_buffer_(token_buffer),
+        kinds_(token_buffer.kinds()),
         scope_tree_(scope_tree),
         diagnostic_consumer_(diagnostic_consumer) {}
 
   Token current_token() const {
-    NTH_REQUIRE((v.debug), iterator_ != token_buffer_.end());
-    return *iterator_;
+    NTH_REQUIRE((v.debug), index_ < token_buffer_.size());
+    return token_buffer_[index_];
+  }
+
+  // Returns the kind of the current token. Prefer this to
+  // `current_token().kind()`, which must also gather the token's offset and
+  // payload from their own arrays.
+  Token::Kind current_kind() const {
+    NTH_REQUIRE((v.debug), index_ < kinds_.size());
+    return kinds_[index_];
   }
 
   void ForceCompleteParsing() { state_.clear(); }
 
+  // Reserves enough space on the state stack to parse tokens whose brackets
+  // are nested at most `nesting` deep without reallocating in the common case.
+  void ReserveStates(size_t nesting) {
+    state_.reserve(UnnestedStates + StatesPerNestingLevel * nesting);
+  }
+
+  // Configures the parser to parse only the top-level statements whose tokens
+  // have indices in `[begin, end)`, rather than an entire module. Both `begin`
+  // and `end` must be the indices of the first token of a top-level statement
+  // (or of the end-of-file token). The resulting nodes are exactly those which
+  // parsing the entire module would produce for these statements, except that
+  // node and scope indices are numbered as if the statements were the only
+  // ones in the module.
+  void RestrictToSegment(size_t begin, size_t end) {
+    index_ = begin;
+    end_   = end;
+    state_ = {{.kind = State::Kind::SubsequentStatementSequence}};
+  }
+
   struct State {
     enum class Kind {
 #define IC_XMACRO_PARSER_STATE(state) state,
@@ -48,7 +90,7 @@ struct Parser {
 
     Kind kind;
     Precedence ambient_precedence = Precedence::Loosest();
-    Token token;
+    uint32_t token_index   = ParseNode::NoToken;
     uint32_t subtree_start = -1;
 
     friend void NthPrint(auto& p, auto& f, State const& s) {
@@ -78,10 +120,7 @@ struct Parser {
   }
 
   void IgnoreAnyNewlines() {
-    while (current_token().kind() != Token::Kind::Eof and
-           current_token().kind() == Token::Kind::Newline) {
-      ++iterator_;
-    }
+    while (kinds_[index_] == Token::Kind::Newline) { ++index_; }
   }
 
   State Expression(ParseTree const& tree,
@@ -94,8 +133,8 @@ struct Parser {
   // Returns `true` if and only if the iterator is pointing to the start of a
   // named argument.
   bool NamedArgumentStart() const {
-    return iterator_->kind() == Token::Kind::Identifier and
-           (iterator_ + 1)->kind() == Token::Kind::Equal;
+    return kinds_[index_] == Token::Kind::Identifier and
+           kinds_[index_ + 1] == Token::Kind::Equal;
   }
 
   void ExpandState(auto... states) {
@@ -109,16 +148,16 @@ struct Parser {
                                                    State::Kind repeat_state,
                                                    ParseTree& tree) {
     IgnoreAnyNewlines();
-    if (current_token().kind() == Token::Kind::RightParen) {
+    if (current_kind() == Token::Kind::RightParen) {
       pop_and_discard_state();
       return;
-    } else if (current_token().kind() == Token::Kind::Comma) {
-      ++iterator_;
+    } else if (current_kind() == Token::Kind::Comma) {
+      ++index_;
       IgnoreAnyNewlines();
       ExpandState(State{.kind = one_state, .subtree_start = tree.size()},
                   repeat_state);
     } else {
-      NTH_UNREACHABLE("{}") <<= {current_token().kind()};
+      NTH_UNREACHABLE("{}") <<= {current_kind()};
     }
   }
 
@@ -157,10 +196,14 @@ struct Parser {
   }
   void ExpandStateImpl(State const&, State state) { state_.push_back(state); }
 
-  std::vector<State> state_ = {
-      {.kind = State::Kind::Module, .subtree_start = 0},
-      {.kind = State::Kind::Newlines, .subtree_start = 0},
-  };
+  // Estimates of the depth of the state stack: A top-level statement whose
+  // expression chains several operators needs about a dozen states, and each
+  // level of bracketed nesting (parentheses, calls, `if` bodies) adds three or
+  // four more.
+  static constexpr size_t UnnestedStates        = 16;
+  static constexpr size_t StatesPerNestingLevel = 4;
+
+  std::pmr::vector<State> state_;
 
   bool inside_function_declaration() const {
     return inside_function_declaration_.back();
@@ -176,9 +219,13 @@ struct Parser {
     inside_function_declaration_.push_back(b);
   }
 
-  TokenBuffer::const_iterator iterator_;
+  uint32_t index_ = 0;
+  // The index at which the top-level statement sequence ends, if parsing has
+  // been restricted to a segment of the module.
+  size_t end_ = -1;
 
   TokenBuffer const& token_buffer_;
+  std::span<Token::Kind const> kinds_;
   LexicalScopeTree& scope_tree_;
   std::vector<bool> inside_function_declaration_ = {false};
   std::vector<DeclarationKind> declaration_kinds_;
@@ -187,8 +234,50 @@ struct Parser {
   diag::DiagnosticConsumer& diagnostic_consumer_;
 };
 
+// The precedence group of each infix operator, indexed by the kind of the token
+// spelling the operator. Tokens which are not infix operators map to
+// `std::nullopt`.
+constexpr auto InfixPrecedence = [] {
+  std::array<std::optional<Precedence>, 256> table{};
+  table[static_cast<uint8_t>(Token::Kind::As)]   = Precedence::As();
+  table[static_cast<uint8_t>(Token::Kind::Star)] = Precedence::MultiplyDivide();
+#define IC_XMACRO_TOKEN_KIND_BINARY_OPERATOR(kind, symbol, precedence_group)   \
+  table[static_cast<uint8_t>(Token::Kind::kind)] =                             \
+      Precedence::precedence_group();
+#include "lexer/token_kind.xmacro.h"
+  return table;
+}();
+
+// Returns the maximum depth to which brackets are nested in `kinds`.
+size_t MaximumNesting(std::span<Token::Kind const> kinds) {
+  size_t depth = 0, maximum = 0;
+  for (Token::Kind kind : kinds) {
+    switch (kind) {
+#define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol) case Token::Kind::kind:
+#include "lexer/token_kind.xmacro.h"
+      maximum = std::max(maximum, ++depth);
+      break;
+#define IC_XMACRO_TOKEN_KIND_CLOSE(kind, symbol) case Token::Kind::kind:
+#include "lexer/token_kind.xmacro.h"
+      depth -= (depth != 0);
+      break;
+      default: break;
+    }
+  }
+  return maximum;
+}
+
+// Returns an estimate of the number of nodes in the parse tree of a module with
+// `token_count` tokens, used to reserve space in the tree up front. Most tokens
+// produce one node, and the nodes marking the starts of statements, scopes and
+// precedence groups outnumber tokens which produce none (newlines, brackets) by
+// at most about 15%.
+size_t EstimatedParseNodeCount(size_t token_count) {
+  return token_count + token_count / 4;
+}
+
 void CompleteSubExpression(ParseTree& tree, uint32_t subtree_start) {
-  tree.append(ParseNode::Kind::ExpressionPrecedenceGroup, Token::Invalid(),
+  tree.append(ParseNode::Kind::ExpressionPrecedenceGroup, ParseNode::NoToken,
               subtree_start);
   tree.set_back_child_count();
 }
@@ -202,55 +291,485 @@ struct DebugView {
   std::span<Parser::State const> state;
 };
 
-}  // namespace
-
-ParseResult Parse(TokenBuffer const& token_buffer,
-                  diag::DiagnosticConsumer& diagnostic_consumer) {
-  ParseResult result;
-  Parser p(token_buffer, result.scope_tree, diagnostic_consumer);
-
-  while (not p.state().empty()) {
-    if (result.parse_tree.size() != 0) {
-      NTH_REQUIRE((v.debug), result.parse_tree.back().subtree_size > 0);
+void Run(Parser& p, ParseTree& tree) {
+  auto trace = [&] {
+    if (tree.size() != 0) {
+      NTH_REQUIRE((v.debug), tree.back().subtree_size > 0);
     }
     NTH_LOG((v.when(debug::parser)), "{} {}:\n{}") <<=
         {p.current_token(), p.state().back().subtree_start,
          DebugView{.state = p.state()}};
+  };
+  if (p.state().empty()) { return; }
+
+#if defined(__GNUC__)
+  // Where labels-as-values are supported, the handler for each state jumps
+  // directly to the handler for the next state through a table indexed by its
+  // kind. Unlike a loop around a single `switch`, this gives each state its
+  // own indirect branch, so the branch predictor learns which states tend to
+  // follow which.
+  static void* const Handlers[] = {
+#define IC_XMACRO_PARSER_STATE(parser_state) &&Handle##parser_state,
+#include "parse/state.xmacro.h"
+  };
+  trace();
+  goto* Handlers[static_cast<size_t>(p.state().back().kind)];
+#define IC_XMACRO_PARSER_STATE(parser_state)                                   \
+  Handle##parser_state : p.Handle##parser_state(tree);                         \
+  if (p.state().empty()) { return; }                                           \
+  trace();                                                                     \
+  goto* Handlers[static_cast<size_t>(p.state().back().kind)];
+#include "parse/state.xmacro.h"
+#else
+  do {
+    trace();
     switch (p.state().back().kind) {
-#define IC_XMACRO_PARSER_STATE(state)                                          \
-  case Parser::State::Kind::state:                                             \
-    p.Handle##state(result.parse_tree);                                        \
+#define IC_XMACRO_PARSER_STATE(parser_state)                                   \
+  case Parser::State::Kind::parser_state:                                      \
+    p.Handle##parser_state(tree);                                              \
     break;
 #include "parse/state.xmacro.h"
     }
+  } while (not p.state().empty());
+#endif
+}
+
+// Returns the indices of the tokens at which the top-level statements of the
+// module may be split into `segment_count` segments of roughly equal numbers of
+// tokens. The first index is that of the first statement and the last is that
+// of the end-of-file token. Statement boundaries are found without parsing:
+// Outside of any brackets (which are skipped over via the index of their
+// matching close symbol), every newline ends a statement unless it is followed
+// by `else`. Returns an empty vector if some open symbol is never closed.
+std::vector<size_t> SegmentBoundaries(TokenBuffer const& token_buffer,
+                                      size_t segment_count) {
+  std::span kinds = token_buffer.kinds();
+  size_t target   = kinds.size() / segment_count;
+
+  size_t i = 0;
+  while (kinds[i] == Token::Kind::Newline) { ++i; }
+  std::vector<size_t> boundaries = {i};
+  while (kinds[i] != Token::Kind::Eof) {
+    switch (kinds[i]) {
+#define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol)                                \
+  case Token::Kind::kind: {                                                    \
+    size_t close = token_buffer.payload(i);                                    \
+    if (close <= i) { return {}; }                                             \
+    i = close + 1;                                                             \
+  } break;
+#include "lexer/token_kind.xmacro.h"
+      case Token::Kind::Newline: {
+        do { ++i; } while (kinds[i] == Token::Kind::Newline);
+        if (kinds[i] != Token::Kind::Else and kinds[i] != Token::Kind::Eof and
+            i - boundaries.back() >= target) {
+          boundaries.push_back(i);
+        }
+      } break;
+      default: ++i; break;
+    }
+  }
+  boundaries.push_back(i);
+  return boundaries;
+}
+
+// Returns whether nodes of kind `kind` store the index of the scope they open.
+bool StoresScopeIndex(ParseNode::Kind kind) {
+  switch (kind) {
+    case ParseNode::Kind::EnumLiteralStart:
+    case ParseNode::Kind::FunctionLiteralStart:
+    case ParseNode::Kind::IfStatementFalseBranchStart:
+    case ParseNode::Kind::IfStatementTrueBranchStart:
+    case ParseNode::Kind::InterfaceLiteralStart:
+    case ParseNode::Kind::ScopeBlockStart:
+    case ParseNode::Kind::ScopeLiteralStart:
+    case ParseNode::Kind::WhileLoopBodyStart: return true;
+    default: return false;
+  }
+}
+
+// Shifts the node indices and scope indices stored in `node`, which was parsed
+// as part of a segment, by `node_offset` and `scope_offset` respectively. This
+// must account for every field that the parser populates with an index.
+void Rebase(ParseNode& node, int32_t node_offset, uint32_t scope_offset) {
+  if (StoresScopeIndex(node.kind)) {
+    node.scope_index =
+        LexicalScope::Index(node.scope_index.value() + scope_offset);
+    return;
+  }
+  switch (node.kind) {
+    case ParseNode::Kind::ScopeStart:
+      node.corresponding_statement_sequence += node_offset;
+      break;
+    case ParseNode::Kind::DeclarationStart:
+      node.declaration_index += node_offset;
+      break;
+    default: break;
+  }
+}
+
+// Shifts the indices stored in `nodes`, which were parsed separately from the
+// tree now holding them, as `Rebase` does.
+void RebaseAll(std::span<ParseNode> nodes, int32_t node_offset,
+               uint32_t scope_offset) {
+  for (ParseNode& node : nodes) { Rebase(node, node_offset, scope_offset); }
+}
+
+// Appends the nodes which `HandleResolveStatementSequence` and
+// `HandleResolveModule` would append after the last top-level statement of a
+// module whose tree begins with `ModuleStart` and `ScopeStart` nodes.
+void AppendModuleEnd(ParseTree& tree, TokenBuffer const& token_buffer) {
+  tree[ParseNodeIndex(1)].corresponding_statement_sequence =
+      ParseNodeIndex(tree.size());
+  tree.append(ParseNode::Kind::StatementSequence, ParseNode::NoToken, 1);
+  tree.append(ParseNode::Kind::Module, token_buffer.size() - 1, 0);
+}
+
+// Parses the module in segments on separate threads, returning
+// `std::nullopt` if the module cannot be split or if any segment fails to
+// parse. In the latter case the module should be parsed serially so that
+// diagnostics are reported exactly as they otherwise would be. The resulting
+// trees are allocated from `memory_resource`, but as it need not support
+// concurrent allocation, the trees of individual segments are not.
+std::optional<ParseResult> ParseSegments(
+    TokenBuffer const& token_buffer, size_t segment_count,
+    std::pmr::memory_resource* memory_resource) {
+  std::vector<size_t> boundaries =
+      SegmentBoundaries(token_buffer, segment_count);
+  if (boundaries.size() < 3) { return std::nullopt; }
+
+  std::vector<ParseResult> segments(boundaries.size() - 1);
+  std::vector<diag::NullConsumer> consumers(segments.size());
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+      threads.emplace_back([&, i] {
+        Parser p(token_buffer, segments[i].scope_tree, consumers[i]);
+        p.RestrictToSegment(boundaries[i], boundaries[i + 1]);
+        p.ReserveStates(MaximumNesting(token_buffer.kinds().subspan(
+            boundaries[i], boundaries[i + 1] - boundaries[i])));
+        Run(p, segments[i].parse_tree);
+      });
+    }
+  }
+  for (auto const& consumer : consumers) {
+    if (consumer.count() != 0) { return std::nullopt; }
+  }
+
+  // Produces the same nodes as `HandleModule`, `HandleStatementSequence`,
+  // `HandleResolveStatementSequence` and `HandleResolveModule` would around the
+  // nodes of each segment.
+  ParseResult result = {
+      .parse_tree = ParseTree(token_buffer, memory_resource),
+      .scope_tree = LexicalScopeTree(memory_resource),
+  };
+  ParseTree& tree = result.parse_tree;
+  tree.reserve(EstimatedParseNodeCount(token_buffer.size()));
+  tree.append_leaf(ParseNode::Kind::ModuleStart, ParseNode::NoToken);
+  tree.append_leaf(ParseNode::Kind::ScopeStart, ParseNode::NoToken);
+  for (ParseResult const& segment : segments) {
+    int32_t node_offset = tree.size();
+    uint32_t scope_offset =
+        result.scope_tree.append_descendants(segment.scope_tree);
+    for (ParseNode const& node : segment.parse_tree.nodes()) {
+      tree.append(node);
+    }
+    RebaseAll(tree.nodes().subspan(node_offset), node_offset, scope_offset);
+  }
+  AppendModuleEnd(tree, token_buffer);
+  return result;
+}
+
+// Finds the boundaries between top-level statements in a token buffer to which
+// tokens are still being appended, by the same rule as `SegmentBoundaries`.
+// Because the matching close symbol of an open symbol may not yet have been
+// appended, brackets are skipped by tracking their depth rather than via their
+// payloads.
+struct StatementBoundaryScanner {
+  // Scans any tokens in `kinds` not yet scanned, and returns the index of the
+  // first token of the last top-level statement known to begin among them (or
+  // of the end-of-file token, once it is scanned), or `npos` if no statement
+  // is yet known to begin. A newline ending `kinds` does not end a statement
+  // until the token following it is known not to be `else`.
+  size_t Scan(std::span<Token::Kind const> kinds) {
+    for (; position_ < kinds.size(); ++position_) {
+      Token::Kind kind = kinds[position_];
+      if (after_newline_) {
+        if (kind == Token::Kind::Newline) { continue; }
+        after_newline_ = false;
+        if (kind != Token::Kind::Else) { boundary_ = position_; }
+      }
+      switch (kind) {
+#define IC_XMACRO_TOKEN_KIND_OPEN(kind, symbol) case Token::Kind::kind:
+#include "lexer/token_kind.xmacro.h"
+        ++depth_;
+        break;
+#define IC_XMACRO_TOKEN_KIND_CLOSE(kind, symbol) case Token::Kind::kind:
+#include "lexer/token_kind.xmacro.h"
+        depth_ -= (depth_ != 0);
+        break;
+        case Token::Kind::Newline: after_newline_ = (depth_ == 0); break;
+        case Token::Kind::Eof: return boundary_ = position_;
+        default: break;
+      }
+    }
+    return boundary_;
+  }
+
+  static constexpr size_t npos = -1;
+
+ private:
+  size_t position_    = 0;
+  size_t depth_       = 0;
+  size_t boundary_    = npos;
+  bool after_newline_ = true;
+};
+
+// Returns the index of the first scope opened by any of `nodes`, or `fallback`
+// if they open no scopes. Scopes are numbered in the order they are opened, and
+// the nodes storing their indices appear in the same order. (The index of the
+// body of a scope literal is not stored, but it is opened immediately after the
+// scope of the literal itself.)
+LexicalScope::Index FirstScope(std::span<ParseNode const> nodes,
+                               LexicalScope::Index fallback) {
+  for (ParseNode const& node : nodes) {
+    if (StoresScopeIndex(node.kind)) { return node.scope_index; }
+  }
+  return fallback;
+}
+
+// Returns the index of some token from which the top-level statement whose root
+// is `index` was parsed, or `std::nullopt` if none of its nodes store one.
+std::optional<uint32_t> StatementToken(ParseTree const& tree,
+                                       ParseNodeIndex index) {
+  for (ParseNode const& node : tree.subtree(index)) {
+    if (node.token_index != ParseNode::NoToken) { return node.token_index; }
+  }
+  return std::nullopt;
+}
+
+// Updates `result`, the result of parsing a module without diagnostics, to
+// reflect `edit`, returning `false` without modifying `result` if the
+// statements affected by the edit fail to parse or cannot be found. In that
+// case the module should be parsed from scratch so that diagnostics are
+// reported.
+//
+// The module is split into segments as `SegmentBoundaries` splits it, each
+// holding one or more top-level statements. Whether a segment begins at some
+// token depends only on that token, the one before it, and the tokens before
+// those, so the segments beginning before the first edited token begin at the
+// same tokens as they did before the edit. Likewise the segments beginning
+// after the last edited token are unchanged but for being shifted. Only the
+// segments in between are parsed, and their nodes and scopes replace those of
+// the same statements in `result`. Nodes of the statements which follow are
+// rebased and their token indices shifted in place.
+bool ReparseStatements(ParseResult& result, TokenBuffer const& token_buffer,
+                       TokenEdit const& edit) {
+  std::vector<size_t> boundaries =
+      SegmentBoundaries(token_buffer, token_buffer.size());
+  if (boundaries.empty()) { return false; }
+  auto last  = boundaries.end() - 1;
+  auto begin = std::lower_bound(boundaries.begin(), last, edit.first);
+  if (begin != boundaries.begin()) { --begin; }
+  auto end = std::upper_bound(begin, last, edit.new_end);
+
+  // The roots of the top-level statements of `result`, in order.
+  ParseTree const& old_tree = result.parse_tree;
+  std::span old_nodes       = old_tree.nodes();
+  if (old_nodes.size() < 4) { return false; }
+  std::vector<ParseNodeIndex> statements;
+  for (ParseNodeIndex index :
+       old_tree.child_indices(ParseNodeIndex(old_nodes.size() - 2))) {
+    if (old_nodes[index.value()].kind == ParseNode::Kind::ScopeStart) { break; }
+    statements.push_back(index);
+  }
+  std::reverse(statements.begin(), statements.end());
+
+  // Returns the index of the first node of the first statement in `result`
+  // parsed from tokens at or after the token at `token_index` (as numbered
+  // before the edit).
+  bool found = true;
+  auto first_node_at = [&](size_t token_index) -> size_t {
+    auto iter = std::partition_point(
+        statements.begin(), statements.end(), [&](ParseNodeIndex index) {
+          std::optional statement_token = StatementToken(old_tree, index);
+          found &= statement_token.has_value();
+          return statement_token.value_or(0) < token_index;
+        });
+    return iter == statements.end()
+               ? old_nodes.size() - 2
+               : old_tree.first_descendant_index(*iter).value();
+  };
+  // Statements before the first edited token are unchanged only if some
+  // segment begins before it.
+  size_t prefix_end   = *begin < edit.first ? first_node_at(*begin) : 2;
+  size_t suffix_begin = end == last ? old_nodes.size() - 2
+                                    : first_node_at(*end + edit.old_end -
+                                                    edit.new_end);
+  if (not found or prefix_end > suffix_begin) { return false; }
+
+  ParseResult middle;
+  if (begin != end) {
+    diag::NullConsumer consumer;
+    Parser p(token_buffer, middle.scope_tree, consumer);
+    p.RestrictToSegment(*begin, *end);
+    p.ReserveStates(
+        MaximumNesting(token_buffer.kinds().subspan(*begin, *end - *begin)));
+    Run(p, middle.parse_tree);
+    if (consumer.count() != 0) { return false; }
+  }
+
+  LexicalScope::Index suffix_scopes =
+      FirstScope(old_nodes.subspan(suffix_begin),
+                 LexicalScope::Index(result.scope_tree.size()));
+  LexicalScope::Index middle_scopes = FirstScope(
+      old_nodes.subspan(prefix_end, suffix_begin - prefix_end), suffix_scopes);
+
+  int32_t node_offset = prefix_end + middle.parse_tree.size() - suffix_begin;
+  uint32_t middle_scope_offset = result.scope_tree.replace_descendants(
+      middle_scopes, suffix_scopes, middle.scope_tree);
+  uint32_t scope_offset =
+      (middle.scope_tree.size() - 1) -
+      (suffix_scopes.value() - middle_scopes.value());
+  result.parse_tree.replace(ParseNodeIndex(prefix_end),
+                            ParseNodeIndex(suffix_begin),
+                            middle.parse_tree.nodes());
+
+  std::span nodes = result.parse_tree.nodes();
+  RebaseAll(nodes.subspan(prefix_end, middle.parse_tree.size()), prefix_end,
+            middle_scope_offset);
+  size_t suffix_start = prefix_end + middle.parse_tree.size();
+  std::span suffix = nodes.subspan(suffix_start, nodes.size() - 2 - suffix_start);
+  if (node_offset != 0 or scope_offset != 0) {
+    RebaseAll(suffix, node_offset, scope_offset);
+  }
+  if (edit.new_end != edit.old_end) {
+    uint32_t token_offset = edit.new_end - edit.old_end;
+    for (ParseNode& node : suffix) {
+      if (node.token_index != ParseNode::NoToken) {
+        node.token_index += token_offset;
+      }
+    }
+  }
+  // The trailing `StatementSequence` and `Module` nodes span every statement.
+  nodes[1].corresponding_statement_sequence = ParseNodeIndex(nodes.size() - 2);
+  nodes[nodes.size() - 1].token_index       = token_buffer.size() - 1;
+  nodes[nodes.size() - 2].subtree_size += node_offset;
+  nodes[nodes.size() - 1].subtree_size += node_offset;
+  return true;
+}
+
+}  // namespace
+
+ParseResult Parse(TokenBuffer const& token_buffer,
+                  diag::DiagnosticConsumer& diagnostic_consumer,
+                  ParseOptions const& options) {
+  size_t segment_count =
+      std::min<size_t>(std::max<uint32_t>(options.threads, 1),
+                       token_buffer.size() / options.minimum_segment_size + 1);
+  if (segment_count > 1) {
+    if (auto result = ParseSegments(token_buffer, segment_count,
+                                    options.memory_resource)) {
+      return *std::move(result);
+    }
+  }
+
+  ParseResult result = {
+      .parse_tree = ParseTree(token_buffer, options.memory_resource),
+      .scope_tree = LexicalScopeTree(options.memory_resource),
+  };
+  result.parse_tree.reserve(EstimatedParseNodeCount(token_buffer.size()));
+  Parser p(token_buffer, result.scope_tree, diagnostic_consumer,
+           options.memory_resource);
+  p.ReserveStates(MaximumNesting(token_buffer.kinds()));
+  Run(p, result.parse_tree);
+  return result;
+}
+
+std::optional<ParseResult> ParsePipelined(lex::PipelinedLexer& lexer,
+                                          ParseOptions const& options) {
+  TokenBuffer const& token_buffer = lexer.token_buffer();
+  ParseResult result              = {
+      .parse_tree = ParseTree(token_buffer, options.memory_resource),
+      .scope_tree = LexicalScopeTree(options.memory_resource),
+  };
+  ParseTree& tree = result.parse_tree;
+  // The lexer reserves space in the token buffer for an estimate of the number
+  // of tokens in the source, from which the number of nodes is estimated.
+  tree.reserve(EstimatedParseNodeCount(token_buffer.capacity()));
+  tree.append_leaf(ParseNode::Kind::ModuleStart, ParseNode::NoToken);
+  tree.append_leaf(ParseNode::Kind::ScopeStart, ParseNode::NoToken);
+
+  // Each time more tokens are appended, the statements which are now known to
+  // be complete are parsed as a segment. Segments are parsed in order on this
+  // thread, directly into the module's trees, so unlike those parsed by
+  // `ParseSegments` their nodes need no rebasing. A statement is only parsed
+  // once the token following it has been lexed, so the parser never looks
+  // beyond the tokens appended so far.
+  StatementBoundaryScanner scanner;
+  size_t begin = StatementBoundaryScanner::npos;
+  bool lexing  = true;
+  while (true) {
+    std::span kinds = token_buffer.kinds();
+    size_t end      = scanner.Scan(kinds);
+    if (end != StatementBoundaryScanner::npos and
+        begin == StatementBoundaryScanner::npos) {
+      begin = 0;
+      while (kinds[begin] == Token::Kind::Newline) { ++begin; }
+    }
+    if (end != begin) {
+      diag::NullConsumer consumer;
+      Parser p(token_buffer, result.scope_tree, consumer,
+               options.memory_resource);
+      p.RestrictToSegment(begin, end);
+      p.ReserveStates(MaximumNesting(kinds.subspan(begin, end - begin)));
+      Run(p, tree);
+      if (consumer.count() != 0) {
+        while (lexer.Advance()) {}
+        return std::nullopt;
+      }
+      begin = end;
+    }
+    if (not lexing) { break; }
+    lexing = lexer.Advance();
   }
+  AppendModuleEnd(tree, token_buffer);
   return result;
 }
 
+void Reparse(ParseResult& result, TokenBuffer const& token_buffer,
+             TokenEdit const& edit,
+             diag::DiagnosticConsumer& diagnostic_consumer,
+             ParseOptions const& options) {
+  if (not ReparseStatements(result, token_buffer, edit)) {
+    result = Parse(token_buffer, diagnostic_consumer, options);
+  }
+}
+
 void Parser::HandleNewlines(ParseTree& tree) {
   pop_and_discard_state();
   IgnoreAnyNewlines();
 }
 
 void Parser::HandleModule(ParseTree& tree) {
-  tree.append_leaf(ParseNode::Kind::ModuleStart, Token::Invalid());
+  tree.append_leaf(ParseNode::Kind::ModuleStart, ParseNode::NoToken);
   ExpandState(
       State{
           .kind               = State::Kind::StatementSequence,
           .ambient_precedence = Precedence::Loosest(),
-          .token              = *iterator_,
+          .token_index        = index_,
           .subtree_start      = tree.size(),
       },
       State::Kind::ResolveModule);
 }
 
 void Parser::HandleResolveModule(ParseTree& tree) {
-  tree.append(ParseNode::Kind::Module, current_token(), 0);
+  tree.append(ParseNode::Kind::Module, index_, 0);
   pop_and_discard_state();
 }
 
 void Parser::HandleDeclaration(ParseTree& tree) {
-  switch (current_token().kind()) {
+  switch (current_kind()) {
     case Token::Kind::Let:
       PushDeclaration();
       CurrentDeclaration().set_addressable(false);
@@ -260,7 +779,7 @@ void Parser::HandleDeclaration(ParseTree& tree) {
                       .kind          = State::Kind::ResolveDeclaration,
                       .subtree_start = tree.size(),
                   });
-      tree.append_leaf(ParseNode::Kind::DeclarationStart, *++iterator_);
+      tree.append_leaf(ParseNode::Kind::DeclarationStart, ++index_);
       break;
     case Token::Kind::Var:
       PushDeclaration();
@@ -271,7 +790,7 @@ void Parser::HandleDeclaration(ParseTree& tree) {
                       .kind          = State::Kind::ResolveDeclaration,
                       .subtree_start = tree.size(),
                   });
-      tree.append_leaf(ParseNode::Kind::DeclarationStart, *++iterator_);
+      tree.append_leaf(ParseNode::Kind::DeclarationStart, ++index_);
       break;
     default:
       diagnostic_consumer_.Consume({
@@ -285,7 +804,7 @@ void Parser::HandleDeclaration(ParseTree& tree) {
 
 void Parser::HandleColonToEndOfDeclaration(ParseTree& tree) {
   ParseNode::Kind node_kind;
-  switch (current_token().kind()) {
+  switch (current_kind()) {
     case Token::Kind::ColonColonEqual: {
       auto& cd = CurrentDeclaration();
       cd.set_explicit_type(false);
@@ -320,14 +839,14 @@ void Parser::HandleColonToEndOfDeclaration(ParseTree& tree) {
                       .subtree_start = state().back().subtree_start,
                   });
     } break;
-    default: NTH_UNIMPLEMENTED("{}") <<= {current_token().kind()};
+    default: NTH_UNIMPLEMENTED("{}") <<= {current_kind()};
   }
-  ++iterator_;
+  ++index_;
 }
 
 void Parser::HandleStatement(ParseTree& tree) {
-  tree.append_leaf(ParseNode::Kind::StatementStart, Token::Invalid());
-  switch (current_token().kind()) {
+  tree.append_leaf(ParseNode::Kind::StatementStart, ParseNode::NoToken);
+  switch (current_kind()) {
     case Token::Kind::Let:
       PushDeclaration();
       CurrentDeclaration().set_addressable(false);
@@ -341,7 +860,7 @@ void Parser::HandleStatement(ParseTree& tree) {
                       .kind          = State::Kind::ResolveStatement,
                       .subtree_start = tree.size() - 1,
                   });
-      tree.append_leaf(ParseNode::Kind::DeclarationStart, *++iterator_);
+      tree.append_leaf(ParseNode::Kind::DeclarationStart, ++index_);
       break;
     case Token::Kind::Var:
       PushDeclaration();
@@ -356,10 +875,10 @@ void Parser::HandleStatement(ParseTree& tree) {
                       .kind          = State::Kind::ResolveStatement,
                       .subtree_start = tree.size() - 1,
                   });
-      tree.append_leaf(ParseNode::Kind::DeclarationStart, *++iterator_);
+      tree.append_leaf(ParseNode::Kind::DeclarationStart, ++index_);
       break;
     case Token::Kind::Extend:
-      tree.append_leaf(ParseNode::Kind::ExtensionStart, *iterator_);
+      tree.append_leaf(ParseNode::Kind::ExtensionStart, index_);
       ExpandState(
           State{
               .kind               = State::Kind::Expression,
@@ -375,7 +894,7 @@ void Parser::HandleStatement(ParseTree& tree) {
               .kind          = State::Kind::ResolveStatement,
               .subtree_start = tree.size() - 2,
           });
-      ++iterator_;
+      ++index_;
       return;
     case Token::Kind::Return:
       tree.back().statement_kind = ParseNode::StatementKind::Return;
@@ -388,7 +907,7 @@ void Parser::HandleStatement(ParseTree& tree) {
                       .kind          = State::Kind::ResolveStatement,
                       .subtree_start = tree.size() - 1,
                   });
-      ++iterator_;
+      ++index_;
       break;
     case Token::Kind::If:
       tree.back().statement_kind = ParseNode::StatementKind::Expression;
@@ -402,18 +921,18 @@ void Parser::HandleStatement(ParseTree& tree) {
           State{
               .kind               = State::Kind::ResolveIfStatement,
               .ambient_precedence = Precedence::Loosest(),
-              .token              = *iterator_,
+              .token_index        = index_,
               .subtree_start      = tree.size(),
           },
           State{
               .kind          = State::Kind::ResolveStatement,
               .subtree_start = tree.size() - 1,
           });
-      ++iterator_;
+      ++index_;
       return;
     case Token::Kind::While:
       tree.back().statement_kind = ParseNode::StatementKind::Expression;
-      tree.append_leaf(ParseNode::Kind::WhileLoopStart, *iterator_);
+      tree.append_leaf(ParseNode::Kind::WhileLoopStart, index_);
       ExpandState(
           State{
               .kind          = State::Kind::ParenthesizedExpression,
@@ -423,14 +942,14 @@ void Parser::HandleStatement(ParseTree& tree) {
           State{
               .kind               = State::Kind::ResolveWhileLoop,
               .ambient_precedence = Precedence::Loosest(),
-              .token              = *iterator_,
+              .token_index        = index_,
               .subtree_start      = tree.size() - 1,
           },
           State{
               .kind          = State::Kind::ResolveStatement,
               .subtree_start = tree.size() - 2,
           });
-      ++iterator_;
+      ++index_;
       return;
     default:
       // Statement kind defaults to an `Expression`, but may be changed to
@@ -452,19 +971,20 @@ void Parser::HandleStatement(ParseTree& tree) {
 void Parser::HandleResolveEnumLiteral(ParseTree& tree) {
   PopScope();
   auto state = pop_state();
-  tree.append(ParseNode::Kind::EnumLiteral, state.token, state.subtree_start);
+  tree.append(ParseNode::Kind::EnumLiteral, state.token_index,
+              state.subtree_start);
 }
 
 void Parser::HandleResolveInterfaceLiteral(ParseTree& tree) {
   PopScope();
   auto state = pop_state();
-  tree.append(ParseNode::Kind::InterfaceLiteral, state.token,
+  tree.append(ParseNode::Kind::InterfaceLiteral, state.token_index,
               state.subtree_start);
   tree.set_back_child_count();
 }
 
 void Parser::HandleWhileLoopBody(ParseTree& tree) {
-  tree.append_leaf(ParseNode::Kind::WhileLoopBodyStart, *iterator_);
+  tree.append_leaf(ParseNode::Kind::WhileLoopBodyStart, index_);
   tree.back().scope_index = PushScope();
   pop_and_discard_state();
 }
@@ -472,26 +992,29 @@ void Parser::HandleWhileLoopBody(ParseTree& tree) {
 void Parser::HandleResolveWhileLoop(ParseTree& tree) {
   PopScope();
   auto state = pop_state();
-  tree.append(ParseNode::Kind::WhileLoop, state.token, state.subtree_start);
+  tree.append(ParseNode::Kind::WhileLoop, state.token_index,
+              state.subtree_start);
 }
 
 void Parser::HandleIfStatementTrueBranchStart(ParseTree& tree) {
-  tree.append_leaf(ParseNode::Kind::IfStatementTrueBranchStart, *iterator_);
+  tree.append_leaf(ParseNode::Kind::IfStatementTrueBranchStart, index_);
   tree.back().scope_index = PushScope();
   pop_and_discard_state();
 }
 
 void Parser::HandleIfStatementTryElse(ParseTree& tree) {
-  PopScope();
   IgnoreAnyNewlines();
-  if (current_token().kind() == Token::Kind::Else) {
-    ++iterator_;
+  if (current_kind() == Token::Kind::Else) {
+    // The scope of the true branch is popped here only if it is replaced by
+    // that of the false branch. Otherwise, `ResolveIfStatement` pops it.
+    PopScope();
+    ++index_;
     IgnoreAnyNewlines();
-    tree.append_leaf(ParseNode::Kind::IfStatementFalseBranchStart, *iterator_);
+    tree.append_leaf(ParseNode::Kind::IfStatementFalseBranchStart, index_);
     tree.back().scope_index = PushScope();
-    if (current_token().kind() == Token::Kind::If) {
-      tree.append_leaf(ParseNode::Kind::ScopeStart, Token::Invalid());
-      tree.append_leaf(ParseNode::Kind::StatementStart, Token::Invalid());
+    if (current_kind() == Token::Kind::If) {
+      tree.append_leaf(ParseNode::Kind::ScopeStart, ParseNode::NoToken);
+      tree.append_leaf(ParseNode::Kind::StatementStart, ParseNode::NoToken);
       tree.back().statement_kind = ParseNode::StatementKind::Expression;
       ExpandState(
           State{
@@ -503,7 +1026,7 @@ void Parser::HandleIfStatementTryElse(ParseTree& tree) {
           State{
               .kind               = State::Kind::ResolveIfStatement,
               .ambient_precedence = Precedence::Loosest(),
-              .token              = *iterator_,
+              .token_index        = index_,
               .subtree_start      = tree.size(),
           },
           State{
@@ -514,7 +1037,7 @@ void Parser::HandleIfStatementTryElse(ParseTree& tree) {
               .kind          = State::Kind::ResolveStatementSequence,
               .subtree_start = tree.size() - 2,
           });
-      ++iterator_;
+      ++index_;
     } else {
       ExpandState(State{
           .kind          = State::Kind::BracedStatementSequence,
@@ -527,10 +1050,9 @@ void Parser::HandleIfStatementTryElse(ParseTree& tree) {
 }
 
 void Parser::HandleTryAssignment(ParseTree& tree) {
-  if (current_token().kind() == Token::Kind::Equal) {
-    ++iterator_;
-    tree.append(ParseNode::Kind::AssignedValueStart, current_token(),
-                tree.size());
+  if (current_kind() == Token::Kind::Equal) {
+    ++index_;
+    tree.append(ParseNode::Kind::AssignedValueStart, index_, tree.size());
     ExpandState(Expression(tree), State::Kind::ResolveAssignment);
   } else {
     pop_and_discard_state();
@@ -540,18 +1062,19 @@ void Parser::HandleTryAssignment(ParseTree& tree) {
 void Parser::HandleResolveIfStatement(ParseTree& tree) {
   PopScope();
   auto state = pop_state();
-  tree.append(ParseNode::Kind::IfStatement, state.token, state.subtree_start);
+  tree.append(ParseNode::Kind::IfStatement, state.token_index,
+              state.subtree_start);
 }
 
 void Parser::HandleParenthesizedExpression(ParseTree& tree) {
-  if (current_token().kind() == Token::Kind::LeftParen) {
-    ++iterator_;
+  if (current_kind() == Token::Kind::LeftParen) {
+    ++index_;
     IgnoreAnyNewlines();
-    if (current_token().kind() == Token::Kind::RightParen) {
+    if (current_kind() == Token::Kind::RightParen) {
       auto state = pop_state();
-      tree.append(ParseNode::Kind::EmptyParenthesis, state.token,
+      tree.append(ParseNode::Kind::EmptyParenthesis, state.token_index,
                   state.subtree_start);
-      ++iterator_;
+      ++index_;
       return;
     }
     ExpandState(Expression(tree), State::Kind::ClosingParenthesis);
@@ -561,8 +1084,8 @@ void Parser::HandleParenthesizedExpression(ParseTree& tree) {
 }
 
 void Parser::HandleBracedStatementSequence(ParseTree& tree) {
-  if (current_token().kind() == Token::Kind::LeftBrace) {
-    ++iterator_;
+  if (current_kind() == Token::Kind::LeftBrace) {
+    ++index_;
     IgnoreAnyNewlines();
     ExpandState(
         State{
@@ -572,20 +1095,20 @@ void Parser::HandleBracedStatementSequence(ParseTree& tree) {
         },
         State::Kind::ClosingBrace);
   } else {
-    NTH_UNIMPLEMENTED("{}") <<= {current_token().kind()};
+    NTH_UNIMPLEMENTED("{}") <<= {current_kind()};
   }
 }
 
 void Parser::HandleResolveStatement(ParseTree& tree) {
   State state = pop_state();
-  tree.append(ParseNode::Kind::Statement, Token::Invalid(),
+  tree.append(ParseNode::Kind::Statement, ParseNode::NoToken,
               state.subtree_start);
 }
 
 void Parser::HandleStatementSequence(ParseTree& tree) {
-  tree.append_leaf(ParseNode::Kind::ScopeStart, Token::Invalid());
-  if (current_token().kind() == Token::Kind::Eof or
-      current_token().kind() == Token::Kind::RightBrace) {
+  tree.append_leaf(ParseNode::Kind::ScopeStart, ParseNode::NoToken);
+  if (current_kind() == Token::Kind::Eof or
+      current_kind() == Token::Kind::RightBrace) {
     ExpandState(State::Kind::ResolveStatementSequence);
     return;
   }
@@ -596,8 +1119,8 @@ void Parser::HandleStatementSequence(ParseTree& tree) {
 }
 
 void Parser::HandleSubsequentStatementSequence(ParseTree& tree) {
-  if (current_token().kind() == Token::Kind::Eof or
-      current_token().kind() == Token::Kind::RightBrace) {
+  if (index_ == end_ or current_kind() == Token::Kind::Eof or
+      current_kind() == Token::Kind::RightBrace) {
     pop_and_discard_state();
     return;
   }
@@ -611,13 +1134,13 @@ void Parser::HandleResolveStatementSequence(ParseTree& tree) {
   auto& start = tree[ParseNodeIndex(state.subtree_start)];
   NTH_REQUIRE(start.kind == ParseNode::Kind::ScopeStart);
   start.corresponding_statement_sequence = ParseNodeIndex(tree.size());
-  tree.append(ParseNode::Kind::StatementSequence, Token::Invalid(),
+  tree.append(ParseNode::Kind::StatementSequence, ParseNode::NoToken,
               state.subtree_start);
 }
 
 void Parser::HandleBracedIdentifierSequence(ParseTree& tree) {
-  if (current_token().kind() == Token::Kind::LeftBrace) {
-    ++iterator_;
+  if (current_kind() == Token::Kind::LeftBrace) {
+    ++index_;
     IgnoreAnyNewlines();
     ExpandState(
         State{
@@ -627,13 +1150,13 @@ void Parser::HandleBracedIdentifierSequence(ParseTree& tree) {
         },
         State::Kind::ClosingBrace);
   } else {
-    NTH_UNIMPLEMENTED("{}") <<= {current_token().kind()};
+    NTH_UNIMPLEMENTED("{}") <<= {current_kind()};
   }
 }
 
 void Parser::HandleSubsequentIdentifierSequence(ParseTree& tree) {
-  if (current_token().kind() == Token::Kind::Eof or
-      current_token().kind() == Token::Kind::RightBrace) {
+  if (current_kind() == Token::Kind::Eof or
+      current_kind() == Token::Kind::RightBrace) {
     pop_and_discard_state();
     return;
   }
@@ -650,9 +1173,9 @@ void Parser::HandleResolveIdentifierSequence(ParseTree& tree) {
 }
 
 void Parser::HandleIdentifierSequence(ParseTree& tree) {
-  tree.append_leaf(ParseNode::Kind::ScopeStart, Token::Invalid());
-  if (current_token().kind() == Token::Kind::Eof or
-      current_token().kind() == Token::Kind::RightBrace) {
+  tree.append_leaf(ParseNode::Kind::ScopeStart, ParseNode::NoToken);
+  if (current_kind() == Token::Kind::Eof or
+      current_kind() == Token::Kind::RightBrace) {
     ExpandState(State::Kind::ResolveIdentifierSequence);
     return;
   }
@@ -663,9 +1186,9 @@ void Parser::HandleIdentifierSequence(ParseTree& tree) {
 }
 
 void Parser::HandleResolveUninferredTypeDeclaration(ParseTree& tree) {
-  switch (current_token().kind()) {
+  switch (current_kind()) {
     case Token::Kind::Equal:
-      ++iterator_;
+      ++index_;
       CurrentDeclaration().set_initializer(true);
       ExpandState(Expression(tree));
       break;
@@ -678,19 +1201,20 @@ void Parser::HandleResolveUninferredTypeDeclaration(ParseTree& tree) {
 
 void Parser::HandleResolveDeclaration(ParseTree& tree) {
   State state = pop_state();
-  tree.append(ParseNode::Kind::Declaration, state.token, state.subtree_start);
+  tree.append(ParseNode::Kind::Declaration, state.token_index,
+              state.subtree_start);
   ParseNodeIndex decl_index(tree.size() - 1);
   auto start_index = tree.subtree_range(decl_index).lower_bound();
-  tree[start_index].declaration_info = {
+  tree[start_index].set_declaration_info({
       .index = decl_index,
       .kind  = PopDeclaration(),
-  };
+  });
 }
 
 void Parser::HandleDeclaredSymbol(ParseTree& tree) {
-  NTH_REQUIRE((v.debug), current_token().kind() == Token::Kind::Identifier);
-  state()[state().size() - 4].token = current_token();
-  tree.append_leaf(ParseNode::Kind::DeclaredIdentifier, *iterator_++);
+  NTH_REQUIRE((v.debug), current_kind() == Token::Kind::Identifier);
+  state()[state().size() - 4].token_index = index_;
+  tree.append_leaf(ParseNode::Kind::DeclaredIdentifier, index_++);
   pop_and_discard_state();
 }
 
@@ -699,17 +1223,16 @@ void Parser::HandleExpression(ParseTree& tree) {
 }
 
 void Parser::HandleSuffixOfCall(ParseTree& tree) {
-  NTH_REQUIRE((v.debug), current_token().kind() == Token::Kind::LeftParen);
-  ++iterator_;
+  NTH_REQUIRE((v.debug), current_kind() == Token::Kind::LeftParen);
+  ++index_;
   IgnoreAnyNewlines();
-  tree.append(ParseNode::Kind::InvocationArgumentStart, current_token(),
-              tree.size());
+  tree.append(ParseNode::Kind::InvocationArgumentStart, index_, tree.size());
   ExpandState(State{.kind          = State::Kind::InvocationArgumentSequence,
                     .subtree_start = state().back().subtree_start});
-  if (current_token().kind() != Token::Kind::RightParen) {
+  if (current_kind() != Token::Kind::RightParen) {
     if (NamedArgumentStart()) {
-      tree.append_leaf(ParseNode::Kind::NamedArgumentStart, *iterator_);
-      iterator_ += 2;
+      tree.append_leaf(ParseNode::Kind::NamedArgumentStart, index_);
+      index_ += 2;
       push_state({.kind          = State::Kind::NamedArgument,
                   .subtree_start = tree.size() - 1});
     }
@@ -718,15 +1241,15 @@ void Parser::HandleSuffixOfCall(ParseTree& tree) {
 }
 
 void Parser::HandleTryTermSuffix(ParseTree& tree) {
-  switch (current_token().kind()) {
+  switch (current_kind()) {
     case Token::Kind::Period: 
-      ++iterator_;
+      ++index_;
       push_state({.kind          = State::Kind::ResolveMemberTerm,
                   .subtree_start = state().back().subtree_start});
       return;
     case Token::Kind::SingleQuote:
-      ++iterator_;
-      tree.append(ParseNode::Kind::PrefixInvocationArgumentEnd, current_token(),
+      ++index_;
+      tree.append(ParseNode::Kind::PrefixInvocationArgumentEnd, index_,
                   tree.size());
         push_state({.kind          = State::Kind::SuffixOfCall,
                   .subtree_start = state().back().subtree_start});
@@ -734,16 +1257,16 @@ void Parser::HandleTryTermSuffix(ParseTree& tree) {
                     .subtree_start = state().back().subtree_start});
         return;
     case Token::Kind::LeftParen:
-      ++iterator_;
+      ++index_;
       IgnoreAnyNewlines();
-      tree.append(ParseNode::Kind::InvocationArgumentStart, current_token(),
+      tree.append(ParseNode::Kind::InvocationArgumentStart, index_,
                   tree.size());
       push_state({.kind          = State::Kind::InvocationArgumentSequence,
                   .subtree_start = state().back().subtree_start});
-      if (current_token().kind() != Token::Kind::RightParen) {
+      if (current_kind() != Token::Kind::RightParen) {
         if (NamedArgumentStart()) {
-          tree.append_leaf(ParseNode::Kind::NamedArgumentStart, *iterator_);
-          iterator_ += 2;
+          tree.append_leaf(ParseNode::Kind::NamedArgumentStart, index_);
+          index_ += 2;
           push_state({.kind          = State::Kind::NamedArgument,
                       .subtree_start = tree.size() - 1});
         }
@@ -751,13 +1274,12 @@ void Parser::HandleTryTermSuffix(ParseTree& tree) {
       }
       return;
     case Token::Kind::LeftBracket:
-      ++iterator_;
+      ++index_;
       IgnoreAnyNewlines();
-      tree.append(ParseNode::Kind::IndexArgumentStart, current_token(),
-                  tree.size());
+      tree.append(ParseNode::Kind::IndexArgumentStart, index_, tree.size());
       push_state({.kind          = State::Kind::IndexArgumentSequence,
                   .subtree_start = state().back().subtree_start});
-      if (current_token().kind() != Token::Kind::RightBracket) {
+      if (current_kind() != Token::Kind::RightBracket) {
         push_state(Expression(tree));
       }
       return;
@@ -770,9 +1292,9 @@ void Parser::HandleTryTermSuffix(ParseTree& tree) {
         }
       }
       if (not in_fn) {
+        tree.append_leaf(ParseNode::Kind::ScopeBodyStart, index_);
+        tree.append_leaf(ParseNode::Kind::ScopeBlockStart, index_);
         tree.back().scope_index = PushScope();
-        tree.append_leaf(ParseNode::Kind::ScopeBodyStart, *iterator_);
-        tree.append_leaf(ParseNode::Kind::ScopeBlockStart, *iterator_);
         ExpandState(
             State{
                 .kind               = State::Kind::BracedStatementSequence,
@@ -782,13 +1304,13 @@ void Parser::HandleTryTermSuffix(ParseTree& tree) {
             State{
                 .kind               = State::Kind::ResolveScopeBlock,
                 .ambient_precedence = Precedence::Loosest(),
-                .token              = *iterator_,
+                .token_index        = index_,
                 .subtree_start      = tree.size() - 1,
             },
             State{
                 .kind               = State::Kind::ResolveScope,
                 .ambient_precedence = Precedence::Loosest(),
-                .token              = *iterator_,
+                .token_index        = index_,
                 .subtree_start      = state().back().subtree_start,
             });
       } else {
@@ -801,9 +1323,9 @@ void Parser::HandleTryTermSuffix(ParseTree& tree) {
 }
 
 void Parser::HandleExtensionWithToEnd(ParseTree& tree) {
-  if (current_token().kind() != Token::Kind::With) { NTH_UNIMPLEMENTED(); }
-  tree.append(ParseNode::Kind::ExtendWith, Token::Invalid(), tree.size());
-  ++iterator_;
+  if (current_kind() != Token::Kind::With) { NTH_UNIMPLEMENTED(); }
+  tree.append(ParseNode::Kind::ExtendWith, ParseNode::NoToken, tree.size());
+  ++index_;
   ExpandState(
       State{
           .kind               = State::Kind::ParenthesizedExpression,
@@ -823,20 +1345,21 @@ void Parser::HandleExtensionWithToEnd(ParseTree& tree) {
 }
 void Parser::HandleResolveExtension(ParseTree& tree) {
   auto state = pop_state();
-  tree.append(ParseNode::Kind::Extension, state.token, state.subtree_start);
+  tree.append(ParseNode::Kind::Extension, state.token_index,
+              state.subtree_start);
 }
 
 
 void Parser::HandleAtom(ParseTree& tree) {
   ParseNode::Kind k;
-  switch (current_token().kind()) {
+  switch (current_kind()) {
     case Token::Kind::Fn: {
       push_inside_function_decl(true);
-      tree.append_leaf(ParseNode::Kind::FunctionLiteralStart, *iterator_++);
+      tree.append_leaf(ParseNode::Kind::FunctionLiteralStart, index_++);
       tree.back().scope_index = PushScope();
-      if (iterator_->kind() != Token::Kind::LeftParen) { NTH_UNIMPLEMENTED(); }
-      ++iterator_;
-      if (iterator_->kind() == Token::Kind::RightParen) {
+      if (current_kind() != Token::Kind::LeftParen) { NTH_UNIMPLEMENTED(); }
+      ++index_;
+      if (current_kind() == Token::Kind::RightParen) {
         ExpandState(
             State{
                 .kind = State::Kind::FunctionLiteralReturnTypeStart,
@@ -872,9 +1395,9 @@ void Parser::HandleAtom(ParseTree& tree) {
       return;
     } break;
     case Token::Kind::Enum: {
-      tree.append_leaf(ParseNode::Kind::EnumLiteralStart, *iterator_++);
+      tree.append_leaf(ParseNode::Kind::EnumLiteralStart, index_++);
       tree.back().scope_index = PushScope();
-      if (iterator_->kind() != Token::Kind::LeftBrace) { NTH_UNIMPLEMENTED(); }
+      if (current_kind() != Token::Kind::LeftBrace) { NTH_UNIMPLEMENTED(); }
       ExpandState(
           State{
               .kind               = State::Kind::BracedIdentifierSequence,
@@ -889,15 +1412,15 @@ void Parser::HandleAtom(ParseTree& tree) {
       return;
     } break;
     case Token::Kind::Interface: {
-      tree.append_leaf(ParseNode::Kind::InterfaceLiteralStart, *iterator_++);
+      tree.append_leaf(ParseNode::Kind::InterfaceLiteralStart, index_++);
       tree.back().scope_index = PushScope();
-      if (iterator_->kind() != Token::Kind::LeftBracket) { NTH_UNIMPLEMENTED(); }
-      ++iterator_;
-      if (iterator_->kind() != Token::Kind::Identifier) { NTH_UNIMPLEMENTED(); }
-      ++iterator_;
-      if (iterator_->kind() != Token::Kind::RightBracket) { NTH_UNIMPLEMENTED(); }
-      ++iterator_;
-      if (iterator_->kind() != Token::Kind::LeftBrace) { NTH_UNIMPLEMENTED(); }
+      if (current_kind() != Token::Kind::LeftBracket) { NTH_UNIMPLEMENTED(); }
+      ++index_;
+      if (current_kind() != Token::Kind::Identifier) { NTH_UNIMPLEMENTED(); }
+      ++index_;
+      if (current_kind() != Token::Kind::RightBracket) { NTH_UNIMPLEMENTED(); }
+      ++index_;
+      if (current_kind() != Token::Kind::LeftBrace) { NTH_UNIMPLEMENTED(); }
       ExpandState(
           State{
               .kind               = State::Kind::BracedStatementSequence,
@@ -912,18 +1435,18 @@ void Parser::HandleAtom(ParseTree& tree) {
       return;
     } break;
     case Token::Kind::Scope: {
-      tree.append_leaf(ParseNode::Kind::ScopeLiteralStart, *iterator_++);
+      tree.append_leaf(ParseNode::Kind::ScopeLiteralStart, index_++);
       tree.back().scope_index = PushScope();
-      if (iterator_->kind() != Token::Kind::LeftBracket) {
+      if (current_kind() != Token::Kind::LeftBracket) {
         NTH_UNIMPLEMENTED();
       }
-      ++iterator_;
-      if (iterator_->kind() != Token::Kind::Identifier) { NTH_UNIMPLEMENTED(); }
-      tree.append_leaf(ParseNode::Kind::Identifier, *iterator_++);
-      if (iterator_->kind() != Token::Kind::RightBracket) {
+      ++index_;
+      if (current_kind() != Token::Kind::Identifier) { NTH_UNIMPLEMENTED(); }
+      tree.append_leaf(ParseNode::Kind::Identifier, index_++);
+      if (current_kind() != Token::Kind::RightBracket) {
         NTH_UNIMPLEMENTED();
       }
-      ++iterator_;
+      ++index_;
       PushScope();
       ExpandState(
           State{
@@ -939,11 +1462,11 @@ void Parser::HandleAtom(ParseTree& tree) {
       return;
     } break;
     case Token::Kind::LeftParen: {
-      size_t paren_gap      = iterator_->payload();
-      auto kind_after_paren = token_buffer_[paren_gap + 1].kind();
+      size_t paren_gap      = token_buffer_.payload(index_);
+      auto kind_after_paren = kinds_[paren_gap + 1];
       if (kind_after_paren == Token::Kind::MinusGreater) {
-        ++iterator_;
-        if (std::distance(token_buffer_.begin(), iterator_) == paren_gap) {
+        ++index_;
+        if (index_ == paren_gap) {
           ExpandState(State::Kind::ResolveFunctionTypeParameters);
         } else {
           ExpandState(State::Kind::Expression,
@@ -958,8 +1481,8 @@ void Parser::HandleAtom(ParseTree& tree) {
       return;
     } break;
     case Token::Kind::Backtick: {
-      ++iterator_;
-      if (iterator_->kind() != Token::Kind::Identifier) { NTH_UNIMPLEMENTED(); }
+      ++index_;
+      if (current_kind() != Token::Kind::Identifier) { NTH_UNIMPLEMENTED(); }
       k = ParseNode::Kind::Binding;
     } break;
     case Token::Kind::LeftBracket: {
@@ -974,16 +1497,16 @@ void Parser::HandleAtom(ParseTree& tree) {
     default: NTH_UNIMPLEMENTED("Token: {}") <<= {current_token()};
   }
 
-  tree.append_leaf(k, *iterator_++);
+  tree.append_leaf(k, index_++);
   pop_and_discard_state();
 }
 
 void Parser::HandleTryPrefix(ParseTree& tree) {
-  switch (current_token().kind()) {
+  switch (current_kind()) {
 #define IC_XMACRO_PARSE_NODE_PREFIX_UNARY(node, token, precedence)             \
   case Token::Kind::token:                                                     \
-    tree.append_leaf(ParseNode::Kind::node##Start, *iterator_);                \
-    ++iterator_;                                                               \
+    tree.append_leaf(ParseNode::Kind::node##Start, index_);           \
+    ++index_;                                                               \
     ExpandState(Expression(tree, Precedence::precedence()),                    \
                 State{                                                         \
                     .kind               = State::Kind::Resolve##node,          \
@@ -997,38 +1520,30 @@ void Parser::HandleTryPrefix(ParseTree& tree) {
 }
 
 void Parser::HandleTryInfix(ParseTree& tree) {
-  Precedence p = Precedence::Loosest();
-  switch (current_token().kind()) {
-    case Token::Kind::As: p = Precedence::As(); break;
-    case Token::Kind::Star: p = Precedence::MultiplyDivide(); break;
-#define IC_XMACRO_TOKEN_KIND_BINARY_OPERATOR(kind, symbol, precedence_group)   \
-  case Token::Kind::kind:                                                      \
-    p = Precedence::precedence_group();                                        \
-    break;
-
-#include "lexer/token_kind.xmacro.h"
-    default: {
-      auto state = pop_state();
-      if (tree.back().subtree_size + state.subtree_start != tree.size()) {
-        CompleteSubExpression(tree, state.subtree_start);
-      }
-      return;
+  std::optional precedence =
+      InfixPrecedence[static_cast<uint8_t>(current_kind())];
+  if (not precedence) {
+    auto state = pop_state();
+    if (tree.back().subtree_size + state.subtree_start != tree.size()) {
+      CompleteSubExpression(tree, state.subtree_start);
     }
+    return;
   }
 
+  Precedence p  = *precedence;
   auto state    = pop_state();
   auto priority = Precedence::Priority(state.ambient_precedence, p);
   NTH_LOG((v.when(debug::parser)), "Priority({}, {}) == {}") <<=
       {state.ambient_precedence, p, priority};
 
-  switch (Precedence::Priority(state.ambient_precedence, p)) {
+  switch (priority) {
     case Priority::Left: return;
    case Priority::Same:
-     tree.append_leaf(ParseNode::Kind::InfixOperator, *iterator_++);
+     tree.append_leaf(ParseNode::Kind::InfixOperator, index_++);
      push_state(Expression(tree, p));
      break;
     case Priority::Right:
-      tree.append_leaf(ParseNode::Kind::InfixOperator, *iterator_++);
+      tree.append_leaf(ParseNode::Kind::InfixOperator, index_++);
       push_state({
           .kind               = State::Kind::ResolveInfix,
           .ambient_precedence = p,
@@ -1056,8 +1571,8 @@ void Parser::HandleResolveInfix(ParseTree& tree) {
 
 void Parser::HandleClosingBrace(ParseTree& tree) {
   IgnoreAnyNewlines();
-  if (current_token().kind() == Token::Kind::RightBrace) {
-    ++iterator_;
+  if (current_kind() == Token::Kind::RightBrace) {
+    ++index_;
     pop_and_discard_state();
   } else {
     NTH_UNIMPLEMENTED();
@@ -1066,8 +1581,8 @@ void Parser::HandleClosingBrace(ParseTree& tree) {
 
 void Parser::HandleClosingParenthesis(ParseTree& tree) {
   IgnoreAnyNewlines();
-  if (current_token().kind() == Token::Kind::RightParen) {
-    ++iterator_;
+  if (current_kind() == Token::Kind::RightParen) {
+    ++index_;
     pop_and_discard_state();
   } else {
     NTH_UNIMPLEMENTED();
@@ -1076,34 +1591,34 @@ void Parser::HandleClosingParenthesis(ParseTree& tree) {
 
 void Parser::HandleIndexArgumentSequence(ParseTree& tree) {
   IgnoreAnyNewlines();
-  if (current_token().kind() == Token::Kind::RightBracket) {
+  if (current_kind() == Token::Kind::RightBracket) {
     ExpandState(State::Kind::ResolveIndexArgumentSequence);
     return;
-  } else if (current_token().kind() == Token::Kind::Comma) {
-    ++iterator_;
+  } else if (current_kind() == Token::Kind::Comma) {
+    ++index_;
     IgnoreAnyNewlines();
     ExpandState(Expression(tree), State::Kind::IndexArgumentSequence);
   } else {
-    NTH_UNREACHABLE("{}") <<= {current_token().kind()};
+    NTH_UNREACHABLE("{}") <<= {current_kind()};
   }
 }
 
 void Parser::HandleNamedArgument(ParseTree& tree) {
-  tree.append(ParseNode::Kind::NamedArgument, current_token(),
+  tree.append(ParseNode::Kind::NamedArgument, index_,
               pop_state().subtree_start);
 }
 
 void Parser::HandleInvocationArgumentSequence(ParseTree& tree) {
   IgnoreAnyNewlines();
-  if (current_token().kind() == Token::Kind::RightParen) {
+  if (current_kind() == Token::Kind::RightParen) {
     ExpandState(State::Kind::ResolveInvocationArgumentSequence);
     return;
-  } else if (current_token().kind() == Token::Kind::Comma) {
-    ++iterator_;
+  } else if (current_kind() == Token::Kind::Comma) {
+    ++index_;
     IgnoreAnyNewlines();
     if (NamedArgumentStart()) {
-      tree.append_leaf(ParseNode::Kind::NamedArgumentStart, *iterator_);
-      iterator_ += 2;
+      tree.append_leaf(ParseNode::Kind::NamedArgumentStart, index_);
+      index_ += 2;
       ExpandState(Expression(tree),
                   State{.kind          = State::Kind::NamedArgument,
                         .subtree_start = tree.size() - 1},
@@ -1112,7 +1627,7 @@ void Parser::HandleInvocationArgumentSequence(ParseTree& tree) {
       ExpandState(Expression(tree), State::Kind::InvocationArgumentSequence);
     }
   } else {
-    NTH_UNREACHABLE("{}") <<= {current_token().kind()};
+    NTH_UNREACHABLE("{}") <<= {current_kind()};
   }
 }
 
@@ -1129,34 +1644,35 @@ void Parser::HandleCommaSeparatedDeclarationSequence(ParseTree& tree) {
 }
 
 void Parser::HandleResolveFunctionTypeParameters(ParseTree& tree) {
-  tree.append(ParseNode::Kind::FunctionTypeParameters, current_token(),
+  tree.append(ParseNode::Kind::FunctionTypeParameters, index_,
               state().back().subtree_start);
   tree.set_back_child_count();
-  ++iterator_;
+  ++index_;
   pop_and_discard_state();
 }
 
 void Parser::HandleResolveFunctionLiteral(ParseTree& tree) {
-  tree.append(ParseNode::Kind::FunctionLiteral, current_token(),
+  PopScope();
+  tree.append(ParseNode::Kind::FunctionLiteral, index_,
               state().back().subtree_start);
   pop_and_discard_state();
 }
 
 void Parser::HandleFunctionLiteralReturnTypeStart(ParseTree& tree) {
-  NTH_REQUIRE((v.debug), current_token().kind() == Token::Kind::RightParen);
-  ++iterator_;
-  if (current_token().kind() != Token::Kind::MinusGreater) {
+  NTH_REQUIRE((v.debug), current_kind() == Token::Kind::RightParen);
+  ++index_;
+  if (current_kind() != Token::Kind::MinusGreater) {
     NTH_UNIMPLEMENTED();
   }
 
-  ++iterator_;
-  if (iterator_->kind() == Token::Kind::LeftParen) {
-    auto it = iterator_ + 1;
-    while (it->kind() == Token::Kind::Newline) { ++it; }
-    if (it->kind() == Token::Kind::RightParen) {
+  ++index_;
+  if (current_kind() == Token::Kind::LeftParen) {
+    size_t i = index_ + 1;
+    while (kinds_[i] == Token::Kind::Newline) { ++i; }
+    if (kinds_[i] == Token::Kind::RightParen) {
       pop_and_discard_state();
-      tree.append_leaf(ParseNode::Kind::NoReturns, *iterator_);
-      iterator_ = it + 1;
+      tree.append_leaf(ParseNode::Kind::NoReturns, index_);
+      index_ = i + 1;
     } else {
       ExpandState(State{
           .kind               = State::Kind::Expression,
@@ -1175,29 +1691,28 @@ void Parser::HandleFunctionLiteralReturnTypeStart(ParseTree& tree) {
 
 void Parser::HandleFunctionLiteralBody(ParseTree& tree) {
   pop_inside_function_decl();
-  tree.append(ParseNode::Kind::FunctionLiteralSignature, Token::Invalid(),
+  tree.append(ParseNode::Kind::FunctionLiteralSignature, ParseNode::NoToken,
               state().back().subtree_start);
   ExpandState(State{
       .kind               = State::Kind::BracedStatementSequence,
       .ambient_precedence = Precedence::Loosest(),
-      .token              = *iterator_,
+      .token_index        = index_,
       .subtree_start      = tree.size(),
   });
 }
 
 void Parser::HandleResolveMemberTerm(ParseTree& tree) {
-  if (current_token().kind() != Token::Kind::Identifier) {
+  if (current_kind() != Token::Kind::Identifier) {
     NTH_UNIMPLEMENTED("{}") <<= {current_token()};
   }
-  tree.append(ParseNode::Kind::MemberExpression, current_token(),
+  tree.append(ParseNode::Kind::MemberExpression, index_,
               state().back().subtree_start);
-  ++iterator_;
+  ++index_;
   pop_and_discard_state();
 }
 
 void Parser::HandleResolveReturn(ParseTree& tree) {
-  tree.append(ParseNode::Kind::Return, current_token(),
-              state().back().subtree_start);
+  tree.append(ParseNode::Kind::Return, index_, state().back().subtree_start);
   pop_and_discard_state();
 }
 
@@ -1208,49 +1723,47 @@ void Parser::HandleResolveAssignment(ParseTree& tree) {
       ParseNode::StatementKind::Assignment;
   // TODO: s.subtree_start - 1 seems like a bit of a hack and I'm not entirely
   // sure it's correct.
-  tree.append(ParseNode::Kind::Assignment, s.token, s.subtree_start);
+  tree.append(ParseNode::Kind::Assignment, s.token_index, s.subtree_start);
 }
 
 void Parser::HandleResolveInvocationArgumentSequence(ParseTree& tree) {
-  NTH_REQUIRE(current_token().kind() == Token::Kind::RightParen);
-  tree.append(ParseNode::Kind::CallExpression, current_token(),
+  NTH_REQUIRE(current_kind() == Token::Kind::RightParen);
+  tree.append(ParseNode::Kind::CallExpression, index_,
               state().back().subtree_start);
   tree.set_back_child_count();
-  ++iterator_;
+  ++index_;
   pop_and_discard_state();
 }
 
 void Parser::HandleResolveIndexArgumentSequence(ParseTree& tree) {
-  NTH_REQUIRE(current_token().kind() == Token::Kind::RightBracket);
-  tree.append(ParseNode::Kind::IndexExpression, current_token(),
+  NTH_REQUIRE(current_kind() == Token::Kind::RightBracket);
+  tree.append(ParseNode::Kind::IndexExpression, index_,
               state().back().subtree_start);
   tree.set_back_child_count();
-  ++iterator_;
+  ++index_;
   pop_and_discard_state();
 }
 
 void Parser::HandleResolveScopeBlock(ParseTree& tree) {
-  PopScope();
-  tree.append(ParseNode::Kind::ScopeBlock, current_token(),
-              pop_state().subtree_start);
+  tree.append(ParseNode::Kind::ScopeBlock, index_, pop_state().subtree_start);
 }
 
 void Parser::HandleResolveScope(ParseTree& tree) {
   PopScope();
-  tree.append(ParseNode::Kind::Scope, current_token(),
-              pop_state().subtree_start);
+  tree.append(ParseNode::Kind::Scope, index_, pop_state().subtree_start);
 }
 
 void Parser::HandleResolveScopeLiteral(ParseTree& tree) {
+  // Scope literals push two scopes: that of the literal and that of its body.
   PopScope();
-  tree.append(ParseNode::Kind::ScopeLiteral, current_token(),
-              pop_state().subtree_start);
+  PopScope();
+  tree.append(ParseNode::Kind::ScopeLiteral, index_, pop_state().subtree_start);
 }
 
 #define IC_XMACRO_PARSE_NODE_PREFIX_UNARY(node, unused_token,                  \
                                           unused_precedence)                   \
   void Parser::HandleResolve##node(ParseTree& tree) {                          \
-    tree.append(ParseNode::Kind::node, Token::Invalid(),                       \
+    tree.append(ParseNode::Kind::node, ParseNode::NoToken,                     \
                 pop_state().subtree_start);                                    \
   }
 #include "parse/node.xmacro.h"
@@ -1,8 +1,14 @@
 #ifndef ICARUS_PARSER_PARSER_H
 #define ICARUS_PARSER_PARSER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+
 #include "diagnostics/consumer/consumer.h"
 #include "ir/lexical_scope.h"
+#include "lexer/lexer.h"
 #include "lexer/token_buffer.h"
 #include "parse/tree.h"
 
@@ -13,8 +19,53 @@ struct ParseResult {
   LexicalScopeTree scope_tree;
 };
 
+struct ParseOptions {
+  // The maximum number of threads used to parse the module. When more than one
+  // thread is used, the top-level statements are split into segments which are
+  // parsed concurrently and then spliced together. The resulting parse and
+  // scope trees are identical to those produced by parsing on a single thread.
+  uint32_t threads = 1;
+
+  // Modules are not split into segments of fewer than this many tokens.
+  size_t minimum_segment_size = size_t{1} << 16;
+
+  // The memory resource from which the resulting parse and scope trees, and
+  // the parser's state stack, are allocated. Trees built by individual threads
+  // are always allocated from the default resource.
+  std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource();
+};
+
 ParseResult Parse(TokenBuffer const& token_buffer,
-                  diag::DiagnosticConsumer& diagnostic_consumer);
+                  diag::DiagnosticConsumer& diagnostic_consumer,
+                  ParseOptions const& options = {});
+
+// Parses the module whose tokens `lexer` appends to its token buffer,
+// concurrently with lexing: Each time a chunk of tokens is appended, the
+// top-level statements it completes are parsed, while the lexer moves on to the
+// next chunk on its own thread. The result is identical to that of `Parse` on
+// the complete token buffer. Returns `std::nullopt` if the module fails to
+// parse, once the entire source has been lexed. The module should then be
+// parsed with `Parse`, so that diagnostics are reported exactly as they
+// otherwise would be. `options.threads` and `options.minimum_segment_size` are
+// ignored.
+std::optional<ParseResult> ParsePipelined(lex::PipelinedLexer& lexer,
+                                          ParseOptions const& options = {});
+
+// Updates `result`, the result of parsing `token_buffer` before `edit` was
+// applied to it (for example, by `lex::Relex`), to be the result of parsing
+// `token_buffer` as it is now. Only the top-level statements overlapping the
+// edited tokens are parsed again, and their nodes and scopes are spliced into
+// `result` in place of the old ones; indices stored in the nodes of later
+// statements are shifted as needed. The result is identical to that of
+// `Parse`, which is used instead if the edited statements cannot be parsed on
+// their own. `result` must have been produced without diagnostics, and only
+// fields populated by the parser are kept up to date, so any later passes over
+// the tree must be repeated. `options.threads` and
+// `options.minimum_segment_size` only apply if the entire module is parsed.
+void Reparse(ParseResult& result, TokenBuffer const& token_buffer,
+             TokenEdit const& edit,
+             diag::DiagnosticConsumer& diagnostic_consumer,
+             ParseOptions const& options = {});
 
 }  // namespace ic
 
@@ -0,0 +1,197 @@
+// Measures parser throughput in tokens per second. By default a synthetic
+// source file resembling machine-generated Icarus code is parsed, but a path to
+// a source file may be passed as the sole argument instead.
+//
+// Alongside the full parse, a kind-only scan (counting newline tokens, as
+// `IgnoreAnyNewlines` does) is timed over both the array-of-structs token
+// layout (`std::vector<Token>`) and the struct-of-arrays layout used by
+// `TokenBuffer`, so the former row serves as the baseline for the latter.
+// Likewise, the serial parse serves as the baseline for the parallel parse,
+// which uses every available hardware thread. The reparse row measures
+// `Relex` and `Reparse` applying a single-line edit in the middle of the source,
+// reported as the rate at which tokens of the whole source are accounted for,
+// so that it may be compared directly with the full parse. Lexing followed by
+// parsing serves as the baseline for pipelined lexing and parsing, in which the
+// two overlap on separate threads.
+//
+// Finally, a suite of sources each stressing one shape of input is parsed:
+// deeply nested expressions (exercising the depth of the state stack), long
+// sequences of short statements (exercising state dispatch), and calls with
+// many arguments (exercising argument sequences).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "parse/parser.h"
+
+namespace ic {
+namespace {
+
+std::string SyntheticSource(size_t minimum_size) {
+  std::string source;
+  for (size_t i = 0; source.size() < minimum_size; ++i) {
+    source.append("// Generated declaration number ")
+        .append(std::to_string(i))
+        .append("\n")
+        .append("let generated_identifier_")
+        .append(std::to_string(i))
+        .append(" ::= some_function_name(argument.member, ")
+        .append(std::to_string(i * 7919))
+        .append(") + other_identifier * 3\n\n");
+  }
+  return source;
+}
+
+// Returns a source consisting of copies of `statement` with a total size of at
+// least `minimum_size` bytes.
+std::string Repeat(std::string_view statement, size_t minimum_size) {
+  std::string source;
+  while (source.size() < minimum_size) { source.append(statement); }
+  return source;
+}
+
+std::string DeepExpression(size_t depth) {
+  std::string statement = "x = ";
+  for (size_t i = 0; i < depth; ++i) {
+    statement.append(i % 2 == 0 ? "(a + " : "(b * ");
+  }
+  statement.append("c");
+  statement.append(depth, ')');
+  statement.append("\n");
+  return statement;
+}
+
+std::string WideCall(size_t width) {
+  std::string statement = "f(argument_0";
+  for (size_t i = 1; i < width; ++i) {
+    statement.append(", argument_").append(std::to_string(i));
+  }
+  statement.append(")\n");
+  return statement;
+}
+
+bool ReadFile(char const* path, std::string& content) {
+  std::FILE* file = std::fopen(path, "rb");
+  if (not file) { return false; }
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    content.append(buffer, n);
+  }
+  std::fclose(file);
+  return true;
+}
+
+constexpr int Iterations = 10;
+
+void Report(char const* name, size_t tokens, auto&& f) {
+  f();  // Warm up caches and the allocator before timing.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Iterations; ++i) { f(); }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::printf("%-24s %10.1f Mtokens/s\n", name,
+              tokens * Iterations / elapsed.count() / 1e6);
+}
+
+size_t CountNewlines(std::vector<Token> const& tokens) {
+  size_t count = 0;
+  for (Token token : tokens) { count += token.kind() == Token::Kind::Newline; }
+  return count;
+}
+
+size_t CountNewlines(TokenBuffer const& buffer) {
+  size_t count = 0;
+  for (Token::Kind kind : buffer.kinds()) {
+    count += kind == Token::Kind::Newline;
+  }
+  return count;
+}
+
+}  // namespace
+}  // namespace ic
+
+int main(int argc, char const* argv[]) {
+  std::string source;
+  if (argc > 1) {
+    if (not ic::ReadFile(argv[1], source)) {
+      std::fprintf(stderr, "Failed to read '%s'.\n", argv[1]);
+      return 1;
+    }
+  } else {
+    source = ic::SyntheticSource(32 << 20);
+  }
+
+  ic::diag::NullConsumer consumer;
+  ic::TokenBuffer buffer = ic::lex::Lex(source, consumer);
+  std::vector<ic::Token> tokens(buffer.begin(), buffer.end());
+  std::printf("%zu bytes, %zu tokens\n", source.size(), buffer.size());
+
+  // `volatile` keeps the scans from being optimized away.
+  volatile size_t sink;
+  ic::Report("kind scan (structs)", tokens.size(),
+             [&] { sink = ic::CountNewlines(tokens); });
+  ic::Report("kind scan (arrays)", buffer.size(),
+             [&] { sink = ic::CountNewlines(buffer); });
+  ic::Report("parse", buffer.size(), [&] { ic::Parse(buffer, consumer); });
+  uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+  ic::Report("parse (parallel)", buffer.size(),
+             [&] { ic::Parse(buffer, consumer, {.threads = threads}); });
+
+  // Alternately renames an identifier in the middle of the source and renames
+  // it back, so that every iteration applies a single-line edit.
+  size_t offset = source.find("let ", source.size() / 2) + 4;
+  std::string original(source.substr(offset, 9));
+  std::string renamed = "renamed_identifier";
+  std::string edited  = source.substr(0, offset) + renamed +
+                       source.substr(offset + original.size());
+  ic::TokenBuffer edit_buffer = ic::lex::Lex(source, consumer);
+  ic::ParseResult result      = ic::Parse(edit_buffer, consumer);
+  bool is_edited              = false;
+  ic::Report("reparse", edit_buffer.size(), [&] {
+    std::string_view before = is_edited ? edited : source;
+    std::string_view from   = is_edited ? renamed : original;
+    std::string_view to     = is_edited ? original : renamed;
+    ic::TokenEdit edit =
+        ic::lex::Relex(edit_buffer, before,
+                       {.offset      = static_cast<uint32_t>(offset),
+                        .length      = static_cast<uint32_t>(from.size()),
+                        .replacement = to},
+                       consumer);
+    ic::Reparse(result, edit_buffer, edit, consumer);
+    is_edited = not is_edited;
+  });
+  ic::Report("lex + parse", buffer.size(), [&] {
+    ic::Parse(ic::lex::Lex(source, consumer), consumer);
+  });
+  ic::Report("lex + parse (pipelined)", buffer.size(), [&] {
+    ic::TokenBuffer pipelined_buffer;
+    ic::lex::PipelinedLexer lexer(source, pipelined_buffer);
+    ic::ParsePipelined(lexer);
+  });
+  (void)sink;
+
+  std::printf("\n");
+  struct {
+    char const* name;
+    std::string statement;
+  } const suite[] = {
+      {.name = "deep expressions", .statement = ic::DeepExpression(64)},
+      {.name = "statement sequence", .statement = "a = b\n"},
+      {.name = "wide calls", .statement = ic::WideCall(256)},
+  };
+  for (auto const& [name, statement] : suite) {
+    std::string suite_source     = ic::Repeat(statement, 8 << 20);
+    ic::TokenBuffer suite_buffer = ic::lex::Lex(suite_source, consumer);
+    ic::Report(name, suite_buffer.size(),
+               [&] { ic::Parse(suite_buffer, consumer); });
+  }
+  return 0;
+}
@@ -1,9 +1,12 @@
 #ifndef ICARUS_PARSE_PRECEDENCE_H
 #define ICARUS_PARSE_PRECEDENCE_H
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <string_view>
+#include <utility>
 
 namespace ic {
 
@@ -37,7 +40,9 @@ struct Precedence {
 
   constexpr Kind kind() const { return kind_; }
 
-  static Priority Priority(Precedence lhs, Precedence rhs);
+  // Returns the relationship between the precedence groups `lhs` and `rhs`, as
+  // read from a table computed at compile-time.
+  static constexpr Priority Priority(Precedence lhs, Precedence rhs);
 
   friend bool operator==(Precedence, Precedence) = default;
   friend bool operator!=(Precedence, Precedence) = default;
@@ -62,6 +67,87 @@ struct Precedence {
   Kind kind_;
 };
 
+namespace internal_precedence {
+
+inline constexpr size_t PrecedenceGroupCount = (1  // For `Loosest`
+#define IC_XMACRO_PRECEDENCE_GROUP(group) +1
+#include "common/language/precedence.xmacro.h"
+);
+
+using PrecedenceTable = std::array<std::array<Priority, PrecedenceGroupCount>,
+                                   PrecedenceGroupCount>;
+
+// The table is generated from the orderings in `precedence.xmacro.h` by taking
+// their transitive closure, and then filling in the reverse relationships and
+// the diagonal. Pairs of groups which remain unrelated are ambiguous.
+inline constexpr PrecedenceTable Table = [] {
+  PrecedenceTable table;
+  auto entry = [&](Precedence lhs, Precedence rhs) -> Priority& {
+    return table[static_cast<int>(lhs.kind())][static_cast<int>(rhs.kind())];
+  };
+
+  // Initialize everything to be ambiguous.
+  for (auto& a : table) {
+    for (auto& p : a) { p = Priority::Ambiguous; }
+  }
+
+  // Loosest should be less than everything.
+#define IC_XMACRO_PRECEDENCE_GROUP(group)                                      \
+  entry(Precedence::Loosest(), Precedence::group()) = Priority::Right;
+#define IC_XMACRO_PRECEDENCE_ORDER(lower, higher)                              \
+  entry(Precedence::lower(), Precedence::higher()) = Priority::Right;
+#include "common/language/precedence.xmacro.h"
+
+  bool changed;
+  do {
+    changed = false;
+    for (size_t i = 0; i < PrecedenceGroupCount; ++i) {
+      for (size_t j = 0; j < PrecedenceGroupCount; ++j) {
+        if (table[i][j] != Priority::Right) { continue; }
+        for (size_t k = 0; k < PrecedenceGroupCount; ++k) {
+          if (table[j][k] == Priority::Right) {
+            changed |= (std::exchange(table[i][k], Priority::Right) !=
+                        Priority::Right);
+          }
+        }
+      }
+    }
+  } while (changed);
+
+  // Ensure symmetry.
+  for (size_t i = 0; i < PrecedenceGroupCount; ++i) {
+    for (size_t j = i + 1; j < PrecedenceGroupCount; ++j) {
+      if (table[i][j] == Priority::Right) {
+        table[j][i] = Priority::Left;
+      } else if (table[j][i] == Priority::Right) {
+        table[i][j] = Priority::Left;
+      }
+    }
+  }
+
+  // Initialize the diagonal
+  for (size_t i = 0; i < PrecedenceGroupCount; ++i) {
+    table[i][i] = Priority::Same;
+  }
+
+  return table;
+}();
+
+}  // namespace internal_precedence
+
+constexpr Priority Precedence::Priority(Precedence lhs, Precedence rhs) {
+  return internal_precedence::Table[static_cast<int>(lhs.kind())]
+                                   [static_cast<int>(rhs.kind())];
+}
+
+#define IC_XMACRO_PRECEDENCE_ORDER(lower, higher)                              \
+  static_assert(                                                               \
+      Precedence::Priority(Precedence::lower(), Precedence::higher()) ==       \
+          Priority::Right and                                                  \
+      Precedence::Priority(Precedence::higher(), Precedence::lower()) ==       \
+          Priority::Left);
+#include "common/language/precedence.xmacro.h"
+
 }  // namespace ic
 
 #endif  // ICARUS_PARSE_PRECEDENCE_H
@@ -1,3 +1,6 @@
+#include <string>
+#include <utility>
+
 #include "diagnostics/consumer/null.h"
 #include "lexer/lexer.h"
 #include "nth/test/test.h"
@@ -46,5 +49,60 @@ NTH_TEST("parser/parenthesized/newlines") {
                                    Statement(StatementStart(), Identifier()))));
 }
 
+NTH_TEST("parser/more-tokens-than-payload-limit") {
+  // Each line `a` contributes the same number of nodes, so the size of the
+  // parse tree for many lines can be extrapolated from that of a few.
+  auto parse_tree_size = [](uint32_t lines) {
+    std::string source;
+    for (uint32_t i = 0; i < lines; ++i) { source += "a\n"; }
+    // The parenthesized expression's closing parenthesis is located via the
+    // payload of its opening parenthesis, which does not fit in a `Token` when
+    // `lines` is large.
+    source += "(a)";
+    diag::NullConsumer d;
+    TokenBuffer buffer = lex::Lex(source, d);
+    return std::pair<size_t, uint32_t>(buffer.size(),
+                                       Parse(buffer, d).parse_tree.size());
+  };
+
+  auto [one_tokens, one_nodes] = parse_tree_size(1);
+  auto [two_tokens, two_nodes] = parse_tree_size(2);
+  uint32_t lines               = Token::PayloadLimit / 2;
+  auto [tokens, nodes]         = parse_tree_size(lines);
+  NTH_ASSERT(tokens > Token::PayloadLimit);
+  NTH_EXPECT(nodes == one_nodes + (lines - 1) * (two_nodes - one_nodes));
+}
+
+NTH_TEST("parser/node-tokens") {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(R"(f(a, 12))", d);
+  auto tree          = Parse(buffer, d).parse_tree;
+  for (uint32_t n = 0; n < tree.size(); ++n) {
+    ParseNodeIndex i(n);
+    uint32_t token_index = tree[i].token_index;
+    if (token_index == ParseNode::NoToken) {
+      NTH_EXPECT(tree.token(i) == Token::Invalid());
+    } else {
+      NTH_ASSERT(token_index < buffer.size());
+      NTH_EXPECT(tree.token(i) == buffer[token_index]);
+    }
+  }
+  NTH_EXPECT(tree.token(ParseNodeIndex(tree.size() - 1)).kind() ==
+             Token::Kind::Eof);
+}
+
+NTH_TEST("parser/more-children-than-int16") {
+  std::string source = "f(a";
+  for (int i = 0; i < 40000; ++i) { source += ", a"; }
+  source += ")";
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  auto tree          = Parse(buffer, d).parse_tree;
+  NTH_ASSERT(d.count() == 0);
+  ParseNodeIndex call(tree.size() - 4);
+  NTH_ASSERT(tree[call].kind == ParseNode::Kind::CallExpression);
+  NTH_EXPECT(tree[call].child_count > 40000);
+}
+
 }  // namespace
 }  // namespace ic
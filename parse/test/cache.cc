@@ -0,0 +1,133 @@
+#include "parse/cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+#include "parse/test/same_result.h"
+
+namespace ic {
+namespace {
+
+constexpr std::string_view Source = R"(let x ::= 3
+let s ::= "hello"
+f(x, s, 0x1_f, 12)
+if (x) {
+  g(s)
+} else {
+  h(0b101)
+}
+)";
+
+std::optional<nth::file_path> CacheDirectory() {
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "ic-parse-cache-test";
+  std::filesystem::create_directories(path);
+  return nth::file_path::try_construct(path.string());
+}
+
+NTH_TEST("parse-cache/round-trip") {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(Source, d);
+  ParseResult result = Parse(buffer, d);
+  NTH_ASSERT(d.count() == 0);
+
+  std::optional directory = CacheDirectory();
+  NTH_ASSERT(directory.has_value());
+  std::optional path = ParseCachePath(*directory, Source);
+  NTH_ASSERT(path.has_value());
+  NTH_ASSERT(WriteParseCache(*path, Source, buffer, result));
+
+  TokenBuffer cached_buffer;
+  std::optional cached = ReadParseCache(*path, Source, cached_buffer);
+  NTH_ASSERT(cached.has_value());
+  NTH_EXPECT(SameResult(*cached, result));
+  NTH_EXPECT(std::ranges::equal(cached_buffer.kinds(), buffer.kinds()));
+  NTH_EXPECT(std::ranges::equal(cached_buffer.offsets(), buffer.offsets()));
+  NTH_EXPECT(std::ranges::equal(cached_buffer.payloads(), buffer.payloads()));
+}
+
+NTH_TEST("parse-cache/large-integers") {
+  constexpr std::string_view Large =
+      "f(3, 9_000_000_000, 18446744073709551616, 3)\n";
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(Large, d);
+  ParseResult result = Parse(buffer, d);
+  NTH_ASSERT(d.count() == 0);
+
+  std::optional directory = CacheDirectory();
+  NTH_ASSERT(directory.has_value());
+  std::optional path = ParseCachePath(*directory, Large);
+  NTH_ASSERT(path.has_value());
+  NTH_ASSERT(WriteParseCache(*path, Large, buffer, result));
+
+  // Literals too large to be held in their payloads are stored again when read,
+  // so only their values, rather than their payloads, are preserved.
+  TokenBuffer cached_buffer;
+  std::optional cached = ReadParseCache(*path, Large, cached_buffer);
+  NTH_ASSERT(cached.has_value());
+  NTH_EXPECT(SameResult(*cached, result));
+  NTH_ASSERT(cached_buffer.size() == buffer.size());
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    if (buffer.kind(i) != Token::Kind::IntegerLiteral) { continue; }
+    NTH_EXPECT(cached_buffer.integer_literal(i) == buffer.integer_literal(i));
+  }
+}
+
+NTH_TEST("parse-cache/mismatch") {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(Source, d);
+  ParseResult result = Parse(buffer, d);
+  std::optional directory = CacheDirectory();
+  NTH_ASSERT(directory.has_value());
+  std::optional path = ParseCachePath(*directory, Source);
+  NTH_ASSERT(path.has_value());
+  NTH_ASSERT(WriteParseCache(*path, Source, buffer, result));
+
+  // A source of the same size differing in a single byte.
+  std::string edited(Source);
+  edited[4] = 'y';
+  NTH_EXPECT(ParseCachePath(*directory, edited)->path() != path->path());
+  TokenBuffer cached_buffer;
+  NTH_EXPECT(not ReadParseCache(*path, edited, cached_buffer).has_value());
+
+  // Were the hashes of the two sources to collide, the file would still be
+  // rejected. The hash is recorded immediately after the magic number and the
+  // format fingerprint.
+  {
+    uint64_t hash = SourceHash(edited);
+    std::fstream file(path->path(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(2 * sizeof(uint64_t));
+    file.write(reinterpret_cast<char const*>(&hash), sizeof(hash));
+  }
+  NTH_EXPECT(not ReadParseCache(*path, edited, cached_buffer).has_value());
+  NTH_EXPECT(not ReadParseCache(*path, Source, cached_buffer).has_value());
+  NTH_ASSERT(WriteParseCache(*path, Source, buffer, result));
+  NTH_EXPECT(ReadParseCache(*path, Source, cached_buffer).has_value());
+
+  std::filesystem::resize_file(path->path(),
+                               std::filesystem::file_size(path->path()) - 1);
+  NTH_EXPECT(not ReadParseCache(*path, Source, cached_buffer).has_value());
+
+  std::filesystem::remove(path->path());
+  NTH_EXPECT(not ReadParseCache(*path, Source, cached_buffer).has_value());
+}
+
+NTH_TEST("parse-cache/hash") {
+  NTH_EXPECT(SourceHash("") != SourceHash(std::string_view("\0", 1)));
+  NTH_EXPECT(SourceHash("abcdefgh") != SourceHash("abcdefgi"));
+  NTH_EXPECT(SourceHash("abcdefghi") != SourceHash("abcdefgh"));
+  NTH_EXPECT(SourceHash(Source) == SourceHash(std::string(Source)));
+}
+
+}  // namespace
+}  // namespace ic
@@ -0,0 +1,32 @@
+#ifndef ICARUS_PARSE_TEST_GENERATED_SOURCE_H
+#define ICARUS_PARSE_TEST_GENERATED_SOURCE_H
+
+#include <string>
+
+namespace ic {
+
+// Returns a source which parses without diagnostics, consisting of `count`
+// repetitions of statements exercising most of the grammar.
+inline std::string GeneratedSource(int count = 100) {
+  std::string source;
+  for (int i = 0; i < count; ++i) {
+    std::string n = std::to_string(i);
+    source += "let function_" + n + " ::= fn(let x: i64) -> i64 {\n";
+    source += "  if (x) {\n    return x\n  }\n  else {\n    return " + n +
+              "\n  }\n}\n\n";
+    source += "var value_" + n + ": i64 = (1 + " + n + ") * 3\n";
+    source += "let enum_" + n + " ::= enum {\n  A\n  B\n}\n";
+    source += "while (a) {\n  b = c[1, " + n + "]\n}\n";
+    source += "if (x) { y }\n\nelse if (z) { w }\n";
+    source += "f(a, b = c)\nloop {\n  x\n}\n";
+    source += "let scope_" + n + " ::= scope [ctx] {\n  x\n}\n";
+    source += "let interface_" + n +
+              " ::= interface [T] {\n  let f ::= 3\n}\n";
+    source += "extend a with (b) {\n  c\n}\n";
+  }
+  return source;
+}
+
+}  // namespace ic
+
+#endif  // ICARUS_PARSE_TEST_GENERATED_SOURCE_H
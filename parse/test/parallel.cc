@@ -0,0 +1,56 @@
+#include <string>
+#include <string_view>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+#include "parse/test/generated_source.h"
+#include "parse/test/same_result.h"
+
+namespace ic {
+namespace {
+
+NTH_TEST("parser/parallel", uint32_t threads) {
+  std::string source = GeneratedSource();
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  auto serial        = Parse(buffer, d);
+  auto parallel      = Parse(buffer, d,
+                             {.threads = threads, .minimum_segment_size = 1});
+  NTH_EXPECT(d.count() == 0);
+  NTH_EXPECT(SameResult(serial, parallel));
+}
+
+NTH_INVOKE_TEST("parser/parallel") {
+  for (uint32_t threads : {2, 3, 8, 64, 10000}) { co_yield threads; }
+}
+
+NTH_TEST("parser/parallel/small", std::string_view source) {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  auto serial        = Parse(buffer, d);
+  auto parallel =
+      Parse(buffer, d, {.threads = 8, .minimum_segment_size = 1});
+  NTH_EXPECT(SameResult(serial, parallel));
+}
+
+NTH_INVOKE_TEST("parser/parallel/small") {
+  co_yield std::string_view("");
+  co_yield std::string_view("\n\n");
+  co_yield std::string_view("a");
+  co_yield std::string_view("\n\na\n\nb\n\n");
+  co_yield std::string_view("if (a) {\n  b\n}\n\n\nelse {\n  c\n}\nd");
+}
+
+NTH_TEST("parser/parallel/error") {
+  // Diagnostics are reported exactly once, as they would be by a serial parse.
+  std::string source = "a\nb\nlet f ::= fn(x: i64) -> i64 { x }\nc\n";
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  Parse(buffer, d, {.threads = 8, .minimum_segment_size = 1});
+  NTH_EXPECT(d.count() == 1);
+}
+
+}  // namespace
+}  // namespace ic
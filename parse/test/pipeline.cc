@@ -0,0 +1,66 @@
+#include <string>
+#include <string_view>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+#include "parse/test/generated_source.h"
+#include "parse/test/same_result.h"
+
+namespace ic {
+namespace {
+
+NTH_TEST("parser/pipelined", size_t chunk_size) {
+  std::string source = GeneratedSource();
+  diag::NullConsumer d;
+  TokenBuffer expected_buffer = lex::Lex(source, d);
+  auto serial                 = Parse(expected_buffer, d);
+
+  TokenBuffer buffer;
+  lex::PipelinedLexer lexer(source, buffer, chunk_size);
+  auto pipelined = ParsePipelined(lexer);
+  NTH_ASSERT(pipelined.has_value());
+  NTH_EXPECT(buffer.size() == expected_buffer.size());
+  NTH_EXPECT(SameResult(serial, *pipelined));
+}
+
+NTH_INVOKE_TEST("parser/pipelined") {
+  for (size_t chunk_size : {1, 2, 7, 64, 4096, 1 << 20}) {
+    co_yield chunk_size;
+  }
+}
+
+NTH_TEST("parser/pipelined/split-brackets", std::string_view source) {
+  // Newlines within brackets do not end a statement, even when the brackets
+  // are lexed in separate chunks.
+  diag::NullConsumer d;
+  TokenBuffer expected_buffer = lex::Lex(source, d);
+  auto serial                 = Parse(expected_buffer, d);
+
+  TokenBuffer buffer;
+  lex::PipelinedLexer lexer(source, buffer, 1);
+  auto pipelined = ParsePipelined(lexer);
+  NTH_ASSERT(pipelined.has_value());
+  NTH_EXPECT(SameResult(serial, *pipelined));
+}
+
+NTH_INVOKE_TEST("parser/pipelined/split-brackets") {
+  co_yield std::string_view("f(a,\n  b)\ng(\n)\n");
+  co_yield std::string_view("a[\n  b]\nf(g(\n  c),\n  d)\n");
+}
+
+NTH_TEST("parser/pipelined/error") {
+  // The entire source is lexed after parsing fails, so that it may be parsed
+  // again to report diagnostics.
+  std::string source =
+      "let f ::= fn(x: i64) -> i64 { x }\n" + GeneratedSource(10);
+  TokenBuffer buffer;
+  lex::PipelinedLexer lexer(source, buffer, 1);
+  NTH_EXPECT(not ParsePipelined(lexer).has_value());
+  diag::NullConsumer d;
+  NTH_EXPECT(buffer.size() == lex::Lex(source, d).size());
+}
+
+}  // namespace
+}  // namespace ic
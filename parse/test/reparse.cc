@@ -0,0 +1,111 @@
+#include <string>
+#include <string_view>
+
+#include "diagnostics/consumer/null.h"
+#include "lexer/lexer.h"
+#include "nth/test/test.h"
+#include "parse/parser.h"
+#include "parse/test/generated_source.h"
+#include "parse/test/same_result.h"
+
+namespace ic {
+namespace {
+
+NTH_TEST("parser/reparse", std::string_view source, lex::SourceEdit edit) {
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  ParseResult result = Parse(buffer, d);
+  NTH_ASSERT(d.count() == 0);
+  TokenEdit token_edit = lex::Relex(buffer, source, edit, d);
+  Reparse(result, buffer, token_edit, d);
+  NTH_EXPECT(SameResult(result, Parse(buffer, d)));
+}
+
+NTH_INVOKE_TEST("parser/reparse") {
+  // Edits within a single statement.
+  co_yield nth::TestArguments{
+      "a\nb\nc\n",
+      lex::SourceEdit{.offset = 2, .length = 1, .replacement = "x + y"}};
+  co_yield nth::TestArguments{
+      "a\nb\nc", lex::SourceEdit{.offset = 4, .length = 1, .replacement = "d"}};
+  co_yield nth::TestArguments{
+      "\n\na\nb\n",
+      lex::SourceEdit{.offset = 0, .length = 1, .replacement = "\n\n"}};
+  // Edits adding, removing, and merging statements.
+  co_yield nth::TestArguments{
+      "a\nb\nc\n",
+      lex::SourceEdit{.offset = 2, .length = 0, .replacement = "x\ny\n"}};
+  co_yield nth::TestArguments{
+      "a\nb\nc\n", lex::SourceEdit{.offset = 2, .length = 2, .replacement = ""}};
+  co_yield nth::TestArguments{
+      "a\nb\nc\n",
+      lex::SourceEdit{.offset = 1, .length = 1, .replacement = " + "}};
+  // Edits changing how symbols are paired.
+  co_yield nth::TestArguments{
+      "f(a)\ng(b)\nh(c)\n",
+      lex::SourceEdit{.offset = 5, .length = 4, .replacement = "((b))"}};
+  co_yield nth::TestArguments{
+      "f(a)\ng(b)\nh(c)\n",
+      lex::SourceEdit{.offset = 3, .length = 5, .replacement = ", b"}};
+  // Edits to statements which open scopes, preceding statements which also
+  // open scopes.
+  co_yield nth::TestArguments{
+      "if (a) { b }\nwhile (c) { d }\nif (e) { f }\n",
+      lex::SourceEdit{.offset = 13, .length = 15, .replacement = "g"}};
+  co_yield nth::TestArguments{
+      "if (a) { b }\nx\nif (e) { f }\n",
+      lex::SourceEdit{.offset = 13, .length = 1, .replacement = "while (c) {}"}};
+  co_yield nth::TestArguments{
+      "if (a) { b }\nx\nif (e) { f }\n",
+      lex::SourceEdit{
+          .offset = 13, .length = 1, .replacement = "let s ::= scope [c] { d }"}};
+  // Edits attaching to and detaching from the preceding statement.
+  co_yield nth::TestArguments{
+      "if (a) { b }\nc { d }\n",
+      lex::SourceEdit{.offset = 13, .length = 1, .replacement = "else"}};
+  co_yield nth::TestArguments{
+      "if (a) { b }\nelse { d }\ne\n",
+      lex::SourceEdit{.offset = 13, .length = 4, .replacement = "c"}};
+  // Edits which fail to parse.
+  co_yield nth::TestArguments{
+      "a\nb\nc\n",
+      lex::SourceEdit{.offset      = 2,
+                      .length      = 1,
+                      .replacement = "let f ::= fn(x: i64) -> i64 { x }"}};
+}
+
+NTH_TEST("parser/reparse/generated") {
+  std::string source = GeneratedSource(10);
+  diag::NullConsumer d;
+  TokenBuffer buffer = lex::Lex(source, d);
+  ParseResult result = Parse(buffer, d);
+  NTH_ASSERT(d.count() == 0);
+
+  // Rename a declaration in the middle of the file and change the number of
+  // tokens in its initializer, repeatedly updating the same result.
+  size_t offset = source.find("value_5: i64 = (1 + 5)");
+  NTH_ASSERT(offset != std::string::npos);
+  std::string_view replacements[] = {
+      "renamed: i64 = (2 + 5)",
+      "value_5: i64 = (((1 + 5)))",
+      "value_5: i64 = (1 + 5)",
+  };
+  std::string_view current = "value_5: i64 = (1 + 5)";
+  for (std::string_view replacement : replacements) {
+    TokenEdit token_edit =
+        lex::Relex(buffer, source,
+                   {.offset      = static_cast<uint32_t>(offset),
+                    .length      = static_cast<uint32_t>(current.size()),
+                    .replacement = replacement},
+                   d);
+    source.replace(offset, current.size(), replacement);
+    current = replacement;
+
+    Reparse(result, buffer, token_edit, d);
+    NTH_EXPECT(d.count() == 0);
+    NTH_EXPECT(SameResult(result, Parse(buffer, d)));
+  }
+}
+
+}  // namespace
+}  // namespace ic
@@ -0,0 +1,58 @@
+#ifndef ICARUS_PARSE_TEST_SAME_RESULT_H
+#define ICARUS_PARSE_TEST_SAME_RESULT_H
+
+#include <cstddef>
+
+#include "parse/node.h"
+#include "parse/parser.h"
+
+namespace ic {
+
+// Returns whether `lhs` and `rhs` are identical, including every field of the
+// union in which the parser stores node and scope indices.
+inline bool SameNode(ParseNode const& lhs, ParseNode const& rhs) {
+  if (lhs.kind != rhs.kind or lhs.subtree_size != rhs.subtree_size or
+      lhs.token_index != rhs.token_index) {
+    return false;
+  }
+  switch (lhs.kind) {
+    case ParseNode::Kind::ScopeStart:
+      return lhs.corresponding_statement_sequence ==
+             rhs.corresponding_statement_sequence;
+    case ParseNode::Kind::DeclarationStart:
+      return lhs.declaration_index == rhs.declaration_index and
+             lhs.declaration_kind == rhs.declaration_kind;
+    case ParseNode::Kind::StatementStart:
+      return lhs.statement_kind == rhs.statement_kind;
+    case ParseNode::Kind::EnumLiteralStart:
+    case ParseNode::Kind::FunctionLiteralStart:
+    case ParseNode::Kind::IfStatementFalseBranchStart:
+    case ParseNode::Kind::IfStatementTrueBranchStart:
+    case ParseNode::Kind::InterfaceLiteralStart:
+    case ParseNode::Kind::ScopeBlockStart:
+    case ParseNode::Kind::ScopeLiteralStart:
+    case ParseNode::Kind::WhileLoopBodyStart:
+      return lhs.scope_index == rhs.scope_index;
+    case ParseNode::Kind::CallExpression:
+    case ParseNode::Kind::ExpressionPrecedenceGroup:
+    case ParseNode::Kind::FunctionTypeParameters:
+    case ParseNode::Kind::IndexExpression:
+    case ParseNode::Kind::InterfaceLiteral:
+      return lhs.child_count == rhs.child_count;
+    default: return true;
+  }
+}
+
+inline bool SameResult(ParseResult const& lhs, ParseResult const& rhs) {
+  auto l = lhs.parse_tree.nodes();
+  auto r = rhs.parse_tree.nodes();
+  if (l.size() != r.size()) { return false; }
+  for (size_t i = 0; i < l.size(); ++i) {
+    if (not SameNode(l[i], r[i])) { return false; }
+  }
+  return lhs.scope_tree == rhs.scope_tree;
+}
+
+}  // namespace ic
+
+#endif  // ICARUS_PARSE_TEST_SAME_RESULT_H
@@ -1,5 +1,7 @@
 #include "parse/tree.h"
 
+#include <algorithm>
+
 #include "nth/debug/debug.h"
 
 namespace ic {
@@ -35,13 +37,46 @@ std::span<ParseNode const> ParseTree::subtree(ParseNodeIndex node_index) const {
                                     &nodes_[upper.value()]);
 }
 
-void ParseTree::append(ParseNode::Kind kind, Token token, int subtree_start) {
+void ParseTree::append(ParseNode::Kind kind, uint32_t token_index,
+                       int subtree_start) {
   uint32_t size = static_cast<uint32_t>(nodes_.size() - subtree_start + 1);
-  nodes_.push_back({.kind = kind, .subtree_size = size, .token = token});
+  nodes_.push_back(
+      {.kind = kind, .subtree_size = size, .token_index = token_index});
+}
+
+Token ParseTree::token(ParseNodeIndex node_index) const {
+  uint32_t token_index = (*this)[node_index].token_index;
+  if (token_index == ParseNode::NoToken) { return Token::Invalid(); }
+  NTH_REQUIRE((v.debug), token_buffer_ != nullptr);
+  return (*token_buffer_)[token_index];
+}
+
+Identifier ParseTree::identifier(ParseNodeIndex node_index) const {
+  NTH_REQUIRE((v.debug), token_buffer_ != nullptr);
+  return token_buffer_->identifier((*this)[node_index].token_index);
+}
+
+uint32_t ParseTree::string_literal_index(ParseNodeIndex node_index) const {
+  NTH_REQUIRE((v.debug), token_buffer_ != nullptr);
+  return token_buffer_->string_literal_index((*this)[node_index].token_index);
+}
+
+void ParseTree::replace(ParseNodeIndex first, ParseNodeIndex last,
+                        std::span<ParseNode const> nodes) {
+  NTH_REQUIRE((v.harden), first <= last);
+  NTH_REQUIRE((v.harden), last.value() <= size());
+  auto position = nodes_.begin() + first.value();
+  size_t count  = last.value() - first.value();
+  if (count == nodes.size()) {
+    std::copy(nodes.begin(), nodes.end(), position);
+  } else {
+    position = nodes_.erase(position, position + count);
+    nodes_.insert(position, nodes.begin(), nodes.end());
+  }
 }
 
 void ParseTree::set_back_child_count() {
-  int16_t count = 0;
+  uint32_t count = 0;
   for (auto const& unused : child_indices(ParseNodeIndex(nodes_.size() - 1))) {
     ++count;
   }
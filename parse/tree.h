@@ -2,11 +2,16 @@
 #define ICARUS_PARSE_TREE_H
 
 #include <cstdint>
+#include <memory_resource>
 #include <span>
 #include <vector>
 
+#include "common/identifier.h"
 #include "lexer/token.h"
+#include "lexer/token_buffer.h"
+#include "nth/base/attributes.h"
 #include "nth/container/interval.h"
+#include "nth/debug/debug.h"
 #include "nth/utility/iterator_range.h"
 #include "parse/node.h"
 #include "parse/node_index.h"
@@ -24,12 +29,48 @@ struct ParseTree {
       nth::iterator_range<sibling_index_iterator, sibling_index_iterator>;
 
  public:
+  ParseTree() = default;
+
+  // Constructs an empty parse tree for the tokens of `token_buffer`, which
+  // must outlive it, whose nodes are allocated from `memory_resource`.
+  explicit ParseTree(
+      TokenBuffer const &token_buffer NTH_ATTRIBUTE(lifetimebound),
+      std::pmr::memory_resource *memory_resource)
+      : nodes_(memory_resource), token_buffer_(&token_buffer) {}
+
+  // Constructs a parse tree for the tokens of `token_buffer` consisting of
+  // copies of `nodes`, as returned by `nodes()` for some tree, allocated from
+  // `memory_resource`.
+  explicit ParseTree(
+      TokenBuffer const &token_buffer NTH_ATTRIBUTE(lifetimebound),
+      std::span<ParseNode const> nodes,
+      std::pmr::memory_resource *memory_resource)
+      : nodes_(nodes.begin(), nodes.end(), memory_resource),
+        token_buffer_(&token_buffer) {}
+
+  std::span<ParseNode> nodes() { return nodes_; }
   std::span<ParseNode const> nodes() const { return nodes_; }
   nth::interval<ParseNodeIndex> node_range() const {
     return nth::interval(ParseNodeIndex{0}, ParseNodeIndex(nodes_.size()));
   }
   uint32_t size() const { return nodes_.size(); }
 
+  // Returns the token from which the node at `node_index` was parsed, or
+  // `Token::Invalid()` if there is no such token.
+  Token token(ParseNodeIndex node_index) const;
+
+  // Returns the identifier held by the token from which the node at
+  // `node_index` was parsed, which must be an identifier. Unlike
+  // `token(node_index).Identifier()`, this does not depend on the identifier
+  // fitting in a `Token`.
+  Identifier identifier(ParseNodeIndex node_index) const;
+
+  // Returns the string literal index held by the token from which the node at
+  // `node_index` was parsed, which must be a string literal.
+  uint32_t string_literal_index(ParseNodeIndex node_index) const;
+
+  TokenBuffer const &token_buffer() const { return *token_buffer_; }
+
   std::span<ParseNode const> subtree(ParseNodeIndex node_index) const;
   nth::interval<ParseNodeIndex> subtree_range(ParseNodeIndex node_index) const;
 
@@ -44,16 +85,33 @@ struct ParseTree {
 
   ParseNodeIndex first_descendant_index(ParseNodeIndex node_index) const;
 
-  void append(ParseNode::Kind kind, Token token, int subtree_start);
+  void append(ParseNode::Kind kind, uint32_t token_index, int subtree_start);
 
-  void append_leaf(ParseNode::Kind kind, Token token) {
-    nodes_.push_back({.kind = kind, .subtree_size = 1, .token = token});
+  void append_leaf(ParseNode::Kind kind, uint32_t token_index) {
+    nodes_.push_back(
+        {.kind = kind, .subtree_size = 1, .token_index = token_index});
   }
 
+  // Appends a copy of `node`, whose subtree must consist of `node` along with
+  // nodes already in the tree.
+  void append(ParseNode const &node) {
+    NTH_REQUIRE((v.debug), node.subtree_size <= nodes_.size() + 1);
+    nodes_.push_back(node);
+  }
+
+  // Replaces the nodes with indices in `[first, last)` with copies of `nodes`.
+  // Indices stored in any node are left unchanged, so the caller is responsible
+  // for shifting those referring to nodes at or after `last`.
+  void replace(ParseNodeIndex first, ParseNodeIndex last,
+               std::span<ParseNode const> nodes);
+
   void set_back_child_count();
 
+  void reserve(size_t n) { nodes_.reserve(n); }
+
  private:
-  std::vector<ParseNode> nodes_;
+  std::pmr::vector<ParseNode> nodes_;
+  TokenBuffer const *token_buffer_ = nullptr;
 };
 
 struct ParseTree::sibling_iterator_base {
@@ -1,30 +1,37 @@
+#include <algorithm>
 #include <cstdio>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
 
 #include "absl/debugging/failure_signal_handler.h"
 #include "absl/debugging/symbolize.h"
+#include "common/arena.h"
 #include "common/debug.h"
 #include "common/errno.h"
+#include "common/mapped_file.h"
 #include "common/resources.h"
 #include "common/string.h"
 #include "common/to_bytes.h"
 #include "diagnostics/consumer/streaming.h"
 #include "diagnostics/message.h"
 #include "ir/declaration.h"
+#include "ir/dependency_graph.h"
 #include "ir/dependent_modules.h"
 #include "ir/deserialize.h"
 #include "ir/emit.h"
 #include "ir/ir.h"
 #include "ir/serialize.h"
+#include "ir/type_check_cache.h"
 #include "lexer/lexer.h"
 #include "nth/commandline/commandline.h"
 #include "nth/debug/log/log.h"
 #include "nth/io/file_path.h"
-#include "nth/io/reader/file.h"
 #include "nth/io/serialize/serialize.h"
 #include "nth/io/writer/string.h"
 #include "nth/process/exit_code.h"
+#include "parse/cache.h"
 #include "parse/parser.h"
 #include "toolchain/module_map.h"
 
@@ -46,6 +53,36 @@ nth::exit_code Compile(nth::FlagValueSet flags, nth::file_path const& source) {
   if (debug_type_check) { ic::debug::type_check = *debug_type_check; }
   if (debug_emit) { ic::debug::emit = *debug_emit; }
 
+  lex::LexOptions lex_options;
+  if (auto const* parallel_lex = flags.try_get<bool>("parallel-lex");
+      parallel_lex and *parallel_lex) {
+    lex_options.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  ParseOptions parse_options;
+  if (auto const* parallel_parse = flags.try_get<bool>("parallel-parse");
+      parallel_parse and *parallel_parse) {
+    parse_options.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  DeclarationOptions declaration_options;
+  if (auto const* parallel_resolve = flags.try_get<bool>("parallel-resolve");
+      parallel_resolve and *parallel_resolve) {
+    declaration_options.threads =
+        std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  ProcessIrOptions process_ir_options;
+  if (auto const* parallel_type_check =
+          flags.try_get<bool>("parallel-type-check");
+      parallel_type_check and *parallel_type_check) {
+    process_ir_options.threads =
+        std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  auto const* pipeline_lex_parse = flags.try_get<bool>("pipeline-lex-parse");
+  bool pipelined = pipeline_lex_parse and *pipeline_lex_parse;
+
   diag::StreamingConsumer consumer;
 
   std::optional dependencies = PopulateModuleMap(module_map_path, shared_context);
@@ -63,17 +100,10 @@ nth::exit_code Compile(nth::FlagValueSet flags, nth::file_path const& source) {
   StringLiteral::CompleteGeneration();
   ForeignFunction::CompleteGeneration();
 
-  std::optional reader = nth::io::file_reader::try_open(source);
-  if (not reader) {
-    consumer.Consume({
-        diag::Header(diag::MessageKind::Error),
-        diag::Text(
-            InterpolateString<"Failed to load the content from {}.">(source)),
-    });
-    return nth::exit_code::generic_error;
-  }
-  std::string content(reader->size(), '\0');
-  if (not reader->read(ToBytes(content))) {
+  // The source is mapped rather than copied into memory. It must outlive the
+  // diagnostic consumer's view of it as well as every stage below.
+  std::optional source_file = MappedFile::TryOpen(source);
+  if (not source_file) {
     consumer.Consume({
         diag::Header(diag::MessageKind::Error),
         diag::Text(
@@ -81,28 +111,88 @@ nth::exit_code Compile(nth::FlagValueSet flags, nth::file_path const& source) {
     });
     return nth::exit_code::generic_error;
   }
+  std::string_view content = source_file->content();
 
-  consumer.set_source(content);
+  // The token buffer, trees, and side tables built below are allocated from
+  // this arena and released together when compilation completes.
+  Arena arena(Arena::InitialSizeFor(content.size()));
+  lex_options.memory_resource         = &arena;
+  parse_options.memory_resource       = &arena;
+  declaration_options.memory_resource = &arena;
 
-  TokenBuffer token_buffer = lex::Lex(content, consumer);
-  if (consumer.count() != 0) { return nth::exit_code::generic_error; }
-  auto [parse_tree, scope_tree] = Parse(token_buffer, consumer);
-  if (consumer.count() != 0) { return nth::exit_code::generic_error; }
-  if (not AssignDeclarationsToIdentifiers(parse_tree, consumer)) {
-    return nth::exit_code::generic_error;
+  // A byte-identical source compiled before need not be lexed, parsed, or have
+  // its declarations assigned again if the results were cached.
+  std::optional<nth::file_path> cache_path;
+  if (auto const* cache_directory =
+          flags.try_get<nth::file_path>("parse-cache")) {
+    cache_path = ParseCachePath(*cache_directory, content);
+  }
+  TokenBuffer token_buffer(&arena);
+  std::optional<ParseResult> parse_result;
+  if (cache_path) {
+    parse_result = ReadParseCache(*cache_path, content, token_buffer, &arena);
+  }
+
+  if (parse_result) {
+    consumer.set_source(content);
+  } else {
+    if (pipelined) {
+      // Falls back to a serial parse below, which reports any diagnostics.
+      lex::PipelinedLexer lexer(content, token_buffer);
+      parse_result = ParsePipelined(lexer, parse_options);
+    } else {
+      token_buffer = lex::Lex(content, consumer, lex_options);
+    }
+    consumer.set_source(content, token_buffer.line_table());
+    if (consumer.count() != 0) { return nth::exit_code::generic_error; }
+    if (not parse_result) {
+      parse_result = Parse(token_buffer, consumer, parse_options);
+    }
+    if (consumer.count() != 0) { return nth::exit_code::generic_error; }
+    if (not AssignDeclarationsToIdentifiers(parse_result->parse_tree, consumer,
+                                            declaration_options)) {
+      return nth::exit_code::generic_error;
+    }
+    // Failing to write the cache only costs a later compilation time.
+    if (cache_path) {
+      WriteParseCache(*cache_path, content, token_buffer, *parse_result);
+    }
   }
+  auto& [parse_tree, scope_tree] = *parse_result;
   consumer.set_parse_tree(parse_tree);
 
   Module module;
-  EmitContext emit_context(parse_tree, *dependencies, scope_tree, module);
-  ProcessIr(emit_context, consumer);
+  EmitContext emit_context(parse_tree, *dependencies, scope_tree, module,
+                           &arena);
+  DependencyGraph dependency_graph(parse_tree, &arena);
+
+  // Top-level declarations unchanged since this source file was last compiled
+  // in the same environment need not be type-checked again.
+  std::optional<nth::file_path> type_check_cache_path;
+  std::optional<uint64_t> environment;
+  if (auto const* cache_directory =
+          flags.try_get<nth::file_path>("type-check-cache")) {
+    type_check_cache_path = TypeCheckCachePath(*cache_directory, source);
+    environment           = ModuleMapHash(module_map_path);
+  }
+  RestoredTypeCheck restored;
+  if (type_check_cache_path and environment) {
+    if (std::optional cache =
+            TypeCheckCache::Read(*type_check_cache_path, *environment)) {
+      restored = cache->Restore(content, dependency_graph, emit_context);
+      process_ir_options.restored = &restored;
+    }
+  }
+
+  ProcessIr(emit_context, dependency_graph, consumer, process_ir_options);
   if (consumer.count() != 0) { return nth::exit_code::generic_error; }
-  EmitContext::WorkItem item{
-      .range = parse_tree.node_range(),
-  };
-  item.push_function(module.insert_initializer(), LexicalScope::Index::Root());
-  emit_context.queue.push(std::move(item));
-  EmitIr(emit_context);
+  // Failing to write the cache only costs a later compilation time.
+  if (type_check_cache_path and environment) {
+    TypeCheckCache::Record(*environment, content, dependency_graph,
+                           emit_context)
+        .Write(*type_check_cache_path);
+  }
+  EmitModule(emit_context, dependency_graph, module.insert_initializer());
   SetExported(emit_context);
 
   std::string serialized_content;
@@ -167,6 +257,61 @@ nth::Usage const nth::program_usage = {
                 .description =
                     "Turns on debug information for the type-checker.",
             },
+            {
+                .name = {"parallel-lex"},
+                .type = nth::type<bool>,
+                .description =
+                    "Lexes large source files concurrently on all available "
+                    "hardware threads.",
+            },
+            {
+                .name = {"parallel-parse"},
+                .type = nth::type<bool>,
+                .description =
+                    "Parses the top-level statements of large source files "
+                    "concurrently on all available hardware threads.",
+            },
+            {
+                .name = {"parallel-resolve"},
+                .type = nth::type<bool>,
+                .description =
+                    "Resolves the identifiers within each top-level function "
+                    "literal concurrently on all available hardware threads.",
+            },
+            {
+                .name = {"parallel-type-check"},
+                .type = nth::type<bool>,
+                .description =
+                    "Type-checks declarations and statements which do not "
+                    "depend on one another concurrently on all available "
+                    "hardware threads.",
+            },
+            {
+                .name = {"pipeline-lex-parse"},
+                .type = nth::type<bool>,
+                .description =
+                    "Lexes source files on a separate thread, parsing each "
+                    "top-level statement as soon as it has been lexed. Takes "
+                    "precedence over --parallel-lex and --parallel-parse.",
+            },
+            {
+                .name = {"parse-cache"},
+                .type = nth::type<nth::file_path>,
+                .description =
+                    "A directory in which the parse results of each source "
+                    "file are cached, keyed by a hash of its contents. Sources "
+                    "found in the cache are not lexed or parsed again.",
+            },
+            {
+                .name = {"type-check-cache"},
+                .type = nth::type<nth::file_path>,
+                .description =
+                    "A directory in which the results of type-checking the "
+                    "top-level declarations of each source file are cached, "
+                    "keyed by its location. Declarations which, along with "
+                    "everything they depend on, are unchanged since the "
+                    "source was last compiled are not type-checked again.",
+            },
             {
                 .name = {"output"},
                 .type = nth::type<nth::file_path>,
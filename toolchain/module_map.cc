@@ -5,25 +5,24 @@
 #include <string_view>
 
 #include "absl/strings/str_split.h"
+#include "common/cache_file.h"
+#include "common/mapped_file.h"
 #include "common/resources.h"
 #include "ir/deserialize.h"
 #include "jasmin/core/function_registry.h"
 #include "nth/io/deserialize/deserialize.h"
-#include "nth/io/reader/file.h"
 #include "nth/io/reader/string.h"
 
 namespace ic {
 
 std::optional<DependentModules> PopulateModuleMap(
     nth::file_path const& module_map_file, SharedContext& context) {
-  std::optional reader = nth::io::file_reader::try_open(module_map_file);
-  if (not reader) { return std::nullopt; }
-
-  std::string content(reader->size(), '\0');
-  if (not reader->read(ToBytes(content))) { return std::nullopt; }
+  std::optional module_map = MappedFile::TryOpen(module_map_file);
+  if (not module_map) { return std::nullopt; }
 
   DependentModules dependent_modules;
-  for (std::string_view line : absl::StrSplit(content, absl::ByChar('\n'))) {
+  for (std::string_view line :
+       absl::StrSplit(module_map->content(), absl::ByChar('\n'))) {
     if (line.empty()) { continue; }
     size_t count = 0;
     std::string_view name, location;
@@ -40,18 +39,13 @@ std::optional<DependentModules> PopulateModuleMap(
     std::optional path = nth::file_path::try_construct(location);
     if (not path) { return std::nullopt; }
 
-    std::optional serialized_module_reader =
-        nth::io::file_reader::try_open(*path);
-    if (not serialized_module_reader) { return std::nullopt; }
-
-    std::string serialized_module_content(serialized_module_reader->size(), '\0');
-    if (not serialized_module_reader->read(
-            ToBytes(serialized_module_content))) {
-      return std::nullopt;
-    }
+    // Deserialization copies everything it needs out of the serialized
+    // module, so the mapping may be released at the end of this iteration.
+    std::optional serialized_module = MappedFile::TryOpen(*path);
+    if (not serialized_module) { return std::nullopt; }
 
     ModuleDeserializer<nth::io::string_reader> deserializer(
-        serialized_module_content, context);
+        serialized_module->content(), context);
     Result r = nth::io::deserialize(deserializer, dependent_modules.add(name));
     if (not r) { return std::nullopt; }
   }
@@ -59,4 +53,23 @@ std::optional<DependentModules> PopulateModuleMap(
   return dependent_modules;
 }
 
+std::optional<uint64_t> ModuleMapHash(nth::file_path const& module_map_file) {
+  std::optional module_map = MappedFile::TryOpen(module_map_file);
+  if (not module_map) { return std::nullopt; }
+
+  std::string description(module_map->content());
+  for (std::string_view line :
+       absl::StrSplit(module_map->content(), absl::ByChar('\n'))) {
+    if (line.empty()) { continue; }
+    std::string_view location = line.substr(line.find('\t') + 1);
+    std::optional path        = nth::file_path::try_construct(location);
+    if (not path) { return std::nullopt; }
+    std::optional serialized_module = MappedFile::TryOpen(*path);
+    if (not serialized_module) { return std::nullopt; }
+    description.append(std::to_string(SourceHash(serialized_module->content())))
+        .append("\n");
+  }
+  return SourceHash(description);
+}
+
 }  // namespace ic
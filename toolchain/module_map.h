@@ -1,6 +1,7 @@
 #ifndef ICARUS_TOOLCHAIN_MODULE_MAP_H
 #define ICARUS_TOOLCHAIN_MODULE_MAP_H
 
+#include <cstdint>
 #include <optional>
 
 #include "ir/dependent_modules.h"
@@ -12,6 +13,10 @@ namespace ic {
 std::optional<DependentModules> PopulateModuleMap(
     nth::file_path const& module_map_file, SharedContext& context);
 
+// Returns a hash of the contents of the module map at `module_map_file` and of
+// every module it names, or `std::nullopt` if any of them cannot be read.
+std::optional<uint64_t> ModuleMapHash(nth::file_path const& module_map_file);
+
 }  // namespace ic
 
 #endif // ICARUS_TOOLCHAIN_MODULE_MAP_H